@@ -1,5 +1,7 @@
 #include "android-application.hpp"
 
+#include <algorithm>
+
 #include <dynarmic/interface/A32/a32.h>
 #include <dynarmic/interface/A32/config.h>
 
@@ -8,9 +10,31 @@
 
 void AndroidApplication::init_jni() {
 	if (this->program_loader().has_symbol("JNI_OnLoad")) {
+		Silene::JniState::LocalFrame frame{this->jni()};
+
 		auto jvm_ptr = this->jni().get_vm_ptr();
 		_env.call_symbol<void>("JNI_OnLoad", jvm_ptr);
 	}
+
+	this->resolve_entry_points();
+}
+
+void AndroidApplication::resolve_entry_points() {
+	auto& loader = this->program_loader();
+
+	this->_entry_points = {
+		loader.get_symbol_addr("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeRender"),
+		loader.get_symbol_addr("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeTouchesBegin"),
+		loader.get_symbol_addr("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeTouchesEnd"),
+		loader.get_symbol_addr("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeTouchesMove"),
+		loader.get_symbol_addr("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeInsertText"),
+		loader.get_symbol_addr("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeDeleteBackward"),
+		loader.get_symbol_addr("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeKeyDown"),
+	};
+
+	if (this->_entry_points.render == 0) {
+		spdlog::error("game is missing nativeRender, nothing will be drawn");
+	}
 }
 
 void AndroidApplication::load_library(Elf::File& lib) {
@@ -37,6 +61,9 @@ void AndroidApplication::finalize_libraries() {
 }
 
 void AndroidApplication::init() {
+	// the thread calling init is the one that renders
+	_scheduler.register_render_thread(0);
+
 	this->init_memory();
 
 	if (_config.debug) {
@@ -45,9 +72,26 @@ void AndroidApplication::init() {
 }
 
 void AndroidApplication::create_processor_with_func(std::uint32_t start_addr, std::uint32_t arg, std::uint32_t id) {
+	_scheduler.register_thread(id);
+
 	auto& env = _envs.at(id);
 	env.current_cpu()->Regs()[0] = arg;
-	env.run_func(start_addr);
+
+	try {
+		env.run_func(start_addr);
+	} catch (const ThreadExit& exit) {
+		env.current_cpu()->Regs()[0] = exit.value;
+	}
+
+	// destructors are guest calls, so keep the return value safe for join
+	auto return_value = env.current_cpu()->Regs()[0];
+	this->libc().exit_thread(env);
+	env.current_cpu()->Regs()[0] = return_value;
+
+	// whatever locals the thread made outside of a frame go with it
+	this->jni().release_thread_refs();
+
+	_scheduler.unregister_thread();
 
 	{
 		// this processor is unneeded, so remove it ig
@@ -65,7 +109,8 @@ std::uint32_t AndroidApplication::create_thread(std::uint32_t start_addr, std::u
 	auto id = _last_tid++;
 
 	spdlog::info("creating thread with id {}", id);
-	_envs.try_emplace(id, *this, _state, &_monitor, id);
+	auto [it, _] = _envs.try_emplace(id, *this, _state, &_monitor, id);
+	it->second.init_tls();
 
 	// keep the thread alive so join/detach can be called on it
 	_unclaimed_threads.try_emplace(id, &AndroidApplication::create_processor_with_func, this, start_addr, arg, id);
@@ -99,7 +144,12 @@ bool AndroidApplication::join_thread(std::uint32_t thread_id, std::uint32_t exit
 	}
 
 	auto& thread = _unclaimed_threads.at(thread_id);
-	thread.join();
+
+	{
+		// the thread being joined may need the slot this one is holding
+		Scheduler::ParkGuard park{};
+		thread.join();
+	}
 
 	auto r_ptr = 0;
 	{
@@ -139,88 +189,291 @@ void AndroidApplication::init_memory() {
 
 	this->libc().pre_init(*this);
 	this->jni().pre_init(*this);
+
+	_env.init_tls();
 }
 
 void AndroidApplication::init_game(int width, int height) {
 	this->libc().expose_file("/application_resources.apk", _config.resources);
 
-	// first arg should be a jstring to the path
+	// the guest creates most of its objects during init, so the trace has to start before that
+	if (!_config.gl_trace.empty()) {
+		this->gl_trace().start(_config.gl_trace, _config.gl_trace_frames, width, height);
+	}
+
 	auto jni_env_ptr = this->jni().get_env_ptr();
-	auto path_string = this->jni().create_string_ref("/application_resources.apk");
 
-	if (this->program_loader().has_symbol("Java_org_cocos2dx_lib_Cocos2dxActivity_nativeSetPaths")) {
-		// this symbol was used on older versions of cocos (but are otherwise identical)
-		_env.call_symbol<void>("Java_org_cocos2dx_lib_Cocos2dxActivity_nativeSetPaths", jni_env_ptr, 0, path_string);
-	} else {
-		_env.call_symbol<void>("Java_org_cocos2dx_lib_Cocos2dxHelper_nativeSetApkPath", jni_env_ptr, 0, path_string);
+	{
+		// the path is a local of the call, so it goes away along with anything else the call made
+		Silene::JniState::LocalFrame frame{this->jni()};
+
+		// first arg should be a jstring to the path
+		auto path_string = this->jni().create_string_ref("/application_resources.apk", true);
+
+		if (this->program_loader().has_symbol("Java_org_cocos2dx_lib_Cocos2dxActivity_nativeSetPaths")) {
+			// this symbol was used on older versions of cocos (but are otherwise identical)
+			_env.call_symbol<void>("Java_org_cocos2dx_lib_Cocos2dxActivity_nativeSetPaths", jni_env_ptr, 0, path_string);
+		} else {
+			_env.call_symbol<void>("Java_org_cocos2dx_lib_Cocos2dxHelper_nativeSetApkPath", jni_env_ptr, 0, path_string);
+		}
 	}
 
-	this->jni().remove_ref(path_string);
+	{
+		Silene::JniState::LocalFrame frame{this->jni()};
+		_env.call_symbol<void>("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeInit", jni_env_ptr, 0, width, height);
+	}
 
-	_env.call_symbol<void>("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeInit", jni_env_ptr, 0, width, height);
 	spdlog::info("init finished");
 }
 
 AndroidApplication::AndroidApplication(ApplicationConfig config)
-	: StateHolder{_state}, _config{config}, _env{*this, _state, &_monitor, 0} {}
+	: StateHolder{_state}, _config{config}, _scheduler{config.worker_threads}, _env{*this, _state, &_monitor, 0} {
+	this->shader_cache().set_directory(config.shader_cache);
+
+	if (!config.frame_log.empty()) {
+		this->gl_stats().set_log_file(config.frame_log);
+	}
+
+	if (config.coalesce_draws) {
+		this->gl_streamer().enable_coalescing(this->gl_commands());
+	}
+
+	if (!config.record.empty()) {
+		this->replay_log().start_recording(config.record);
+	} else if (!config.replay.empty()) {
+		this->replay_log().start_replay(config.replay);
+	}
+}
 
 void AndroidApplication::draw_frame() {
-	auto jni_env_ptr = this->jni().get_env_ptr();
-	_env.call_symbol<void>("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeRender", jni_env_ptr, 0);
+	// recorded input is sent right before the frame it came before when it was recorded
+	for (const auto& record : this->replay_log().take_inputs(this->_frame)) {
+		this->replay_input(record);
+	}
+
+	// input handlers run guest code too, so whatever gl calls they made go before the frame
+	this->gl_batch().flush(_env);
+	this->gl_batch().begin_frame();
+
+	this->gl_trace().begin_frame();
+
+	// the frontend has had the context since the last frame
+	this->gl().begin_frame();
+	this->gl_commands().begin_frame();
+	this->frame_chain().begin_frame();
+	this->gl_streamer().begin_frame(_env);
+	this->texture_uploader().begin_frame(_env);
+
+	this->gl_stats().begin_frame(this->gl());
+
+	{
+		Silene::JniState::LocalFrame frame{this->jni()};
+
+		auto jni_env_ptr = this->jni().get_env_ptr();
+		if (this->_entry_points.render != 0) {
+			_env.call_function<void>(this->_entry_points.render, jni_env_ptr, 0);
+		}
+	}
+
+	// the frontend is about to draw over it, so the guest's frame has to be submitted by now
+	{
+		auto timer = this->gl_stats().time_driver();
+		this->gl_batch().flush(_env);
+		this->gl_commands().flush();
+	}
+
+	this->gl_stats().end_frame(this->gl());
+	this->frame_chain().end_frame();
+
+	this->gl_trace().end_frame();
+
+	this->_frame++;
 }
 
-void AndroidApplication::send_touch(bool is_push, TouchData data) {
+void AndroidApplication::deliver_touch(bool is_push, TouchData data) {
+	auto fn = is_push ? this->_entry_points.touches_begin : this->_entry_points.touches_end;
+	if (fn == 0) {
+		return;
+	}
+
+	Silene::JniState::LocalFrame frame{this->jni()};
+
 	auto jni_env_ptr = this->jni().get_env_ptr();
+	_env.call_function<void>(fn, jni_env_ptr, 0, data.id, data.x, data.y);
+}
 
-	if (is_push) {
-		_env.call_symbol<void>("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeTouchesBegin",
-			jni_env_ptr, 0, data.id, data.x, data.y);
-	} else {
-		_env.call_symbol<void>("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeTouchesEnd",
-			jni_env_ptr, 0, data.id, data.x, data.y);
+void AndroidApplication::deliver_moves(std::span<const TouchData> touches) {
+	if (this->_entry_points.touches_move == 0 || touches.empty()) {
+		return;
 	}
-}
 
-void AndroidApplication::move_touches(const std::vector<TouchData>& touches) {
+	Silene::JniState::LocalFrame frame{this->jni()};
+
 	auto jni_env_ptr = this->jni().get_env_ptr();
 
-	std::vector<int> ids{};
-	std::vector<float> xs{};
-	std::vector<float> ys{};
+	if (this->_touch_ids == 0) {
+		this->_touch_ids = this->jni().create_array(sizeof(std::int32_t), MAX_TOUCHES, Silene::JniState::RefKind::Global);
+		this->_touch_xs = this->jni().create_array(sizeof(float), MAX_TOUCHES, Silene::JniState::RefKind::Global);
+		this->_touch_ys = this->jni().create_array(sizeof(float), MAX_TOUCHES, Silene::JniState::RefKind::Global);
+	}
+
+	auto ids_array = this->jni().get_array(this->_touch_ids);
+	auto xs_array = this->jni().get_array(this->_touch_xs);
+	auto ys_array = this->jni().get_array(this->_touch_ys);
+	if (!ids_array || !xs_array || !ys_array) {
+		return;
+	}
+
+	auto count = std::min(static_cast<std::uint32_t>(touches.size()), MAX_TOUCHES);
 
-	for (const auto& touch : touches) {
-		ids.push_back(touch.id);
-		xs.push_back(touch.x);
-		ys.push_back(touch.y);
+	// written straight into the guest's copy, so nothing gets allocated for a move
+	auto ids = this->memory_manager().read_bytes<std::int32_t>(ids_array->elements_ptr());
+	auto xs = this->memory_manager().read_bytes<float>(xs_array->elements_ptr());
+	auto ys = this->memory_manager().read_bytes<float>(ys_array->elements_ptr());
+
+	for (auto i = 0u; i < count; i++) {
+		ids[i] = touches[i].id;
+		xs[i] = touches[i].x;
+		ys[i] = touches[i].y;
 	}
 
-	auto ids_ref = this->jni().create_ref(ids);
-	auto xs_ref = this->jni().create_ref(xs);
-	auto ys_ref = this->jni().create_ref(ys);
+	this->jni().set_array_length(this->_touch_ids, count);
+	this->jni().set_array_length(this->_touch_xs, count);
+	this->jni().set_array_length(this->_touch_ys, count);
 
-	_env.call_symbol<void>("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeTouchesMove", jni_env_ptr, 0, ids_ref, xs_ref, ys_ref);
+	_env.call_function<void>(this->_entry_points.touches_move, jni_env_ptr, 0, this->_touch_ids, this->_touch_xs, this->_touch_ys);
 }
 
-void AndroidApplication::send_ime_insert(std::string data) {
-	if (!this->program_loader().has_symbol("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeInsertText")) {
+void AndroidApplication::deliver_ime_insert(std::string_view data) {
+	if (this->_entry_points.insert_text == 0) {
 		return;
 	}
 
+	Silene::JniState::LocalFrame frame{this->jni()};
+
 	auto jni_env_ptr = this->jni().get_env_ptr();
 	auto data_ref = this->jni().create_string_ref(data);
-	_env.call_symbol<void>("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeInsertText", jni_env_ptr, 0, data_ref);
+	_env.call_function<void>(this->_entry_points.insert_text, jni_env_ptr, 0, data_ref);
 }
 
-void AndroidApplication::send_ime_delete() {
-	if (!this->program_loader().has_symbol("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeDeleteBackward")) {
+void AndroidApplication::deliver_ime_delete() {
+	if (this->_entry_points.delete_backward == 0) {
 		return;
 	}
 
+	Silene::JniState::LocalFrame frame{this->jni()};
+
 	auto jni_env_ptr = this->jni().get_env_ptr();
-	_env.call_symbol<void>("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeDeleteBackward", jni_env_ptr, 0);
+	_env.call_function<void>(this->_entry_points.delete_backward, jni_env_ptr, 0);
 }
 
-void AndroidApplication::send_keydown(int android_keycode) {
+void AndroidApplication::deliver_keydown(int android_keycode) {
+	if (this->_entry_points.key_down == 0) {
+		return;
+	}
+
+	Silene::JniState::LocalFrame frame{this->jni()};
+
 	auto jni_env_ptr = this->jni().get_env_ptr();
-	_env.call_symbol<void>("Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeKeyDown", jni_env_ptr, 0, android_keycode);
+	_env.call_function<void>(this->_entry_points.key_down, jni_env_ptr, 0, android_keycode);
+}
+
+bool AndroidApplication::log_input(std::span<const InputEvent> events, std::string_view text) {
+	auto& log = this->replay_log();
+	if (log.replaying()) {
+		// the replay sends the recorded input itself, anything from the frontend would make it diverge
+		return false;
+	}
+
+	log.record_input(this->_frame, events, text);
+	return true;
+}
+
+void AndroidApplication::replay_input(const ReplayLog::InputRecord& record) {
+	if (record.events.empty()) {
+		return;
+	}
+
+	const auto& event = record.events.front();
+	switch (event.type) {
+		case InputEvent::Type::TouchDown:
+		case InputEvent::Type::TouchUp:
+			this->deliver_touch(event.type == InputEvent::Type::TouchDown, {event.id, event.x, event.y});
+			break;
+		case InputEvent::Type::TouchMove: {
+			std::array<TouchData, MAX_TOUCHES> touches{};
+			auto count = std::min(record.events.size(), touches.size());
+
+			for (auto i = 0u; i < count; i++) {
+				touches[i] = {record.events[i].id, record.events[i].x, record.events[i].y};
+			}
+
+			this->deliver_moves({touches.data(), count});
+			break;
+		}
+		case InputEvent::Type::ImeInsert:
+			this->deliver_ime_insert(record.text);
+			break;
+		case InputEvent::Type::ImeDelete:
+			this->deliver_ime_delete();
+			break;
+		case InputEvent::Type::KeyDown:
+			this->deliver_keydown(event.keycode);
+			break;
+	}
+}
+
+void AndroidApplication::send_touch(bool is_push, TouchData touch) {
+	InputEvent event{
+		.type = is_push ? InputEvent::Type::TouchDown : InputEvent::Type::TouchUp,
+		.id = touch.id,
+		.x = touch.x,
+		.y = touch.y
+	};
+
+	if (this->log_input({&event, 1})) {
+		this->deliver_touch(is_push, touch);
+	}
+}
+
+void AndroidApplication::move_touches(std::span<const TouchData> touches) {
+	if (this->replay_log().mode() != ReplayLog::Mode::Off) {
+		std::array<InputEvent, MAX_TOUCHES> events{};
+		auto count = std::min(touches.size(), events.size());
+
+		for (auto i = 0u; i < count; i++) {
+			events[i] = {.type = InputEvent::Type::TouchMove, .id = touches[i].id, .x = touches[i].x, .y = touches[i].y};
+		}
+
+		if (!this->log_input({events.data(), count})) {
+			return;
+		}
+	}
+
+	this->deliver_moves(touches);
+}
+
+void AndroidApplication::send_ime_insert(std::string_view data) {
+	InputEvent event{.type = InputEvent::Type::ImeInsert};
+
+	// the text is recorded in full, the event would cut it off
+	if (this->log_input({&event, 1}, data)) {
+		this->deliver_ime_insert(data);
+	}
+}
+
+void AndroidApplication::send_ime_delete() {
+	InputEvent event{.type = InputEvent::Type::ImeDelete};
+
+	if (this->log_input({&event, 1})) {
+		this->deliver_ime_delete();
+	}
+}
+
+void AndroidApplication::send_keydown(int android_keycode) {
+	InputEvent event{.type = InputEvent::Type::KeyDown, .keycode = android_keycode};
+
+	if (this->log_input({&event, 1})) {
+		this->deliver_keydown(android_keycode);
+	}
 }
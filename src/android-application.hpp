@@ -4,6 +4,8 @@
 #define _ANDROID_APPLICATION_HPP
 
 #include <array>
+#include <span>
+#include <string_view>
 #include <unordered_map>
 #include <atomic>
 #include <mutex>
@@ -13,6 +15,7 @@
 
 #include "application-state.h"
 #include "android-environment.hpp"
+#include "scheduler.hpp"
 #include "elf.h"
 
 // manages global application state
@@ -21,6 +24,28 @@ public:
 	struct ApplicationConfig {
 		bool debug{false};
 		std::string resources{};
+
+		// maximum guest threads allowed to run at once, 0 picks based on the host
+		std::uint32_t worker_threads{0};
+
+		// where linked shader programs are kept between runs, left empty to not keep them
+		std::string shader_cache{};
+
+		// per frame gl stats are written here as csv, if set
+		std::string frame_log{};
+
+		// every gl call is recorded here for replaying with silene-glreplay, if set
+		std::string gl_trace{};
+		std::uint32_t gl_trace_frames{600};
+
+		// merge consecutive draws of streamed vertices into one where the state allows it
+		bool coalesce_draws{false};
+
+		// every value from the host that could change between runs is written here, if set
+		std::string record{};
+
+		// values are taken from this recording instead of the host, if set
+		std::string replay{};
 	};
 
 private:
@@ -30,6 +55,8 @@ private:
 	ApplicationConfig _config;
 	ApplicationState _state{};
 
+	Scheduler _scheduler;
+
 	std::uint32_t _last_tid{1};
 	std::unordered_map<std::uint32_t, AndroidEnvironment> _envs{};
 	std::unordered_map<std::uint32_t, std::thread> _unclaimed_threads{};
@@ -41,12 +68,44 @@ private:
 	// primary env for function calls
 	AndroidEnvironment _env;
 
+	/**
+	 * the native methods called every frame or for every input, looked up once after JNI_OnLoad.
+	 * any the game doesn't have are left at 0 and never called
+	 */
+	struct EntryPoints {
+		std::uint32_t render{0u};
+		std::uint32_t touches_begin{0u};
+		std::uint32_t touches_end{0u};
+		std::uint32_t touches_move{0u};
+		std::uint32_t insert_text{0u};
+		std::uint32_t delete_backward{0u};
+		std::uint32_t key_down{0u};
+	};
+
+	EntryPoints _entry_points{};
+
+	// global refs to the arrays that touch moves are sent in, which are refilled every time
+	std::uint32_t _touch_ids{0};
+	std::uint32_t _touch_xs{0};
+	std::uint32_t _touch_ys{0};
+
+	// frames drawn so far, which is what input is recorded against
+	std::uint32_t _frame{0};
+
 	// initializes the stack and initial callback addresses
 	// should be called before anything involving the memory is performed
 	void init_memory();
 
 	void create_processor_with_func(std::uint32_t start_addr, std::uint32_t arg, std::uint32_t id);
 
+	void resolve_entry_points();
+
+	/**
+	 * hands input from the frontend to the replay log. returns false if it should be dropped, as a replay is running
+	 */
+	bool log_input(std::span<const InputEvent> events, std::string_view text = {});
+	void replay_input(const ReplayLog::InputRecord& record);
+
 public:
 	// creates the initial application state
 	void init();
@@ -57,7 +116,7 @@ public:
 	// calls the init functions for each loaded library
 	void finalize_libraries();
 
-	// calls jni_onload, if the symbol exists
+	// calls jni_onload, if the symbol exists, then looks up the native methods used by the frontend
 	void init_jni();
 
 	// begins game initialization
@@ -69,18 +128,34 @@ public:
 
 	void draw_frame();
 
+	Scheduler& scheduler() {
+		return this->_scheduler;
+	}
+
 	struct TouchData {
 		std::uint32_t id;
 		float x;
 		float y;
 	};
 
+	// touches past this in a single move are dropped
+	static constexpr std::uint32_t MAX_TOUCHES = 10;
+
 	void send_touch(bool is_push, TouchData touch);
-	void move_touches(const std::vector<TouchData>&);
-	void send_ime_insert(std::string data);
+	void move_touches(std::span<const TouchData> touches);
+	void send_ime_insert(std::string_view data);
 	void send_ime_delete();
 	void send_keydown(int android_keycode);
 
+private:
+	// what the send functions do once the input is let through, also used to send a replay's input
+	void deliver_touch(bool is_push, TouchData touch);
+	void deliver_moves(std::span<const TouchData> touches);
+	void deliver_ime_insert(std::string_view data);
+	void deliver_ime_delete();
+	void deliver_keydown(int android_keycode);
+
+public:
 	AndroidApplication(ApplicationConfig config);
 
 	// these should already be implicit
@@ -2,7 +2,7 @@
 
 #include <spdlog/spdlog.h>
 
-// this is just for thread local storage, which we don't currently use, so most of these can do nothing
+// this is just for thread local storage, so most of these can do nothing
 
 std::optional<AndroidCP15::Callback> AndroidCP15::CompileInternalOperation(bool two, std::uint32_t opc1, CoprocReg CRd, CoprocReg CRn, CoprocReg CRm, std::uint32_t opc2) {
 	return std::nullopt;
@@ -18,8 +18,9 @@ AndroidCP15::CallbackOrAccessTwoWords AndroidCP15::CompileSendTwoWords(bool two,
 
 AndroidCP15::CallbackOrAccessOneWord AndroidCP15::CompileGetOneWord(bool two, std::uint32_t opc1, CoprocReg CRn, CoprocReg CRm, std::uint32_t opc2) {
 	if (opc1 == 0 && CRn == CoprocReg::C13 && CRm == CoprocReg::C0 && opc2 == 3) {
-		// whatever a TPIDRURO (read only thread id) is
-		return &_thread_id;
+		// TPIDRURO (user read-only thread id register), which bionic uses as the tls pointer
+		// returning the address lets the jit read it directly instead of calling back into us
+		return &_tls_addr;
 	}
 
 	return CallbackOrAccessOneWord{};
@@ -13,7 +13,8 @@
 
 class AndroidCP15 final : public Dynarmic::A32::Coprocessor {
 private:
-	std::uint32_t _thread_id{0x00c0ffee};
+	// guest address of the current thread's tls block, read by bionic's __get_tls()
+	std::uint32_t _tls_addr{0x00c0ffee};
 
 	using CoprocReg = Dynarmic::A32::CoprocReg;
 
@@ -26,12 +27,12 @@ public:
 	std::optional<Callback> CompileLoadWords(bool two, bool long_transfer, CoprocReg CRd, std::optional<std::uint8_t> option) override;
 	std::optional<Callback> CompileStoreWords(bool two, bool long_transfer, CoprocReg CRd, std::optional<std::uint8_t> option) override;
 
-	void set_thread_id(std::uint32_t id) {
-		this->_thread_id = id;
+	void set_tls_addr(std::uint32_t addr) {
+		this->_tls_addr = addr;
 	}
 
-	std::uint32_t get_thread_id() const {
-		return this->_thread_id;
+	std::uint32_t get_tls_addr() const {
+		return this->_tls_addr;
 	}
 };
 
@@ -1,5 +1,7 @@
 #include "android-environment.hpp"
 
+#include "scheduler.hpp"
+
 bool AndroidEnvironment::validate_pointer_addr(std::uint32_t vaddr, bool for_write) {
 	if (vaddr < PagedMemory::EMU_PAGE_SIZE) [[unlikely]] {
 		spdlog::warn("attempted to {} value at invalid addr {:#010x}", for_write ? "write" : "read", vaddr);
@@ -193,9 +195,22 @@ void AndroidEnvironment::run_func(std::uint32_t vaddr) {
 			halt_reason = this->_cpu->Run();
 		}
 
+		this->counters().jit_exits.fetch_add(1, std::memory_order_relaxed);
+
 		if (Dynarmic::Has(halt_reason, HALT_REASON_HANDLE_SYSCALL)) {
 			try {
 				this->syscall_handler().on_symbol_call(*this);
+			} catch (const ThreadExit&) {
+				// not an error, every call the thread is in gets unwound on the way out
+				_cpu->SetCpsr(original_cpsr);
+
+				regs[13] = original_stack;
+				regs[14] = original_lr;
+				regs[15] = original_pc;
+
+				this->_active = false;
+
+				throw;
 			} catch (...) {
 				spdlog::error("unhandled exception in symbol handler");
 				this->dump_state();
@@ -212,6 +227,11 @@ void AndroidEnvironment::run_func(std::uint32_t vaddr) {
 
 		// 0 means it ran out of steps
 		if (!halt_reason) {
+			// good place to let another thread have a turn
+			if (auto scheduler = Scheduler::current(); scheduler != nullptr) {
+				scheduler->yield();
+			}
+
 			this->ticks_left += 50000;
 			continue;
 		}
@@ -279,6 +299,11 @@ void AndroidEnvironment::dump_state() {
 	}
 }
 
+void AndroidEnvironment::init_tls() {
+	auto tls = this->libc().allocate_tls(this->_thread_id);
+	this->_cp15->set_tls_addr(tls);
+}
+
 void AndroidEnvironment::begin_debugging() {
 	auto port = 5039;
 
@@ -286,9 +311,7 @@ void AndroidEnvironment::begin_debugging() {
 	this->_debug_server->begin_connection("0.0.0.0", port);
 }
 
-AndroidEnvironment::AndroidEnvironment(AndroidApplication& application, ApplicationState& state, Dynarmic::ExclusiveMonitor* monitor, std::uint32_t thread_id) : Environment(state), _application{application} {
-	_cp15->set_thread_id(thread_id);
-
+AndroidEnvironment::AndroidEnvironment(AndroidApplication& application, ApplicationState& state, Dynarmic::ExclusiveMonitor* monitor, std::uint32_t thread_id) : Environment(state), _thread_id{static_cast<std::int32_t>(thread_id)}, _application{application} {
 	Dynarmic::A32::UserConfig user_config{};
 
 	// this feels like a hack..?
@@ -99,7 +99,15 @@ public:
 			throw std::runtime_error("symbol not found");
 		}
 
-		return SyscallTranslator::call_func<R>(*this, symbol_addr, args...);
+		return this->call_function<R>(symbol_addr, args...);
+	}
+
+	/**
+	 * like call_symbol, for an address that has already been looked up
+	 */
+	template <typename R = void, typename... Args>
+	R call_function(std::uint32_t vaddr, Args... args) {
+		return SyscallTranslator::call_func<R>(*this, vaddr, args...);
 	}
 
 	void begin_debugging();
@@ -108,6 +116,15 @@ public:
 		return this->_thread_id;
 	}
 
+	virtual std::uint32_t tls_addr() override {
+		return this->_cp15->get_tls_addr();
+	}
+
+	/**
+	 * allocates the tls block for this thread. requires libc to be initialized
+	 */
+	void init_tls();
+
 	void dump_state() override;
 
 	std::shared_ptr<Dynarmic::A32::Jit> current_cpu() override {
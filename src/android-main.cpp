@@ -24,7 +24,9 @@ void android_main(struct android_app* app) {
 	auto internal_apk = internal_data / "app.apk";
 	std::string app_apk = internal_apk.string();
 
-	AndroidApplication application{{false, app_apk}};
+	auto shader_cache = internal_data / "shader-cache";
+
+	AndroidApplication application{{false, app_apk, 0, shader_cache.string()}};
 
 	AndroidWindow window{app, application};
 
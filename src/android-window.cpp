@@ -13,6 +13,7 @@
 #include <backends/imgui_impl_opengl3.h>
 
 #include "android-application.hpp"
+#include "gl/gl-extensions.hpp"
 
 // i think a lot of the code here comes from cocosv3's native backend
 // but it's been like two years since i wrote it, sorry...
@@ -100,6 +101,8 @@ void AndroidWindow::init_render_full() {
 			spdlog::error("eglMakeCurrent failed, EGL error {}", eglGetError());
 		}
 
+		GlExtensions::load(reinterpret_cast<GlExtensions::ProcLoader>(eglGetProcAddress));
+
 		eglQuerySurface(_egl_display, _egl_surface, EGL_WIDTH, &_surface_width);
 		eglQuerySurface(_egl_display, _egl_surface, EGL_HEIGHT, &_surface_height);
 
@@ -3,11 +3,37 @@
 #ifndef _APPLICATION_STATE_H
 #define _APPLICATION_STATE_H
 
+#include <atomic>
+#include <cstdint>
+
 #include "paged-memory.hpp"
 #include "elf-loader.h"
 #include "syscall-handler.hpp"
 #include "libc-state.h"
 #include "jni.h"
+#include "gl/gl-state.hpp"
+#include "gl/gl-commands.hpp"
+#include "gl/gl-streamer.hpp"
+#include "gl/texture-uploader.hpp"
+#include "gl/shader-cache.hpp"
+#include "gl/gl-stats.hpp"
+#include "gl/frame-chain.hpp"
+#include "gl/gl-batch.hpp"
+#include "gl/gl-trace.hpp"
+#include "guest-clock.hpp"
+#include "replay-log.hpp"
+
+/**
+ * counts of the ways the guest leaves the jit, for measuring. guest threads all add to the same counters
+ */
+struct EmulationCounters {
+	// calls into functions the host implements
+	std::atomic<std::uint64_t> symbol_calls{0u};
+	std::atomic<std::uint64_t> kernel_calls{0u};
+
+	// every time the jit returned to the host, for any reason
+	std::atomic<std::uint64_t> jit_exits{0u};
+};
 
 struct ApplicationState {
 	PagedMemory memory;
@@ -15,9 +41,21 @@ struct ApplicationState {
 	SyscallHandler syscall_handler;
 	LibcState libc;
 	Silene::JniState jni;
+	GlState gl;
+	GlCommandStream gl_commands;
+	GlStreamer gl_streamer;
+	TextureUploader texture_uploader;
+	ShaderCache shader_cache;
+	GlStats gl_stats;
+	FrameChain frame_chain;
+	GlBatch gl_batch;
+	GlTrace gl_trace;
+	GuestClock guest_clock;
+	EmulationCounters counters;
+	ReplayLog replay_log;
 
 	ApplicationState() :
-		memory{}, program_loader{memory}, syscall_handler{memory}, libc{memory}, jni{memory} {}
+		memory{}, program_loader{memory}, syscall_handler{memory}, libc{memory}, jni{memory}, gl{gl_commands}, gl_batch{memory, syscall_handler}, gl_trace{memory} {}
 
 	ApplicationState(const ApplicationState&) = delete;
 	ApplicationState& operator=(const ApplicationState&) = delete;
@@ -48,6 +86,54 @@ public:
 		return this->_state.jni;
 	}
 
+	inline GlState& gl() const {
+		return this->_state.gl;
+	}
+
+	inline GlCommandStream& gl_commands() const {
+		return this->_state.gl_commands;
+	}
+
+	inline GlStreamer& gl_streamer() const {
+		return this->_state.gl_streamer;
+	}
+
+	inline TextureUploader& texture_uploader() const {
+		return this->_state.texture_uploader;
+	}
+
+	inline ShaderCache& shader_cache() const {
+		return this->_state.shader_cache;
+	}
+
+	inline GlStats& gl_stats() const {
+		return this->_state.gl_stats;
+	}
+
+	inline FrameChain& frame_chain() const {
+		return this->_state.frame_chain;
+	}
+
+	inline GlBatch& gl_batch() const {
+		return this->_state.gl_batch;
+	}
+
+	inline GlTrace& gl_trace() const {
+		return this->_state.gl_trace;
+	}
+
+	inline GuestClock& guest_clock() const {
+		return this->_state.guest_clock;
+	}
+
+	inline EmulationCounters& counters() const {
+		return this->_state.counters;
+	}
+
+	inline ReplayLog& replay_log() const {
+		return this->_state.replay_log;
+	}
+
 	StateHolder(ApplicationState& state) : _state{state} {}
 };
 
@@ -0,0 +1,255 @@
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+
+#include <CLI/CLI.hpp>
+#include <spdlog/spdlog.h>
+
+#include "headless-window.h"
+#include "android-application.hpp"
+#include "bench-report.hpp"
+#include "bench-runner.hpp"
+#include "bench-scenarios.hpp"
+#include "elf.h"
+#include "zip-file.h"
+
+int main(int argc, char** argv) {
+	CLI::App app{"runs a game headless on virtual time and reports how fast the emulator got through it"};
+	argv = app.ensure_utf8(argv);
+	app.require_subcommand(1);
+
+	bool verbose = false;
+	app.add_flag("-v,--verbose", verbose, "enable extra debug logging");
+
+	auto run = app.add_subcommand("run", "run a benchmark and write a report");
+
+	std::string app_apk;
+	run->add_option("apk", app_apk, "path to apk file to use for libraries")
+		->check(CLI::ExistingFile)
+		->required();
+
+	std::string app_resources{};
+	run->add_option("--resources", app_resources, "Determines the APK file to use for resources. If left blank, the main APK file is used")
+		->check(CLI::ExistingFile);
+
+	std::string support_dir = "./support/";
+	run->add_option("--link", support_dir, "path to load support binaries from")
+		->capture_default_str()
+		->check(CLI::ExistingDirectory);
+
+	std::uint32_t worker_threads = 0;
+	run->add_option("--threads", worker_threads, "maximum number of guest threads that can run at once. if 0, uses the number of host cores");
+
+	std::string shader_cache_dir = "./shader-cache/";
+	run->add_option("--shader-cache", shader_cache_dir, "path to store compiled shaders in. if empty, shaders are compiled every launch")
+		->capture_default_str();
+
+	bool coalesce_draws = false;
+	run->add_flag("--coalesce-draws", coalesce_draws, "merge consecutive draws that share state into one. mostly helps games drawing sprites one at a time");
+
+	std::string record_path{};
+	auto record_option = run->add_option("--record", record_path, "path to record the time, random numbers, socket results and input to, so the session can be played back exactly with --replay");
+
+	std::string replay_path{};
+	run->add_option("--replay", replay_path, "path to a session recorded with --record to play back. input from the frontend is ignored while replaying")
+		->check(CLI::ExistingFile)
+		->excludes(record_option);
+
+	BenchRunner::Config bench_config{};
+	run->add_option("--frames", bench_config.frames, "number of frames to run")
+		->capture_default_str();
+
+	run->add_option("--width", bench_config.width, "width of the guest's framebuffer")
+		->capture_default_str();
+
+	run->add_option("--height", bench_config.height, "height of the guest's framebuffer")
+		->capture_default_str();
+
+	run->add_option("--frame-rate", bench_config.frame_rate, "guest time that passes every frame, as frames per second")
+		->capture_default_str()
+		->check(CLI::PositiveNumber);
+
+	auto backend = HeadlessAppWindow::Backend::Null;
+	std::map<std::string, HeadlessAppWindow::Backend> backend_names{
+		{"null", HeadlessAppWindow::Backend::Null},
+		{"egl", HeadlessAppWindow::Backend::Egl},
+		{"software", HeadlessAppWindow::Backend::Software},
+	};
+	run->add_option("--gl", backend, "gl implementation to render with. null skips rendering entirely, software uses egl with llvmpipe")
+		->transform(CLI::CheckedTransformer(backend_names, CLI::ignore_case));
+
+	std::string script_path{};
+	run->add_option("--script", script_path, "timeline of input to send, see bench-runner.hpp for the format")
+		->check(CLI::ExistingFile);
+
+	std::string output_path = "bench-report.json";
+	run->add_option("-o,--output", output_path, "path to write the report to")
+		->capture_default_str();
+
+	auto compare = app.add_subcommand("compare", "compare two reports, exiting with 1 if the second regressed");
+
+	std::string base_path;
+	compare->add_option("base", base_path, "report to compare against")
+		->check(CLI::ExistingFile)
+		->required();
+
+	std::string current_path;
+	compare->add_option("current", current_path, "report to check")
+		->check(CLI::ExistingFile)
+		->required();
+
+	double threshold = 5.0;
+	compare->add_option("--threshold", threshold, "percent a metric can get worse by before it counts as a regression")
+		->capture_default_str()
+		->check(CLI::NonNegativeNumber);
+
+	auto contention = app.add_subcommand("contention", "time guest threads fighting over a mutex and a semaphore, without a game");
+
+	BenchScenarios::ContentionConfig contention_config{};
+	contention->add_option("--max-threads", contention_config.max_threads, "guest threads to stop at, starting from 2 and doubling")
+		->capture_default_str()
+		->check(CLI::Range(2u, 64u));
+
+	contention->add_option("--iterations", contention_config.iterations, "times each thread takes the lock")
+		->capture_default_str()
+		->check(CLI::PositiveNumber);
+
+	contention->add_option("--threads", worker_threads, "maximum number of guest threads that can run at once. if 0, uses the number of host cores");
+
+	contention->add_option("-o,--output", output_path, "path to write the report to")
+		->capture_default_str();
+
+	auto loopback = app.add_subcommand("loopback", "time guest sockets talking to an echo server on the loopback interface, without a game");
+
+	BenchScenarios::LoopbackConfig loopback_config{};
+	loopback->add_option("--max-clients", loopback_config.max_clients, "clients to stop at, starting from 1 and doubling")
+		->capture_default_str()
+		->check(CLI::Range(1u, 64u));
+
+	loopback->add_option("--round-trips", loopback_config.round_trips, "messages each client sends and waits to get back")
+		->capture_default_str()
+		->check(CLI::PositiveNumber);
+
+	loopback->add_option("--message-size", loopback_config.message_size, "size of every message in bytes")
+		->capture_default_str()
+		->check(CLI::Range(1u, 1024u * 1024u));
+
+	loopback->add_option("--threads", worker_threads, "maximum number of guest threads that can run at once. if 0, uses the number of host cores");
+
+	loopback->add_option("-o,--output", output_path, "path to write the report to")
+		->capture_default_str();
+
+	CLI11_PARSE(app, argc, argv);
+
+	if (verbose) {
+		spdlog::set_level(spdlog::level::debug);
+	}
+
+	if (compare->parsed()) {
+		auto base = BenchReport::read(base_path);
+		auto current = BenchReport::read(current_path);
+		if (!base || !current) {
+			return 2;
+		}
+
+		if (BenchReport::compare(*base, *current, threshold / 100.0)) {
+			spdlog::error("regressions past {}% from {}", threshold, base_path);
+			return 1;
+		}
+
+		return 0;
+	}
+
+	if (contention->parsed() || loopback->parsed()) {
+		AndroidApplication application{{false, {}, worker_threads, {}, {}, {}, 0, false, {}, {}}};
+		application.init();
+
+		auto report = contention->parsed()
+			? BenchScenarios::contention(application, contention_config)
+			: BenchScenarios::loopback(application, loopback_config);
+
+		if (!report || !report->write(output_path)) {
+			return 1;
+		}
+
+		spdlog::info("wrote report to {}", output_path);
+
+		return 0;
+	}
+
+	if (app_resources.empty()) {
+		app_resources = app_apk;
+	}
+
+	BenchRunner runner{bench_config};
+
+	if (!script_path.empty()) {
+		auto script = BenchRunner::read_script(script_path);
+		if (!script) {
+			return 1;
+		}
+
+		runner.set_script(std::move(*script));
+	}
+
+	AndroidApplication application{{false, app_resources, worker_threads, shader_cache_dir, {}, {}, 0, coalesce_draws, record_path, replay_path}};
+
+	ZipFile apk_file{app_apk};
+
+	std::string lib_path;
+	if (apk_file.has_file("lib/armeabi-v7a/libgame.so")) {
+		lib_path = "lib/armeabi-v7a/libgame.so";
+	} else if (apk_file.has_file("lib/armeabi-v7a/libcocos2dcpp.so")) {
+		lib_path = "lib/armeabi-v7a/libcocos2dcpp.so";
+	} else if (apk_file.has_file("lib/armeabi/libgame.so")) {
+		lib_path = "lib/armeabi/libgame.so"; // pre 1.6 only has armv5
+	} else {
+		spdlog::error("apk is missing library for a supported architecture");
+		return 1;
+	}
+
+	auto main_lib = apk_file.read_file_bytes(lib_path);
+
+	auto elf = Elf::File(std::move(main_lib));
+
+	std::filesystem::path support_path{support_dir};
+
+	auto zlib_path = support_path / "libz.so";
+	auto zlib = Elf::File(zlib_path.string());
+
+	// the window is only used to set up gl, the runner drives the frames itself
+	HeadlessAppWindow window{application, {
+		.backend = backend,
+		.width = bench_config.width,
+		.height = bench_config.height,
+		.frames = bench_config.frames
+	}};
+
+	if (!window.init()) {
+		spdlog::critical("failed to init window");
+		return 1;
+	}
+
+	application.init();
+
+	application.load_library(zlib);
+	application.load_library(elf);
+
+	application.finalize_libraries();
+
+	application.init_jni();
+
+	auto report = runner.run(application, window);
+
+	report.add_info("apk", std::filesystem::path{app_apk}.filename().string());
+	report.add_info("script", script_path.empty() ? "" : std::filesystem::path{script_path}.filename().string());
+
+	if (!report.write(output_path)) {
+		return 1;
+	}
+
+	spdlog::info("wrote report to {}", output_path);
+
+	return 0;
+}
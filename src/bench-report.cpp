@@ -0,0 +1,317 @@
+#include "bench-report.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+	// metrics where getting worse fails a comparison. everything else is only shown.
+	// all of these are better when lower
+	constexpr std::array<std::string_view, 7> GATED_METRICS{
+		"wall_s",
+		"frame_ms_p50",
+		"frame_ms_p95",
+		"frame_ms_p99",
+		"hle_calls_per_frame",
+		"kernel_calls_per_frame",
+		"jit_exits_per_frame",
+	};
+
+	std::string escape(std::string_view str) {
+		std::string escaped{};
+		escaped.reserve(str.size());
+
+		for (auto c : str) {
+			switch (c) {
+				case '"':
+					escaped += "\\\"";
+					break;
+				case '\\':
+					escaped += "\\\\";
+					break;
+				case '\n':
+					escaped += "\\n";
+					break;
+				case '\t':
+					escaped += "\\t";
+					break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20) {
+						escaped += fmt::format("\\u{:04x}", static_cast<int>(c));
+					} else {
+						escaped += c;
+					}
+					break;
+			}
+		}
+
+		return escaped;
+	}
+
+	/**
+	 * just enough of a json parser for a flat object of strings and numbers
+	 */
+	class FlatJsonReader {
+		std::string_view _data;
+		std::size_t _pos{0u};
+
+		void skip_whitespace() {
+			while (this->_pos < this->_data.size() && std::isspace(static_cast<unsigned char>(this->_data[this->_pos]))) {
+				this->_pos++;
+			}
+		}
+
+		bool consume(char c) {
+			this->skip_whitespace();
+			if (this->_pos < this->_data.size() && this->_data[this->_pos] == c) {
+				this->_pos++;
+				return true;
+			}
+
+			return false;
+		}
+
+		std::optional<std::string> read_string() {
+			if (!this->consume('"')) {
+				return std::nullopt;
+			}
+
+			std::string str{};
+			while (this->_pos < this->_data.size()) {
+				auto c = this->_data[this->_pos++];
+				if (c == '"') {
+					return str;
+				}
+
+				if (c != '\\') {
+					str += c;
+					continue;
+				}
+
+				if (this->_pos >= this->_data.size()) {
+					break;
+				}
+
+				switch (auto escaped = this->_data[this->_pos++]) {
+					case 'n':
+						str += '\n';
+						break;
+					case 't':
+						str += '\t';
+						break;
+					case 'u':
+						// only ever written for control characters, so anything wider is dropped
+						if (this->_pos + 4 > this->_data.size()) {
+							return std::nullopt;
+						}
+
+						str += static_cast<char>(std::strtol(std::string{this->_data.substr(this->_pos, 4)}.c_str(), nullptr, 16) & 0x7f);
+						this->_pos += 4;
+						break;
+					default:
+						str += escaped;
+						break;
+				}
+			}
+
+			return std::nullopt;
+		}
+
+		std::optional<double> read_number() {
+			this->skip_whitespace();
+
+			auto start = this->_pos;
+			while (this->_pos < this->_data.size() && std::string_view{"+-.0123456789eE"}.find(this->_data[this->_pos]) != std::string_view::npos) {
+				this->_pos++;
+			}
+
+			if (start == this->_pos) {
+				return std::nullopt;
+			}
+
+			std::string number{this->_data.substr(start, this->_pos - start)};
+
+			char* end = nullptr;
+			auto value = std::strtod(number.c_str(), &end);
+			if (end != number.c_str() + number.size()) {
+				return std::nullopt;
+			}
+
+			return value;
+		}
+
+	public:
+		bool read(BenchReport& report) {
+			if (!this->consume('{')) {
+				return false;
+			}
+
+			if (this->consume('}')) {
+				return true;
+			}
+
+			do {
+				auto key = this->read_string();
+				if (!key || !this->consume(':')) {
+					return false;
+				}
+
+				this->skip_whitespace();
+				if (this->_pos < this->_data.size() && this->_data[this->_pos] == '"') {
+					auto value = this->read_string();
+					if (!value) {
+						return false;
+					}
+
+					report.add_info(*key, *value);
+				} else {
+					auto value = this->read_number();
+					if (!value) {
+						return false;
+					}
+
+					report.add_metric(*key, *value);
+				}
+			} while (this->consume(','));
+
+			return this->consume('}');
+		}
+
+		FlatJsonReader(std::string_view data) : _data{data} {}
+	};
+}
+
+void BenchReport::add_info(std::string_view name, std::string_view value) {
+	this->_info.emplace_back(name, value);
+}
+
+void BenchReport::add_metric(std::string_view name, double value) {
+	this->_metrics.emplace_back(name, value);
+}
+
+std::optional<double> BenchReport::metric(std::string_view name) const {
+	auto it = std::find_if(this->_metrics.begin(), this->_metrics.end(), [&](const auto& metric) {
+		return metric.first == name;
+	});
+
+	if (it == this->_metrics.end()) {
+		return std::nullopt;
+	}
+
+	return it->second;
+}
+
+std::optional<std::string> BenchReport::info(std::string_view name) const {
+	auto it = std::find_if(this->_info.begin(), this->_info.end(), [&](const auto& info) {
+		return info.first == name;
+	});
+
+	if (it == this->_info.end()) {
+		return std::nullopt;
+	}
+
+	return it->second;
+}
+
+std::string BenchReport::to_json() const {
+	std::string json = "{\n";
+
+	auto first = true;
+	auto separator = [&]() {
+		if (!first) {
+			json += ",\n";
+		}
+
+		first = false;
+	};
+
+	for (const auto& [name, value] : this->_info) {
+		separator();
+		json += fmt::format("\t\"{}\": \"{}\"", escape(name), escape(value));
+	}
+
+	for (const auto& [name, value] : this->_metrics) {
+		separator();
+
+		// json has no way to write these
+		auto number = std::isfinite(value) ? value : 0.0;
+		json += fmt::format("\t\"{}\": {}", escape(name), number);
+	}
+
+	json += "\n}\n";
+
+	return json;
+}
+
+bool BenchReport::write(const std::filesystem::path& path) const {
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file) {
+		spdlog::error("failed to open report at {}", path.string());
+		return false;
+	}
+
+	file << this->to_json();
+	return static_cast<bool>(file);
+}
+
+std::optional<BenchReport> BenchReport::read(const std::filesystem::path& path) {
+	std::ifstream file(path);
+	if (!file) {
+		spdlog::error("failed to open report at {}", path.string());
+		return std::nullopt;
+	}
+
+	std::string data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+	BenchReport report{};
+	if (!FlatJsonReader{data}.read(report)) {
+		spdlog::error("{} is not a report written by silene-bench", path.string());
+		return std::nullopt;
+	}
+
+	return report;
+}
+
+bool BenchReport::compare(const BenchReport& base, const BenchReport& current, double threshold) {
+	for (auto name : {"apk", "gl_renderer", "script"}) {
+		auto base_info = base.info(name).value_or("");
+		auto current_info = current.info(name).value_or("");
+
+		if (base_info != current_info) {
+			spdlog::warn("reports differ in {} ({} vs {}), they may not be comparable", name, base_info, current_info);
+		}
+	}
+
+	auto regressed = false;
+
+	spdlog::info("{:<24} {:>12} {:>12} {:>9}", "metric", "base", "current", "change");
+
+	for (const auto& [name, base_value] : base._metrics) {
+		auto current_value = current.metric(name);
+		if (!current_value) {
+			spdlog::info("{:<24} {:>12.3f} {:>12} {:>9}", name, base_value, "-", "-");
+			continue;
+		}
+
+		auto change = base_value != 0.0 ? (*current_value - base_value) / base_value : 0.0;
+		auto gated = std::find(GATED_METRICS.begin(), GATED_METRICS.end(), name) != GATED_METRICS.end();
+
+		std::string_view verdict{};
+		if (gated && change > threshold) {
+			verdict = "regressed";
+			regressed = true;
+		} else if (gated && change < -threshold) {
+			verdict = "improved";
+		}
+
+		spdlog::info("{:<24} {:>12.3f} {:>12.3f} {:>+8.1f}% {}", name, base_value, *current_value, change * 100.0, verdict);
+	}
+
+	return regressed;
+}
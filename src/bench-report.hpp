@@ -0,0 +1,47 @@
+#pragma once
+
+#ifndef _BENCH_REPORT_HPP
+#define _BENCH_REPORT_HPP
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * the results of a silene-bench run. kept as a flat json object of strings and numbers,
+ * so that reports are easy to read back in and to handle with other tools
+ */
+class BenchReport {
+	std::vector<std::pair<std::string, std::string>> _info{};
+	std::vector<std::pair<std::string, double>> _metrics{};
+
+public:
+	/**
+	 * describes the run, such as the apk and the gl renderer. not compared
+	 */
+	void add_info(std::string_view name, std::string_view value);
+
+	void add_metric(std::string_view name, double value);
+
+	std::optional<double> metric(std::string_view name) const;
+	std::optional<std::string> info(std::string_view name) const;
+
+	std::string to_json() const;
+	bool write(const std::filesystem::path& path) const;
+
+	/**
+	 * reads a report written by write. only flat objects are understood, returns nothing on anything else
+	 */
+	static std::optional<BenchReport> read(const std::filesystem::path& path);
+
+	/**
+	 * prints how every metric changed from base to current. returns true if any metric meant to gate changes
+	 * got worse by more than threshold (a fraction, so 0.05 is 5%)
+	 */
+	static bool compare(const BenchReport& base, const BenchReport& current, double threshold);
+};
+
+#endif
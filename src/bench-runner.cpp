@@ -0,0 +1,257 @@
+#include "bench-runner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#include "headless-window.h"
+#include "android-application.hpp"
+
+namespace {
+	std::optional<InputEvent> parse_event(std::string_view type, std::istringstream& line) {
+		InputEvent event{};
+
+		if (type == "down" || type == "up" || type == "move") {
+			if (type == "down") {
+				event.type = InputEvent::Type::TouchDown;
+			} else if (type == "up") {
+				event.type = InputEvent::Type::TouchUp;
+			} else {
+				event.type = InputEvent::Type::TouchMove;
+			}
+
+			if (!(line >> event.id >> event.x >> event.y)) {
+				return std::nullopt;
+			}
+
+			return event;
+		}
+
+		if (type == "key") {
+			event.type = InputEvent::Type::KeyDown;
+			if (!(line >> event.keycode)) {
+				return std::nullopt;
+			}
+
+			return event;
+		}
+
+		if (type == "text") {
+			std::string text;
+			line >> std::ws;
+			std::getline(line, text);
+
+			// an event can't hold any more, and cutting it short would send something else than the script says
+			if (text.empty() || text.size() > InputEvent::MAX_TEXT - 1) {
+				return std::nullopt;
+			}
+
+			return InputEvent::with_text(text);
+		}
+
+		if (type == "delete") {
+			event.type = InputEvent::Type::ImeDelete;
+			return event;
+		}
+
+		return std::nullopt;
+	}
+}
+
+std::optional<std::vector<BenchRunner::ScriptedEvent>> BenchRunner::read_script(const std::filesystem::path& path) {
+	std::ifstream file(path);
+	if (!file) {
+		spdlog::error("failed to open input script at {}", path.string());
+		return std::nullopt;
+	}
+
+	std::vector<ScriptedEvent> script{};
+
+	std::string contents;
+	auto line_number = 0u;
+	while (std::getline(file, contents)) {
+		line_number++;
+
+		if (auto comment = contents.find('#'); comment != std::string::npos) {
+			contents.resize(comment);
+		}
+
+		if (contents.find_first_not_of(" \t\r") == std::string::npos) {
+			continue;
+		}
+
+		std::istringstream line{contents};
+
+		std::uint32_t frame;
+		std::string type;
+		if (!(line >> frame)) {
+			spdlog::error("{}:{}: expected a frame number", path.string(), line_number);
+			return std::nullopt;
+		}
+
+		if (!(line >> type)) {
+			spdlog::error("{}:{}: expected an event after the frame", path.string(), line_number);
+			return std::nullopt;
+		}
+
+		auto event = parse_event(type, line);
+		if (!event) {
+			spdlog::error("{}:{}: invalid {} event", path.string(), line_number, type);
+			return std::nullopt;
+		}
+
+		script.push_back({frame, *event});
+	}
+
+	// events on the same frame stay in the order they were written
+	std::stable_sort(script.begin(), script.end(), [](const auto& a, const auto& b) {
+		return a.frame < b.frame;
+	});
+
+	return script;
+}
+
+void BenchRunner::set_script(std::vector<ScriptedEvent> script) {
+	this->_script = std::move(script);
+}
+
+void BenchRunner::dispatch(AndroidApplication& application, const InputEvent& event) {
+	switch (event.type) {
+		case InputEvent::Type::TouchDown:
+		case InputEvent::Type::TouchUp:
+			application.send_touch(event.type == InputEvent::Type::TouchDown, {event.id, event.x, event.y});
+			break;
+		case InputEvent::Type::TouchMove: {
+			AndroidApplication::TouchData touch{event.id, event.x, event.y};
+			application.move_touches({&touch, 1});
+			break;
+		}
+		case InputEvent::Type::ImeInsert:
+			application.send_ime_insert(event.text);
+			break;
+		case InputEvent::Type::ImeDelete:
+			application.send_ime_delete();
+			break;
+		case InputEvent::Type::KeyDown:
+			application.send_keydown(event.keycode);
+			break;
+	}
+}
+
+BenchReport BenchRunner::run(AndroidApplication& application, HeadlessAppWindow& window) {
+	using Clock = std::chrono::steady_clock;
+
+	auto frames = std::max(this->_config.frames, 1u);
+	auto frame_step = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1.0 / this->_config.frame_rate));
+
+	auto init_start = Clock::now();
+	application.init_game(this->_config.width, this->_config.height);
+	auto init_end = Clock::now();
+
+	// loading is left on host time, as games tend to wait on the clock while they load
+	application.guest_clock().use_virtual_time();
+
+	auto& counters = application.counters();
+	auto symbol_calls = counters.symbol_calls.load(std::memory_order_relaxed);
+	auto kernel_calls = counters.kernel_calls.load(std::memory_order_relaxed);
+	auto jit_exits = counters.jit_exits.load(std::memory_order_relaxed);
+
+	// every guest thread's cpu time, as some games do most of their work off the main thread
+	auto& scheduler = application.scheduler();
+	auto guest_cpu_ns = [&scheduler]() {
+		auto total = scheduler.retired_cpu_time_ns();
+		for (const auto& thread : scheduler.thread_stats()) {
+			total += thread.cpu_time_ns;
+		}
+
+		return total;
+	};
+
+	auto cpu_ns = guest_cpu_ns();
+
+	std::vector<double> frame_ms{};
+	frame_ms.reserve(frames);
+
+	std::uint64_t draw_calls = 0u;
+
+	auto next_event = this->_script.begin();
+
+	auto start = Clock::now();
+
+	for (auto frame = 0u; frame < frames; frame++) {
+		auto frame_start = Clock::now();
+
+		for (; next_event != this->_script.end() && next_event->frame <= frame; ++next_event) {
+			this->dispatch(application, next_event->event);
+		}
+
+		application.guest_clock().advance(frame_step);
+
+		application.draw_frame();
+		window.swap_buffers();
+
+		frame_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - frame_start).count());
+		draw_calls += application.gl_stats().last_frame().draw_calls;
+	}
+
+	auto end = Clock::now();
+
+	if (next_event != this->_script.end()) {
+		spdlog::warn("{} scripted events were after the last frame", std::distance(next_event, this->_script.end()));
+	}
+
+	auto wall_s = std::chrono::duration<double>(end - start).count();
+	auto init_s = std::chrono::duration<double>(init_end - init_start).count();
+
+	symbol_calls = counters.symbol_calls.load(std::memory_order_relaxed) - symbol_calls;
+	kernel_calls = counters.kernel_calls.load(std::memory_order_relaxed) - kernel_calls;
+	jit_exits = counters.jit_exits.load(std::memory_order_relaxed) - jit_exits;
+	cpu_ns = guest_cpu_ns() - cpu_ns;
+
+	auto threads = scheduler.thread_stats();
+	auto guest_threads = std::count_if(threads.begin(), threads.end(), [](const auto& thread) {
+		return !thread.render;
+	});
+
+	auto mean_ms = wall_s * 1000.0 / frames;
+
+	std::sort(frame_ms.begin(), frame_ms.end());
+	auto percentile = [&](double p) {
+		return frame_ms[static_cast<std::size_t>(p * (frame_ms.size() - 1))];
+	};
+
+	BenchReport report{};
+
+	if (auto renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER)); renderer != nullptr) {
+		report.add_info("gl_renderer", renderer);
+	}
+
+	report.add_metric("frames", frames);
+	report.add_metric("frame_rate", this->_config.frame_rate);
+	report.add_metric("init_s", init_s);
+	report.add_metric("wall_s", wall_s);
+	report.add_metric("total_s", init_s + wall_s);
+	report.add_metric("fps", frames / wall_s);
+	report.add_metric("frame_ms_mean", mean_ms);
+	report.add_metric("frame_ms_p50", percentile(0.5));
+	report.add_metric("frame_ms_p95", percentile(0.95));
+	report.add_metric("frame_ms_p99", percentile(0.99));
+	report.add_metric("frame_ms_max", percentile(1.0));
+	report.add_metric("hle_calls_per_frame", static_cast<double>(symbol_calls) / frames);
+	report.add_metric("kernel_calls_per_frame", static_cast<double>(kernel_calls) / frames);
+	report.add_metric("jit_exits_per_frame", static_cast<double>(jit_exits) / frames);
+	report.add_metric("draw_calls_per_frame", static_cast<double>(draw_calls) / frames);
+	report.add_metric("guest_cpu_ms_per_frame", cpu_ns / 1e6 / frames);
+	report.add_metric("guest_threads", static_cast<double>(guest_threads));
+
+	spdlog::info("ran {} frames in {:.2f}s ({:.1f} fps), frame times p50 {:.3f}ms p95 {:.3f}ms p99 {:.3f}ms",
+		frames, wall_s, frames / wall_s, percentile(0.5), percentile(0.95), percentile(0.99));
+
+	return report;
+}
+
+BenchRunner::BenchRunner(Config config) : _config{config} {}
@@ -0,0 +1,64 @@
+#pragma once
+
+#ifndef _BENCH_RUNNER_HPP
+#define _BENCH_RUNNER_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "bench-report.hpp"
+#include "input-queue.hpp"
+
+class AndroidApplication;
+class HeadlessAppWindow;
+
+/**
+ * runs a game for a fixed number of frames on virtual time, so every run sees the same time pass
+ * and the same input on the same frame. what's left to vary between runs is the emulator itself
+ */
+class BenchRunner {
+public:
+	struct Config {
+		std::uint32_t frames{600};
+		std::uint32_t width{1280};
+		std::uint32_t height{720};
+
+		// how much guest time passes every frame
+		double frame_rate{60.0};
+	};
+
+	struct ScriptedEvent {
+		std::uint32_t frame{0};
+		InputEvent event{};
+	};
+
+private:
+	Config _config;
+	std::vector<ScriptedEvent> _script{};
+
+	void dispatch(AndroidApplication& application, const InputEvent& event);
+
+public:
+	/**
+	 * reads a timeline of input, one event per line, as one of
+	 *   <frame> down|up|move <id> <x> <y>
+	 *   <frame> key <android keycode>
+	 *   <frame> text <string>
+	 *   <frame> delete
+	 * blank lines and anything after a # are ignored. events are sent before their frame is drawn
+	 */
+	static std::optional<std::vector<ScriptedEvent>> read_script(const std::filesystem::path& path);
+
+	void set_script(std::vector<ScriptedEvent> script);
+
+	/**
+	 * starts the game and runs it to the end. the application should be ready for init_game
+	 */
+	BenchReport run(AndroidApplication& application, HeadlessAppWindow& window);
+
+	BenchRunner(Config config);
+};
+
+#endif
@@ -0,0 +1,460 @@
+#include "bench-scenarios.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <chrono>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#include "android-application.hpp"
+
+namespace {
+	/**
+	 * locks, bumps the counter, unlocks, for as many iterations as asked. r0 points at a LockArgs.
+	 * arm rather than thumb, so the address needs no tagging
+	 */
+	constexpr std::array<std::uint32_t, 17> LOCK_LOOP{
+		0xe92d41f0, // push {r4-r8, lr}
+		0xe5904000, // ldr r4, [r0]        ; lock object
+		0xe5905004, // ldr r5, [r0, #4]    ; lock
+		0xe5906008, // ldr r6, [r0, #8]    ; unlock
+		0xe590700c, // ldr r7, [r0, #12]   ; counter
+		0xe5908010, // ldr r8, [r0, #16]   ; iterations
+		// loop:
+		0xe1a00004, // mov r0, r4
+		0xe12fff35, // blx r5
+		0xe5970000, // ldr r0, [r7]
+		0xe2800001, // add r0, r0, #1
+		0xe5870000, // str r0, [r7]
+		0xe1a00004, // mov r0, r4
+		0xe12fff36, // blx r6
+		0xe2588001, // subs r8, r8, #1
+		0x1afffff6, // bne loop
+		0xe3a00000, // mov r0, #0
+		0xe8bd81f0, // pop {r4-r8, pc}
+	};
+
+	struct LockArgs {
+		std::uint32_t object;
+		std::uint32_t lock;
+		std::uint32_t unlock;
+		std::uint32_t counter;
+		std::uint32_t iterations;
+	};
+
+	/**
+	 * calls init(object, 0, 1), which is the shape of sem_init. r0 points at an InitArgs
+	 */
+	constexpr std::array<std::uint32_t, 5> INIT_CALL{
+		0xe5903004, // ldr r3, [r0, #4]    ; init
+		0xe5900000, // ldr r0, [r0]        ; object
+		0xe3a01000, // mov r1, #0
+		0xe3a02001, // mov r2, #1
+		0xe12fff13, // bx r3
+	};
+
+	struct InitArgs {
+		std::uint32_t object;
+		std::uint32_t init;
+	};
+
+	/**
+	 * connects to the address, then sends the buffer and reads it back in full for as many round trips as asked.
+	 * returns the round trips left, so anything but 0 means the connection failed. r0 points at an EchoArgs
+	 */
+	constexpr std::array<std::uint32_t, 40> ECHO_CLIENT{
+		0xe92d4ff8, // push {r3-r11, lr}   ; r3 keeps sp 8 byte aligned
+		0xe1a04000, // mov r4, r0
+		0xe3a00002, // mov r0, #2          ; AF_INET
+		0xe3a01001, // mov r1, #1          ; SOCK_STREAM
+		0xe3a02000, // mov r2, #0
+		0xe5943000, // ldr r3, [r4]        ; socket
+		0xe12fff33, // blx r3
+		0xe1a05000, // mov r5, r0          ; fd
+		0xe5941014, // ldr r1, [r4, #20]   ; address
+		0xe3a02010, // mov r2, #16
+		0xe5943004, // ldr r3, [r4, #4]    ; connect
+		0xe12fff33, // blx r3
+		0xe5946018, // ldr r6, [r4, #24]   ; buffer
+		0xe594701c, // ldr r7, [r4, #28]   ; size
+		0xe5948020, // ldr r8, [r4, #32]   ; round trips
+		// loop:
+		0xe1a00005, // mov r0, r5
+		0xe1a01006, // mov r1, r6
+		0xe1a02007, // mov r2, r7
+		0xe3a03000, // mov r3, #0
+		0xe5949008, // ldr r9, [r4, #8]    ; send
+		0xe12fff39, // blx r9
+		0xe3a0a000, // mov r10, #0         ; received
+		// recv_loop:
+		0xe1a00005, // mov r0, r5
+		0xe086100a, // add r1, r6, r10
+		0xe047200a, // sub r2, r7, r10
+		0xe3a03000, // mov r3, #0
+		0xe594900c, // ldr r9, [r4, #12]   ; recv
+		0xe12fff39, // blx r9
+		0xe3500000, // cmp r0, #0
+		0xda000004, // ble done
+		0xe08aa000, // add r10, r10, r0
+		0xe15a0007, // cmp r10, r7
+		0xbafffff4, // blt recv_loop
+		0xe2588001, // subs r8, r8, #1
+		0x1affffeb, // bne loop
+		// done:
+		0xe1a00005, // mov r0, r5
+		0xe5949010, // ldr r9, [r4, #16]   ; close
+		0xe12fff39, // blx r9
+		0xe1a00008, // mov r0, r8
+		0xe8bd8ff8, // pop {r3-r11, pc}
+	};
+
+	struct EchoArgs {
+		std::uint32_t socket;
+		std::uint32_t connect;
+		std::uint32_t send;
+		std::uint32_t recv;
+		std::uint32_t close;
+		std::uint32_t address;
+		std::uint32_t buffer;
+		std::uint32_t size;
+		std::uint32_t round_trips;
+	};
+
+	/**
+	 * sends back whatever it's sent, with a thread for every connection
+	 */
+	class EchoServer {
+		int _listener{-1};
+		std::uint16_t _port{0};
+
+		std::atomic<bool> _stopping{false};
+		std::thread _accept_thread{};
+
+		void accept_loop() {
+			std::vector<std::thread> connections{};
+
+			while (true) {
+				auto fd = accept(this->_listener, nullptr, nullptr);
+				if (fd == -1 || this->_stopping.load()) {
+					if (fd != -1) {
+						close(fd);
+					}
+
+					break;
+				}
+
+				connections.emplace_back(&EchoServer::echo, fd);
+			}
+
+			// clients close their end once they're done, which ends these
+			for (auto& connection : connections) {
+				connection.join();
+			}
+		}
+
+		static void echo(int fd) {
+			std::array<std::uint8_t, 4096> buffer;
+
+			while (true) {
+				auto r = recv(fd, buffer.data(), buffer.size(), 0);
+				if (r <= 0) {
+					break;
+				}
+
+				auto sent = 0;
+				while (sent < r) {
+					auto s = send(fd, buffer.data() + sent, r - sent, 0);
+					if (s <= 0) {
+						close(fd);
+						return;
+					}
+
+					sent += s;
+				}
+			}
+
+			close(fd);
+		}
+
+	public:
+		bool start() {
+			this->_listener = socket(AF_INET, SOCK_STREAM, 0);
+			if (this->_listener == -1) {
+				spdlog::error("bench: failed to create the echo server's socket");
+				return false;
+			}
+
+			sockaddr_in addr{};
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			addr.sin_port = 0;
+
+			socklen_t addr_len = sizeof(addr);
+			if (bind(this->_listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+				|| listen(this->_listener, 64) != 0
+				|| getsockname(this->_listener, reinterpret_cast<sockaddr*>(&addr), &addr_len) != 0) {
+				spdlog::error("bench: failed to start the echo server");
+				return false;
+			}
+
+			this->_port = ntohs(addr.sin_port);
+			this->_accept_thread = std::thread(&EchoServer::accept_loop, this);
+
+			return true;
+		}
+
+		std::uint16_t port() const {
+			return this->_port;
+		}
+
+		~EchoServer() {
+			if (this->_accept_thread.joinable()) {
+				// accept only returns for a connection, so make one
+				this->_stopping.store(true);
+
+				auto fd = socket(AF_INET, SOCK_STREAM, 0);
+
+				sockaddr_in addr{};
+				addr.sin_family = AF_INET;
+				addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+				addr.sin_port = htons(this->_port);
+
+				connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+				close(fd);
+
+				this->_accept_thread.join();
+			}
+
+			if (this->_listener != -1) {
+				close(this->_listener);
+			}
+		}
+	};
+
+	/**
+	 * copies something into newly allocated guest memory, returning where it went
+	 */
+	std::uint32_t write_guest(AndroidApplication& application, const void* data, std::uint32_t size) {
+		auto addr = application.libc().allocate_memory(size, true);
+		application.memory_manager().copy(addr, data, size);
+
+		return addr;
+	}
+
+	template <std::size_t N>
+	std::uint32_t write_code(AndroidApplication& application, const std::array<std::uint32_t, N>& code) {
+		return write_guest(application, code.data(), static_cast<std::uint32_t>(N * sizeof(std::uint32_t)));
+	}
+
+	std::uint32_t find_symbol(AndroidApplication& application, std::string_view name) {
+		auto addr = application.program_loader().get_symbol_addr(name);
+		if (addr == 0) {
+			spdlog::error("bench: {} isn't implemented", name);
+		}
+
+		return addr;
+	}
+
+	/**
+	 * starts a guest thread at entry for every arg, then waits for all of them. returns how long that took in seconds,
+	 * or nothing if a thread returned anything but 0
+	 */
+	std::optional<double> run_threads(AndroidApplication& application, std::uint32_t entry, std::span<const std::uint32_t> args) {
+		auto result_ptr = application.libc().allocate_memory(sizeof(std::uint32_t), true);
+
+		std::vector<std::uint32_t> threads{};
+		threads.reserve(args.size());
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (auto arg : args) {
+			threads.push_back(application.create_thread(entry, arg));
+		}
+
+		auto failed = false;
+		for (auto thread : threads) {
+			application.join_thread(thread, result_ptr);
+			failed |= application.memory_manager().read_word(result_ptr) != 0;
+		}
+
+		auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		application.libc().free_memory(result_ptr);
+
+		if (failed) {
+			return std::nullopt;
+		}
+
+		return elapsed;
+	}
+
+	/**
+	 * has thread_count threads fight over object, returning the time each lock and unlock took in nanoseconds
+	 */
+	std::optional<double> run_contention(AndroidApplication& application, std::uint32_t entry, LockArgs args, std::uint32_t thread_count) {
+		args.counter = application.libc().allocate_memory(sizeof(std::uint32_t), true);
+		application.memory_manager().write_word(args.counter, 0);
+
+		auto args_ptr = write_guest(application, &args, sizeof(args));
+
+		std::vector<std::uint32_t> thread_args(thread_count, args_ptr);
+		auto elapsed = run_threads(application, entry, thread_args);
+
+		auto counted = application.memory_manager().read_word(args.counter);
+		auto expected = thread_count * args.iterations;
+
+		application.libc().free_memory(args_ptr);
+		application.libc().free_memory(args.counter);
+
+		if (!elapsed) {
+			spdlog::error("bench: a guest thread failed");
+			return std::nullopt;
+		}
+
+		if (counted != expected) {
+			spdlog::error("bench: counted {} with {} threads, expected {}", counted, thread_count, expected);
+			return std::nullopt;
+		}
+
+		return *elapsed * 1e9 / expected;
+	}
+}
+
+std::optional<BenchReport> BenchScenarios::contention(AndroidApplication& application, const ContentionConfig& config) {
+	auto mutex_lock = find_symbol(application, "pthread_mutex_lock");
+	auto mutex_unlock = find_symbol(application, "pthread_mutex_unlock");
+	auto sem_init = find_symbol(application, "sem_init");
+	auto sem_wait = find_symbol(application, "sem_wait");
+	auto sem_post = find_symbol(application, "sem_post");
+
+	if (mutex_lock == 0 || mutex_unlock == 0 || sem_init == 0 || sem_wait == 0 || sem_post == 0) {
+		return std::nullopt;
+	}
+
+	auto lock_loop = write_code(application, LOCK_LOOP);
+	auto init_call = write_code(application, INIT_CALL);
+
+	// both are zeroed, which is already an unlocked normal mutex. the semaphore has to start at 1
+	auto mutex = application.libc().allocate_memory(16, true);
+	auto semaphore = application.libc().allocate_memory(16, true);
+
+	InitArgs init_args{semaphore, sem_init};
+	auto init_args_ptr = write_guest(application, &init_args, sizeof(init_args));
+	std::array<std::uint32_t, 1> init_thread{init_args_ptr};
+	run_threads(application, init_call, init_thread);
+	application.libc().free_memory(init_args_ptr);
+
+	BenchReport report{};
+	report.add_info("scenario", "contention");
+	report.add_metric("iterations", config.iterations);
+
+	struct Primitive {
+		std::string_view name;
+		LockArgs args;
+	};
+
+	std::array<Primitive, 2> primitives{{
+		{"mutex", {mutex, mutex_lock, mutex_unlock, 0, config.iterations}},
+		{"semaphore", {semaphore, sem_wait, sem_post, 0, config.iterations}},
+	}};
+
+	for (const auto& primitive : primitives) {
+		for (auto threads = 2u; threads <= config.max_threads; threads *= 2) {
+			auto ns_per_op = run_contention(application, lock_loop, primitive.args, threads);
+			if (!ns_per_op) {
+				return std::nullopt;
+			}
+
+			spdlog::info("{} with {} threads: {:.1f}ns per lock", primitive.name, threads, *ns_per_op);
+			report.add_metric(fmt::format("{}_{}_threads_ns", primitive.name, threads), *ns_per_op);
+		}
+	}
+
+	application.libc().free_memory(mutex);
+	application.libc().free_memory(semaphore);
+
+	return report;
+}
+
+std::optional<BenchReport> BenchScenarios::loopback(AndroidApplication& application, const LoopbackConfig& config) {
+	EchoArgs args{
+		.socket = find_symbol(application, "socket"),
+		.connect = find_symbol(application, "connect"),
+		.send = find_symbol(application, "send"),
+		.recv = find_symbol(application, "recv"),
+		.close = find_symbol(application, "close"),
+		.address = 0,
+		.buffer = 0,
+		.size = config.message_size,
+		.round_trips = config.round_trips
+	};
+
+	if (args.socket == 0 || args.connect == 0 || args.send == 0 || args.recv == 0 || args.close == 0) {
+		return std::nullopt;
+	}
+
+	EchoServer server{};
+	if (!server.start()) {
+		return std::nullopt;
+	}
+
+	// a guest sockaddr_in, which is the family followed by the port and address as they'd go over the network
+	std::array<std::uint8_t, 16> address{
+		2, 0,
+		static_cast<std::uint8_t>(server.port() >> 8), static_cast<std::uint8_t>(server.port() & 0xff),
+		127, 0, 0, 1
+	};
+
+	args.address = write_guest(application, address.data(), address.size());
+
+	auto echo_client = write_code(application, ECHO_CLIENT);
+
+	BenchReport report{};
+	report.add_info("scenario", "loopback");
+	report.add_metric("round_trips", config.round_trips);
+	report.add_metric("message_size", config.message_size);
+
+	for (auto clients = 1u; clients <= config.max_clients; clients *= 2) {
+		// every client needs a buffer of its own
+		std::vector<std::uint32_t> client_args{};
+		for (auto i = 0u; i < clients; i++) {
+			auto client = args;
+			client.buffer = application.libc().allocate_memory(config.message_size, true);
+
+			client_args.push_back(write_guest(application, &client, sizeof(client)));
+		}
+
+		auto elapsed = run_threads(application, echo_client, client_args);
+
+		for (auto ptr : client_args) {
+			application.libc().free_memory(application.memory_manager().read_word(ptr + offsetof(EchoArgs, buffer)));
+			application.libc().free_memory(ptr);
+		}
+
+		if (!elapsed) {
+			spdlog::error("bench: a client lost its connection with {} clients", clients);
+			return std::nullopt;
+		}
+
+		auto us_per_round_trip = *elapsed * 1e6 / config.round_trips;
+		auto mb_per_s = 2.0 * clients * config.round_trips * config.message_size / *elapsed / 1e6;
+
+		spdlog::info("{} clients: {:.1f}us per round trip, {:.1f}MB/s", clients, us_per_round_trip, mb_per_s);
+		report.add_metric(fmt::format("loopback_{}_clients_us", clients), us_per_round_trip);
+		report.add_metric(fmt::format("loopback_{}_clients_mb_s", clients), mb_per_s);
+	}
+
+	application.libc().free_memory(args.address);
+
+	return report;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef _BENCH_SCENARIOS_HPP
+#define _BENCH_SCENARIOS_HPP
+
+#include <cstdint>
+#include <optional>
+
+#include "bench-report.hpp"
+
+class AndroidApplication;
+
+/**
+ * benchmarks for parts of the emulator that a game only leans on now and then, so they can be measured without one.
+ *
+ * each scenario is a small guest program written as arm code straight into guest memory. it runs on real guest threads
+ * and calls into the emulated libc the same way a game would, so the jit, the scheduler and the libc all take part.
+ * the application only has to have been through init
+ */
+namespace BenchScenarios {
+	struct ContentionConfig {
+		// runs with 2 threads, then doubles until this many
+		std::uint32_t max_threads{16};
+
+		// times each thread takes the lock
+		std::uint32_t iterations{20000};
+	};
+
+	struct LoopbackConfig {
+		// runs with 1 client, then doubles until this many, each on its own guest thread and connection
+		std::uint32_t max_clients{8};
+
+		// messages each client sends and waits to get back
+		std::uint32_t round_trips{2000};
+
+		std::uint32_t message_size{256};
+	};
+
+	/**
+	 * every thread takes a shared mutex, bumps a counter and lets go, then does the same with a semaphore.
+	 * returns nothing if the counter doesn't add up, as then the lock let two threads in at once
+	 */
+	std::optional<BenchReport> contention(AndroidApplication& application, const ContentionConfig& config);
+
+	/**
+	 * starts an echo server on the loopback interface, then has clients connect to it through the guest's sockets and
+	 * send messages back and forth. the server is a plain host one, so only the guest's side is being measured
+	 */
+	std::optional<BenchReport> loopback(AndroidApplication& application, const LoopbackConfig& config);
+}
+
+#endif
@@ -0,0 +1,259 @@
+#include "emulation-thread.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+#include <imgui.h>
+#include <spdlog/spdlog.h>
+
+void EmulationThread::run(std::int32_t width, std::int32_t height, ContextFn make_current, ContextFn release_current) {
+	this->_application.scheduler().register_render_thread(0);
+
+	make_current();
+
+	auto& chain = this->_application.frame_chain();
+	if (!chain.create(width, height)) {
+		spdlog::error("failed to create the frame chain, the game will not be started");
+
+		release_current();
+		return;
+	}
+
+	this->_application.init_game(width, height);
+
+	auto fps = 0.0f;
+	auto frames = 0u;
+	auto fps_start = std::chrono::steady_clock::now();
+
+	auto& scheduler = this->_application.scheduler();
+
+	auto guest_threads = 0u;
+	auto parked_threads = 0u;
+	auto guest_cpu = 0.0f;
+	auto cpu_start = this->guest_cpu_time_ns();
+
+	while (this->_running.load(std::memory_order_relaxed)) {
+		// only fails once the window is going away
+		if (!chain.acquire()) {
+			break;
+		}
+
+		this->dispatch_input();
+		this->_application.draw_frame();
+
+		frames++;
+
+		auto now = std::chrono::steady_clock::now();
+		auto elapsed = std::chrono::duration<float>(now - fps_start).count();
+		if (elapsed >= 1.0f) {
+			fps = frames / elapsed;
+			frames = 0;
+			fps_start = now;
+
+			auto threads = scheduler.thread_stats();
+			guest_threads = static_cast<std::uint32_t>(std::count_if(threads.begin(), threads.end(), [](const auto& thread) {
+				return !thread.render;
+			}));
+			parked_threads = static_cast<std::uint32_t>(std::count_if(threads.begin(), threads.end(), [](const auto& thread) {
+				return thread.parked;
+			}));
+
+			auto cpu_time = this->guest_cpu_time_ns();
+			guest_cpu = (cpu_time - cpu_start) / (elapsed * 1e9f);
+			cpu_start = cpu_time;
+		}
+
+		std::scoped_lock lk{this->_info_lock};
+
+		this->_info.stats = this->_application.gl_stats().last_frame();
+		this->_info.fps = fps;
+		this->_info.gl_batched = this->_application.gl_batch().replayed_last_frame();
+		this->_info.gl_batch_flushes = this->_application.gl_batch().flushes_last_frame();
+		this->_info.gl_commands = this->_application.gl_commands().commands_last_frame();
+		this->_info.gl_batches = this->_application.gl_commands().flushes_last_frame();
+		this->_info.bytes_streamed = this->_application.gl_streamer().bytes_streamed_last_frame();
+		this->_info.stalls_avoided = this->_application.gl_streamer().stalls_avoided_last_frame();
+		this->_info.draws_coalesced = this->_application.gl_streamer().draws_coalesced_last_frame();
+		this->_info.coalesced_batches = this->_application.gl_streamer().batches_submitted_last_frame();
+		this->_info.uploads_deferred = this->_application.texture_uploader().deferred_last_frame();
+		this->_info.upload_waits = this->_application.texture_uploader().waits_last_frame();
+		this->_info.guest_threads = guest_threads;
+		this->_info.parked_threads = parked_threads;
+		this->_info.guest_cpu = guest_cpu;
+	}
+
+	this->log_thread_stats();
+
+	chain.destroy();
+
+	release_current();
+}
+
+std::uint64_t EmulationThread::guest_cpu_time_ns() {
+	auto& scheduler = this->_application.scheduler();
+
+	auto total = scheduler.retired_cpu_time_ns();
+	for (const auto& thread : scheduler.thread_stats()) {
+		total += thread.cpu_time_ns;
+	}
+
+	return total;
+}
+
+void EmulationThread::log_thread_stats() {
+	auto& scheduler = this->_application.scheduler();
+
+	for (const auto& thread : scheduler.thread_stats()) {
+		spdlog::info("thread {}{}: {:.2f}s on cpu, {} yields, {} parks", thread.thread_id, thread.render ? " (render)" : "", thread.cpu_time_ns / 1e9, thread.yields, thread.parks);
+	}
+
+	spdlog::info("exited threads: {:.2f}s on cpu", scheduler.retired_cpu_time_ns() / 1e9);
+}
+
+void EmulationThread::dispatch_input() {
+	// a move only matters for where it ends up, so moves are held back and sent together with the latest position
+	// of every touch. they go out before anything else, which keeps them in order with touches starting and ending
+	std::array<AndroidApplication::TouchData, AndroidApplication::MAX_TOUCHES> moves{};
+	std::size_t move_count = 0;
+
+	auto send_moves = [&]() {
+		if (move_count != 0) {
+			this->_application.move_touches({moves.data(), move_count});
+			move_count = 0;
+		}
+	};
+
+	InputEvent event;
+	while (this->_input.pop(event)) {
+		if (event.type == InputEvent::Type::TouchMove) {
+			auto end = moves.begin() + move_count;
+			if (auto it = std::find_if(moves.begin(), end, [&](const auto& touch) { return touch.id == event.id; }); it != end) {
+				it->x = event.x;
+				it->y = event.y;
+			} else if (move_count < moves.size()) {
+				moves[move_count++] = {event.id, event.x, event.y};
+			}
+
+			continue;
+		}
+
+		send_moves();
+
+		switch (event.type) {
+			case InputEvent::Type::TouchDown:
+			case InputEvent::Type::TouchUp:
+				this->_application.send_touch(event.type == InputEvent::Type::TouchDown, {event.id, event.x, event.y});
+				break;
+			case InputEvent::Type::ImeInsert:
+				this->_application.send_ime_insert(event.text);
+				break;
+			case InputEvent::Type::ImeDelete:
+				this->_application.send_ime_delete();
+				break;
+			case InputEvent::Type::KeyDown:
+				this->_application.send_keydown(event.keycode);
+				break;
+			default:
+				break;
+		}
+	}
+
+	send_moves();
+}
+
+void EmulationThread::push(const InputEvent& event) {
+	// only happens if the guest has been stuck for a while, in which case the input is stale anyways
+	if (!this->_input.push(event)) {
+		spdlog::debug("input queue is full, dropping event");
+	}
+}
+
+void EmulationThread::start(std::int32_t width, std::int32_t height, ContextFn make_current, ContextFn release_current) {
+	this->_application.scheduler().leave_render_thread();
+
+	this->_running = true;
+	this->_thread = std::thread(&EmulationThread::run, this, width, height, std::move(make_current), std::move(release_current));
+}
+
+void EmulationThread::stop() {
+	if (!this->_thread.joinable()) {
+		return;
+	}
+
+	this->_running = false;
+	this->_application.frame_chain().shutdown();
+
+	this->_thread.join();
+}
+
+EmulationThread::FrameInfo EmulationThread::last_frame() {
+	std::scoped_lock lk{this->_info_lock};
+	return this->_info;
+}
+
+void EmulationThread::send_touch(bool is_push, AndroidApplication::TouchData touch) {
+	InputEvent event{};
+	event.type = is_push ? InputEvent::Type::TouchDown : InputEvent::Type::TouchUp;
+	event.id = touch.id;
+	event.x = touch.x;
+	event.y = touch.y;
+
+	this->push(event);
+}
+
+void EmulationThread::move_touch(AndroidApplication::TouchData touch) {
+	InputEvent event{};
+	event.type = InputEvent::Type::TouchMove;
+	event.id = touch.id;
+	event.x = touch.x;
+	event.y = touch.y;
+
+	this->push(event);
+}
+
+void EmulationThread::send_ime_insert(std::string_view data) {
+	this->push(InputEvent::with_text(data));
+}
+
+void EmulationThread::send_ime_delete() {
+	InputEvent event{};
+	event.type = InputEvent::Type::ImeDelete;
+
+	this->push(event);
+}
+
+void EmulationThread::send_keydown(int android_keycode) {
+	InputEvent event{};
+	event.type = InputEvent::Type::KeyDown;
+	event.keycode = android_keycode;
+
+	this->push(event);
+}
+
+EmulationThread::~EmulationThread() {
+	this->stop();
+}
+
+void draw_frame_info(const EmulationThread::FrameInfo& info, const FramePacer::FrameTimes& frame_times) {
+	const auto& stats = info.stats;
+
+	ImGui::Text("FPS: %.0f | Present: %.2fms (p99 %.2fms)", info.fps, frame_times.median, frame_times.p99);
+	if (stats.gpu_ns >= 0) {
+		ImGui::Text("CPU: %.2fms (GL %.2fms) | GPU: %.2fms", stats.render_ns / 1e6, stats.gl_ns / 1e6, stats.gpu_ns / 1e6);
+	} else {
+		ImGui::Text("CPU: %.2fms (GL %.2fms) | GPU: n/a", stats.render_ns / 1e6, stats.gl_ns / 1e6);
+	}
+
+	ImGui::Text("Draws: %u | State changes: %u (elided %u) | Programs: %u", stats.draw_calls, stats.state_changes, stats.elided_calls, stats.program_switches);
+	ImGui::Text("Uploaded: %llu buffer bytes, %llu texture bytes", static_cast<unsigned long long>(stats.buffer_bytes), static_cast<unsigned long long>(stats.texture_bytes));
+	ImGui::Text("GL calls batched: %u (%u flushes)", info.gl_batched, info.gl_batch_flushes);
+	ImGui::Text("GL commands: %u in %u batches", info.gl_commands, info.gl_batches);
+	ImGui::Text("GL bytes streamed: %u", info.bytes_streamed);
+	ImGui::Text("GL stalls avoided: %u", info.stalls_avoided);
+	if (info.coalesced_batches != 0) {
+		ImGui::Text("Draws coalesced: %u into %u (%.2fx)", info.draws_coalesced, info.coalesced_batches, static_cast<float>(info.draws_coalesced) / info.coalesced_batches);
+	}
+	ImGui::Text("Texture uploads deferred: %u (waited on %u)", info.uploads_deferred, info.upload_waits);
+	ImGui::Text("Guest threads: %u (%u parked) | %.2f cores busy", info.guest_threads, info.parked_threads, info.guest_cpu);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#ifndef _EMULATION_THREAD_HPP
+#define _EMULATION_THREAD_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+#include "android-application.hpp"
+#include "frame-pacer.hpp"
+#include "input-queue.hpp"
+
+/**
+ * runs the guest on a thread of its own, so that the window thread is left with pumping events and presenting.
+ *
+ * input goes through a queue that's drained before every frame, and frames come back through the frame chain.
+ * the guest's gl context has to share objects with the window's, as the frames are textures
+ */
+class EmulationThread {
+public:
+	/**
+	 * everything the overlay shows, copied out at the end of every frame so the window doesn't race the guest
+	 */
+	struct FrameInfo {
+		GlStats::FrameStats stats{};
+		float fps{0.0f};
+
+		std::uint32_t gl_batched{0u};
+		std::uint32_t gl_batch_flushes{0u};
+		std::uint32_t gl_commands{0u};
+		std::uint32_t gl_batches{0u};
+		std::uint32_t bytes_streamed{0u};
+		std::uint32_t stalls_avoided{0u};
+		std::uint32_t draws_coalesced{0u};
+		std::uint32_t coalesced_batches{0u};
+		std::uint32_t uploads_deferred{0u};
+		std::uint32_t upload_waits{0u};
+
+		// these come from the scheduler and are updated along with fps
+		std::uint32_t guest_threads{0u};
+		std::uint32_t parked_threads{0u};
+
+		// how many cores the guest threads kept busy
+		float guest_cpu{0.0f};
+	};
+
+	// makes the guest's context current on the calling thread, or releases it
+	using ContextFn = std::function<void()>;
+
+private:
+	static constexpr std::size_t INPUT_CAPACITY = 1024;
+
+	AndroidApplication& _application;
+
+	InputQueue<INPUT_CAPACITY> _input{};
+
+	std::thread _thread{};
+	std::atomic<bool> _running{false};
+
+	std::mutex _info_lock{};
+	FrameInfo _info{};
+
+	void run(std::int32_t width, std::int32_t height, ContextFn make_current, ContextFn release_current);
+
+	/**
+	 * hands everything that has been queued so far over to the guest. moves are merged into a single call
+	 */
+	void dispatch_input();
+
+	void push(const InputEvent& event);
+
+	/**
+	 * cpu time used by every guest thread so far, including the ones that have exited
+	 */
+	std::uint64_t guest_cpu_time_ns();
+
+	void log_thread_stats();
+
+public:
+	/**
+	 * starts the game, the calling thread gives up rendering and must not call into the guest afterwards
+	 */
+	void start(std::int32_t width, std::int32_t height, ContextFn make_current, ContextFn release_current);
+
+	/**
+	 * lets the current frame finish, then waits for the thread to exit
+	 */
+	void stop();
+
+	FrameInfo last_frame();
+
+	// these match AndroidApplication, but only queue the input up
+
+	void send_touch(bool is_push, AndroidApplication::TouchData touch);
+	void move_touch(AndroidApplication::TouchData touch);
+	void send_ime_insert(std::string_view data);
+	void send_ime_delete();
+	void send_keydown(int android_keycode);
+
+	EmulationThread(AndroidApplication& application) : _application{application} {}
+	~EmulationThread();
+
+	EmulationThread(const EmulationThread&) = delete;
+	EmulationThread& operator=(const EmulationThread&) = delete;
+};
+
+/**
+ * writes out the overlay's stats into the current imgui window, which is the same for every frontend
+ */
+void draw_frame_info(const EmulationThread::FrameInfo& info, const FramePacer::FrameTimes& frame_times);
+
+#endif
@@ -12,6 +12,14 @@
 
 class AndroidApplication;
 
+/**
+ * thrown by pthread_exit to unwind the guest thread back to where it was started,
+ * which then finishes it the same way as returning from the start routine
+ */
+struct ThreadExit {
+	std::uint32_t value;
+};
+
 /**
  * abstract class to hold global state
  * prevents circular dependency with syscall handler
@@ -36,6 +44,11 @@ public:
 	 */
 	virtual std::int32_t thread_id() = 0;
 
+	/**
+	 * gets the guest address of the tls block for the current thread
+	 */
+	virtual std::uint32_t tls_addr() = 0;
+
 	/**
 	 * returns the current application
 	 */
@@ -0,0 +1,108 @@
+#include "frame-pacer.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+	constexpr std::chrono::steady_clock::duration MIN_SPIN_MARGIN = std::chrono::microseconds(100);
+	constexpr std::chrono::steady_clock::duration MAX_SPIN_MARGIN = std::chrono::milliseconds(4);
+}
+
+int FramePacer::swap_interval() const {
+	switch (this->_config.mode) {
+		case Mode::Uncapped:
+			return 0;
+		case Mode::Adaptive:
+			return -1;
+		case Mode::Vsync:
+		default:
+			return 1;
+	}
+}
+
+void FramePacer::set_refresh_rate(double refresh_rate) {
+	if (this->_config.mode == Mode::Uncapped || refresh_rate <= 0.0 || this->_period == Clock::duration::zero()) {
+		return;
+	}
+
+	// vblank already holds the loop to the display's rate. pacing on top of it only makes the two drift apart,
+	// which shows up as a frame skipped every so often. the tolerance covers rates like 59.94hz
+	if (this->_config.target_fps >= refresh_rate - 0.5) {
+		spdlog::debug("frame pacer: leaving pacing to vsync at {:.2f}hz", refresh_rate);
+		this->_period = Clock::duration::zero();
+	}
+}
+
+void FramePacer::record(Clock::time_point now) {
+	auto frame_time = std::chrono::duration<float, std::milli>(now - this->_last_frame).count();
+	this->_last_frame = now;
+
+	this->_history[this->_history_next] = frame_time;
+	this->_history_next = (this->_history_next + 1) % HISTORY_SIZE;
+	this->_history_count = std::min(this->_history_count + 1, HISTORY_SIZE);
+}
+
+void FramePacer::sleep_until(Clock::time_point deadline) {
+	auto wake = deadline - this->_spin_margin;
+	if (Clock::now() < wake) {
+		std::this_thread::sleep_until(wake);
+
+		// oversleeping past the wake up is what the margin covers, so keep it just above the worst recent case
+		auto overshoot = Clock::now() - wake;
+		this->_spin_margin = std::clamp(std::max(this->_spin_margin * 15 / 16, overshoot * 3 / 2), MIN_SPIN_MARGIN, MAX_SPIN_MARGIN);
+	}
+
+	while (Clock::now() < deadline) {
+		std::this_thread::yield();
+	}
+}
+
+void FramePacer::start() {
+	auto now = Clock::now();
+
+	this->_deadline = now;
+	this->_last_frame = now;
+
+	this->_history_next = 0;
+	this->_history_count = 0;
+}
+
+void FramePacer::wait() {
+	if (this->_period != Clock::duration::zero()) {
+		this->_deadline += this->_period;
+
+		auto now = Clock::now();
+		if (now > this->_deadline + this->_period) {
+			// more than a frame behind, so start over rather than rushing frames out to catch up
+			this->_deadline = now;
+		} else if (now < this->_deadline) {
+			this->sleep_until(this->_deadline);
+		}
+	}
+
+	this->record(Clock::now());
+}
+
+FramePacer::FrameTimes FramePacer::frame_times() const {
+	if (this->_history_count == 0) {
+		return {};
+	}
+
+	auto times = this->_history;
+	auto end = times.begin() + this->_history_count;
+	std::sort(times.begin(), end);
+
+	auto percentile = [&](double p) {
+		return static_cast<double>(times[static_cast<std::size_t>(p * (this->_history_count - 1))]);
+	};
+
+	return {percentile(0.5), percentile(0.95), percentile(0.99), percentile(1.0)};
+}
+
+FramePacer::FramePacer(Config config) : _config{config} {
+	if (config.target_fps > 0.0) {
+		this->_period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / config.target_fps));
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#ifndef _FRAME_PACER_HPP
+#define _FRAME_PACER_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * paces the window thread's present loop to a target rate, without spinning a core while it waits.
+ *
+ * waiting sleeps until shortly before the deadline, then spins for the rest. the spin is only as long as the
+ * os has been oversleeping recently, so it's usually well under a millisecond.
+ * it also keeps the time between the last few hundred frames, for the overlay
+ */
+class FramePacer {
+public:
+	enum class Mode {
+		// the driver waits for vblank on swap
+		Vsync,
+
+		// swaps right away, so only the target rate limits anything
+		Uncapped,
+
+		// waits for vblank, unless the frame was late in which case it tears instead
+		Adaptive,
+	};
+
+	struct Config {
+		Mode mode{Mode::Vsync};
+
+		// frames per second to pace to, or 0 to leave it to the mode
+		double target_fps{60.0};
+	};
+
+	struct FrameTimes {
+		// in milliseconds
+		double median{0.0};
+		double p95{0.0};
+		double p99{0.0};
+		double max{0.0};
+	};
+
+	static constexpr std::size_t HISTORY_SIZE = 256;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	Config _config;
+	Clock::duration _period{};
+
+	Clock::time_point _deadline{};
+	Clock::time_point _last_frame{};
+
+	// how much earlier than the deadline to wake up, so the spin can absorb the os oversleeping
+	Clock::duration _spin_margin{std::chrono::milliseconds(1)};
+
+	std::array<float, HISTORY_SIZE> _history{};
+	std::size_t _history_next{0u};
+	std::size_t _history_count{0u};
+
+	void record(Clock::time_point now);
+	void sleep_until(Clock::time_point deadline);
+
+public:
+	/**
+	 * the swap interval to request for the mode
+	 */
+	int swap_interval() const;
+
+	Mode mode() const {
+		return this->_config.mode;
+	}
+
+	/**
+	 * tells the pacer how fast the display is. with vsync, a target at or above it is left to vblank
+	 */
+	void set_refresh_rate(double refresh_rate);
+
+	/**
+	 * starts timing from now, call right before the first frame
+	 */
+	void start();
+
+	/**
+	 * waits until the next frame should start, call right after presenting
+	 */
+	void wait();
+
+	/**
+	 * percentiles of the time between recent frames
+	 */
+	FrameTimes frame_times() const;
+
+	FramePacer(Config config);
+};
+
+#endif
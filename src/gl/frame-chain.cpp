@@ -0,0 +1,437 @@
+#include "frame-chain.hpp"
+
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+#ifdef SILENE_USE_EGL
+#include <GLES2/gl2.h>
+#else
+#include <glad/glad.h>
+#endif
+
+#include "gl-extensions.hpp"
+
+namespace {
+	// from oes_packed_depth_stencil on gles 2, which has the same value
+	constexpr std::uint32_t DEPTH24_STENCIL8 = 0x88F0;
+	constexpr std::uint32_t DRAW_FRAMEBUFFER = 0x8CA9;
+
+	// no version, so the same source is valid for both glsl 1.10 and glsl es 1.00
+	constexpr const char* PRESENT_VERTEX_SHADER = R"(
+attribute vec2 a_position;
+attribute vec2 a_texcoord;
+varying vec2 v_texcoord;
+
+void main() {
+	v_texcoord = a_texcoord;
+	gl_Position = vec4(a_position, 0.0, 1.0);
+}
+)";
+
+	constexpr const char* PRESENT_FRAGMENT_SHADER = R"(
+#ifdef GL_ES
+precision mediump float;
+#endif
+
+varying vec2 v_texcoord;
+uniform sampler2D u_texture;
+
+void main() {
+	gl_FragColor = texture2D(u_texture, v_texcoord);
+}
+)";
+
+	constexpr const char* PRESENT_SHARP_FRAGMENT_SHADER = R"(
+#ifdef GL_ES
+precision mediump float;
+#endif
+
+varying vec2 v_texcoord;
+uniform sampler2D u_texture;
+uniform vec2 u_texel;
+
+void main() {
+	vec4 center = texture2D(u_texture, v_texcoord);
+	vec4 around = texture2D(u_texture, v_texcoord + vec2(u_texel.x, 0.0))
+		+ texture2D(u_texture, v_texcoord - vec2(u_texel.x, 0.0))
+		+ texture2D(u_texture, v_texcoord + vec2(0.0, u_texel.y))
+		+ texture2D(u_texture, v_texcoord - vec2(0.0, u_texel.y));
+
+	gl_FragColor = vec4(clamp(center.rgb + (center.rgb * 4.0 - around.rgb) * 0.2, 0.0, 1.0), 1.0);
+}
+)";
+
+	// x, y, u, v as a strip covering the whole viewport
+	constexpr float PRESENT_QUAD[] = {
+		-1.0f, -1.0f, 0.0f, 0.0f,
+		 1.0f, -1.0f, 1.0f, 0.0f,
+		-1.0f,  1.0f, 0.0f, 1.0f,
+		 1.0f,  1.0f, 1.0f, 1.0f,
+	};
+
+	std::uint32_t compile_shader(std::uint32_t type, const char* source) {
+		auto shader = glCreateShader(type);
+		glShaderSource(shader, 1, &source, nullptr);
+		glCompileShader(shader);
+
+		GLint status = 0;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (!status) {
+			char log[512]{};
+			glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+			spdlog::error("failed to compile present shader: {}", log);
+
+			glDeleteShader(shader);
+			return 0;
+		}
+
+		return shader;
+	}
+}
+
+void FrameChain::wait_fence(GlSync& fence) {
+	if (fence == nullptr) {
+		return;
+	}
+
+	auto& ext = GlExtensions::get();
+
+	auto status = ext.client_wait_sync(fence, GlExtensions::SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+	if (status == GlExtensions::TIMEOUT_EXPIRED || status == GlExtensions::WAIT_FAILED) {
+		spdlog::warn("frame chain: gave up waiting on the other context");
+	}
+
+	ext.delete_sync(fence);
+	fence = nullptr;
+}
+
+std::int32_t FrameChain::free_buffer() const {
+	for (auto i = 0; i < static_cast<std::int32_t>(BUFFER_COUNT); i++) {
+		if (i != this->_published && i != this->_presenting) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+bool FrameChain::create_buffer(Buffer& buffer) {
+	glGenTextures(1, &buffer.texture);
+	glBindTexture(GL_TEXTURE_2D, buffer.texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, this->_width, this->_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &buffer.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, buffer.framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, buffer.texture, 0);
+
+	// the window's framebuffer has depth and stencil, so the guest might rely on both.
+	// gles 2 without the packed format only gets depth
+	glGenRenderbuffers(1, &buffer.depth_stencil);
+	glBindRenderbuffer(GL_RENDERBUFFER, buffer.depth_stencil);
+	glRenderbufferStorage(GL_RENDERBUFFER, DEPTH24_STENCIL8, this->_width, this->_height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, buffer.depth_stencil);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, buffer.depth_stencil);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, 0);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, this->_width, this->_height);
+
+		spdlog::warn("frame chain: no packed depth stencil, the guest only gets depth");
+	}
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		spdlog::error("frame chain: framebuffer is incomplete ({:#x})", status);
+		return false;
+	}
+
+	return true;
+}
+
+bool FrameChain::create(std::uint32_t width, std::uint32_t height) {
+	this->_width = width;
+	this->_height = height;
+
+	for (auto& buffer : this->_buffers) {
+		if (!this->create_buffer(buffer)) {
+			this->destroy();
+			return false;
+		}
+	}
+
+	this->_enabled = true;
+
+	spdlog::info("frame chain: rendering offscreen at {}x{}", width, height);
+
+	return true;
+}
+
+void FrameChain::destroy() {
+	auto& ext = GlExtensions::get();
+
+	for (auto& buffer : this->_buffers) {
+		for (auto fence : {buffer.ready, buffer.released}) {
+			if (fence != nullptr) {
+				ext.delete_sync(fence);
+			}
+		}
+
+		glDeleteFramebuffers(1, &buffer.framebuffer);
+		glDeleteRenderbuffers(1, &buffer.depth_stencil);
+		glDeleteTextures(1, &buffer.texture);
+
+		buffer = Buffer{};
+	}
+
+	this->_enabled = false;
+}
+
+bool FrameChain::acquire() {
+	if (!this->_enabled) {
+		return true;
+	}
+
+	GlSync released = nullptr;
+
+	{
+		std::unique_lock lk{this->_lock};
+		this->_cv.wait(lk, [this] {
+			return this->_shutdown || this->free_buffer() != -1;
+		});
+
+		if (this->_shutdown) {
+			return false;
+		}
+
+		this->_back = this->free_buffer();
+		released = std::exchange(this->_buffers[this->_back].released, nullptr);
+	}
+
+	// the window may have only just stopped drawing from it
+	wait_fence(released);
+
+	return true;
+}
+
+void FrameChain::begin_frame() {
+	if (!this->_enabled || this->_back == -1) {
+		return;
+	}
+
+	// the guest expects whatever it bound last to still be bound
+	if (this->_guest_framebuffer == 0) {
+		glBindFramebuffer(GL_FRAMEBUFFER, this->_buffers[this->_back].framebuffer);
+	}
+}
+
+void FrameChain::end_frame() {
+	if (!this->_enabled || this->_back == -1) {
+		return;
+	}
+
+	auto& ext = GlExtensions::get();
+	auto& buffer = this->_buffers[this->_back];
+
+	if (ext.has_sync) {
+		buffer.ready = ext.fence_sync(GlExtensions::SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		// the other context can't see the fence until it's been submitted
+		glFlush();
+	} else {
+		glFinish();
+	}
+
+	{
+		std::scoped_lock lk{this->_lock};
+
+		// the window never got to the last one, so it gets dropped
+		if (this->_published != -1) {
+			auto& skipped = this->_buffers[this->_published];
+			if (skipped.ready != nullptr) {
+				ext.delete_sync(skipped.ready);
+				skipped.ready = nullptr;
+			}
+		}
+
+		this->_published = std::exchange(this->_back, -1);
+	}
+
+	this->_cv.notify_all();
+}
+
+void FrameChain::shutdown() {
+	{
+		std::scoped_lock lk{this->_lock};
+		this->_shutdown = true;
+	}
+
+	this->_cv.notify_all();
+}
+
+std::uint32_t FrameChain::bind_framebuffer(std::uint32_t target, std::uint32_t framebuffer) {
+	if (target == GL_FRAMEBUFFER || target == DRAW_FRAMEBUFFER) {
+		this->_guest_framebuffer = framebuffer;
+	}
+
+	if (framebuffer == 0 && this->_enabled && this->_back != -1) {
+		return this->_buffers[this->_back].framebuffer;
+	}
+
+	return framebuffer;
+}
+
+std::uint32_t FrameChain::guest_framebuffer(std::uint32_t framebuffer) const {
+	if (!this->_enabled || framebuffer == 0) {
+		return framebuffer;
+	}
+
+	for (const auto& buffer : this->_buffers) {
+		if (buffer.framebuffer == framebuffer) {
+			return 0;
+		}
+	}
+
+	return framebuffer;
+}
+
+bool FrameChain::create_present_program() {
+	auto vertex_shader = compile_shader(GL_VERTEX_SHADER, PRESENT_VERTEX_SHADER);
+	auto fragment_source = this->_filter == Filter::Sharp ? PRESENT_SHARP_FRAGMENT_SHADER : PRESENT_FRAGMENT_SHADER;
+	auto fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+
+	if (vertex_shader == 0 || fragment_shader == 0) {
+		glDeleteShader(vertex_shader);
+		glDeleteShader(fragment_shader);
+		return false;
+	}
+
+	auto program = glCreateProgram();
+	glAttachShader(program, vertex_shader);
+	glAttachShader(program, fragment_shader);
+
+	glBindAttribLocation(program, 0, "a_position");
+	glBindAttribLocation(program, 1, "a_texcoord");
+
+	glLinkProgram(program);
+
+	glDeleteShader(vertex_shader);
+	glDeleteShader(fragment_shader);
+
+	GLint status = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (!status) {
+		char log[512]{};
+		glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+		spdlog::error("failed to link present program: {}", log);
+
+		glDeleteProgram(program);
+		return false;
+	}
+
+	this->_program = program;
+
+	// the sharpening samples its neighbours, which are a texel away in the guest's resolution
+	if (auto texel = glGetUniformLocation(program, "u_texel"); texel != -1) {
+		glUseProgram(program);
+		glUniform2f(texel, 1.0f / this->_width, 1.0f / this->_height);
+		glUseProgram(0);
+	}
+
+	glGenBuffers(1, &this->_vertex_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, this->_vertex_buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(PRESENT_QUAD), PRESENT_QUAD, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return true;
+}
+
+bool FrameChain::present(std::int32_t width, std::int32_t height) {
+	auto& ext = GlExtensions::get();
+
+	auto fresh = false;
+	auto frame = -1;
+	GlSync ready = nullptr;
+
+	{
+		std::scoped_lock lk{this->_lock};
+
+		if (this->_published != -1) {
+			auto previous = std::exchange(this->_presenting, this->_published);
+			this->_published = -1;
+			fresh = true;
+
+			ready = std::exchange(this->_buffers[this->_presenting].ready, nullptr);
+
+			// everything drawn from the old frame is already submitted, so it can go back to the guest once that's done
+			if (previous != -1) {
+				if (ext.has_sync) {
+					this->_buffers[previous].released = ext.fence_sync(GlExtensions::SYNC_GPU_COMMANDS_COMPLETE, 0);
+					glFlush();
+				} else {
+					glFinish();
+				}
+			}
+		}
+
+		frame = this->_presenting;
+	}
+
+	if (fresh) {
+		this->_cv.notify_all();
+	}
+
+	wait_fence(ready);
+
+	glViewport(0, 0, width, height);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	if (frame == -1 || (this->_program == 0 && !this->create_present_program())) {
+		return fresh;
+	}
+
+	glDisable(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_SCISSOR_TEST);
+	glDisable(GL_CULL_FACE);
+	glDisable(GL_STENCIL_TEST);
+
+	glUseProgram(this->_program);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, this->_buffers[frame].texture);
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->_vertex_buffer);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), reinterpret_cast<const void*>(0));
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), reinterpret_cast<const void*>(2 * sizeof(float)));
+
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	glDisableVertexAttribArray(0);
+	glDisableVertexAttribArray(1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return fresh;
+}
+
+void FrameChain::destroy_present() {
+	if (this->_program != 0) {
+		glDeleteProgram(this->_program);
+		glDeleteBuffers(1, &this->_vertex_buffer);
+	}
+
+	this->_program = 0;
+	this->_vertex_buffer = 0;
+}
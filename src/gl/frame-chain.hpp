@@ -0,0 +1,159 @@
+#pragma once
+
+#ifndef _FRAME_CHAIN_HPP
+#define _FRAME_CHAIN_HPP
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * hands finished frames from the emulation thread to the thread that owns the window.
+ *
+ * the guest renders into one of two offscreen framebuffers instead of the default one, on a context of its own
+ * that shares objects with the window's. when a frame is done it's published, and the window thread draws
+ * whichever frame was published last every time it presents. a buffer isn't reused until the window has
+ * moved on from it, so the guest is never more than one frame ahead of what's on screen.
+ *
+ * the buffers don't have to match the window's size, they're scaled to fit when presented.
+ *
+ * until create is called (frontends that render on a single thread), framebuffer 0 is passed through as is
+ */
+class FrameChain {
+public:
+	enum class Filter {
+		Bilinear,
+
+		// bilinear, then an unsharp mask to win back some of the detail lost to upscaling
+		Sharp,
+	};
+
+private:
+	static constexpr std::uint32_t BUFFER_COUNT = 2;
+
+	// how long either side will wait on the other's gpu work before giving up on it
+	static constexpr std::uint64_t FENCE_TIMEOUT_NS = 100'000'000;
+
+	using GlSync = void*;
+
+	struct Buffer {
+		std::uint32_t framebuffer{0u};
+		std::uint32_t texture{0u};
+		std::uint32_t depth_stencil{0u};
+
+		// set when the guest has finished drawing into it
+		GlSync ready{nullptr};
+
+		// set when the window has finished drawing from it
+		GlSync released{nullptr};
+	};
+
+	std::array<Buffer, BUFFER_COUNT> _buffers{};
+
+	bool _enabled{false};
+	std::uint32_t _width{0u};
+	std::uint32_t _height{0u};
+
+	// framebuffer the guest thinks it has bound, where 0 is the screen
+	std::uint32_t _guest_framebuffer{0u};
+
+	std::mutex _lock{};
+	std::condition_variable _cv{};
+
+	// -1 if the slot is empty
+	std::int32_t _back{-1};
+	std::int32_t _published{-1};
+	std::int32_t _presenting{-1};
+
+	bool _shutdown{false};
+
+	Filter _filter{Filter::Bilinear};
+
+	// owned by the window's context
+	std::uint32_t _program{0u};
+	std::uint32_t _vertex_buffer{0u};
+
+	/**
+	 * waits for the fence to signal, then deletes it
+	 */
+	static void wait_fence(GlSync& fence);
+
+	/**
+	 * returns the first buffer that's neither published nor presenting, or -1. the lock has to be held
+	 */
+	std::int32_t free_buffer() const;
+
+	bool create_buffer(Buffer& buffer);
+	bool create_present_program();
+
+public:
+	/**
+	 * creates the framebuffers on the emulation context, using the size the guest was told the screen is
+	 */
+	bool create(std::uint32_t width, std::uint32_t height);
+
+	/**
+	 * destroys the framebuffers. the emulation context has to be current
+	 */
+	void destroy();
+
+	bool enabled() const {
+		return this->_enabled;
+	}
+
+	/**
+	 * emulation thread. waits for a buffer the window isn't using, returning false if the chain was shut down
+	 */
+	bool acquire();
+
+	/**
+	 * emulation thread. points framebuffer 0 at the acquired buffer
+	 */
+	void begin_frame();
+
+	/**
+	 * emulation thread. publishes the acquired buffer, everything for the frame has to be submitted already
+	 */
+	void end_frame();
+
+	/**
+	 * wakes up anything waiting in acquire, which will fail from then on
+	 */
+	void shutdown();
+
+	/**
+	 * the framebuffer to actually bind when the guest binds the given one
+	 */
+	std::uint32_t bind_framebuffer(std::uint32_t target, std::uint32_t framebuffer);
+
+	/**
+	 * maps a framebuffer the driver reported back to what the guest expects to see
+	 */
+	std::uint32_t guest_framebuffer(std::uint32_t framebuffer) const;
+
+	/**
+	 * window thread. has to be set before the first present
+	 */
+	void set_filter(Filter filter) {
+		this->_filter = filter;
+	}
+
+	/**
+	 * window thread. draws the latest frame stretched over the current framebuffer, or clears it if there isn't one.
+	 * returns true if the frame is one that hasn't been presented before
+	 */
+	bool present(std::int32_t width, std::int32_t height);
+
+	/**
+	 * window thread. destroys whatever present created, the window context has to be current
+	 */
+	void destroy_present();
+
+	FrameChain() = default;
+
+	FrameChain(const FrameChain&) = delete;
+	FrameChain& operator=(const FrameChain&) = delete;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "gl-batch.hpp"
+
+#include <array>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include "../environment.h"
+
+namespace {
+	// all arm (not thumb), so the encodings are fixed size and the entries can be written as words
+
+	constexpr std::uint32_t ARM_PUSH_R4_R5 = 0xe92d0030; // push {r4, r5}
+	constexpr std::uint32_t ARM_LDR_R4_LITERAL = 0xe59f4020; // ldr r4, [pc, #0x20]
+	constexpr std::uint32_t ARM_LDR_R5_R4 = 0xe5945000; // ldr r5, [r4]
+	constexpr std::uint32_t ARM_STMIA_R5_RECORD = 0xe8a5100f; // stmia r5!, {r0-r3, r12}
+	constexpr std::uint32_t ARM_STR_R5_R4 = 0xe5845000; // str r5, [r4]
+	constexpr std::uint32_t ARM_LDR_R4_R4_4 = 0xe5944004; // ldr r4, [r4, #4]
+	constexpr std::uint32_t ARM_CMP_R5_R4 = 0xe1550004; // cmp r5, r4
+	constexpr std::uint32_t ARM_POP_R4_R5 = 0xe8bd0030; // pop {r4, r5}
+	constexpr std::uint32_t ARM_BXLS_LR = 0x912fff1e; // bxls lr
+
+	constexpr std::uint32_t ARM_MOV_R12_IMM = 0xe3a0c000; // mov r12, #imm8
+	constexpr std::uint32_t ARM_LDR_PC_NEXT = 0xe51ff004; // ldr pc, [pc, #-4]
+
+	// offset of the svc that flushes a full ring, the literal goes after it and its return
+	constexpr std::uint32_t APPEND_TRAP_OFFSET = 9 * sizeof(std::uint32_t);
+	constexpr std::uint32_t APPEND_LITERAL_OFFSET = APPEND_TRAP_OFFSET + 2 * sizeof(std::uint32_t);
+	constexpr std::uint32_t APPEND_SIZE = APPEND_LITERAL_OFFSET + sizeof(std::uint32_t);
+
+	constexpr std::uint32_t ENTRY_SIZE = 3 * sizeof(std::uint32_t);
+}
+
+std::uint32_t GlBatch::allocate_code(std::uint32_t size) {
+	auto addr = this->_memory.get_next_addr();
+	auto padding = (4 - addr % 4) % 4;
+
+	this->_memory.allocate(padding + size);
+
+	return addr + padding;
+}
+
+void GlBatch::create_shim() {
+	this->_control = this->allocate_code(2 * sizeof(std::uint32_t));
+	this->_ring = this->allocate_code(RING_RECORDS * RECORD_SIZE);
+
+	this->_memory.write_word(this->_control, this->_ring);
+	this->_memory.write_word(this->_control + 4, this->_ring + (RING_RECORDS - 1) * RECORD_SIZE);
+
+	// entered with the entry index in r12, and the guest's arguments still in r0-r3
+	this->_append = this->allocate_code(APPEND_SIZE);
+
+	constexpr std::array<std::uint32_t, 9> append{
+		ARM_PUSH_R4_R5,
+		ARM_LDR_R4_LITERAL,
+		ARM_LDR_R5_R4,
+		ARM_STMIA_R5_RECORD,
+		ARM_STR_R5_R4,
+		ARM_LDR_R4_R4_4,
+		ARM_CMP_R5_R4,
+		ARM_POP_R4_R5,
+		// there's room for another record, so nothing else to do
+		ARM_BXLS_LR,
+	};
+
+	for (auto i = 0u; i < append.size(); i++) {
+		this->_memory.write_word(this->_append + i * sizeof(std::uint32_t), append[i]);
+	}
+
+	// svc and return
+	this->_syscalls.replace_fn(this->_append + APPEND_TRAP_OFFSET, &GlBatch::on_ring_full);
+
+	this->_memory.write_word(this->_append + APPEND_LITERAL_OFFSET, this->_control);
+}
+
+void GlBatch::on_ring_full(Environment& env) {
+	env.gl_batch().flush(env);
+}
+
+std::uint32_t GlBatch::add_entry(HandlerFunction fn) {
+	if (this->_entries.size() >= MAX_ENTRIES) {
+		throw std::out_of_range("too many batched gl entry points");
+	}
+
+	if (this->_append == 0) {
+		this->create_shim();
+	}
+
+	auto index = static_cast<std::uint32_t>(this->_entries.size());
+	this->_entries.push_back(fn);
+
+	auto entry = this->allocate_code(ENTRY_SIZE);
+
+	this->_memory.write_word(entry, ARM_MOV_R12_IMM | index);
+	this->_memory.write_word(entry + 4, ARM_LDR_PC_NEXT);
+	this->_memory.write_word(entry + 8, this->_append);
+
+	// no thumb bit, the entry is arm
+	return entry;
+}
+
+void GlBatch::flush(Environment& env) {
+	if (this->_append == 0) {
+		return;
+	}
+
+	auto end = this->_memory.read_word(this->_control);
+	if (end == this->_ring) {
+		return;
+	}
+
+	// the handlers take their arguments from the registers, which belong to whoever called into the host
+	auto& regs = env.current_cpu()->Regs();
+	std::array<std::uint32_t, 4> saved{regs[0], regs[1], regs[2], regs[3]};
+
+	// reset first, in case a handler ends up running guest code
+	this->_memory.write_word(this->_control, this->_ring);
+
+	for (auto record = this->_ring; record < end; record += RECORD_SIZE) {
+		auto words = this->_memory.read_bytes<std::uint32_t>(record);
+
+		auto index = words[4];
+		if (index >= this->_entries.size()) {
+			spdlog::error("gl batch: bad entry {} at {:#x}, dropping the rest of the ring", index, record);
+			break;
+		}
+
+		regs[0] = words[0];
+		regs[1] = words[1];
+		regs[2] = words[2];
+		regs[3] = words[3];
+
+		this->_entries[index](env);
+		this->_replayed++;
+	}
+
+	regs[0] = saved[0];
+	regs[1] = saved[1];
+	regs[2] = saved[2];
+	regs[3] = saved[3];
+
+	this->_flushes++;
+}
+
+void GlBatch::begin_frame() {
+	this->_replayed_last_frame = this->_replayed;
+	this->_flushes_last_frame = this->_flushes;
+
+	this->_replayed = 0;
+	this->_flushes = 0;
+}
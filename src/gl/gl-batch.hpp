@@ -0,0 +1,95 @@
+#pragma once
+
+#ifndef _GL_BATCH_HPP
+#define _GL_BATCH_HPP
+
+#include <cstdint>
+#include <vector>
+
+class Environment;
+class PagedMemory;
+class SyscallHandler;
+
+/**
+ * a tiny arm library living in guest memory, so cheap gl calls don't have to leave the jit.
+ *
+ * each batched entry point appends its index and r0-r3 to a ring in guest memory and returns straight away.
+ * the host only gets involved once the ring is full, or when the guest calls anything that isn't batched
+ * (draws, queries, anything taking a pointer), at which point the whole ring is replayed through the regular wrappers.
+ *
+ * only calls with at most four word sized arguments and no return value can be batched,
+ * and the ring assumes only the thread that owns the context calls into gl
+ */
+class GlBatch {
+public:
+	using HandlerFunction = void(*)(Environment& env);
+
+	// r0-r3, then the entry index. this is the order stm writes them in
+	static constexpr std::uint32_t RECORD_SIZE = 5 * sizeof(std::uint32_t);
+	static constexpr std::uint32_t RING_RECORDS = 4096;
+
+	// the entry index is loaded as an immediate, which can't go past this
+	static constexpr std::uint32_t MAX_ENTRIES = 256;
+
+private:
+	PagedMemory& _memory;
+	SyscallHandler& _syscalls;
+
+	std::vector<HandlerFunction> _entries{};
+
+	// the write pointer, followed by the last address a record can be written at
+	std::uint32_t _control{0u};
+	std::uint32_t _ring{0u};
+	std::uint32_t _append{0u};
+
+	std::uint32_t _replayed{0u};
+	std::uint32_t _flushes{0u};
+	std::uint32_t _replayed_last_frame{0u};
+	std::uint32_t _flushes_last_frame{0u};
+
+	/**
+	 * reserves word aligned guest memory, returning its address
+	 */
+	std::uint32_t allocate_code(std::uint32_t size);
+
+	/**
+	 * writes the ring and the shared append routine, done once on the first entry
+	 */
+	void create_shim();
+
+	/**
+	 * called by the shim when the ring fills up
+	 */
+	static void on_ring_full(Environment& env);
+
+public:
+	/**
+	 * writes an entry point that records its arguments for the given handler, returning its (arm) address
+	 */
+	std::uint32_t add_entry(HandlerFunction fn);
+
+	/**
+	 * replays everything recorded so far, on the calling thread's cpu. r0-r3 are left as they were
+	 */
+	void flush(Environment& env);
+
+	/**
+	 * rolls the counters over
+	 */
+	void begin_frame();
+
+	std::uint32_t replayed_last_frame() const {
+		return this->_replayed_last_frame;
+	}
+
+	std::uint32_t flushes_last_frame() const {
+		return this->_flushes_last_frame;
+	}
+
+	GlBatch(PagedMemory& memory, SyscallHandler& syscalls) : _memory{memory}, _syscalls{syscalls} {}
+
+	GlBatch(const GlBatch&) = delete;
+	GlBatch& operator=(const GlBatch&) = delete;
+};
+
+#endif
@@ -0,0 +1,536 @@
+#include "gl-commands.hpp"
+
+#ifdef SILENE_USE_EGL
+#include <GLES2/gl2.h>
+#else
+#include <glad/glad.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+namespace {
+	struct TargetName {
+		std::uint32_t target;
+		std::uint32_t name;
+	};
+
+	struct Value {
+		std::uint32_t value;
+	};
+
+	struct FloatValue {
+		float value;
+	};
+
+	struct Capability {
+		std::uint32_t cap;
+		std::uint32_t enabled;
+	};
+
+	struct Color {
+		float red;
+		float green;
+		float blue;
+		float alpha;
+	};
+
+	struct Rect {
+		std::int32_t x;
+		std::int32_t y;
+		std::uint32_t width;
+		std::uint32_t height;
+	};
+
+	struct Parameter {
+		std::uint32_t target;
+		std::uint32_t name;
+		std::int32_t param;
+	};
+
+	struct AttribPointer {
+		std::uint32_t index;
+		std::int32_t size;
+		std::uint32_t type;
+		std::uint32_t normalized;
+		std::uint32_t stride;
+		std::uint32_t offset;
+	};
+
+	struct Uniform1i {
+		std::int32_t location;
+		std::int32_t v0;
+	};
+
+	struct Uniformf {
+		std::int32_t location;
+		std::uint32_t components;
+		float v[4];
+	};
+
+	struct UniformArray {
+		std::int32_t location;
+		std::uint32_t count;
+		std::uint32_t transpose;
+	};
+
+	struct DrawArrays {
+		std::uint32_t mode;
+		std::int32_t first;
+		std::uint32_t count;
+	};
+
+	struct DrawElements {
+		std::uint32_t mode;
+		std::uint32_t count;
+		std::uint32_t type;
+		std::uint32_t offset;
+	};
+
+	struct BufferData {
+		std::uint32_t target;
+		std::uint32_t size;
+		std::uint32_t usage;
+	};
+
+	struct BufferSubData {
+		std::uint32_t target;
+		std::uint32_t offset;
+	};
+
+	struct TexImage2D {
+		std::uint32_t target;
+		std::int32_t level;
+		std::int32_t internalformat;
+		std::uint32_t width;
+		std::uint32_t height;
+		std::int32_t border;
+		std::uint32_t format;
+		std::uint32_t type;
+	};
+
+	struct FramebufferTexture2D {
+		std::uint32_t target;
+		std::uint32_t attachment;
+		std::uint32_t textarget;
+		std::uint32_t texture;
+		std::int32_t level;
+	};
+
+	struct FramebufferRenderbuffer {
+		std::uint32_t target;
+		std::uint32_t attachment;
+		std::uint32_t renderbuffer_target;
+		std::uint32_t renderbuffer;
+	};
+
+	template <typename T>
+	T read(const std::uint8_t*& it) {
+		T value;
+		std::memcpy(&value, it, sizeof(T));
+		it += sizeof(T);
+
+		return value;
+	}
+
+	/**
+	 * returns the payload and moves past it. the payload is null if nothing was recorded
+	 */
+	const void* read_payload(const std::uint8_t*& it) {
+		auto size = read<std::uint32_t>(it);
+		auto payload = it;
+		it += size;
+
+		return size != 0 ? payload : nullptr;
+	}
+
+	std::uint32_t pixel_size(std::uint32_t format, std::uint32_t type) {
+		switch (type) {
+			case GL_UNSIGNED_SHORT_4_4_4_4:
+			case GL_UNSIGNED_SHORT_5_5_5_1:
+			case GL_UNSIGNED_SHORT_5_6_5:
+				return 2;
+			case GL_UNSIGNED_BYTE:
+				switch (format) {
+					case GL_ALPHA:
+					case GL_LUMINANCE:
+						return 1;
+					case GL_LUMINANCE_ALPHA:
+						return 2;
+					case GL_RGB:
+						return 3;
+					case GL_RGBA:
+						return 4;
+					default:
+						return 0;
+				}
+			default:
+				return 0;
+		}
+	}
+}
+
+void GlCommandStream::bind_buffer(std::uint32_t target, std::uint32_t buffer) {
+	this->encode(Op::BindBuffer, TargetName{target, buffer});
+}
+
+void GlCommandStream::active_texture(std::uint32_t texture) {
+	this->encode(Op::ActiveTexture, Value{texture});
+}
+
+void GlCommandStream::bind_texture(std::uint32_t target, std::uint32_t texture) {
+	this->encode(Op::BindTexture, TargetName{target, texture});
+}
+
+void GlCommandStream::use_program(std::uint32_t program) {
+	this->encode(Op::UseProgram, Value{program});
+}
+
+void GlCommandStream::bind_framebuffer(std::uint32_t target, std::uint32_t framebuffer) {
+	this->encode(Op::BindFramebuffer, TargetName{target, framebuffer});
+}
+
+void GlCommandStream::bind_renderbuffer(std::uint32_t target, std::uint32_t renderbuffer) {
+	this->encode(Op::BindRenderbuffer, TargetName{target, renderbuffer});
+}
+
+void GlCommandStream::set_capability(std::uint32_t cap, bool enabled) {
+	this->encode(Op::Capability, Capability{cap, enabled});
+}
+
+void GlCommandStream::blend_func(std::uint32_t sfactor, std::uint32_t dfactor) {
+	this->encode(Op::BlendFunc, TargetName{sfactor, dfactor});
+}
+
+void GlCommandStream::depth_func(std::uint32_t func) {
+	this->encode(Op::DepthFunc, Value{func});
+}
+
+void GlCommandStream::clear_color(float red, float green, float blue, float alpha) {
+	this->encode(Op::ClearColor, Color{red, green, blue, alpha});
+}
+
+void GlCommandStream::clear_depth(float depth) {
+	this->encode(Op::ClearDepth, FloatValue{depth});
+}
+
+void GlCommandStream::line_width(float width) {
+	this->encode(Op::LineWidth, FloatValue{width});
+}
+
+void GlCommandStream::viewport(std::int32_t x, std::int32_t y, std::uint32_t width, std::uint32_t height) {
+	this->encode(Op::Viewport, Rect{x, y, width, height});
+}
+
+void GlCommandStream::scissor(std::int32_t x, std::int32_t y, std::uint32_t width, std::uint32_t height) {
+	this->encode(Op::Scissor, Rect{x, y, width, height});
+}
+
+void GlCommandStream::pixel_store(std::uint32_t name, std::int32_t param) {
+	this->encode(Op::PixelStore, Parameter{0u, name, param});
+}
+
+void GlCommandStream::set_vertex_attrib_array(std::uint32_t index, bool enabled) {
+	this->encode(Op::VertexAttribArray, Capability{index, enabled});
+}
+
+void GlCommandStream::vertex_attrib_pointer(std::uint32_t index, std::int32_t size, std::uint32_t type, bool normalized, std::uint32_t stride, std::uint32_t offset) {
+	this->encode(Op::VertexAttribPointer, AttribPointer{index, size, type, normalized, stride, offset});
+}
+
+void GlCommandStream::tex_parameteri(std::uint32_t target, std::uint32_t name, std::int32_t param) {
+	this->encode(Op::TexParameteri, Parameter{target, name, param});
+}
+
+void GlCommandStream::uniform_1i(std::int32_t location, std::int32_t v0) {
+	this->encode(Op::Uniform1i, Uniform1i{location, v0});
+}
+
+void GlCommandStream::uniform_f(std::int32_t location, std::uint32_t components, float v0, float v1, float v2, float v3) {
+	this->encode(Op::Uniformf, Uniformf{location, components, {v0, v1, v2, v3}});
+}
+
+void GlCommandStream::uniform_4fv(std::int32_t location, std::uint32_t count, const float* value) {
+	this->encode(Op::Uniform4fv, UniformArray{location, count, false}, value, count * 4 * sizeof(float));
+}
+
+void GlCommandStream::uniform_matrix_4fv(std::int32_t location, std::uint32_t count, bool transpose, const float* value) {
+	this->encode(Op::UniformMatrix4fv, UniformArray{location, count, transpose}, value, count * 16 * sizeof(float));
+}
+
+void GlCommandStream::clear(std::uint32_t mask) {
+	this->encode(Op::Clear, Value{mask});
+}
+
+void GlCommandStream::draw_arrays(std::uint32_t mode, std::int32_t first, std::uint32_t count) {
+	this->encode(Op::DrawArrays, DrawArrays{mode, first, count});
+}
+
+void GlCommandStream::draw_elements(std::uint32_t mode, std::uint32_t count, std::uint32_t type, std::uint32_t offset) {
+	this->encode(Op::DrawElements, DrawElements{mode, count, type, offset});
+}
+
+void GlCommandStream::buffer_data(std::uint32_t target, std::uint32_t size, const void* data, std::uint32_t usage) {
+	this->encode(Op::BufferData, BufferData{target, size, usage}, data, data != nullptr ? size : 0u);
+}
+
+void GlCommandStream::buffer_sub_data(std::uint32_t target, std::uint32_t offset, std::uint32_t size, const void* data) {
+	this->encode(Op::BufferSubData, BufferSubData{target, offset}, data, size);
+}
+
+bool GlCommandStream::tex_image_2d(std::uint32_t target, std::int32_t level, std::int32_t internalformat, std::uint32_t width, std::uint32_t height, std::int32_t border, std::uint32_t format, std::uint32_t type, const void* pixels, std::int32_t unpack_alignment) {
+	auto size = 0u;
+	if (pixels != nullptr && width != 0 && height != 0) {
+		auto pixel_bytes = pixel_size(format, type);
+		if (pixel_bytes == 0 || unpack_alignment <= 0) {
+			return false;
+		}
+
+		// the last row isn't padded out to the alignment
+		auto alignment = static_cast<std::uint32_t>(unpack_alignment);
+		auto stride = (width * pixel_bytes + alignment - 1) / alignment * alignment;
+		size = stride * (height - 1) + width * pixel_bytes;
+	}
+
+	this->encode(Op::TexImage2D, TexImage2D{target, level, internalformat, width, height, border, format, type}, pixels, size);
+	return true;
+}
+
+void GlCommandStream::delete_buffers(std::uint32_t n, const std::uint32_t* buffers) {
+	this->encode(Op::DeleteBuffers, Value{n}, buffers, n * sizeof(std::uint32_t));
+}
+
+void GlCommandStream::delete_textures(std::uint32_t n, const std::uint32_t* textures) {
+	this->encode(Op::DeleteTextures, Value{n}, textures, n * sizeof(std::uint32_t));
+}
+
+void GlCommandStream::framebuffer_texture_2d(std::uint32_t target, std::uint32_t attachment, std::uint32_t textarget, std::uint32_t texture, std::int32_t level) {
+	this->encode(Op::FramebufferTexture2D, FramebufferTexture2D{target, attachment, textarget, texture, level});
+}
+
+void GlCommandStream::framebuffer_renderbuffer(std::uint32_t target, std::uint32_t attachment, std::uint32_t renderbuffer_target, std::uint32_t renderbuffer) {
+	this->encode(Op::FramebufferRenderbuffer, FramebufferRenderbuffer{target, attachment, renderbuffer_target, renderbuffer});
+}
+
+void GlCommandStream::execute(const std::uint8_t*& it) {
+	auto op = read<Op>(it);
+
+	switch (op) {
+		case Op::BindBuffer: {
+			auto cmd = read<TargetName>(it);
+			glBindBuffer(cmd.target, cmd.name);
+			break;
+		}
+		case Op::ActiveTexture:
+			glActiveTexture(read<Value>(it).value);
+			break;
+		case Op::BindTexture: {
+			auto cmd = read<TargetName>(it);
+			glBindTexture(cmd.target, cmd.name);
+			break;
+		}
+		case Op::UseProgram:
+			glUseProgram(read<Value>(it).value);
+			break;
+		case Op::BindFramebuffer: {
+			auto cmd = read<TargetName>(it);
+			glBindFramebuffer(cmd.target, cmd.name);
+			break;
+		}
+		case Op::BindRenderbuffer: {
+			auto cmd = read<TargetName>(it);
+			glBindRenderbuffer(cmd.target, cmd.name);
+			break;
+		}
+		case Op::Capability: {
+			auto cmd = read<Capability>(it);
+			if (cmd.enabled) {
+				glEnable(cmd.cap);
+			} else {
+				glDisable(cmd.cap);
+			}
+			break;
+		}
+		case Op::BlendFunc: {
+			auto cmd = read<TargetName>(it);
+			glBlendFunc(cmd.target, cmd.name);
+			break;
+		}
+		case Op::DepthFunc:
+			glDepthFunc(read<Value>(it).value);
+			break;
+		case Op::ClearColor: {
+			auto cmd = read<Color>(it);
+			glClearColor(cmd.red, cmd.green, cmd.blue, cmd.alpha);
+			break;
+		}
+		case Op::ClearDepth:
+			// this function is unavailable on desktop opengl
+#ifdef SILENE_USE_EGL
+			glClearDepthf(read<FloatValue>(it).value);
+#else
+			glClearDepth(read<FloatValue>(it).value);
+#endif
+			break;
+		case Op::LineWidth:
+			glLineWidth(read<FloatValue>(it).value);
+			break;
+		case Op::Viewport: {
+			auto cmd = read<Rect>(it);
+			glViewport(cmd.x, cmd.y, cmd.width, cmd.height);
+			break;
+		}
+		case Op::Scissor: {
+			auto cmd = read<Rect>(it);
+			glScissor(cmd.x, cmd.y, cmd.width, cmd.height);
+			break;
+		}
+		case Op::PixelStore: {
+			auto cmd = read<Parameter>(it);
+			glPixelStorei(cmd.name, cmd.param);
+			break;
+		}
+		case Op::VertexAttribArray: {
+			auto cmd = read<Capability>(it);
+			if (cmd.enabled) {
+				glEnableVertexAttribArray(cmd.cap);
+			} else {
+				glDisableVertexAttribArray(cmd.cap);
+			}
+			break;
+		}
+		case Op::VertexAttribPointer: {
+			auto cmd = read<AttribPointer>(it);
+			glVertexAttribPointer(cmd.index, cmd.size, cmd.type, cmd.normalized, cmd.stride, reinterpret_cast<void*>(static_cast<std::uintptr_t>(cmd.offset)));
+			break;
+		}
+		case Op::TexParameteri: {
+			auto cmd = read<Parameter>(it);
+			glTexParameteri(cmd.target, cmd.name, cmd.param);
+			break;
+		}
+		case Op::Uniform1i: {
+			auto cmd = read<Uniform1i>(it);
+			glUniform1i(cmd.location, cmd.v0);
+			break;
+		}
+		case Op::Uniformf: {
+			auto cmd = read<Uniformf>(it);
+			switch (cmd.components) {
+				case 1:
+					glUniform1f(cmd.location, cmd.v[0]);
+					break;
+				case 2:
+					glUniform2f(cmd.location, cmd.v[0], cmd.v[1]);
+					break;
+				case 3:
+					glUniform3f(cmd.location, cmd.v[0], cmd.v[1], cmd.v[2]);
+					break;
+				default:
+					glUniform4f(cmd.location, cmd.v[0], cmd.v[1], cmd.v[2], cmd.v[3]);
+					break;
+			}
+			break;
+		}
+		case Op::Uniform4fv: {
+			auto cmd = read<UniformArray>(it);
+			auto value = read_payload(it);
+			glUniform4fv(cmd.location, cmd.count, static_cast<const float*>(value));
+			break;
+		}
+		case Op::UniformMatrix4fv: {
+			auto cmd = read<UniformArray>(it);
+			auto value = read_payload(it);
+			glUniformMatrix4fv(cmd.location, cmd.count, cmd.transpose, static_cast<const float*>(value));
+			break;
+		}
+		case Op::Clear:
+			glClear(read<Value>(it).value);
+			break;
+		case Op::DrawArrays: {
+			auto cmd = read<DrawArrays>(it);
+			glDrawArrays(cmd.mode, cmd.first, cmd.count);
+			break;
+		}
+		case Op::DrawElements: {
+			auto cmd = read<DrawElements>(it);
+			glDrawElements(cmd.mode, cmd.count, cmd.type, reinterpret_cast<void*>(static_cast<std::uintptr_t>(cmd.offset)));
+			break;
+		}
+		case Op::BufferData: {
+			auto cmd = read<BufferData>(it);
+			auto data = read_payload(it);
+			glBufferData(cmd.target, cmd.size, data, cmd.usage);
+			break;
+		}
+		case Op::BufferSubData: {
+			auto cmd = read<BufferSubData>(it);
+			auto size = read<std::uint32_t>(it);
+			glBufferSubData(cmd.target, cmd.offset, size, it);
+			it += size;
+			break;
+		}
+		case Op::TexImage2D: {
+			auto cmd = read<TexImage2D>(it);
+			auto pixels = read_payload(it);
+			glTexImage2D(cmd.target, cmd.level, cmd.internalformat, cmd.width, cmd.height, cmd.border, cmd.format, cmd.type, pixels);
+			break;
+		}
+		case Op::DeleteBuffers: {
+			auto n = read<Value>(it).value;
+			auto buffers = read_payload(it);
+			glDeleteBuffers(n, static_cast<const GLuint*>(buffers));
+			break;
+		}
+		case Op::DeleteTextures: {
+			auto n = read<Value>(it).value;
+			auto textures = read_payload(it);
+			glDeleteTextures(n, static_cast<const GLuint*>(textures));
+			break;
+		}
+		case Op::FramebufferTexture2D: {
+			auto cmd = read<FramebufferTexture2D>(it);
+			glFramebufferTexture2D(cmd.target, cmd.attachment, cmd.textarget, cmd.texture, cmd.level);
+			break;
+		}
+		case Op::FramebufferRenderbuffer: {
+			auto cmd = read<FramebufferRenderbuffer>(it);
+			glFramebufferRenderbuffer(cmd.target, cmd.attachment, cmd.renderbuffer_target, cmd.renderbuffer);
+			break;
+		}
+	}
+}
+
+void GlCommandStream::flush() {
+	// anything talking to the driver directly flushes first, so this is where held back work has to go out too
+	this->run_barrier();
+
+	if (this->_pending == 0) {
+		return;
+	}
+
+	const auto* it = this->_buffer.data();
+	const auto* end = it + this->_buffer.size();
+
+	while (it < end) {
+		execute(it);
+	}
+
+	this->_commands += this->_pending;
+	this->_flushes++;
+
+	this->_pending = 0;
+	this->_buffer.clear();
+}
+
+void GlCommandStream::begin_frame() {
+	if (this->_pending != 0) {
+		spdlog::warn("gl command stream has {} commands left over from the last frame", this->_pending);
+		this->flush();
+	}
+
+	this->_commands_last_frame = this->_commands;
+	this->_flushes_last_frame = this->_flushes;
+
+	this->_commands = 0;
+	this->_flushes = 0;
+}
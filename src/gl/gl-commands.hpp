@@ -0,0 +1,236 @@
+#pragma once
+
+#ifndef _GL_COMMANDS_HPP
+#define _GL_COMMANDS_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/**
+ * records gl calls that don't return anything, so the driver sees them in one go instead of between guest code.
+ *
+ * every call is a one byte op followed by its arguments, and whatever guest memory it points to is copied in
+ * after that, so the guest is free to reuse it immediately. calls that need an answer from the driver
+ * have to flush first, as does anything else that talks to the driver directly.
+ *
+ * flushing is what actually calls into the driver, so it has to happen on whichever thread has the context.
+ *
+ * work that's being held back somewhere else can keep its place in the stream with a barrier,
+ * which runs right before the next command is recorded or anything is submitted
+ */
+class GlCommandStream {
+public:
+	enum class Op : std::uint8_t {
+		BindBuffer,
+		ActiveTexture,
+		BindTexture,
+		UseProgram,
+		BindFramebuffer,
+		BindRenderbuffer,
+		Capability,
+		BlendFunc,
+		DepthFunc,
+		ClearColor,
+		ClearDepth,
+		LineWidth,
+		Viewport,
+		Scissor,
+		PixelStore,
+		VertexAttribArray,
+		VertexAttribPointer,
+		TexParameteri,
+		Uniform1i,
+		Uniformf,
+		Uniform4fv,
+		UniformMatrix4fv,
+		Clear,
+		DrawArrays,
+		DrawElements,
+		BufferData,
+		BufferSubData,
+		TexImage2D,
+		DeleteBuffers,
+		DeleteTextures,
+		FramebufferTexture2D,
+		FramebufferRenderbuffer,
+	};
+
+	static constexpr std::size_t INITIAL_CAPACITY = 1024 * 1024;
+
+	// past this, the commands are submitted early rather than holding onto more memory
+	static constexpr std::size_t FLUSH_THRESHOLD = 16 * 1024 * 1024;
+
+private:
+	std::vector<std::uint8_t> _buffer{};
+	std::uint32_t _pending{0u};
+
+	std::uint32_t _commands{0u};
+	std::uint32_t _flushes{0u};
+	std::uint32_t _commands_last_frame{0u};
+	std::uint32_t _flushes_last_frame{0u};
+
+	std::function<void()> _barrier{};
+	bool _barrier_armed{false};
+
+	void run_barrier() {
+		if (this->_barrier_armed) {
+			this->_barrier_armed = false;
+			this->_barrier();
+		}
+	}
+
+	template <typename T>
+	void write(const T& value) {
+		auto offset = this->_buffer.size();
+		this->_buffer.resize(offset + sizeof(T));
+		std::memcpy(this->_buffer.data() + offset, &value, sizeof(T));
+	}
+
+	template <typename T>
+	void encode(Op op, const T& args) {
+		this->run_barrier();
+
+		this->write(op);
+		this->write(args);
+
+		this->_pending++;
+	}
+
+	template <typename T>
+	void encode(Op op, const T& args, const void* payload, std::uint32_t size) {
+		this->run_barrier();
+
+		this->write(op);
+		this->write(args);
+		this->write(size);
+
+		if (size != 0) {
+			auto offset = this->_buffer.size();
+			this->_buffer.resize(offset + size);
+			std::memcpy(this->_buffer.data() + offset, payload, size);
+		}
+
+		this->_pending++;
+
+		if (this->_buffer.size() >= FLUSH_THRESHOLD) {
+			this->flush();
+		}
+	}
+
+	/**
+	 * decodes a single command and submits it, moving the pointer past it
+	 */
+	static void execute(const std::uint8_t*& it);
+
+public:
+	void bind_buffer(std::uint32_t target, std::uint32_t buffer);
+	void active_texture(std::uint32_t texture);
+	void bind_texture(std::uint32_t target, std::uint32_t texture);
+	void use_program(std::uint32_t program);
+	void bind_framebuffer(std::uint32_t target, std::uint32_t framebuffer);
+	void bind_renderbuffer(std::uint32_t target, std::uint32_t renderbuffer);
+
+	void set_capability(std::uint32_t cap, bool enabled);
+
+	void blend_func(std::uint32_t sfactor, std::uint32_t dfactor);
+	void depth_func(std::uint32_t func);
+	void clear_color(float red, float green, float blue, float alpha);
+	void clear_depth(float depth);
+	void line_width(float width);
+
+	void viewport(std::int32_t x, std::int32_t y, std::uint32_t width, std::uint32_t height);
+	void scissor(std::int32_t x, std::int32_t y, std::uint32_t width, std::uint32_t height);
+
+	void pixel_store(std::uint32_t name, std::int32_t param);
+
+	void set_vertex_attrib_array(std::uint32_t index, bool enabled);
+
+	/**
+	 * only for attribs sourced from a buffer, as the pointer is kept as an offset
+	 */
+	void vertex_attrib_pointer(std::uint32_t index, std::int32_t size, std::uint32_t type, bool normalized, std::uint32_t stride, std::uint32_t offset);
+
+	void tex_parameteri(std::uint32_t target, std::uint32_t name, std::int32_t param);
+
+	void uniform_1i(std::int32_t location, std::int32_t v0);
+
+	/**
+	 * covers glUniform1f through glUniform4f, unused components are ignored
+	 */
+	void uniform_f(std::int32_t location, std::uint32_t components, float v0, float v1 = 0.0f, float v2 = 0.0f, float v3 = 0.0f);
+
+	void uniform_4fv(std::int32_t location, std::uint32_t count, const float* value);
+	void uniform_matrix_4fv(std::int32_t location, std::uint32_t count, bool transpose, const float* value);
+
+	void clear(std::uint32_t mask);
+
+	void draw_arrays(std::uint32_t mode, std::int32_t first, std::uint32_t count);
+
+	/**
+	 * only for indices in an element buffer, the indices are an offset into it
+	 */
+	void draw_elements(std::uint32_t mode, std::uint32_t count, std::uint32_t type, std::uint32_t offset);
+
+	void buffer_data(std::uint32_t target, std::uint32_t size, const void* data, std::uint32_t usage);
+	void buffer_sub_data(std::uint32_t target, std::uint32_t offset, std::uint32_t size, const void* data);
+
+	/**
+	 * copies the pixels with the given unpack alignment. returns false if the format isn't understood,
+	 * in which case the call has to go to the driver directly
+	 */
+	bool tex_image_2d(std::uint32_t target, std::int32_t level, std::int32_t internalformat, std::uint32_t width, std::uint32_t height, std::int32_t border, std::uint32_t format, std::uint32_t type, const void* pixels, std::int32_t unpack_alignment);
+
+	void delete_buffers(std::uint32_t n, const std::uint32_t* buffers);
+	void delete_textures(std::uint32_t n, const std::uint32_t* textures);
+
+	void framebuffer_texture_2d(std::uint32_t target, std::uint32_t attachment, std::uint32_t textarget, std::uint32_t texture, std::int32_t level);
+	void framebuffer_renderbuffer(std::uint32_t target, std::uint32_t attachment, std::uint32_t renderbuffer_target, std::uint32_t renderbuffer);
+
+	/**
+	 * submits everything that has been recorded, in order
+	 */
+	void flush();
+
+	/**
+	 * sets what runs once the barrier is armed. there's only the one
+	 */
+	void set_barrier(std::function<void()> barrier) {
+		this->_barrier = std::move(barrier);
+	}
+
+	/**
+	 * makes the barrier run before the next command, only once
+	 */
+	void arm_barrier() {
+		this->_barrier_armed = true;
+	}
+
+	bool empty() const {
+		return this->_pending == 0;
+	}
+
+	/**
+	 * rolls the counters over, the stream should already be flushed
+	 */
+	void begin_frame();
+
+	std::uint32_t commands_last_frame() const {
+		return this->_commands_last_frame;
+	}
+
+	std::uint32_t flushes_last_frame() const {
+		return this->_flushes_last_frame;
+	}
+
+	GlCommandStream() {
+		this->_buffer.reserve(INITIAL_CAPACITY);
+	}
+
+	GlCommandStream(const GlCommandStream&) = delete;
+	GlCommandStream& operator=(const GlCommandStream&) = delete;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "gl-extensions.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <string_view>
+
+#ifdef SILENE_USE_EGL
+#include <GLES2/gl2.h>
+#else
+#include <glad/glad.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+namespace {
+	GlExtensions::Functions functions{};
+
+	struct ContextVersion {
+		int major{0};
+		int minor{0};
+		bool es{false};
+
+		bool at_least(int req_major, int req_minor) const {
+			return this->major > req_major || (this->major == req_major && this->minor >= req_minor);
+		}
+	};
+
+	ContextVersion get_context_version() {
+		ContextVersion version{};
+
+		auto version_str = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+		if (version_str == nullptr) {
+			return version;
+		}
+
+		// gles prefixes its version, desktop gl starts with the number
+		constexpr std::string_view es_prefix = "OpenGL ES ";
+		if (std::strncmp(version_str, es_prefix.data(), es_prefix.size()) == 0) {
+			version.es = true;
+			version_str += es_prefix.size();
+		}
+
+		std::sscanf(version_str, "%d.%d", &version.major, &version.minor);
+
+		return version;
+	}
+
+	bool has_extension(std::string_view extensions, std::string_view name) {
+		auto pos = extensions.find(name);
+		while (pos != std::string_view::npos) {
+			// make sure this isn't just the prefix of some other extension
+			auto end = pos + name.size();
+			auto at_start = pos == 0 || extensions[pos - 1] == ' ';
+			auto at_end = end == extensions.size() || extensions[end] == ' ';
+			if (at_start && at_end) {
+				return true;
+			}
+
+			pos = extensions.find(name, end);
+		}
+
+		return false;
+	}
+
+	template <typename T>
+	void resolve(T& fn, GlExtensions::ProcLoader loader, std::initializer_list<const char*> names) {
+		for (auto name : names) {
+			auto proc = loader(name);
+			if (proc != nullptr) {
+				fn = reinterpret_cast<T>(proc);
+				return;
+			}
+		}
+
+		fn = nullptr;
+	}
+}
+
+void GlExtensions::load(ProcLoader loader) {
+	functions = Functions{};
+
+	auto version = get_context_version();
+
+	auto extensions_str = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+	std::string_view extensions = extensions_str != nullptr ? extensions_str : "";
+
+	// some loaders will happily return a pointer for anything, so only resolve what the context says it has
+	functions.is_es = version.es;
+
+	if (version.es) {
+		functions.has_sync = version.at_least(3, 0);
+		functions.has_map_buffer_range = version.at_least(3, 0) || has_extension(extensions, "GL_EXT_map_buffer_range");
+		functions.has_buffer_storage = has_extension(extensions, "GL_EXT_buffer_storage");
+		functions.has_pixel_buffer = version.at_least(3, 0) || has_extension(extensions, "GL_NV_pixel_buffer_object");
+		functions.has_program_binary = version.at_least(3, 0) || has_extension(extensions, "GL_OES_get_program_binary");
+		functions.has_timer_query = has_extension(extensions, "GL_EXT_disjoint_timer_query");
+	} else {
+		functions.has_sync = version.at_least(3, 2) || has_extension(extensions, "GL_ARB_sync");
+		functions.has_map_buffer_range = version.at_least(3, 0) || has_extension(extensions, "GL_ARB_map_buffer_range");
+		functions.has_buffer_storage = version.at_least(4, 4) || has_extension(extensions, "GL_ARB_buffer_storage");
+		functions.has_pixel_buffer = version.at_least(2, 1) || has_extension(extensions, "GL_ARB_pixel_buffer_object");
+		functions.has_program_binary = version.at_least(4, 1) || has_extension(extensions, "GL_ARB_get_program_binary");
+		functions.has_timer_query = version.at_least(3, 3) || has_extension(extensions, "GL_ARB_timer_query");
+	}
+
+	if (functions.has_sync) {
+		resolve(functions.fence_sync, loader, {"glFenceSync"});
+		resolve(functions.client_wait_sync, loader, {"glClientWaitSync"});
+		resolve(functions.delete_sync, loader, {"glDeleteSync"});
+
+		functions.has_sync = functions.fence_sync && functions.client_wait_sync && functions.delete_sync;
+	}
+
+	if (functions.has_map_buffer_range) {
+		resolve(functions.map_buffer_range, loader, {"glMapBufferRange", "glMapBufferRangeEXT"});
+		resolve(functions.unmap_buffer, loader, {"glUnmapBuffer", "glUnmapBufferOES"});
+
+		functions.has_map_buffer_range = functions.map_buffer_range && functions.unmap_buffer;
+	}
+
+	if (functions.has_buffer_storage) {
+		resolve(functions.buffer_storage, loader, {"glBufferStorage", "glBufferStorageEXT"});
+
+		// persistent mappings are useless without being able to map them
+		functions.has_buffer_storage = functions.buffer_storage && functions.has_map_buffer_range;
+	}
+
+	if (functions.has_program_binary) {
+		resolve(functions.get_program_binary, loader, {"glGetProgramBinary", "glGetProgramBinaryOES"});
+		resolve(functions.program_binary, loader, {"glProgramBinary", "glProgramBinaryOES"});
+		if (!version.es || version.at_least(3, 0)) {
+			resolve(functions.program_parameteri, loader, {"glProgramParameteri"});
+		}
+
+		functions.has_program_binary = functions.get_program_binary && functions.program_binary;
+	}
+
+	if (functions.has_timer_query) {
+		resolve(functions.gen_queries, loader, {"glGenQueries", "glGenQueriesEXT"});
+		resolve(functions.delete_queries, loader, {"glDeleteQueries", "glDeleteQueriesEXT"});
+		resolve(functions.begin_query, loader, {"glBeginQuery", "glBeginQueryEXT"});
+		resolve(functions.end_query, loader, {"glEndQuery", "glEndQueryEXT"});
+		resolve(functions.get_query_object_uiv, loader, {"glGetQueryObjectuiv", "glGetQueryObjectuivEXT"});
+		resolve(functions.get_query_object_ui64v, loader, {"glGetQueryObjectui64v", "glGetQueryObjectui64vEXT"});
+
+		functions.has_timer_query = functions.gen_queries && functions.delete_queries && functions.begin_query
+			&& functions.end_query && functions.get_query_object_uiv && functions.get_query_object_ui64v;
+	}
+
+	spdlog::info("gl extensions: sync={}, map_buffer_range={}, buffer_storage={}, pixel_buffer={}, program_binary={}, timer_query={}",
+		functions.has_sync, functions.has_map_buffer_range, functions.has_buffer_storage, functions.has_pixel_buffer, functions.has_program_binary, functions.has_timer_query);
+}
+
+const GlExtensions::Functions& GlExtensions::get() {
+	return functions;
+}
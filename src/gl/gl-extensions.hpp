@@ -0,0 +1,84 @@
+#pragma once
+
+#ifndef _GL_EXTENSIONS_HPP
+#define _GL_EXTENSIONS_HPP
+
+#include <cstdint>
+
+/**
+ * entry points that aren't part of the api the wrappers are built against (gl 3.0 or gles 2),
+ * but that newer contexts usually have anyways. these are resolved at runtime after the context is made,
+ * and every user has to check that the feature is supported before calling into it
+ */
+namespace GlExtensions {
+	using ProcLoader = void* (*)(const char*);
+
+	// these aren't defined by the gles 2 headers
+	constexpr std::uint32_t SYNC_GPU_COMMANDS_COMPLETE = 0x9117;
+	constexpr std::uint32_t SYNC_FLUSH_COMMANDS_BIT = 0x0001;
+	constexpr std::uint32_t TIMEOUT_EXPIRED = 0x911B;
+	constexpr std::uint32_t WAIT_FAILED = 0x911D;
+
+	constexpr std::uint32_t MAP_WRITE_BIT = 0x0002;
+	constexpr std::uint32_t MAP_INVALIDATE_RANGE_BIT = 0x0004;
+	constexpr std::uint32_t MAP_UNSYNCHRONIZED_BIT = 0x0020;
+	constexpr std::uint32_t MAP_PERSISTENT_BIT = 0x0040;
+	constexpr std::uint32_t MAP_COHERENT_BIT = 0x0080;
+
+	constexpr std::uint32_t PIXEL_UNPACK_BUFFER = 0x88EC;
+
+	constexpr std::uint32_t PROGRAM_BINARY_RETRIEVABLE_HINT = 0x8257;
+	constexpr std::uint32_t PROGRAM_BINARY_LENGTH = 0x8741;
+	constexpr std::uint32_t NUM_PROGRAM_BINARY_FORMATS = 0x87FE;
+
+	constexpr std::uint32_t TIME_ELAPSED = 0x88BF;
+	constexpr std::uint32_t QUERY_RESULT = 0x8866;
+	constexpr std::uint32_t QUERY_RESULT_AVAILABLE = 0x8867;
+	constexpr std::uint32_t GPU_DISJOINT = 0x8FBB;
+
+	using GlSync = void*;
+
+	struct Functions {
+		bool has_sync{false};
+		bool has_buffer_storage{false};
+		bool has_map_buffer_range{false};
+		bool has_pixel_buffer{false};
+		bool has_program_binary{false};
+		bool has_timer_query{false};
+
+		// gles contexts are stricter about texture formats
+		bool is_es{false};
+
+		GlSync (*fence_sync)(std::uint32_t condition, std::uint32_t flags){nullptr};
+		std::uint32_t (*client_wait_sync)(GlSync sync, std::uint32_t flags, std::uint64_t timeout){nullptr};
+		void (*delete_sync)(GlSync sync){nullptr};
+
+		void (*buffer_storage)(std::uint32_t target, std::intptr_t size, const void* data, std::uint32_t flags){nullptr};
+
+		void* (*map_buffer_range)(std::uint32_t target, std::intptr_t offset, std::intptr_t length, std::uint32_t access){nullptr};
+		std::uint8_t (*unmap_buffer)(std::uint32_t target){nullptr};
+
+		void (*get_program_binary)(std::uint32_t program, std::int32_t buf_size, std::int32_t* length, std::uint32_t* binary_format, void* binary){nullptr};
+		void (*program_binary)(std::uint32_t program, std::uint32_t binary_format, const void* binary, std::int32_t length){nullptr};
+
+		// not part of the oes extension, binaries are always retrievable there
+		void (*program_parameteri)(std::uint32_t program, std::uint32_t name, std::int32_t value){nullptr};
+
+		void (*gen_queries)(std::int32_t n, std::uint32_t* ids){nullptr};
+		void (*delete_queries)(std::int32_t n, const std::uint32_t* ids){nullptr};
+		void (*begin_query)(std::uint32_t target, std::uint32_t id){nullptr};
+		void (*end_query)(std::uint32_t target){nullptr};
+		void (*get_query_object_uiv)(std::uint32_t id, std::uint32_t name, std::uint32_t* params){nullptr};
+		void (*get_query_object_ui64v)(std::uint32_t id, std::uint32_t name, std::uint64_t* params){nullptr};
+	};
+
+	/**
+	 * checks the current context for support and resolves everything that is supported
+	 * should be called by the frontend once its context is current
+	 */
+	void load(ProcLoader loader);
+
+	const Functions& get();
+}
+
+#endif
@@ -0,0 +1,462 @@
+#include "gl-replay.hpp"
+
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include <spdlog/spdlog.h>
+
+#ifdef SILENE_USE_EGL
+#include <GLES2/gl2.h>
+#else
+#include <glad/glad.h>
+#endif
+
+namespace {
+	// not part of gles 2, but it's either supported or the check below catches it
+	constexpr std::uint32_t DEPTH24_STENCIL8 = 0x88F0;
+
+	using Op = GlTrace::Op;
+
+	const void* offset_pointer(std::uint32_t offset) {
+		return reinterpret_cast<const void*>(static_cast<std::uintptr_t>(offset));
+	}
+}
+
+float GlReplay::Record::word_float(std::uint32_t i) const {
+	return std::bit_cast<float>(this->words[i]);
+}
+
+bool GlReplay::read_record(std::size_t& offset, Record& record) const {
+	if (offset + 2 > this->_data.size()) {
+		return false;
+	}
+
+	record.op = static_cast<Op>(this->_data[offset]);
+
+	auto count = this->_data[offset + 1];
+	record.has_payload = (count & GlTrace::PAYLOAD_FLAG) != 0;
+	record.count = static_cast<std::uint8_t>(count & ~GlTrace::PAYLOAD_FLAG);
+
+	offset += 2;
+
+	auto words_size = record.count * sizeof(std::uint32_t);
+	if (offset + words_size > this->_data.size()) {
+		return false;
+	}
+
+	std::memcpy(record.words.data(), this->_data.data() + offset, words_size);
+	offset += words_size;
+
+	record.size = 0;
+	record.payload = nullptr;
+
+	if (record.has_payload) {
+		if (offset + sizeof(std::uint32_t) > this->_data.size()) {
+			return false;
+		}
+
+		std::memcpy(&record.size, this->_data.data() + offset, sizeof(std::uint32_t));
+		offset += sizeof(std::uint32_t);
+
+		if (offset + record.size > this->_data.size()) {
+			return false;
+		}
+
+		record.payload = this->_data.data() + offset;
+		offset += record.size;
+	}
+
+	return true;
+}
+
+std::uint32_t GlReplay::map_name(const NameMap& names, std::uint32_t name) const {
+	auto it = names.find(name);
+	return it != names.end() ? it->second : name;
+}
+
+std::int32_t GlReplay::map_location(std::int32_t location) const {
+	auto program = this->_locations.find(this->_program);
+	if (location == -1 || program == this->_locations.end()) {
+		return location;
+	}
+
+	auto it = program->second.find(location);
+	return it != program->second.end() ? it->second : location;
+}
+
+template <typename F>
+void GlReplay::generate(NameMap& names, const Record& record, F generator) {
+	auto n = record.words[0];
+	if (record.payload == nullptr || record.size < n * sizeof(std::uint32_t)) {
+		return;
+	}
+
+	std::vector<GLuint> recorded(n);
+	std::memcpy(recorded.data(), record.payload, n * sizeof(std::uint32_t));
+
+	std::vector<GLuint> created(n);
+	generator(n, created.data());
+
+	for (auto i = 0u; i < n; i++) {
+		names[recorded[i]] = created[i];
+	}
+}
+
+template <typename F>
+void GlReplay::remove(NameMap& names, const Record& record, F deleter) {
+	auto n = record.words[0];
+	if (record.payload == nullptr || record.size < n * sizeof(std::uint32_t)) {
+		return;
+	}
+
+	std::vector<GLuint> mapped(n);
+	std::memcpy(mapped.data(), record.payload, n * sizeof(std::uint32_t));
+
+	for (auto& name : mapped) {
+		auto recorded = name;
+		name = this->map_name(names, recorded);
+		names.erase(recorded);
+	}
+
+	deleter(n, mapped.data());
+}
+
+void GlReplay::execute(const Record& record) {
+	const auto& w = record.words;
+
+	switch (record.op) {
+		case Op::Frame:
+		case Op::End:
+			break;
+		case Op::PixelStore:
+			glPixelStorei(w[0], record.word_int(1));
+			break;
+		case Op::CreateShader:
+			this->_shaders[w[1]] = glCreateShader(w[0]);
+			break;
+		case Op::ShaderSource: {
+			std::string_view source{reinterpret_cast<const char*>(record.payload), record.size};
+			this->_shader_cache.shader_source(this->map_name(this->_shaders, w[0]), {source});
+			break;
+		}
+		case Op::CompileShader:
+			this->_shader_cache.compile_shader(this->map_name(this->_shaders, w[0]));
+			break;
+		case Op::DeleteShader: {
+			auto shader = this->map_name(this->_shaders, w[0]);
+			this->_shader_cache.delete_shader(shader);
+			glDeleteShader(shader);
+			break;
+		}
+		case Op::CreateProgram:
+			this->_programs[w[0]] = glCreateProgram();
+			this->_shader_cache.create_program(this->_programs[w[0]]);
+			break;
+		case Op::AttachShader: {
+			auto program = this->map_name(this->_programs, w[0]);
+			auto shader = this->map_name(this->_shaders, w[1]);
+			this->_shader_cache.attach_shader(program, shader);
+			glAttachShader(program, shader);
+			break;
+		}
+		case Op::DetachShader: {
+			auto program = this->map_name(this->_programs, w[0]);
+			auto shader = this->map_name(this->_shaders, w[1]);
+			this->_shader_cache.detach_shader(program, shader);
+			glDetachShader(program, shader);
+			break;
+		}
+		case Op::DeleteProgram: {
+			auto program = this->map_name(this->_programs, w[0]);
+			this->_programs.erase(w[0]);
+			this->_shader_cache.delete_program(program);
+			glDeleteProgram(program);
+			break;
+		}
+		case Op::BindAttribLocation: {
+			std::string name{reinterpret_cast<const char*>(record.payload), record.size};
+			auto program = this->map_name(this->_programs, w[0]);
+			this->_shader_cache.bind_attrib_location(program, w[1], name.c_str());
+			glBindAttribLocation(program, w[1], name.c_str());
+			break;
+		}
+		case Op::LinkProgram:
+			this->_shader_cache.link_program(this->map_name(this->_programs, w[0]));
+			break;
+		case Op::GetUniformLocation: {
+			std::string name{reinterpret_cast<const char*>(record.payload), record.size};
+			auto location = glGetUniformLocation(this->map_name(this->_programs, w[0]), name.c_str());
+			this->_locations[w[0]][record.word_int(1)] = location;
+			break;
+		}
+		case Op::UseProgram:
+			this->_program = w[0];
+			glUseProgram(this->map_name(this->_programs, w[0]));
+			break;
+		case Op::Capability:
+			if (w[1]) {
+				glEnable(w[0]);
+			} else {
+				glDisable(w[0]);
+			}
+			break;
+		case Op::BlendFunc:
+			glBlendFunc(w[0], w[1]);
+			break;
+		case Op::DepthFunc:
+			glDepthFunc(w[0]);
+			break;
+		case Op::ClearColor:
+			glClearColor(record.word_float(0), record.word_float(1), record.word_float(2), record.word_float(3));
+			break;
+		case Op::ClearDepth:
+			// this function is unavailable on desktop opengl
+#ifdef SILENE_USE_EGL
+			glClearDepthf(record.word_float(0));
+#else
+			glClearDepth(record.word_float(0));
+#endif
+			break;
+		case Op::LineWidth:
+			glLineWidth(record.word_float(0));
+			break;
+		case Op::Viewport:
+			glViewport(record.word_int(0), record.word_int(1), w[2], w[3]);
+			break;
+		case Op::Scissor:
+			glScissor(record.word_int(0), record.word_int(1), w[2], w[3]);
+			break;
+		case Op::Uniform1i:
+			glUniform1i(this->map_location(record.word_int(0)), record.word_int(1));
+			break;
+		case Op::Uniformf: {
+			auto location = this->map_location(record.word_int(0));
+			switch (w[1]) {
+				case 1:
+					glUniform1f(location, record.word_float(2));
+					break;
+				case 2:
+					glUniform2f(location, record.word_float(2), record.word_float(3));
+					break;
+				case 3:
+					glUniform3f(location, record.word_float(2), record.word_float(3), record.word_float(4));
+					break;
+				default:
+					glUniform4f(location, record.word_float(2), record.word_float(3), record.word_float(4), record.word_float(5));
+					break;
+			}
+			break;
+		}
+		case Op::Uniform4fv:
+			glUniform4fv(this->map_location(record.word_int(0)), w[1], reinterpret_cast<const float*>(record.payload));
+			break;
+		case Op::UniformMatrix4fv:
+			glUniformMatrix4fv(this->map_location(record.word_int(0)), w[1], w[2], reinterpret_cast<const float*>(record.payload));
+			break;
+		case Op::GenBuffers:
+			this->generate(this->_buffers, record, [](GLsizei n, GLuint* names) { glGenBuffers(n, names); });
+			break;
+		case Op::DeleteBuffers:
+			this->remove(this->_buffers, record, [](GLsizei n, const GLuint* names) { glDeleteBuffers(n, names); });
+			break;
+		case Op::BindBuffer: {
+			auto buffer = this->map_name(this->_buffers, w[1]);
+			if (w[0] == GL_ARRAY_BUFFER) {
+				this->_array_buffer = buffer;
+			}
+
+			glBindBuffer(w[0], buffer);
+			break;
+		}
+		case Op::BufferData:
+			glBufferData(w[0], w[1], record.payload, w[2]);
+			break;
+		case Op::BufferSubData:
+			if (record.payload != nullptr) {
+				glBufferSubData(w[0], w[1], w[2], record.payload);
+			}
+			break;
+		case Op::GenTextures:
+			this->generate(this->_textures, record, [](GLsizei n, GLuint* names) { glGenTextures(n, names); });
+			break;
+		case Op::DeleteTextures:
+			this->remove(this->_textures, record, [](GLsizei n, const GLuint* names) { glDeleteTextures(n, names); });
+			break;
+		case Op::ActiveTexture:
+			glActiveTexture(w[0]);
+			break;
+		case Op::BindTexture:
+			glBindTexture(w[0], this->map_name(this->_textures, w[1]));
+			break;
+		case Op::TexParameteri:
+			glTexParameteri(w[0], w[1], record.word_int(2));
+			break;
+		case Op::TexImage2D:
+			glTexImage2D(w[0], record.word_int(1), record.word_int(2), w[3], w[4], record.word_int(5), w[6], w[7], record.payload);
+			break;
+		case Op::GenFramebuffers:
+			this->generate(this->_framebuffers, record, [](GLsizei n, GLuint* names) { glGenFramebuffers(n, names); });
+			break;
+		case Op::BindFramebuffer: {
+			auto framebuffer = w[1] == 0 ? this->_screen_framebuffer : this->map_name(this->_framebuffers, w[1]);
+			glBindFramebuffer(w[0], framebuffer);
+			break;
+		}
+		case Op::FramebufferTexture2D:
+			glFramebufferTexture2D(w[0], w[1], w[2], this->map_name(this->_textures, w[3]), record.word_int(4));
+			break;
+		case Op::GenRenderbuffers:
+			this->generate(this->_renderbuffers, record, [](GLsizei n, GLuint* names) { glGenRenderbuffers(n, names); });
+			break;
+		case Op::BindRenderbuffer:
+			glBindRenderbuffer(w[0], this->map_name(this->_renderbuffers, w[1]));
+			break;
+		case Op::FramebufferRenderbuffer:
+			glFramebufferRenderbuffer(w[0], w[1], w[2], this->map_name(this->_renderbuffers, w[3]));
+			break;
+		case Op::VertexAttribArray:
+			if (w[1]) {
+				glEnableVertexAttribArray(w[0]);
+			} else {
+				glDisableVertexAttribArray(w[0]);
+			}
+			break;
+		case Op::VertexAttribPointer:
+			glVertexAttribPointer(w[0], record.word_int(1), w[2], w[3], w[4], offset_pointer(w[5]));
+			break;
+		case Op::ClientAttrib:
+			// the trace stays loaded, so the driver can read the data from where it is
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			glVertexAttribPointer(w[0], record.word_int(1), w[2], w[3], w[4], record.payload);
+			glBindBuffer(GL_ARRAY_BUFFER, this->_array_buffer);
+			break;
+		case Op::Clear:
+			glClear(w[0]);
+			break;
+		case Op::DrawArrays:
+			glDrawArrays(w[0], record.word_int(1), w[2]);
+			break;
+		case Op::DrawElements:
+			glDrawElements(w[0], w[1], w[2], record.has_payload ? record.payload : offset_pointer(w[3]));
+			break;
+		default:
+			spdlog::warn("gl replay: unknown op {}", static_cast<std::uint32_t>(record.op));
+			break;
+	}
+}
+
+std::uint32_t GlReplay::run_until_frame(std::size_t offset) {
+	auto calls = 0u;
+
+	Record record;
+	while (offset < this->_end && this->read_record(offset, record)) {
+		if (record.op == Op::Frame || record.op == Op::End) {
+			break;
+		}
+
+		this->execute(record);
+		calls++;
+	}
+
+	return calls;
+}
+
+bool GlReplay::load(const std::filesystem::path& path) {
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	if (!file) {
+		spdlog::error("failed to open trace at {}", path.string());
+		return false;
+	}
+
+	this->_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	if (this->_data.size() < sizeof(GlTrace::Header)) {
+		spdlog::error("trace is too small to have a header");
+		return false;
+	}
+
+	std::memcpy(&this->_header, this->_data.data(), sizeof(GlTrace::Header));
+	if (this->_header.magic != GlTrace::MAGIC || this->_header.version != GlTrace::VERSION) {
+		spdlog::error("not a trace, or from a different version (version {}, expected {})", this->_header.version, GlTrace::VERSION);
+		return false;
+	}
+
+	// find where the frames start once, so replaying doesn't have to
+	std::size_t offset = sizeof(GlTrace::Header);
+	this->_frames.clear();
+
+	Record record;
+	while (true) {
+		if (!this->read_record(offset, record)) {
+			spdlog::warn("trace ends partway through a record, it was likely cut short");
+			break;
+		}
+
+		if (record.op == Op::Frame) {
+			this->_frames.push_back(offset);
+		} else if (record.op == Op::End) {
+			break;
+		}
+	}
+
+	this->_end = offset;
+
+	// a frame that never got to finish isn't worth timing
+	if (this->_header.frames < this->_frames.size()) {
+		this->_frames.resize(this->_header.frames);
+	}
+
+	return true;
+}
+
+bool GlReplay::create_screen() {
+	auto width = this->_header.width;
+	auto height = this->_header.height;
+
+	glGenTextures(1, &this->_screen_texture);
+	glBindTexture(GL_TEXTURE_2D, this->_screen_texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &this->_screen_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, this->_screen_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->_screen_texture, 0);
+
+	glGenRenderbuffers(1, &this->_screen_depth_stencil);
+	glBindRenderbuffer(GL_RENDERBUFFER, this->_screen_depth_stencil);
+	glRenderbufferStorage(GL_RENDERBUFFER, DEPTH24_STENCIL8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->_screen_depth_stencil);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->_screen_depth_stencil);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, 0);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+	}
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		spdlog::error("replay framebuffer is incomplete ({:#x})", status);
+		return false;
+	}
+
+	// left bound, as that's where the guest starts out drawing to
+	glViewport(0, 0, width, height);
+
+	return true;
+}
+
+std::uint32_t GlReplay::run_setup() {
+	return this->run_until_frame(sizeof(GlTrace::Header));
+}
+
+std::uint32_t GlReplay::run_frame(std::size_t frame) {
+	return this->run_until_frame(this->_frames[frame]);
+}
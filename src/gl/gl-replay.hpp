@@ -0,0 +1,126 @@
+#pragma once
+
+#ifndef _GL_REPLAY_HPP
+#define _GL_REPLAY_HPP
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+
+#include "gl-trace.hpp"
+#include "shader-cache.hpp"
+
+/**
+ * plays a trace written by GlTrace back on the current context, without any of the emulator.
+ *
+ * the whole file is kept in memory, so payloads (client arrays included) can be handed to the driver where they are.
+ * names are mapped onto whatever the driver hands out this time, and framebuffer 0 is an offscreen framebuffer
+ * the size of the guest's screen. shaders go through the same translation as in the emulator, but nothing is cached
+ */
+class GlReplay {
+	struct Record {
+		GlTrace::Op op;
+
+		std::uint8_t count;
+		std::array<std::uint32_t, 127> words;
+
+		bool has_payload;
+		std::uint32_t size;
+		const std::uint8_t* payload;
+
+		float word_float(std::uint32_t i) const;
+		std::int32_t word_int(std::uint32_t i) const {
+			return static_cast<std::int32_t>(this->words[i]);
+		}
+	};
+
+	using NameMap = std::unordered_map<std::uint32_t, std::uint32_t>;
+
+	std::vector<std::uint8_t> _data{};
+	GlTrace::Header _header{};
+
+	// offset of the first record of every frame, the setup starts right after the header
+	std::vector<std::size_t> _frames{};
+	std::size_t _end{0u};
+
+	ShaderCache _shader_cache{};
+
+	NameMap _buffers{};
+	NameMap _textures{};
+	NameMap _framebuffers{};
+	NameMap _renderbuffers{};
+	NameMap _shaders{};
+	NameMap _programs{};
+
+	// uniform locations the guest was given, for each of its programs
+	std::unordered_map<std::uint32_t, std::unordered_map<std::int32_t, std::int32_t>> _locations{};
+
+	std::uint32_t _program{0u};
+	std::uint32_t _array_buffer{0u};
+
+	std::uint32_t _screen_framebuffer{0u};
+	std::uint32_t _screen_texture{0u};
+	std::uint32_t _screen_depth_stencil{0u};
+
+	/**
+	 * decodes the record at the offset, moving the offset past it. returns false if the record goes past the end
+	 */
+	bool read_record(std::size_t& offset, Record& record) const;
+
+	void execute(const Record& record);
+
+	/**
+	 * runs every record from the offset up to the next frame marker, returning the number of calls made
+	 */
+	std::uint32_t run_until_frame(std::size_t offset);
+
+	std::uint32_t map_name(const NameMap& names, std::uint32_t name) const;
+	std::int32_t map_location(std::int32_t location) const;
+
+	/**
+	 * creates count names with the generator and maps the recorded ones onto them
+	 */
+	template <typename F>
+	void generate(NameMap& names, const Record& record, F generator);
+
+	/**
+	 * deletes the mapped names with the deleter, forgetting them
+	 */
+	template <typename F>
+	void remove(NameMap& names, const Record& record, F deleter);
+
+public:
+	/**
+	 * reads and checks the whole trace, returning false if it can't be used
+	 */
+	bool load(const std::filesystem::path& path);
+
+	const GlTrace::Header& header() const {
+		return this->_header;
+	}
+
+	std::size_t frame_count() const {
+		return this->_frames.size();
+	}
+
+	/**
+	 * makes the framebuffer that stands in for the guest's screen. needs a current context
+	 */
+	bool create_screen();
+
+	/**
+	 * replays everything the guest did before its first frame
+	 */
+	std::uint32_t run_setup();
+
+	std::uint32_t run_frame(std::size_t frame);
+
+	GlReplay() = default;
+
+	GlReplay(const GlReplay&) = delete;
+	GlReplay& operator=(const GlReplay&) = delete;
+};
+
+#endif
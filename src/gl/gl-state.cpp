@@ -0,0 +1,328 @@
+#include "gl-state.hpp"
+#include "gl-commands.hpp"
+
+#include <algorithm>
+#include <span>
+
+#ifdef SILENE_USE_EGL
+#include <GLES2/gl2.h>
+#else
+#include <glad/glad.h>
+#endif
+
+bool GlState::track(bool changed) {
+	if (changed) {
+		this->_state_changes++;
+	} else {
+		this->_elided_calls++;
+	}
+
+	return changed;
+}
+
+GlState::Cached<std::uint32_t>* GlState::texture_binding(std::uint32_t target) {
+	if (!this->_active_texture.valid) {
+		return nullptr;
+	}
+
+	auto unit = this->_active_texture.value - GL_TEXTURE0;
+	if (unit >= MAX_TEXTURE_UNITS) {
+		return nullptr;
+	}
+
+	switch (target) {
+		case GL_TEXTURE_2D:
+			return &this->_texture_2d[unit];
+		case GL_TEXTURE_CUBE_MAP:
+			return &this->_texture_cube_map[unit];
+		default:
+			return nullptr;
+	}
+}
+
+void GlState::write_rect(const Cached<Rect>& rect, std::int32_t* data) const {
+	data[0] = rect.value.x;
+	data[1] = rect.value.y;
+	data[2] = static_cast<std::int32_t>(rect.value.width);
+	data[3] = static_cast<std::int32_t>(rect.value.height);
+}
+
+void GlState::invalidate() {
+	auto state_changes = this->_state_changes;
+	auto elided_calls = this->_elided_calls;
+
+	*this = GlState{*this->_commands};
+
+	this->_state_changes = state_changes;
+	this->_elided_calls = elided_calls;
+}
+
+void GlState::begin_frame() {
+	this->invalidate();
+}
+
+bool GlState::bind_buffer(std::uint32_t target, std::uint32_t buffer) {
+	switch (target) {
+		case GL_ARRAY_BUFFER:
+			return this->track(this->_array_buffer.update(buffer));
+		case GL_ELEMENT_ARRAY_BUFFER:
+			return this->track(this->_element_array_buffer.update(buffer));
+		default:
+			return true;
+	}
+}
+
+bool GlState::active_texture(std::uint32_t texture) {
+	return this->track(this->_active_texture.update(texture));
+}
+
+bool GlState::bind_texture(std::uint32_t target, std::uint32_t texture) {
+	auto binding = this->texture_binding(target);
+	if (binding == nullptr) {
+		return true;
+	}
+
+	return this->track(binding->update(texture));
+}
+
+bool GlState::use_program(std::uint32_t program) {
+	return this->track(this->_program.update(program));
+}
+
+bool GlState::bind_framebuffer(std::uint32_t target, std::uint32_t framebuffer) {
+	if (target != GL_FRAMEBUFFER) {
+		// only one half of the binding changed, so there's no single value to compare against
+		this->_framebuffer.valid = false;
+		return true;
+	}
+
+	return this->track(this->_framebuffer.update(framebuffer));
+}
+
+bool GlState::bind_renderbuffer(std::uint32_t target, std::uint32_t renderbuffer) {
+	if (target != GL_RENDERBUFFER) {
+		return true;
+	}
+
+	return this->track(this->_renderbuffer.update(renderbuffer));
+}
+
+bool GlState::set_capability(std::uint32_t cap, bool enabled) {
+	auto it = std::find(TRACKED_CAPS.begin(), TRACKED_CAPS.end(), cap);
+	if (it == TRACKED_CAPS.end()) {
+		return true;
+	}
+
+	auto idx = std::distance(TRACKED_CAPS.begin(), it);
+	return this->track(this->_caps[idx].update(enabled));
+}
+
+bool GlState::blend_func(std::uint32_t sfactor, std::uint32_t dfactor) {
+	return this->track(this->_blend_func.update({sfactor, dfactor}));
+}
+
+bool GlState::depth_func(std::uint32_t func) {
+	return this->track(this->_depth_func.update(func));
+}
+
+bool GlState::clear_depth(float depth) {
+	return this->track(this->_clear_depth.update(depth));
+}
+
+bool GlState::clear_color(float red, float green, float blue, float alpha) {
+	return this->track(this->_clear_color.update({red, green, blue, alpha}));
+}
+
+bool GlState::line_width(float width) {
+	return this->track(this->_line_width.update(width));
+}
+
+bool GlState::viewport(std::int32_t x, std::int32_t y, std::uint32_t width, std::uint32_t height) {
+	return this->track(this->_viewport.update({x, y, width, height}));
+}
+
+bool GlState::scissor(std::int32_t x, std::int32_t y, std::uint32_t width, std::uint32_t height) {
+	return this->track(this->_scissor.update({x, y, width, height}));
+}
+
+bool GlState::pixel_store(std::uint32_t name, std::int32_t param) {
+	switch (name) {
+		case GL_PACK_ALIGNMENT:
+			return this->track(this->_pack_alignment.update(param));
+		case GL_UNPACK_ALIGNMENT:
+			return this->track(this->_unpack_alignment.update(param));
+		default:
+			return true;
+	}
+}
+
+bool GlState::set_vertex_attrib_array(std::uint32_t index, bool enabled) {
+	if (index >= MAX_VERTEX_ATTRIBS) {
+		return true;
+	}
+
+	return this->track(this->_attrib_enabled[index].update(enabled));
+}
+
+bool GlState::vertex_attrib_pointer(std::uint32_t index, const AttribPointer& attrib) {
+	if (index >= MAX_VERTEX_ATTRIBS) {
+		return true;
+	}
+
+	return this->track(this->_attrib_pointer[index].update(attrib));
+}
+
+void GlState::forget_vertex_attrib_pointer(std::uint32_t index) {
+	if (index >= MAX_VERTEX_ATTRIBS) {
+		return;
+	}
+
+	this->_attrib_pointer[index].valid = false;
+}
+
+void GlState::delete_buffers(std::uint32_t n, const std::uint32_t* buffers) {
+	for (auto buffer : std::span{buffers, n}) {
+		if (buffer == 0) {
+			continue;
+		}
+
+		for (auto binding : {&this->_array_buffer, &this->_element_array_buffer}) {
+			if (binding->valid && binding->value == buffer) {
+				binding->value = 0;
+			}
+		}
+
+		// the attrib keeps pointing at the old buffer, even if the name gets reused
+		for (auto& attrib : this->_attrib_pointer) {
+			if (attrib.valid && attrib.value.buffer == buffer) {
+				attrib.valid = false;
+			}
+		}
+	}
+}
+
+void GlState::delete_textures(std::uint32_t n, const std::uint32_t* textures) {
+	for (auto texture : std::span{textures, n}) {
+		if (texture == 0) {
+			continue;
+		}
+
+		for (auto& binding : this->_texture_2d) {
+			if (binding.valid && binding.value == texture) {
+				binding.value = 0;
+			}
+		}
+
+		for (auto& binding : this->_texture_cube_map) {
+			if (binding.valid && binding.value == texture) {
+				binding.value = 0;
+			}
+		}
+	}
+}
+
+std::int32_t GlState::query_integer(std::uint32_t name, std::int32_t fallback) {
+	this->_commands->flush();
+
+	GLint value = fallback;
+	glGetIntegerv(name, &value);
+
+	return value;
+}
+
+std::uint32_t GlState::array_buffer_binding() {
+	if (!this->_array_buffer.valid) {
+		this->_array_buffer.update(static_cast<std::uint32_t>(this->query_integer(GL_ARRAY_BUFFER_BINDING, 0)));
+	}
+
+	return this->_array_buffer.value;
+}
+
+std::uint32_t GlState::element_array_buffer_binding() {
+	if (!this->_element_array_buffer.valid) {
+		this->_element_array_buffer.update(static_cast<std::uint32_t>(this->query_integer(GL_ELEMENT_ARRAY_BUFFER_BINDING, 0)));
+	}
+
+	return this->_element_array_buffer.value;
+}
+
+std::int32_t GlState::unpack_alignment() {
+	if (!this->_unpack_alignment.valid) {
+		this->_unpack_alignment.update(this->query_integer(GL_UNPACK_ALIGNMENT, 4));
+	}
+
+	return this->_unpack_alignment.value;
+}
+
+bool GlState::get_integer(std::uint32_t name, std::int32_t* data) {
+	if (data == nullptr) {
+		return false;
+	}
+
+	auto read_value = [data](const auto& cached) {
+		if (!cached.valid) {
+			return false;
+		}
+
+		*data = static_cast<std::int32_t>(cached.value);
+		return true;
+	};
+
+	switch (name) {
+		case GL_ARRAY_BUFFER_BINDING:
+			return read_value(this->_array_buffer);
+		case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+			return read_value(this->_element_array_buffer);
+		case GL_CURRENT_PROGRAM:
+			return read_value(this->_program);
+		case GL_ACTIVE_TEXTURE:
+			return read_value(this->_active_texture);
+		case GL_TEXTURE_BINDING_2D:
+		case GL_TEXTURE_BINDING_CUBE_MAP: {
+			auto binding = this->texture_binding(name == GL_TEXTURE_BINDING_2D ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP);
+			return binding != nullptr && read_value(*binding);
+		}
+		case GL_FRAMEBUFFER_BINDING:
+			return read_value(this->_framebuffer);
+		case GL_RENDERBUFFER_BINDING:
+			return read_value(this->_renderbuffer);
+		case GL_DEPTH_FUNC:
+			return read_value(this->_depth_func);
+		case GL_PACK_ALIGNMENT:
+			return read_value(this->_pack_alignment);
+		case GL_UNPACK_ALIGNMENT:
+			return read_value(this->_unpack_alignment);
+		case GL_BLEND_SRC_RGB:
+		case GL_BLEND_SRC_ALPHA:
+			if (!this->_blend_func.valid) {
+				return false;
+			}
+
+			*data = static_cast<std::int32_t>(this->_blend_func.value.sfactor);
+			return true;
+		case GL_BLEND_DST_RGB:
+		case GL_BLEND_DST_ALPHA:
+			if (!this->_blend_func.valid) {
+				return false;
+			}
+
+			*data = static_cast<std::int32_t>(this->_blend_func.value.dfactor);
+			return true;
+		case GL_VIEWPORT:
+			if (!this->_viewport.valid) {
+				return false;
+			}
+
+			this->write_rect(this->_viewport, data);
+			return true;
+		case GL_SCISSOR_BOX:
+			if (!this->_scissor.valid) {
+				return false;
+			}
+
+			this->write_rect(this->_scissor, data);
+			return true;
+		default:
+			return false;
+	}
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#ifndef _GL_STATE_HPP
+#define _GL_STATE_HPP
+
+#include <array>
+#include <cstdint>
+
+class GlCommandStream;
+
+/**
+ * shadow copy of the gl state that the guest touches the most.
+ * the wrappers ask this before forwarding a call, and calls that wouldn't change anything are dropped.
+ *
+ * everything starts out unknown, and goes back to unknown at the start of every frame
+ * as the frontend is free to do whatever it wants to the state between frames
+ */
+class GlState {
+public:
+	static constexpr std::uint32_t MAX_TEXTURE_UNITS = 32;
+	static constexpr std::uint32_t MAX_VERTEX_ATTRIBS = 16;
+
+	struct AttribPointer {
+		std::int32_t size;
+		std::uint32_t type;
+		bool normalized;
+		std::uint32_t stride;
+		std::uint32_t pointer;
+
+		// a pointer is an offset when a buffer is bound, so the buffer has to match too
+		std::uint32_t buffer;
+
+		bool operator==(const AttribPointer&) const = default;
+	};
+
+private:
+	template <typename T>
+	struct Cached {
+		T value{};
+		bool valid{false};
+
+		/**
+		 * stores the new value, returning false if it was already set
+		 */
+		bool update(const T& new_value) {
+			if (this->valid && this->value == new_value) {
+				return false;
+			}
+
+			this->value = new_value;
+			this->valid = true;
+
+			return true;
+		}
+	};
+
+	struct Rect {
+		std::int32_t x;
+		std::int32_t y;
+		std::uint32_t width;
+		std::uint32_t height;
+
+		bool operator==(const Rect&) const = default;
+	};
+
+	struct BlendFunc {
+		std::uint32_t sfactor;
+		std::uint32_t dfactor;
+
+		bool operator==(const BlendFunc&) const = default;
+	};
+
+	struct ClearColor {
+		float red;
+		float green;
+		float blue;
+		float alpha;
+
+		bool operator==(const ClearColor&) const = default;
+	};
+
+	// caps that cocos toggles, anything else is passed through untouched
+	static constexpr std::array<std::uint32_t, 7> TRACKED_CAPS{
+		0x0BE2, // GL_BLEND
+		0x0B71, // GL_DEPTH_TEST
+		0x0C11, // GL_SCISSOR_TEST
+		0x0B44, // GL_CULL_FACE
+		0x0B90, // GL_STENCIL_TEST
+		0x0BD0, // GL_DITHER
+		0x8037, // GL_POLYGON_OFFSET_FILL
+	};
+
+	Cached<std::uint32_t> _array_buffer{};
+	Cached<std::uint32_t> _element_array_buffer{};
+
+	Cached<std::uint32_t> _active_texture{};
+	std::array<Cached<std::uint32_t>, MAX_TEXTURE_UNITS> _texture_2d{};
+	std::array<Cached<std::uint32_t>, MAX_TEXTURE_UNITS> _texture_cube_map{};
+
+	Cached<std::uint32_t> _program{};
+	Cached<std::uint32_t> _framebuffer{};
+	Cached<std::uint32_t> _renderbuffer{};
+
+	std::array<Cached<bool>, TRACKED_CAPS.size()> _caps{};
+
+	Cached<BlendFunc> _blend_func{};
+	Cached<std::uint32_t> _depth_func{};
+	Cached<float> _clear_depth{};
+	Cached<ClearColor> _clear_color{};
+	Cached<float> _line_width{};
+
+	Cached<Rect> _viewport{};
+	Cached<Rect> _scissor{};
+
+	Cached<std::int32_t> _pack_alignment{};
+	Cached<std::int32_t> _unpack_alignment{};
+
+	std::array<Cached<bool>, MAX_VERTEX_ATTRIBS> _attrib_enabled{};
+	std::array<Cached<AttribPointer>, MAX_VERTEX_ATTRIBS> _attrib_pointer{};
+
+	// anything still queued here has to reach the driver before it can be asked about the state
+	GlCommandStream* _commands;
+
+	// running totals, the frame stats take the difference
+	std::uint64_t _state_changes{0u};
+	std::uint64_t _elided_calls{0u};
+
+	/**
+	 * counts the call as either a change or a dropped call, returning whether it changed anything
+	 */
+	bool track(bool changed);
+
+	/**
+	 * returns the cached texture binding for the active unit, or nullptr if it isn't tracked
+	 */
+	Cached<std::uint32_t>* texture_binding(std::uint32_t target);
+
+	void write_rect(const Cached<Rect>& rect, std::int32_t* data) const;
+
+	/**
+	 * asks the driver, once every queued command has been sent
+	 */
+	std::int32_t query_integer(std::uint32_t name, std::int32_t fallback);
+
+public:
+	GlState(GlCommandStream& commands) : _commands{&commands} {}
+
+	/**
+	 * forgets everything, as something outside of the guest has touched the context
+	 */
+	void invalidate();
+
+	/**
+	 * the frontend has had the context since the last frame, so nothing can be trusted
+	 */
+	void begin_frame();
+
+	std::uint64_t state_changes() const {
+		return this->_state_changes;
+	}
+
+	std::uint64_t elided_calls() const {
+		return this->_elided_calls;
+	}
+
+	// each of these update the shadow state, and return false when the call can be skipped
+
+	bool bind_buffer(std::uint32_t target, std::uint32_t buffer);
+	bool active_texture(std::uint32_t texture);
+	bool bind_texture(std::uint32_t target, std::uint32_t texture);
+	bool use_program(std::uint32_t program);
+	bool bind_framebuffer(std::uint32_t target, std::uint32_t framebuffer);
+	bool bind_renderbuffer(std::uint32_t target, std::uint32_t renderbuffer);
+
+	bool set_capability(std::uint32_t cap, bool enabled);
+
+	bool blend_func(std::uint32_t sfactor, std::uint32_t dfactor);
+	bool depth_func(std::uint32_t func);
+	bool clear_depth(float depth);
+	bool clear_color(float red, float green, float blue, float alpha);
+	bool line_width(float width);
+
+	bool viewport(std::int32_t x, std::int32_t y, std::uint32_t width, std::uint32_t height);
+	bool scissor(std::int32_t x, std::int32_t y, std::uint32_t width, std::uint32_t height);
+
+	bool pixel_store(std::uint32_t name, std::int32_t param);
+
+	bool set_vertex_attrib_array(std::uint32_t index, bool enabled);
+	bool vertex_attrib_pointer(std::uint32_t index, const AttribPointer& attrib);
+
+	/**
+	 * for attribs that are changed behind the cache's back, like client arrays that get streamed
+	 */
+	void forget_vertex_attrib_pointer(std::uint32_t index);
+
+	/**
+	 * the gl unbinds deleted objects, so the cache has to as well
+	 */
+	void delete_buffers(std::uint32_t n, const std::uint32_t* buffers);
+	void delete_textures(std::uint32_t n, const std::uint32_t* textures);
+
+	/**
+	 * currently bound GL_ARRAY_BUFFER. this asks the driver if the binding isn't known yet
+	 */
+	std::uint32_t array_buffer_binding();
+	std::uint32_t element_array_buffer_binding();
+
+	/**
+	 * current GL_UNPACK_ALIGNMENT, asking the driver if it isn't known
+	 */
+	std::int32_t unpack_alignment();
+
+	/**
+	 * answers a glGetIntegerv from the shadow state, returning false if it has to go to the driver
+	 */
+	bool get_integer(std::uint32_t name, std::int32_t* data);
+};
+
+#endif
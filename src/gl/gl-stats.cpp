@@ -0,0 +1,176 @@
+#include "gl-stats.hpp"
+
+#ifdef SILENE_USE_EGL
+#include <GLES2/gl2.h>
+#else
+#include <glad/glad.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "gl-extensions.hpp"
+#include "gl-state.hpp"
+
+namespace {
+	std::uint64_t elapsed_ns(GlStats::Clock::time_point start, GlStats::Clock::time_point end) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	}
+
+	std::uint32_t pixel_size(std::uint32_t format, std::uint32_t type) {
+		switch (type) {
+			case GL_UNSIGNED_SHORT_4_4_4_4:
+			case GL_UNSIGNED_SHORT_5_5_5_1:
+			case GL_UNSIGNED_SHORT_5_6_5:
+				return 2;
+			case GL_UNSIGNED_BYTE:
+				switch (format) {
+					case GL_ALPHA:
+					case GL_LUMINANCE:
+						return 1;
+					case GL_LUMINANCE_ALPHA:
+						return 2;
+					case GL_RGB:
+						return 3;
+					default:
+						return 4;
+				}
+			default:
+				return 4;
+		}
+	}
+}
+
+void GlStats::count_texture_upload(std::uint32_t width, std::uint32_t height, std::uint32_t format, std::uint32_t type) {
+	this->_current.texture_bytes += static_cast<std::uint64_t>(width) * height * pixel_size(format, type);
+}
+
+void GlStats::set_log_file(const std::filesystem::path& path) {
+	this->_log = std::ofstream(path, std::ios::out | std::ios::trunc);
+	if (!this->_log) {
+		spdlog::warn("failed to open frame log at {}", path.string());
+		return;
+	}
+
+	this->_log << "frame,frame_ns,render_ns,gl_ns,gpu_ns,draw_calls,state_changes,elided_calls,program_switches,get_error_calls,buffer_bytes,texture_bytes\n";
+}
+
+void GlStats::begin_frame(const GlState& state) {
+	auto now = Clock::now();
+
+	this->_current = FrameStats{};
+	this->_current.frame = this->_frame;
+	if (this->_frame != 0) {
+		this->_current.frame_ns = elapsed_ns(this->_frame_start, now);
+	}
+
+	this->_frame++;
+	this->_frame_start = now;
+
+	this->_state_changes_start = state.state_changes();
+	this->_elided_start = state.elided_calls();
+
+	auto& ext = GlExtensions::get();
+	if (!ext.has_timer_query) {
+		this->_render_start = Clock::now();
+		return;
+	}
+
+	if (!this->_queries_created) {
+		ext.gen_queries(QUERY_COUNT, this->_queries.data());
+		this->_queries_created = true;
+	}
+
+	this->resolve_queries();
+
+	// if the gpu is far enough behind that every query is still in flight, this frame just goes untimed
+	this->_active_query = -1;
+	for (auto i = 0u; i < QUERY_COUNT; i++) {
+		if (!this->_query_busy[i]) {
+			this->_active_query = static_cast<std::int32_t>(i);
+			break;
+		}
+	}
+
+	if (this->_active_query != -1) {
+		ext.begin_query(GlExtensions::TIME_ELAPSED, this->_queries[this->_active_query]);
+	}
+
+	this->_render_start = Clock::now();
+}
+
+void GlStats::end_frame(const GlState& state) {
+	this->_current.render_ns = elapsed_ns(this->_render_start, Clock::now());
+	this->_current.state_changes = static_cast<std::uint32_t>(state.state_changes() - this->_state_changes_start);
+	this->_current.elided_calls = static_cast<std::uint32_t>(state.elided_calls() - this->_elided_start);
+
+	auto& ext = GlExtensions::get();
+	if (this->_active_query != -1) {
+		ext.end_query(GlExtensions::TIME_ELAPSED);
+		this->_query_busy[this->_active_query] = true;
+	}
+
+	// untimed frames wait in line as well, so the log stays in order
+	this->_pending.push_back({this->_active_query, this->_current});
+	this->_active_query = -1;
+
+	this->resolve_queries();
+
+	this->_last = this->_current;
+	this->_last.gpu_ns = this->_last_gpu_ns;
+}
+
+void GlStats::resolve_queries() {
+	auto& ext = GlExtensions::get();
+
+	while (!this->_pending.empty()) {
+		auto& pending = this->_pending.front();
+
+		if (pending.query != -1) {
+			auto query = this->_queries[pending.query];
+
+			std::uint32_t available = 0;
+			ext.get_query_object_uiv(query, GlExtensions::QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				return;
+			}
+
+			std::uint64_t result = 0;
+			ext.get_query_object_ui64v(query, GlExtensions::QUERY_RESULT, &result);
+
+			// the result is garbage if the gpu did something like change clocks while the query was running
+			auto disjoint = 0;
+			if (ext.is_es) {
+				glGetIntegerv(GlExtensions::GPU_DISJOINT, &disjoint);
+			}
+
+			if (!disjoint) {
+				pending.stats.gpu_ns = static_cast<std::int64_t>(result);
+				this->_last_gpu_ns = pending.stats.gpu_ns;
+			}
+
+			this->_query_busy[pending.query] = false;
+		}
+
+		this->finish(pending.stats);
+		this->_pending.pop_front();
+	}
+}
+
+void GlStats::finish(const FrameStats& stats) {
+	if (!this->_log.is_open()) {
+		return;
+	}
+
+	this->_log << stats.frame << ','
+		<< stats.frame_ns << ','
+		<< stats.render_ns << ','
+		<< stats.gl_ns << ','
+		<< stats.gpu_ns << ','
+		<< stats.draw_calls << ','
+		<< stats.state_changes << ','
+		<< stats.elided_calls << ','
+		<< stats.program_switches << ','
+		<< stats.get_error_calls << ','
+		<< stats.buffer_bytes << ','
+		<< stats.texture_bytes << '\n';
+}
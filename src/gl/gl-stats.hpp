@@ -0,0 +1,146 @@
+#pragma once
+
+#ifndef _GL_STATS_HPP
+#define _GL_STATS_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+
+class GlState;
+
+/**
+ * per frame counters for everything that goes through the gl wrappers.
+ *
+ * the time the guest spends rendering is split into time spent inside of the driver and everything else
+ * (which is emulation). gpu time comes from timer queries, which only resolve a few frames later.
+ * if a log file is set, every frame is written to it as a csv row once its gpu time is known
+ */
+class GlStats {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct FrameStats {
+		std::uint64_t frame{0u};
+
+		// wall time since the start of the previous frame
+		std::uint64_t frame_ns{0u};
+
+		// time spent in the guest's render call, gl_ns included
+		std::uint64_t render_ns{0u};
+		std::uint64_t gl_ns{0u};
+
+		// -1 if the context can't measure it
+		std::int64_t gpu_ns{-1};
+
+		std::uint32_t draw_calls{0u};
+		std::uint32_t state_changes{0u};
+		std::uint32_t elided_calls{0u};
+		std::uint32_t program_switches{0u};
+		std::uint32_t get_error_calls{0u};
+
+		std::uint64_t buffer_bytes{0u};
+		std::uint64_t texture_bytes{0u};
+	};
+
+	/**
+	 * adds the time it's alive for to the driver time of the frame
+	 */
+	class DriverTimer {
+		GlStats& _stats;
+		Clock::time_point _start;
+
+	public:
+		DriverTimer(GlStats& stats) : _stats{stats}, _start{Clock::now()} {}
+
+		~DriverTimer() {
+			auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - this->_start);
+			this->_stats._current.gl_ns += elapsed.count();
+		}
+
+		DriverTimer(const DriverTimer&) = delete;
+		DriverTimer& operator=(const DriverTimer&) = delete;
+	};
+
+	static constexpr std::uint32_t QUERY_COUNT = 4;
+
+private:
+	struct PendingFrame {
+		// -1 if the frame wasn't timed
+		std::int32_t query;
+		FrameStats stats;
+	};
+
+	FrameStats _current{};
+	FrameStats _last{};
+
+	std::uint64_t _frame{0u};
+	Clock::time_point _frame_start{};
+	Clock::time_point _render_start{};
+
+	// the state cache counts for the whole session, so only the difference is taken
+	std::uint64_t _state_changes_start{0u};
+	std::uint64_t _elided_start{0u};
+
+	bool _queries_created{false};
+	std::array<std::uint32_t, QUERY_COUNT> _queries{};
+	std::array<bool, QUERY_COUNT> _query_busy{};
+	std::int32_t _active_query{-1};
+
+	std::deque<PendingFrame> _pending{};
+	std::int64_t _last_gpu_ns{-1};
+
+	std::ofstream _log{};
+
+	void resolve_queries();
+	void finish(const FrameStats& stats);
+
+public:
+	/**
+	 * starts writing frame stats to the given csv file
+	 */
+	void set_log_file(const std::filesystem::path& path);
+
+	/**
+	 * call right before and after the guest renders. the gl context must be current
+	 */
+	void begin_frame(const GlState& state);
+	void end_frame(const GlState& state);
+
+	void count_draw() {
+		this->_current.draw_calls++;
+	}
+
+	void count_program_switch() {
+		this->_current.program_switches++;
+	}
+
+	void count_get_error() {
+		this->_current.get_error_calls++;
+	}
+
+	void count_buffer_upload(std::uint64_t bytes) {
+		this->_current.buffer_bytes += bytes;
+	}
+
+	/**
+	 * counts the size of the guest's pixels, before any conversion
+	 */
+	void count_texture_upload(std::uint32_t width, std::uint32_t height, std::uint32_t format, std::uint32_t type);
+
+	DriverTimer time_driver() {
+		return DriverTimer{*this};
+	}
+
+	/**
+	 * the most recently finished frame. the gpu time is from whichever frame resolved last
+	 */
+	const FrameStats& last_frame() const {
+		return this->_last;
+	}
+};
+
+#endif
@@ -0,0 +1,827 @@
+#include "gl-streamer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <span>
+
+#include <spdlog/spdlog.h>
+
+#ifdef SILENE_USE_EGL
+#include <GLES2/gl2.h>
+#else
+#include <glad/glad.h>
+#endif
+
+#include "../environment.h"
+#include "gl-commands.hpp"
+
+namespace {
+	std::uint32_t type_size(std::uint32_t type) {
+		switch (type) {
+			case GL_BYTE:
+			case GL_UNSIGNED_BYTE:
+				return 1;
+			case GL_SHORT:
+			case GL_UNSIGNED_SHORT:
+			case 0x140B: // GL_HALF_FLOAT
+			case 0x8D61: // GL_HALF_FLOAT_OES
+				return 2;
+			default:
+				// GL_FLOAT, GL_FIXED, GL_INT, GL_UNSIGNED_INT
+				return 4;
+		}
+	}
+
+	struct IndexBounds {
+		std::uint32_t min;
+		std::uint32_t max;
+	};
+
+	constexpr std::uint32_t align_up(std::uint32_t size) {
+		return (size + 3) & ~3u;
+	}
+
+	template <typename T>
+	IndexBounds find_index_bounds(const T* indices, std::uint32_t count) {
+		auto [min, max] = std::minmax_element(indices, indices + count);
+		return {*min, *max};
+	}
+
+	template <typename T>
+	void copy_rebased_indices(std::uint8_t* dest, const T* indices, std::uint32_t count, std::uint32_t base) {
+		auto out = reinterpret_cast<T*>(dest);
+		for (auto i = 0u; i < count; i++) {
+			out[i] = static_cast<T>(indices[i] - base);
+		}
+	}
+
+	std::uint32_t buffer_binding(Environment& env, std::uint32_t target) {
+		switch (target) {
+			case GL_ARRAY_BUFFER:
+				return env.gl().array_buffer_binding();
+			case GL_ELEMENT_ARRAY_BUFFER:
+				return env.gl().element_array_buffer_binding();
+			default:
+				return 0;
+		}
+	}
+
+	std::uint32_t attrib_stride(const GlStreamer::AttribPointer& attrib) {
+		return attrib.stride != 0 ? attrib.stride : attrib.size * type_size(attrib.type);
+	}
+
+	std::uint32_t attrib_read_size(const GlStreamer::AttribPointer& attrib, std::uint32_t count) {
+		// only the bytes that the draw is going to read, the last vertex doesn't need a full stride
+		return (count - 1) * attrib_stride(attrib) + attrib.size * type_size(attrib.type);
+	}
+
+	/**
+	 * number of indices a draw turns into as a list of triangles, 0 if it can't be turned into one
+	 */
+	std::uint32_t triangle_list_size(std::uint32_t mode, std::uint32_t count) {
+		switch (mode) {
+			case GL_TRIANGLES:
+				return count / 3 * 3;
+			case GL_TRIANGLE_STRIP:
+			case GL_TRIANGLE_FAN:
+				return count >= 3 ? (count - 2) * 3 : 0;
+			default:
+				return 0;
+		}
+	}
+
+	/**
+	 * appends a draw as a list of triangles. vertex maps the draw's nth vertex to its index in the batch
+	 */
+	template <typename F>
+	void append_triangles(std::vector<std::uint16_t>& out, std::uint32_t mode, std::uint32_t count, F vertex) {
+		auto push = [&out, &vertex](std::uint32_t a, std::uint32_t b, std::uint32_t c) {
+			out.push_back(static_cast<std::uint16_t>(vertex(a)));
+			out.push_back(static_cast<std::uint16_t>(vertex(b)));
+			out.push_back(static_cast<std::uint16_t>(vertex(c)));
+		};
+
+		switch (mode) {
+			case GL_TRIANGLES:
+				for (auto i = 0u; i + 2 < count; i += 3) {
+					push(i, i + 1, i + 2);
+				}
+				break;
+			case GL_TRIANGLE_STRIP:
+				// every other triangle of a strip is wound the other way
+				for (auto i = 0u; i + 2 < count; i++) {
+					if (i % 2 == 0) {
+						push(i, i + 1, i + 2);
+					} else {
+						push(i + 1, i, i + 2);
+					}
+				}
+				break;
+			case GL_TRIANGLE_FAN:
+				for (auto i = 1u; i + 1 < count; i++) {
+					push(0, i, i + 1);
+				}
+				break;
+		}
+	}
+
+	template <typename T>
+	void append_indexed_triangles(std::vector<std::uint16_t>& out, std::uint32_t mode, const T* indices, std::uint32_t count, std::uint32_t shift) {
+		append_triangles(out, mode, count, [indices, shift](std::uint32_t i) {
+			return indices[i] + shift;
+		});
+	}
+}
+
+GlStreamer::BufferState* GlStreamer::find_buffer(std::uint32_t buffer) {
+	if (buffer == 0 || this->_buffers.empty()) {
+		return nullptr;
+	}
+
+	auto it = this->_buffers.find(buffer);
+	return it != this->_buffers.end() ? &it->second : nullptr;
+}
+
+bool GlStreamer::is_streamed(std::uint32_t buffer) {
+	auto state = this->find_buffer(buffer);
+	return state != nullptr && state->streamed;
+}
+
+bool GlStreamer::is_streamed_attrib(const AttribState& state) {
+	return state.enabled && (state.attrib.buffer == 0 || this->is_streamed(state.attrib.buffer));
+}
+
+bool GlStreamer::has_streamed_attribs() {
+	return std::any_of(this->_attribs.begin(), this->_attribs.end(), [this](const auto& state) {
+		return this->is_streamed_attrib(state);
+	});
+}
+
+bool GlStreamer::has_resident_attribs() {
+	return std::any_of(this->_attribs.begin(), this->_attribs.end(), [this](const auto& state) {
+		return state.enabled && !this->is_streamed_attrib(state);
+	});
+}
+
+const std::uint8_t* GlStreamer::attrib_source(Environment& env, const AttribPointer& attrib, std::uint32_t offset, std::uint32_t size) {
+	if (attrib.buffer == 0) {
+		if (attrib.pointer == 0) {
+			return nullptr;
+		}
+
+		return env.memory_manager().read_bytes<std::uint8_t>(attrib.pointer + offset);
+	}
+
+	auto state = this->find_buffer(attrib.buffer);
+	if (state == nullptr || attrib.pointer + offset + size > state->shadow.size()) {
+		return nullptr;
+	}
+
+	return state->shadow.data() + attrib.pointer + offset;
+}
+
+std::uint32_t GlStreamer::find_attrib_blocks(std::array<AttribBlock, MAX_VERTEX_ATTRIBS>& blocks, std::array<std::uint32_t, MAX_VERTEX_ATTRIBS>& attrib_blocks) {
+	auto count = 0u;
+
+	for (auto i = 0u; i < MAX_VERTEX_ATTRIBS; i++) {
+		const auto& state = this->_attribs[i];
+		if (!this->is_streamed_attrib(state)) {
+			continue;
+		}
+
+		const auto& attrib = state.attrib;
+		auto stride = attrib_stride(attrib);
+		auto start = attrib.pointer;
+		auto end = attrib.pointer + attrib.size * type_size(attrib.type);
+
+		// an attrib joins a block if the block's vertices would still fit in one stride with it
+		auto block = std::find_if(blocks.begin(), blocks.begin() + count, [&](const AttribBlock& candidate) {
+			if (candidate.buffer != attrib.buffer || candidate.stride != stride) {
+				return false;
+			}
+
+			auto block_start = std::min(candidate.pointer, start);
+			auto block_end = std::max(candidate.pointer + candidate.vertex_size, end);
+			return block_end - block_start <= stride;
+		});
+
+		if (block == blocks.begin() + count) {
+			*block = {attrib.buffer, start, stride, end - start};
+			count++;
+		} else {
+			auto block_start = std::min(block->pointer, start);
+			auto block_end = std::max(block->pointer + block->vertex_size, end);
+
+			block->pointer = block_start;
+			block->vertex_size = block_end - block_start;
+		}
+
+		attrib_blocks[i] = static_cast<std::uint32_t>(block - blocks.begin());
+	}
+
+	return count;
+}
+
+std::uint32_t GlStreamer::attribs_size(VertexRange range) {
+	std::array<AttribBlock, MAX_VERTEX_ATTRIBS> blocks;
+	std::array<std::uint32_t, MAX_VERTEX_ATTRIBS> attrib_blocks;
+	auto count = this->find_attrib_blocks(blocks, attrib_blocks);
+
+	auto total = 0u;
+
+	for (auto i = 0u; i < count; i++) {
+		const auto& block = blocks[i];
+		total += align_up((range.count - 1) * block.stride + block.vertex_size);
+	}
+
+	return total;
+}
+
+void GlStreamer::write_attribs(Environment& env, const StreamBuffer::Allocation& allocation, VertexRange range) {
+	std::array<AttribBlock, MAX_VERTEX_ATTRIBS> blocks;
+	std::array<std::uint32_t, MAX_VERTEX_ATTRIBS> attrib_blocks;
+	auto count = this->find_attrib_blocks(blocks, attrib_blocks);
+
+	std::array<std::uint32_t, MAX_VERTEX_ATTRIBS> block_offsets;
+	auto cursor = 0u;
+
+	for (auto i = 0u; i < count; i++) {
+		const auto& block = blocks[i];
+		auto size = (range.count - 1) * block.stride + block.vertex_size;
+
+		AttribPointer source{0, 0u, false, block.stride, block.pointer, block.buffer};
+		auto src = this->attrib_source(env, source, range.first * block.stride, size);
+		if (src != nullptr) {
+			std::memcpy(allocation.ptr + cursor, src, size);
+		} else {
+			std::memset(allocation.ptr + cursor, 0, size);
+		}
+
+		block_offsets[i] = cursor;
+		cursor += align_up(size);
+	}
+
+	for (auto i = 0u; i < MAX_VERTEX_ATTRIBS; i++) {
+		const auto& state = this->_attribs[i];
+		if (!this->is_streamed_attrib(state)) {
+			continue;
+		}
+
+		const auto& attrib = state.attrib;
+		const auto& block = blocks[attrib_blocks[i]];
+
+		auto offset = static_cast<std::uintptr_t>(allocation.offset + block_offsets[attrib_blocks[i]] + (attrib.pointer - block.pointer));
+		glVertexAttribPointer(i, attrib.size, attrib.type, attrib.normalized, attrib.stride, reinterpret_cast<void*>(offset));
+	}
+}
+
+void GlStreamer::bind_client_attribs(Environment& env) {
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	for (auto i = 0u; i < MAX_VERTEX_ATTRIBS; i++) {
+		const auto& state = this->_attribs[i];
+		if (!this->is_streamed_attrib(state)) {
+			continue;
+		}
+
+		const auto& attrib = state.attrib;
+		auto pointer = this->attrib_source(env, attrib, 0, 0);
+		glVertexAttribPointer(i, attrib.size, attrib.type, attrib.normalized, attrib.stride, pointer);
+	}
+}
+
+void GlStreamer::mark_drawn() {
+	if (this->_buffers.empty()) {
+		return;
+	}
+
+	for (const auto& state : this->_attribs) {
+		if (!state.enabled) {
+			continue;
+		}
+
+		if (auto buffer = this->find_buffer(state.attrib.buffer); buffer != nullptr) {
+			buffer->drawn = true;
+		}
+	}
+}
+
+bool GlStreamer::mark_updated(std::uint32_t buffer, BufferState& state) {
+	if (state.last_update + 1 == this->_frame) {
+		state.hot_frames++;
+	} else if (state.last_update != this->_frame) {
+		state.hot_frames = 1;
+	}
+
+	state.last_update = this->_frame;
+
+	if (!state.streamed && state.hot_frames >= STREAM_AFTER_FRAMES) {
+		spdlog::debug("gl streamer: buffer {} is updated every frame, streaming it", buffer);
+		state.streamed = true;
+	}
+
+	// the driver would have had to wait for the gpu, or copy the old contents somewhere
+	if (state.streamed && state.drawn) {
+		this->_stalls_avoided++;
+	}
+
+	state.drawn = false;
+
+	return state.streamed;
+}
+
+void GlStreamer::retire_buffer(Environment& env, std::uint32_t buffer, BufferState& state) {
+	spdlog::debug("gl streamer: buffer {} stopped changing, returning it to the driver", buffer);
+
+	state.streamed = false;
+	state.hot_frames = 0;
+
+	env.gl_commands().flush();
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, state.shadow.size(), state.shadow.data(), state.usage);
+
+	// draws pointed these at the ring, so they have to be pointed back
+	for (auto i = 0u; i < MAX_VERTEX_ATTRIBS; i++) {
+		const auto& attrib = this->_attribs[i].attrib;
+		if (attrib.buffer != buffer) {
+			continue;
+		}
+
+		auto offset = static_cast<std::uintptr_t>(attrib.pointer);
+		glVertexAttribPointer(i, attrib.size, attrib.type, attrib.normalized, attrib.stride, reinterpret_cast<void*>(offset));
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, env.gl().array_buffer_binding());
+}
+
+bool GlStreamer::matches_batch() {
+	for (auto i = 0u; i < MAX_VERTEX_ATTRIBS; i++) {
+		const auto& state = this->_attribs[i];
+		const auto& batch = this->_batch_attribs[i];
+
+		auto streamed = this->is_streamed_attrib(state);
+		if (streamed != batch.enabled) {
+			return false;
+		}
+
+		if (streamed && (state.attrib.size != batch.size || state.attrib.type != batch.type || state.attrib.normalized != batch.normalized)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::uint32_t GlStreamer::batch_size() {
+	auto total = static_cast<std::uint32_t>(this->_batch_indices.size() * sizeof(std::uint16_t));
+
+	for (const auto& batch : this->_batch_attribs) {
+		if (batch.enabled) {
+			total += align_up(batch.data.size());
+		}
+	}
+
+	return total;
+}
+
+void GlStreamer::open_batch(Environment& env) {
+	// the batch takes the place of its first draw, so everything before that has to get to the driver now
+	env.gl_commands().flush();
+
+	this->_batch_array_buffer = env.gl().array_buffer_binding();
+	this->_batch_element_buffer = env.gl().element_array_buffer_binding();
+
+	for (auto i = 0u; i < MAX_VERTEX_ATTRIBS; i++) {
+		const auto& state = this->_attribs[i];
+		auto& batch = this->_batch_attribs[i];
+
+		batch.enabled = this->is_streamed_attrib(state);
+		batch.size = state.attrib.size;
+		batch.type = state.attrib.type;
+		batch.normalized = state.attrib.normalized;
+		batch.data.clear();
+	}
+
+	this->_batch_indices.clear();
+	this->_batch_vertices = 0;
+	this->_batch_open = true;
+
+	env.gl_commands().arm_barrier();
+}
+
+void GlStreamer::submit_batch() {
+	if (!this->_batch_open) {
+		return;
+	}
+
+	this->_batch_open = false;
+	this->_batches_submitted++;
+
+	auto count = static_cast<std::uint32_t>(this->_batch_indices.size());
+	auto indices_size = count * static_cast<std::uint32_t>(sizeof(std::uint16_t));
+
+	this->_vertex_stream.bind();
+
+	auto allocation = this->_vertex_stream.allocate(this->batch_size());
+	if (allocation) {
+		auto cursor = 0u;
+
+		for (auto i = 0u; i < MAX_VERTEX_ATTRIBS; i++) {
+			const auto& batch = this->_batch_attribs[i];
+			if (!batch.enabled) {
+				continue;
+			}
+
+			std::memcpy(allocation->ptr + cursor, batch.data.data(), batch.data.size());
+
+			auto offset = static_cast<std::uintptr_t>(allocation->offset + cursor);
+			glVertexAttribPointer(i, batch.size, batch.type, batch.normalized, 0, reinterpret_cast<void*>(offset));
+
+			cursor += align_up(batch.data.size());
+		}
+
+		std::memcpy(allocation->ptr + cursor, this->_batch_indices.data(), indices_size);
+
+		this->_vertex_stream.flush(*allocation);
+		this->_bytes_streamed += allocation->size;
+
+		auto indices_offset = static_cast<std::uintptr_t>(allocation->offset + cursor);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->_vertex_stream.buffer());
+		glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_SHORT, reinterpret_cast<void*>(indices_offset));
+	} else {
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		for (auto i = 0u; i < MAX_VERTEX_ATTRIBS; i++) {
+			const auto& batch = this->_batch_attribs[i];
+			if (batch.enabled) {
+				glVertexAttribPointer(i, batch.size, batch.type, batch.normalized, 0, batch.data.data());
+			}
+		}
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_SHORT, this->_batch_indices.data());
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->_batch_element_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, this->_batch_array_buffer);
+}
+
+std::optional<std::uint32_t> GlStreamer::coalesce_vertices(Environment& env, std::uint32_t mode, VertexRange range, std::uint32_t count) {
+	auto indices = triangle_list_size(mode, count);
+	if (!this->_coalesce || indices == 0 || range.count > MAX_BATCH_VERTICES || this->has_resident_attribs()) {
+		return std::nullopt;
+	}
+
+	auto size = indices * static_cast<std::uint32_t>(sizeof(std::uint16_t));
+	for (const auto& state : this->_attribs) {
+		if (this->is_streamed_attrib(state)) {
+			size += align_up(range.count * state.attrib.size * type_size(state.attrib.type));
+		}
+	}
+
+	// a batch has to fit in the ring in one go
+	if (size > this->_vertex_stream.segment_size()) {
+		return std::nullopt;
+	}
+
+	if (this->_batch_open) {
+		auto full = this->_batch_vertices + range.count > MAX_BATCH_VERTICES
+			|| this->batch_size() + size > this->_vertex_stream.segment_size();
+
+		if (full || !this->matches_batch()) {
+			this->submit_batch();
+		}
+	}
+
+	if (!this->_batch_open) {
+		this->open_batch(env);
+	}
+
+	for (auto i = 0u; i < MAX_VERTEX_ATTRIBS; i++) {
+		auto& batch = this->_batch_attribs[i];
+		if (!batch.enabled) {
+			continue;
+		}
+
+		const auto& attrib = this->_attribs[i].attrib;
+		auto element_size = attrib.size * type_size(attrib.type);
+		auto stride = attrib_stride(attrib);
+
+		auto offset = batch.data.size();
+		batch.data.resize(offset + range.count * element_size);
+		auto dest = batch.data.data() + offset;
+
+		auto src = this->attrib_source(env, attrib, range.first * stride, attrib_read_size(attrib, range.count));
+		if (src == nullptr) {
+			std::memset(dest, 0, range.count * element_size);
+		} else if (stride == element_size) {
+			std::memcpy(dest, src, range.count * element_size);
+		} else {
+			// interleaved vertices are split up, so every draw in the batch can share one pointer per attrib
+			for (auto v = 0u; v < range.count; v++) {
+				std::memcpy(dest + v * element_size, src + v * stride, element_size);
+			}
+		}
+	}
+
+	auto base = this->_batch_vertices;
+	this->_batch_vertices += range.count;
+	this->_draws_coalesced++;
+
+	return base;
+}
+
+bool GlStreamer::set_attrib_pointer(std::uint32_t index, const AttribPointer& attrib) {
+	if (index >= MAX_VERTEX_ATTRIBS) {
+		return false;
+	}
+
+	this->_attribs[index].attrib = attrib;
+
+	return attrib.buffer == 0 || this->is_streamed(attrib.buffer);
+}
+
+void GlStreamer::set_attrib_enabled(std::uint32_t index, bool enabled) {
+	if (index >= MAX_VERTEX_ATTRIBS) {
+		return;
+	}
+
+	this->_attribs[index].enabled = enabled;
+}
+
+void GlStreamer::enable_coalescing(GlCommandStream& commands) {
+	this->_coalesce = true;
+
+	commands.set_barrier([this]() {
+		this->submit_batch();
+	});
+}
+
+bool GlStreamer::buffer_data(Environment& env, std::uint32_t target, std::uint32_t size, std::uint32_t data_ptr, std::uint32_t usage) {
+	auto buffer = buffer_binding(env, target);
+	if (buffer == 0) {
+		return false;
+	}
+
+	// anything that can't fit in the ring would never be streamed, so it isn't worth keeping a copy of
+	if (size > this->_vertex_stream.segment_size()) {
+		if (auto state = this->find_buffer(buffer); state != nullptr) {
+			if (state->streamed) {
+				this->retire_buffer(env, buffer, *state);
+			}
+
+			this->_buffers.erase(buffer);
+		}
+
+		return false;
+	}
+
+	auto& state = this->_buffers[buffer];
+	state.usage = usage;
+	state.shadow.resize(size);
+
+	if (data_ptr != 0) {
+		auto data = env.memory_manager().read_bytes<std::uint8_t>(data_ptr);
+		std::memcpy(state.shadow.data(), data, size);
+	}
+
+	return this->mark_updated(buffer, state);
+}
+
+bool GlStreamer::buffer_sub_data(Environment& env, std::uint32_t target, std::uint32_t offset, std::uint32_t size, std::uint32_t data_ptr) {
+	auto buffer = buffer_binding(env, target);
+
+	auto state = this->find_buffer(buffer);
+	if (state == nullptr || data_ptr == 0 || offset + size > state->shadow.size()) {
+		return false;
+	}
+
+	auto data = env.memory_manager().read_bytes<std::uint8_t>(data_ptr);
+	std::memcpy(state->shadow.data() + offset, data, size);
+
+	return this->mark_updated(buffer, *state);
+}
+
+void GlStreamer::delete_buffers(std::uint32_t n, const std::uint32_t* buffers) {
+	if (this->_buffers.empty()) {
+		return;
+	}
+
+	for (auto buffer : std::span{buffers, n}) {
+		this->_buffers.erase(buffer);
+	}
+}
+
+bool GlStreamer::draw_arrays(Environment& env, std::uint32_t mode, std::int32_t first, std::uint32_t count) {
+	this->mark_drawn();
+
+	if (count == 0 || first < 0 || !this->has_streamed_attribs()) {
+		return false;
+	}
+
+	if (auto base = this->coalesce_vertices(env, mode, {static_cast<std::uint32_t>(first), count}, count); base) {
+		append_triangles(this->_batch_indices, mode, count, [base = *base](std::uint32_t i) {
+			return base + i;
+		});
+
+		return true;
+	}
+
+	// the draw goes straight to the driver, so everything the guest did before it has to get there first
+	env.gl_commands().flush();
+
+	auto guest_array_buffer = env.gl().array_buffer_binding();
+
+	// resident attribs still expect to start from first, so only rebase when everything is streamed
+	auto rebase = !this->has_resident_attribs();
+	auto range = rebase
+		? VertexRange{static_cast<std::uint32_t>(first), count}
+		: VertexRange{0, static_cast<std::uint32_t>(first) + count};
+
+	this->_vertex_stream.bind();
+
+	auto allocation = this->_vertex_stream.allocate(this->attribs_size(range));
+	if (allocation) {
+		this->write_attribs(env, *allocation, range);
+		this->_vertex_stream.flush(*allocation);
+		this->_bytes_streamed += allocation->size;
+
+		glDrawArrays(mode, rebase ? 0 : first, count);
+	} else {
+		this->bind_client_attribs(env);
+		glDrawArrays(mode, first, count);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, guest_array_buffer);
+
+	return true;
+}
+
+bool GlStreamer::draw_host_elements(Environment& env, std::uint32_t mode, std::uint32_t count, std::uint32_t type, const std::uint8_t* indices) {
+	auto has_streamed_attribs = this->has_streamed_attribs();
+
+	IndexBounds bounds{0, 0};
+	if (has_streamed_attribs) {
+		switch (type) {
+			case GL_UNSIGNED_BYTE:
+				bounds = find_index_bounds(indices, count);
+				break;
+			case GL_UNSIGNED_SHORT:
+				bounds = find_index_bounds(reinterpret_cast<const std::uint16_t*>(indices), count);
+				break;
+			default:
+				bounds = find_index_bounds(reinterpret_cast<const std::uint32_t*>(indices), count);
+				break;
+		}
+
+		if (auto batch_base = this->coalesce_vertices(env, mode, {bounds.min, bounds.max - bounds.min + 1}, count); batch_base) {
+			auto shift = *batch_base - bounds.min;
+
+			switch (type) {
+				case GL_UNSIGNED_BYTE:
+					append_indexed_triangles(this->_batch_indices, mode, indices, count, shift);
+					break;
+				case GL_UNSIGNED_SHORT:
+					append_indexed_triangles(this->_batch_indices, mode, reinterpret_cast<const std::uint16_t*>(indices), count, shift);
+					break;
+				default:
+					append_indexed_triangles(this->_batch_indices, mode, reinterpret_cast<const std::uint32_t*>(indices), count, shift);
+					break;
+			}
+
+			return true;
+		}
+	}
+
+	env.gl_commands().flush();
+
+	auto guest_array_buffer = env.gl().array_buffer_binding();
+	auto guest_element_buffer = env.gl().element_array_buffer_binding();
+
+	auto base = this->has_resident_attribs() ? 0u : bounds.min;
+	auto range = VertexRange{base, bounds.max - base + 1};
+
+	// everything goes into one allocation, as wrapping halfway through would lose the first half
+	auto attribs_size = has_streamed_attribs ? this->attribs_size(range) : 0u;
+	auto indices_size = count * type_size(type);
+
+	this->_vertex_stream.bind();
+
+	auto allocation = this->_vertex_stream.allocate(attribs_size + indices_size);
+	if (!allocation) {
+		if (has_streamed_attribs) {
+			this->bind_client_attribs(env);
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, guest_array_buffer);
+
+		// host pointers can only be used for indices when nothing is bound
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		glDrawElements(mode, count, type, indices);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, guest_element_buffer);
+
+		return true;
+	}
+
+	if (has_streamed_attribs) {
+		this->write_attribs(env, *allocation, range);
+	}
+
+	auto indices_dest = allocation->ptr + attribs_size;
+	if (base == 0) {
+		std::memcpy(indices_dest, indices, indices_size);
+	} else {
+		switch (type) {
+			case GL_UNSIGNED_BYTE:
+				copy_rebased_indices(indices_dest, indices, count, base);
+				break;
+			case GL_UNSIGNED_SHORT:
+				copy_rebased_indices(indices_dest, reinterpret_cast<const std::uint16_t*>(indices), count, base);
+				break;
+			default:
+				copy_rebased_indices(indices_dest, reinterpret_cast<const std::uint32_t*>(indices), count, base);
+				break;
+		}
+	}
+
+	this->_vertex_stream.flush(*allocation);
+	this->_bytes_streamed += allocation->size;
+
+	auto indices_offset = static_cast<std::uintptr_t>(allocation->offset + attribs_size);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->_vertex_stream.buffer());
+	glDrawElements(mode, count, type, reinterpret_cast<void*>(indices_offset));
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, guest_element_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, guest_array_buffer);
+
+	return true;
+}
+
+bool GlStreamer::draw_elements(Environment& env, std::uint32_t mode, std::uint32_t count, std::uint32_t type, std::uint32_t indices_ptr) {
+	this->mark_drawn();
+
+	if (count == 0) {
+		return false;
+	}
+
+	auto element_buffer = env.gl().element_array_buffer_binding();
+	if (element_buffer == 0) {
+		if (indices_ptr == 0) {
+			return false;
+		}
+
+		auto indices = env.memory_manager().read_bytes<std::uint8_t>(indices_ptr);
+		return this->draw_host_elements(env, mode, count, type, indices);
+	}
+
+	if (auto state = this->find_buffer(element_buffer); state != nullptr) {
+		state->drawn = true;
+
+		if (state->streamed && indices_ptr + count * type_size(type) <= state->shadow.size()) {
+			return this->draw_host_elements(env, mode, count, type, state->shadow.data() + indices_ptr);
+		}
+	}
+
+	if (!this->has_streamed_attribs()) {
+		return false;
+	}
+
+	// the indices live on the gpu, so there's no cheap way to find out which vertices are used
+	auto guest_array_buffer = env.gl().array_buffer_binding();
+
+	env.gl_commands().flush();
+	this->bind_client_attribs(env);
+	glDrawElements(mode, count, type, reinterpret_cast<void*>(static_cast<std::uintptr_t>(indices_ptr)));
+
+	glBindBuffer(GL_ARRAY_BUFFER, guest_array_buffer);
+
+	return true;
+}
+
+void GlStreamer::begin_frame(Environment& env) {
+	// the end of the last frame flushed the command stream, which should have submitted it already
+	this->submit_batch();
+
+	this->_draws_coalesced_last_frame = this->_draws_coalesced;
+	this->_draws_coalesced = 0;
+
+	this->_batches_submitted_last_frame = this->_batches_submitted;
+	this->_batches_submitted = 0;
+
+	this->_bytes_streamed_last_frame = this->_bytes_streamed;
+	this->_bytes_streamed = 0;
+
+	this->_stalls_avoided_last_frame = this->_stalls_avoided;
+	this->_stalls_avoided = 0;
+
+	this->_frame++;
+
+	for (auto& [buffer, state] : this->_buffers) {
+		if (state.streamed && this->_frame - state.last_update > RETIRE_AFTER_FRAMES) {
+			this->retire_buffer(env, buffer, state);
+		}
+	}
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#ifndef _GL_STREAMER_HPP
+#define _GL_STREAMER_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "gl-state.hpp"
+#include "stream-buffer.hpp"
+
+class Environment;
+class GlCommandStream;
+
+/**
+ * moves guest data that the gl would otherwise read out of client memory into stream buffers.
+ *
+ * vertex attribs that point into guest memory are never handed to the driver directly.
+ * they're remembered here, and at draw time the range that the draw actually reads is copied into a ring
+ * so the driver never has to do a synchronous copy of client arrays.
+ *
+ * buffer objects that get respecified every frame are treated the same way. once a buffer is hot,
+ * its uploads only go to a copy on the host, and draws stream out of that copy instead of making the driver
+ * wait for the gpu to finish with the old contents.
+ *
+ * with coalescing on, triangle draws that only read streamed data are held back instead of drawn,
+ * and the ones after it are appended for as long as nothing else reaches the driver in between.
+ * anything else going into the command stream means the state could have changed, so the held draws
+ * are submitted as a single indexed draw first
+ */
+class GlStreamer {
+public:
+	static constexpr std::uint32_t MAX_VERTEX_ATTRIBS = GlState::MAX_VERTEX_ATTRIBS;
+
+	// 4mb, which is split into four segments
+	static constexpr std::uint32_t STREAM_BUFFER_SIZE = 4 * 1024 * 1024;
+
+	// number of frames in a row a buffer has to be updated in before it's streamed
+	static constexpr std::uint32_t STREAM_AFTER_FRAMES = 3;
+
+	// number of frames without updates before a streamed buffer goes back to the driver
+	static constexpr std::uint32_t RETIRE_AFTER_FRAMES = 60;
+
+	// indices of a merged draw are shorts, as that's all es2 guarantees
+	static constexpr std::uint32_t MAX_BATCH_VERTICES = 0x10000;
+
+	using AttribPointer = GlState::AttribPointer;
+
+private:
+	struct AttribState {
+		bool enabled{false};
+		AttribPointer attrib{};
+	};
+
+	struct BufferState {
+		std::uint32_t usage{0u};
+
+		// everything the guest has uploaded, as the driver's copy goes stale while streaming
+		std::vector<std::uint8_t> shadow{};
+
+		std::uint32_t last_update{0u};
+		std::uint32_t hot_frames{0u};
+
+		bool streamed{false};
+
+		// a draw has used the current contents, so updating them would stall
+		bool drawn{false};
+	};
+
+	struct VertexRange {
+		std::uint32_t first;
+		std::uint32_t count;
+	};
+
+	// streamed attribs that are interleaved in the same vertices, which only have to be copied once
+	struct AttribBlock {
+		std::uint32_t buffer;
+		std::uint32_t pointer;
+		std::uint32_t stride;
+
+		// bytes of each vertex that the attribs read, from pointer
+		std::uint32_t vertex_size;
+	};
+
+	// the vertices of an attrib for every draw in a batch, tightly packed
+	struct BatchAttrib {
+		bool enabled{false};
+
+		std::int32_t size{0};
+		std::uint32_t type{0u};
+		bool normalized{false};
+
+		std::vector<std::uint8_t> data{};
+	};
+
+	std::array<AttribState, MAX_VERTEX_ATTRIBS> _attribs{};
+	std::unordered_map<std::uint32_t, BufferState> _buffers{};
+
+	StreamBuffer _vertex_stream{0x8892 /* GL_ARRAY_BUFFER */, STREAM_BUFFER_SIZE};
+
+	std::uint32_t _frame{1u};
+
+	std::uint32_t _bytes_streamed{0u};
+	std::uint32_t _bytes_streamed_last_frame{0u};
+
+	std::uint32_t _stalls_avoided{0u};
+	std::uint32_t _stalls_avoided_last_frame{0u};
+
+	bool _coalesce{false};
+
+	bool _batch_open{false};
+	std::array<BatchAttrib, MAX_VERTEX_ATTRIBS> _batch_attribs{};
+	std::vector<std::uint16_t> _batch_indices{};
+	std::uint32_t _batch_vertices{0u};
+
+	// what the guest had bound when the batch started, which can't change until it's submitted
+	std::uint32_t _batch_array_buffer{0u};
+	std::uint32_t _batch_element_buffer{0u};
+
+	std::uint32_t _draws_coalesced{0u};
+	std::uint32_t _draws_coalesced_last_frame{0u};
+
+	std::uint32_t _batches_submitted{0u};
+	std::uint32_t _batches_submitted_last_frame{0u};
+
+	BufferState* find_buffer(std::uint32_t buffer);
+	bool is_streamed(std::uint32_t buffer);
+
+	/**
+	 * whether the attrib has to be copied into the ring at draw time
+	 */
+	bool is_streamed_attrib(const AttribState& state);
+
+	bool has_streamed_attribs();
+	bool has_resident_attribs();
+
+	/**
+	 * gets the host address of an attrib's data, or nullptr if the guest pointed it somewhere invalid
+	 */
+	const std::uint8_t* attrib_source(Environment& env, const AttribPointer& attrib, std::uint32_t offset, std::uint32_t size);
+
+	/**
+	 * groups the streamed attribs into blocks, writing the block each attrib ended up in. returns the number of blocks
+	 */
+	std::uint32_t find_attrib_blocks(std::array<AttribBlock, MAX_VERTEX_ATTRIBS>& blocks, std::array<std::uint32_t, MAX_VERTEX_ATTRIBS>& attrib_blocks);
+
+	/**
+	 * number of bytes needed to stream the given vertices of every streamed attrib
+	 */
+	std::uint32_t attribs_size(VertexRange range);
+
+	/**
+	 * copies the given vertices of every attrib block to the start of the allocation,
+	 * then points the attribs at their place in it. the stream has to be bound
+	 */
+	void write_attribs(Environment& env, const StreamBuffer::Allocation& allocation, VertexRange range);
+
+	/**
+	 * points every streamed attrib straight at host memory, for draws that can't be streamed
+	 */
+	void bind_client_attribs(Environment& env);
+
+	/**
+	 * flags buffers used by the enabled attribs as being read by the gpu
+	 */
+	void mark_drawn();
+
+	/**
+	 * returns true if the update should be kept away from the driver
+	 */
+	bool mark_updated(std::uint32_t buffer, BufferState& state);
+
+	/**
+	 * hands a buffer that stopped changing back to the driver
+	 */
+	void retire_buffer(Environment& env, std::uint32_t buffer, BufferState& state);
+
+	/**
+	 * whether the streamed attribs are laid out the same as in the open batch
+	 */
+	bool matches_batch();
+
+	/**
+	 * bytes the open batch takes up in the ring
+	 */
+	std::uint32_t batch_size();
+
+	void open_batch(Environment& env);
+
+	/**
+	 * draws everything in the open batch at once, and closes it
+	 */
+	void submit_batch();
+
+	/**
+	 * copies the given vertices into the open batch, opening a new one if they don't fit.
+	 * returns where the first vertex ended up, or nothing if the draw can't be merged and should be drawn on its own.
+	 * the caller adds the indices
+	 */
+	std::optional<std::uint32_t> coalesce_vertices(Environment& env, std::uint32_t mode, VertexRange range, std::uint32_t count);
+
+	/**
+	 * draws with indices that live on the host
+	 */
+	bool draw_host_elements(Environment& env, std::uint32_t mode, std::uint32_t count, std::uint32_t type, const std::uint8_t* indices);
+
+public:
+	/**
+	 * records a vertex attrib pointer, returning true if it shouldn't be given to the driver
+	 */
+	bool set_attrib_pointer(std::uint32_t index, const AttribPointer& attrib);
+
+	void set_attrib_enabled(std::uint32_t index, bool enabled);
+
+	/**
+	 * starts merging consecutive draws. the stream's barrier is used to know when a batch has to be submitted
+	 */
+	void enable_coalescing(GlCommandStream& commands);
+
+	/**
+	 * handles a glBufferData, returning true if the driver shouldn't see it
+	 */
+	bool buffer_data(Environment& env, std::uint32_t target, std::uint32_t size, std::uint32_t data_ptr, std::uint32_t usage);
+
+	/**
+	 * handles a glBufferSubData, returning true if the driver shouldn't see it
+	 */
+	bool buffer_sub_data(Environment& env, std::uint32_t target, std::uint32_t offset, std::uint32_t size, std::uint32_t data_ptr);
+
+	void delete_buffers(std::uint32_t n, const std::uint32_t* buffers);
+
+	/**
+	 * performs a glDrawArrays if any attribs need streaming, returning false if the caller should draw normally
+	 */
+	bool draw_arrays(Environment& env, std::uint32_t mode, std::int32_t first, std::uint32_t count);
+
+	/**
+	 * performs a glDrawElements if any attribs or indices need streaming, returning false if the caller should draw normally
+	 */
+	bool draw_elements(Environment& env, std::uint32_t mode, std::uint32_t count, std::uint32_t type, std::uint32_t indices_ptr);
+
+	void begin_frame(Environment& env);
+
+	std::uint32_t bytes_streamed_last_frame() const {
+		return this->_bytes_streamed_last_frame;
+	}
+
+	std::uint32_t stalls_avoided_last_frame() const {
+		return this->_stalls_avoided_last_frame;
+	}
+
+	/**
+	 * guest draws that went into a batch, including batches of only one draw
+	 */
+	std::uint32_t draws_coalesced_last_frame() const {
+		return this->_draws_coalesced_last_frame;
+	}
+
+	std::uint32_t batches_submitted_last_frame() const {
+		return this->_batches_submitted_last_frame;
+	}
+};
+
+#endif
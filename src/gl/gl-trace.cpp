@@ -0,0 +1,353 @@
+#include "gl-trace.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#ifdef SILENE_USE_EGL
+#include <GLES2/gl2.h>
+#else
+#include <glad/glad.h>
+#endif
+
+#include "../paged-memory.hpp"
+
+namespace {
+	std::uint32_t type_size(std::uint32_t type) {
+		switch (type) {
+			case GL_BYTE:
+			case GL_UNSIGNED_BYTE:
+				return 1;
+			case GL_SHORT:
+			case GL_UNSIGNED_SHORT:
+			case 0x140B: // GL_HALF_FLOAT
+			case 0x8D61: // GL_HALF_FLOAT_OES
+				return 2;
+			default:
+				return 4;
+		}
+	}
+
+	std::uint32_t pixel_size(std::uint32_t format, std::uint32_t type) {
+		switch (type) {
+			case GL_UNSIGNED_SHORT_4_4_4_4:
+			case GL_UNSIGNED_SHORT_5_5_5_1:
+			case GL_UNSIGNED_SHORT_5_6_5:
+				return 2;
+			case GL_UNSIGNED_BYTE:
+				switch (format) {
+					case GL_ALPHA:
+					case GL_LUMINANCE:
+						return 1;
+					case GL_LUMINANCE_ALPHA:
+						return 2;
+					case GL_RGB:
+						return 3;
+					default:
+						return 4;
+				}
+			default:
+				return 4;
+		}
+	}
+
+	template <typename T>
+	std::uint32_t max_index(const std::uint8_t* indices, std::uint32_t count) {
+		auto begin = reinterpret_cast<const T*>(indices);
+		return *std::max_element(begin, begin + count);
+	}
+}
+
+void GlTrace::write(const void* data, std::size_t size) {
+	auto offset = this->_buffer.size();
+	this->_buffer.resize(offset + size);
+	std::memcpy(this->_buffer.data() + offset, data, size);
+}
+
+void GlTrace::write_record(Op op, const std::uint32_t* words, std::uint8_t count, const void* payload, std::uint32_t size, bool has_payload) {
+	std::uint8_t prefix[2]{static_cast<std::uint8_t>(op), static_cast<std::uint8_t>(has_payload ? count | PAYLOAD_FLAG : count)};
+	this->write(prefix, sizeof(prefix));
+	this->write(words, count * sizeof(std::uint32_t));
+
+	if (has_payload) {
+		this->write(&size, sizeof(size));
+		this->write(payload, size);
+	}
+
+	if (this->_buffer.size() >= WRITE_THRESHOLD) {
+		this->write_buffer();
+	}
+}
+
+void GlTrace::write_buffer() {
+	this->_file.write(reinterpret_cast<const char*>(this->_buffer.data()), this->_buffer.size());
+	this->_buffer.clear();
+}
+
+void GlTrace::close() {
+	this->record(Op::End);
+	this->write_buffer();
+
+	// the frame count is only known now
+	this->_file.seekp(offsetof(Header, frames));
+	this->_file.write(reinterpret_cast<const char*>(&this->_frames), sizeof(this->_frames));
+
+	this->_file.close();
+
+	spdlog::info("gl trace: wrote {} frames to {}", this->_frames, this->_path.string());
+
+	this->_buffer = {};
+	this->_index_buffers.clear();
+}
+
+bool GlTrace::has_client_attribs() const {
+	return std::any_of(this->_attribs.begin(), this->_attribs.end(), [](const auto& attrib) {
+		return attrib.enabled && attrib.pointer != 0;
+	});
+}
+
+void GlTrace::record_client_attribs(std::uint32_t last_vertex) {
+	for (auto i = 0u; i < MAX_VERTEX_ATTRIBS; i++) {
+		const auto& attrib = this->_attribs[i];
+		if (!attrib.enabled || attrib.pointer == 0) {
+			continue;
+		}
+
+		auto element_size = attrib.size * type_size(attrib.type);
+		auto stride = attrib.stride != 0 ? attrib.stride : element_size;
+		auto size = last_vertex * stride + element_size;
+
+		auto data = this->_memory.read_bytes<std::uint8_t>(attrib.pointer);
+		this->record_with(Op::ClientAttrib, data, size, i, attrib.size, attrib.type, attrib.normalized, attrib.stride);
+	}
+}
+
+void GlTrace::start(const std::filesystem::path& path, std::uint32_t frames, std::uint32_t width, std::uint32_t height) {
+	this->_file = std::ofstream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!this->_file) {
+		spdlog::warn("failed to open gl trace at {}", path.string());
+		return;
+	}
+
+	this->_path = path;
+	this->_frames = 0;
+	this->_max_frames = frames;
+
+	Header header{MAGIC, VERSION, width, height, 0u, 0u};
+	this->write(&header, sizeof(header));
+
+	spdlog::info("gl trace: recording {} frames to {}", frames, path.string());
+}
+
+void GlTrace::bind_buffer(std::uint32_t target, std::uint32_t buffer) {
+	if (!this->active()) {
+		return;
+	}
+
+	switch (target) {
+		case GL_ARRAY_BUFFER:
+			this->_array_buffer = buffer;
+			break;
+		case GL_ELEMENT_ARRAY_BUFFER:
+			this->_element_array_buffer = buffer;
+			break;
+	}
+
+	this->record(Op::BindBuffer, target, buffer);
+}
+
+void GlTrace::buffer_data(std::uint32_t target, std::uint32_t size, const void* data, std::uint32_t usage) {
+	if (!this->active()) {
+		return;
+	}
+
+	if (target == GL_ELEMENT_ARRAY_BUFFER && this->_element_array_buffer != 0) {
+		auto& shadow = this->_index_buffers[this->_element_array_buffer];
+		shadow.assign(size, 0);
+
+		if (data != nullptr) {
+			std::memcpy(shadow.data(), data, size);
+		}
+	}
+
+	this->record_with(Op::BufferData, data, size, target, size, usage);
+}
+
+void GlTrace::buffer_sub_data(std::uint32_t target, std::uint32_t offset, std::uint32_t size, const void* data) {
+	if (!this->active()) {
+		return;
+	}
+
+	if (target == GL_ELEMENT_ARRAY_BUFFER && data != nullptr) {
+		auto it = this->_index_buffers.find(this->_element_array_buffer);
+		if (it != this->_index_buffers.end() && offset + size <= it->second.size()) {
+			std::memcpy(it->second.data() + offset, data, size);
+		}
+	}
+
+	this->record_with(Op::BufferSubData, data, size, target, offset, size);
+}
+
+void GlTrace::delete_buffers(std::uint32_t n, const std::uint32_t* buffers) {
+	if (!this->active() || buffers == nullptr) {
+		return;
+	}
+
+	for (auto buffer : std::span{buffers, n}) {
+		this->_index_buffers.erase(buffer);
+
+		if (this->_array_buffer == buffer) {
+			this->_array_buffer = 0;
+		}
+
+		if (this->_element_array_buffer == buffer) {
+			this->_element_array_buffer = 0;
+		}
+	}
+
+	this->record_with(Op::DeleteBuffers, buffers, n * sizeof(std::uint32_t), n);
+}
+
+void GlTrace::set_vertex_attrib_array(std::uint32_t index, bool enabled) {
+	if (!this->active()) {
+		return;
+	}
+
+	if (index < MAX_VERTEX_ATTRIBS) {
+		this->_attribs[index].enabled = enabled;
+	}
+
+	this->record(Op::VertexAttribArray, index, enabled);
+}
+
+void GlTrace::vertex_attrib_pointer(std::uint32_t index, std::int32_t size, std::uint32_t type, bool normalized, std::uint32_t stride, std::uint32_t pointer) {
+	if (!this->active()) {
+		return;
+	}
+
+	auto client = this->_array_buffer == 0;
+	if (index < MAX_VERTEX_ATTRIBS) {
+		this->_attribs[index] = {this->_attribs[index].enabled, size, type, normalized, stride, client ? pointer : 0u};
+	}
+
+	// client arrays have their data recorded at draw time instead
+	if (!client) {
+		this->record(Op::VertexAttribPointer, index, size, type, normalized, stride, pointer);
+	}
+}
+
+void GlTrace::tex_image_2d(std::uint32_t target, std::int32_t level, std::int32_t internalformat, std::uint32_t width, std::uint32_t height, std::int32_t border, std::uint32_t format, std::uint32_t type, const void* pixels, std::int32_t unpack_alignment) {
+	if (!this->active()) {
+		return;
+	}
+
+	auto size = 0u;
+	if (pixels != nullptr && width != 0 && height != 0) {
+		auto pixel_bytes = pixel_size(format, type);
+		auto alignment = static_cast<std::uint32_t>(std::max(unpack_alignment, 1));
+		auto stride = (width * pixel_bytes + alignment - 1) / alignment * alignment;
+		size = stride * (height - 1) + width * pixel_bytes;
+	}
+
+	this->record_with(Op::TexImage2D, pixels, size, target, level, internalformat, width, height, border, format, type);
+}
+
+void GlTrace::shader_source(std::uint32_t shader, const std::vector<std::string_view>& sources) {
+	if (!this->active()) {
+		return;
+	}
+
+	std::string source{};
+	for (auto str : sources) {
+		source.append(str);
+	}
+
+	this->record_with(Op::ShaderSource, source.data(), source.size(), shader);
+}
+
+void GlTrace::get_uniform_location(std::uint32_t program, const char* name, std::int32_t location) {
+	if (!this->active() || name == nullptr) {
+		return;
+	}
+
+	this->record_with(Op::GetUniformLocation, name, std::strlen(name), program, location);
+}
+
+void GlTrace::draw_arrays(std::uint32_t mode, std::int32_t first, std::uint32_t count) {
+	if (!this->active()) {
+		return;
+	}
+
+	if (count != 0 && first >= 0 && this->has_client_attribs()) {
+		this->record_client_attribs(first + count - 1);
+	}
+
+	this->record(Op::DrawArrays, mode, first, count);
+}
+
+void GlTrace::draw_elements(std::uint32_t mode, std::uint32_t count, std::uint32_t type, std::uint32_t indices_ptr) {
+	if (!this->active()) {
+		return;
+	}
+
+	auto indices_size = count * type_size(type);
+
+	const std::uint8_t* indices = nullptr;
+	if (this->_element_array_buffer != 0) {
+		auto it = this->_index_buffers.find(this->_element_array_buffer);
+		if (it != this->_index_buffers.end() && indices_ptr + indices_size <= it->second.size()) {
+			indices = it->second.data() + indices_ptr;
+		}
+	} else if (indices_ptr != 0) {
+		indices = this->_memory.read_bytes<std::uint8_t>(indices_ptr);
+	}
+
+	if (count != 0 && this->has_client_attribs()) {
+		if (indices != nullptr) {
+			switch (type) {
+				case GL_UNSIGNED_BYTE:
+					this->record_client_attribs(max_index<std::uint8_t>(indices, count));
+					break;
+				case GL_UNSIGNED_SHORT:
+					this->record_client_attribs(max_index<std::uint16_t>(indices, count));
+					break;
+				default:
+					this->record_client_attribs(max_index<std::uint32_t>(indices, count));
+					break;
+			}
+		} else {
+			spdlog::warn("gl trace: draw reads client arrays through indices that weren't recorded, it will replay wrong");
+		}
+	}
+
+	if (this->_element_array_buffer != 0) {
+		this->record(Op::DrawElements, mode, count, type, indices_ptr);
+	} else {
+		this->record_with(Op::DrawElements, indices, indices != nullptr ? indices_size : 0u, mode, count, type, 0u);
+	}
+}
+
+void GlTrace::begin_frame() {
+	this->record(Op::Frame);
+}
+
+void GlTrace::end_frame() {
+	if (!this->active()) {
+		return;
+	}
+
+	this->_frames++;
+	if (this->_frames >= this->_max_frames) {
+		this->close();
+	}
+}
+
+GlTrace::~GlTrace() {
+	if (this->active()) {
+		this->close();
+	}
+}
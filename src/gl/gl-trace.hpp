@@ -0,0 +1,238 @@
+#pragma once
+
+#ifndef _GL_TRACE_HPP
+#define _GL_TRACE_HPP
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+class PagedMemory;
+
+/**
+ * writes every gl call the guest makes to a file, so it can be replayed later without the emulator (see GlReplay).
+ *
+ * calls are recorded as the guest made them, before the wrappers drop, batch or convert anything,
+ * along with whatever guest memory they read. client arrays are copied out at draw time for the vertices the draw uses.
+ * names handed out by the driver are recorded too, so a replay can map them onto its own.
+ * queries don't change anything and aren't recorded.
+ *
+ * every record is a one byte op, then a byte with the number of argument words (the top bit is set if a payload follows),
+ * then the words, then the payload's size and its bytes
+ */
+class GlTrace {
+public:
+	enum class Op : std::uint8_t {
+		// everything before the first frame marker is setup
+		Frame,
+		End,
+
+		PixelStore,
+		CreateShader,
+		ShaderSource,
+		CompileShader,
+		DeleteShader,
+		CreateProgram,
+		AttachShader,
+		BindAttribLocation,
+		LinkProgram,
+		GetUniformLocation,
+		UseProgram,
+		Capability,
+		BlendFunc,
+		DepthFunc,
+		ClearColor,
+		ClearDepth,
+		LineWidth,
+		Viewport,
+		Scissor,
+		Uniform1i,
+		Uniformf,
+		Uniform4fv,
+		UniformMatrix4fv,
+		GenBuffers,
+		DeleteBuffers,
+		BindBuffer,
+		BufferData,
+		BufferSubData,
+		GenTextures,
+		DeleteTextures,
+		ActiveTexture,
+		BindTexture,
+		TexParameteri,
+		TexImage2D,
+		GenFramebuffers,
+		BindFramebuffer,
+		FramebufferTexture2D,
+		GenRenderbuffers,
+		BindRenderbuffer,
+		FramebufferRenderbuffer,
+		VertexAttribArray,
+		VertexAttribPointer,
+
+		// the data of a client array, written right before the draw that reads it
+		ClientAttrib,
+		Clear,
+		DrawArrays,
+		DrawElements,
+
+		// added after the first version, so older traces still line up
+		DetachShader,
+		DeleteProgram,
+	};
+
+	static constexpr std::uint32_t MAGIC = 0x54474c53; // SLGT
+	static constexpr std::uint32_t VERSION = 1;
+
+	static constexpr std::uint8_t PAYLOAD_FLAG = 0x80;
+
+	struct Header {
+		std::uint32_t magic;
+		std::uint32_t version;
+
+		// size of the guest's screen, which is what framebuffer 0 has to be
+		std::uint32_t width;
+		std::uint32_t height;
+
+		std::uint32_t frames;
+		std::uint32_t reserved;
+	};
+
+	static_assert(sizeof(Header) == 24);
+
+	static constexpr std::uint32_t MAX_VERTEX_ATTRIBS = 16;
+
+	// records are kept in memory until there's this much of them
+	static constexpr std::size_t WRITE_THRESHOLD = 4 * 1024 * 1024;
+
+private:
+	struct ClientAttrib {
+		bool enabled{false};
+
+		std::int32_t size{0};
+		std::uint32_t type{0u};
+		bool normalized{false};
+		std::uint32_t stride{0u};
+
+		// guest address, 0 if the attrib is sourced from a buffer
+		std::uint32_t pointer{0u};
+	};
+
+	PagedMemory& _memory;
+
+	std::ofstream _file{};
+	std::filesystem::path _path{};
+	std::vector<std::uint8_t> _buffer{};
+
+	std::uint32_t _frames{0u};
+	std::uint32_t _max_frames{0u};
+
+	std::uint32_t _array_buffer{0u};
+	std::uint32_t _element_array_buffer{0u};
+	std::array<ClientAttrib, MAX_VERTEX_ATTRIBS> _attribs{};
+
+	// indices have to be read to know which vertices a draw uses, but the driver's copy can't be read back
+	std::unordered_map<std::uint32_t, std::vector<std::uint8_t>> _index_buffers{};
+
+	template <typename T>
+	static std::uint32_t to_word(T value) {
+		if constexpr (std::is_floating_point_v<T>) {
+			return std::bit_cast<std::uint32_t>(static_cast<float>(value));
+		} else {
+			return static_cast<std::uint32_t>(value);
+		}
+	}
+
+	void write(const void* data, std::size_t size);
+	void write_record(Op op, const std::uint32_t* words, std::uint8_t count, const void* payload, std::uint32_t size, bool has_payload);
+
+	/**
+	 * writes out whatever has been buffered
+	 */
+	void write_buffer();
+
+	void close();
+
+	bool has_client_attribs() const;
+
+	/**
+	 * records the data of every enabled client array, for vertices up to and including the last one
+	 */
+	void record_client_attribs(std::uint32_t last_vertex);
+
+public:
+	/**
+	 * starts writing to the given file, for the given number of frames
+	 */
+	void start(const std::filesystem::path& path, std::uint32_t frames, std::uint32_t width, std::uint32_t height);
+
+	bool active() const {
+		return this->_file.is_open();
+	}
+
+	template <typename... Args>
+	void record(Op op, Args... args) {
+		if (!this->active()) {
+			return;
+		}
+
+		std::array<std::uint32_t, sizeof...(Args)> words{to_word(args)...};
+		this->write_record(op, words.data(), static_cast<std::uint8_t>(words.size()), nullptr, 0, false);
+	}
+
+	/**
+	 * records a call that points at memory, which is copied into the trace. a null payload is kept as null
+	 */
+	template <typename... Args>
+	void record_with(Op op, const void* payload, std::uint32_t size, Args... args) {
+		if (!this->active()) {
+			return;
+		}
+
+		std::array<std::uint32_t, sizeof...(Args)> words{to_word(args)...};
+		this->write_record(op, words.data(), static_cast<std::uint8_t>(words.size()), payload, size, payload != nullptr);
+	}
+
+	// these track the bits of state needed to know how much memory a call reads
+
+	void bind_buffer(std::uint32_t target, std::uint32_t buffer);
+	void buffer_data(std::uint32_t target, std::uint32_t size, const void* data, std::uint32_t usage);
+	void buffer_sub_data(std::uint32_t target, std::uint32_t offset, std::uint32_t size, const void* data);
+	void delete_buffers(std::uint32_t n, const std::uint32_t* buffers);
+
+	void set_vertex_attrib_array(std::uint32_t index, bool enabled);
+	void vertex_attrib_pointer(std::uint32_t index, std::int32_t size, std::uint32_t type, bool normalized, std::uint32_t stride, std::uint32_t pointer);
+
+	void tex_image_2d(std::uint32_t target, std::int32_t level, std::int32_t internalformat, std::uint32_t width, std::uint32_t height, std::int32_t border, std::uint32_t format, std::uint32_t type, const void* pixels, std::int32_t unpack_alignment);
+
+	/**
+	 * the sources are concatenated, like the gl would
+	 */
+	void shader_source(std::uint32_t shader, const std::vector<std::string_view>& sources);
+
+	void get_uniform_location(std::uint32_t program, const char* name, std::int32_t location);
+
+	void draw_arrays(std::uint32_t mode, std::int32_t first, std::uint32_t count);
+	void draw_elements(std::uint32_t mode, std::uint32_t count, std::uint32_t type, std::uint32_t indices_ptr);
+
+	void begin_frame();
+
+	/**
+	 * stops once enough frames have been written
+	 */
+	void end_frame();
+
+	GlTrace(PagedMemory& memory) : _memory{memory} {}
+	~GlTrace();
+
+	GlTrace(const GlTrace&) = delete;
+	GlTrace& operator=(const GlTrace&) = delete;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #define _GL_WRAP_H
 
 #include "../environment.h"
+#include "../syscall-translator.hpp"
 
 #ifdef SILENE_USE_EGL
 #include <GLES2/gl2.h>
@@ -12,7 +13,45 @@
 #include <glad/glad.h>
 #endif
 
+/**
+ * logs a call along with the error it caused. the error is only asked for if the message is actually printed,
+ * as it's a round trip to the driver. recorded commands are submitted first so the error belongs to this call
+ */
+#define TRACE_GL(env, fmt, ...) \
+	do { \
+		if (spdlog::should_log(spdlog::level::trace)) { \
+			(env).gl_commands().flush(); \
+			spdlog::trace(fmt, __VA_ARGS__ __VA_OPT__(,) glGetError()); \
+		} \
+	} while (0)
+
+/**
+ * anything that isn't batched has to replay the guest's ring first, so the wrappers still see every call in order
+ */
+template <const auto F>
+void flush_gl_batch(Environment& env) {
+	env.gl_batch().flush(env);
+	F(env);
+}
+
+#define REGISTER_GL_FN(ENV, NAME, SYMBOL) \
+	ENV.program_loader().add_stub_symbol( \
+		ENV.syscall_handler().create_stub_fn(&flush_gl_batch<&SyscallTranslator::translate_wrap<&NAME>>), \
+		SYMBOL \
+	)
+
+/**
+ * only for calls that return nothing, take at most four words, and don't read guest memory when called
+ */
+#define REGISTER_GL_BATCHED(ENV, NAME, SYMBOL) \
+	ENV.program_loader().add_stub_symbol( \
+		ENV.gl_batch().add_entry(&SyscallTranslator::translate_wrap<&NAME>), \
+		SYMBOL \
+	)
+
 std::uint32_t emu_glGetString(Environment& env, std::uint32_t name) {
+	env.gl_commands().flush();
+
 	auto r = reinterpret_cast<const char*>(glGetString(name));
 	if (r == 0) {
 		return 0;
@@ -25,7 +64,7 @@ std::uint32_t emu_glGetString(Environment& env, std::uint32_t name) {
 	auto str = env.memory_manager().read_bytes<char>(r_ptr);
 	std::memcpy(str, r, r_len + 1);
 
-	spdlog::trace("glGetString(name: {}) -> {}", name, glGetError());
+	TRACE_GL(env, "glGetString(name: {}) -> {}", name);
 
 	return r_ptr;
 }
@@ -36,8 +75,18 @@ void emu_glGetIntegerv(Environment& env, std::uint32_t name, std::uint32_t data_
 		data = env.memory_manager().read_bytes<int>(data_ptr);
 	}
 
+	if (env.gl().get_integer(name, data)) {
+		return;
+	}
+
+	env.gl_commands().flush();
 	glGetIntegerv(name, data);
-	spdlog::trace("glGetIntegerv(name: {}, data: {:#x}) -> {}", name, data_ptr, glGetError());
+
+	if (name == GL_FRAMEBUFFER_BINDING && data != nullptr) {
+		*data = env.frame_chain().guest_framebuffer(*data);
+	}
+
+	TRACE_GL(env, "glGetIntegerv(name: {}, data: {:#x}) -> {}", name, data_ptr);
 }
 
 void emu_glGetFloatv(Environment& env, std::uint32_t name, std::uint32_t data_ptr) {
@@ -46,20 +95,30 @@ void emu_glGetFloatv(Environment& env, std::uint32_t name, std::uint32_t data_pt
 		data = env.memory_manager().read_bytes<float>(data_ptr);
 	}
 
+	env.gl_commands().flush();
 	glGetFloatv(name, data);
-	spdlog::trace("glGetFloatv(name: {}, data: {:#x}) -> {}", name, data_ptr, glGetError());
+	TRACE_GL(env, "glGetFloatv(name: {}, data: {:#x}) -> {}", name, data_ptr);
 }
 
 void emu_glPixelStorei(Environment& env, std::uint32_t name, std::int32_t param) {
-	glPixelStorei(name, param);
+	env.gl_trace().record(GlTrace::Op::PixelStore, name, param);
+
+	if (!env.gl().pixel_store(name, param)) {
+		return;
+	}
 
-	spdlog::trace("glPixelStorei(name: {}, param: {}) -> {}", name, param, glGetError());
+	env.gl_commands().pixel_store(name, param);
+
+	TRACE_GL(env, "glPixelStorei(name: {}, param: {}) -> {}", name, param);
 }
 
 std::uint32_t emu_glCreateShader(Environment& env, std::uint32_t type) {
+	env.gl_commands().flush();
+
 	auto r = glCreateShader(type);
+	env.gl_trace().record(GlTrace::Op::CreateShader, type, r);
 
-	spdlog::trace("glCreateShader(type: {}) => {} -> {}", type, r, glGetError());
+	TRACE_GL(env, "glCreateShader(type: {}) => {} -> {}", type, r);
 
 	return r;
 }
@@ -75,25 +134,27 @@ void emu_glShaderSource(Environment& env, std::uint32_t shader, std::uint32_t co
 		len = env.memory_manager().read_bytes<int>(len_ptr);
 	}
 
-	std::vector<char*> str_ptr_tr{};
-	str_ptr_tr.reserve(count);
+	std::vector<std::string_view> sources{};
+	sources.reserve(count);
 
 	for (auto i = 0u; i < count; i++) {
 		auto ptr = env.memory_manager().read_bytes<char>(str_ptr[i]);
 
-#ifndef SILENE_USE_EGL
-		// desktop opengl doesn't support precision
-		if (std::strcmp("precision highp float;\n", ptr) == 0 || std::strcmp("precision mediump float;\n", ptr) == 0) {
-			continue;
+		// negative lengths mean the string is null terminated
+		if (len != nullptr && len[i] >= 0) {
+			sources.emplace_back(ptr, len[i]);
+		} else {
+			sources.emplace_back(ptr);
 		}
-#endif
-
-		str_ptr_tr.push_back(ptr);
 	}
 
-	glShaderSource(shader, str_ptr_tr.size(), str_ptr_tr.data(), len);
+	env.gl_trace().shader_source(shader, sources);
+
+	// translation for the host happens in the cache
+	env.gl_commands().flush();
+	env.shader_cache().shader_source(shader, sources);
 
-	spdlog::trace("glShaderSource(shader: {}, count: {}, strs: {:#x}, len: {:#x}) -> {}", shader, count, str_ptrs, len_ptr, glGetError());
+	TRACE_GL(env, "glShaderSource(shader: {}, count: {}, strs: {:#x}, len: {:#x}) -> {}", shader, count, str_ptrs, len_ptr);
 }
 
 void emu_glGetShaderSource(Environment& env, std::uint32_t shader, std::uint32_t buf_size, std::uint32_t length_ptr, std::uint32_t source_ptr) {
@@ -104,15 +165,22 @@ void emu_glGetShaderSource(Environment& env, std::uint32_t shader, std::uint32_t
 		length = env.memory_manager().read_bytes<std::int32_t>(length_ptr);
 	}
 
+	env.gl_commands().flush();
 	glGetShaderSource(shader, buf_size, length, source);
 
-	spdlog::trace("glGetShaderSource(shader: {}, buf_size: {}, length: {:#x}, source: {:#x}) -> {}", shader, buf_size, length_ptr, source_ptr, glGetError());
+	TRACE_GL(env, "glGetShaderSource(shader: {}, buf_size: {}, length: {:#x}, source: {:#x}) -> {}", shader, buf_size, length_ptr, source_ptr);
 }
 
 void emu_glCompileShader(Environment& env, std::uint32_t shader) {
-	glCompileShader(shader);
+	env.gl_trace().record(GlTrace::Op::CompileShader, shader);
 
-	spdlog::trace("glCompileShader(shader: {}) -> {}", shader, glGetError());
+	{
+		auto timer = env.gl_stats().time_driver();
+		env.gl_commands().flush();
+		env.shader_cache().compile_shader(shader);
+	}
+
+	TRACE_GL(env, "glCompileShader(shader: {}) -> {}", shader);
 }
 
 void emu_glGetShaderiv(Environment& env, std::uint32_t shader, std::uint32_t name, std::uint32_t data_ptr) {
@@ -121,9 +189,14 @@ void emu_glGetShaderiv(Environment& env, std::uint32_t shader, std::uint32_t nam
 		data = env.memory_manager().read_bytes<int>(data_ptr);
 	}
 
+	if (env.shader_cache().get_shader_iv(shader, name, data)) {
+		return;
+	}
+
+	env.gl_commands().flush();
 	glGetShaderiv(shader, name, data);
 
-	spdlog::trace("glGetShaderiv(shader: {}, name: {}, data: {:#x} => {}) -> {}", shader, name, data_ptr, *data, glGetError());
+	TRACE_GL(env, "glGetShaderiv(shader: {}, name: {}, data: {:#x} => {}) -> {}", shader, name, data_ptr, *data);
 }
 
 void emu_glGetShaderInfoLog(Environment& env, std::uint32_t shader, std::uint32_t max_length, std::uint32_t length_ptr, std::uint32_t info_log_ptr) {
@@ -134,21 +207,42 @@ void emu_glGetShaderInfoLog(Environment& env, std::uint32_t shader, std::uint32_
 
 	auto info_log = env.memory_manager().read_bytes<char>(info_log_ptr);
 
+	env.gl_commands().flush();
 	glGetShaderInfoLog(shader, max_length, length, info_log);
 
-	spdlog::trace("glGetShaderInfoLog(shader: {}, max_length: {}, length_ptr: {:#x}, info_log_ptr: {:#x} => {}) -> {}", shader, max_length, length_ptr, info_log_ptr, *info_log, glGetError());
+	TRACE_GL(env, "glGetShaderInfoLog(shader: {}, max_length: {}, length_ptr: {:#x}, info_log_ptr: {:#x} => {}) -> {}", shader, max_length, length_ptr, info_log_ptr, *info_log);
 }
 
 std::uint32_t emu_glCreateProgram(Environment& env) {
-	return glCreateProgram();
+	env.gl_commands().flush();
 
-	spdlog::trace("glCreateProgram() -> {}", glGetError());
+	auto r = glCreateProgram();
+	env.gl_trace().record(GlTrace::Op::CreateProgram, r);
+	env.shader_cache().create_program(r);
+
+	return r;
+
+	TRACE_GL(env, "glCreateProgram() -> {}");
 }
 
 void emu_glAttachShader(Environment& env, std::uint32_t program, std::uint32_t shader) {
+	env.gl_trace().record(GlTrace::Op::AttachShader, program, shader);
+
+	env.gl_commands().flush();
+	env.shader_cache().attach_shader(program, shader);
 	glAttachShader(program, shader);
 
-	spdlog::trace("glAttachShader(program: {}, shader: {}) -> {}", program, shader, glGetError());
+	TRACE_GL(env, "glAttachShader(program: {}, shader: {}) -> {}", program, shader);
+}
+
+void emu_glDetachShader(Environment& env, std::uint32_t program, std::uint32_t shader) {
+	env.gl_trace().record(GlTrace::Op::DetachShader, program, shader);
+
+	env.gl_commands().flush();
+	env.shader_cache().detach_shader(program, shader);
+	glDetachShader(program, shader);
+
+	TRACE_GL(env, "glDetachShader(program: {}, shader: {}) -> {}", program, shader);
 }
 
 void emu_glBindAttribLocation(Environment& env, std::uint32_t program, std::uint32_t index, std::uint32_t name_ptr) {
@@ -157,98 +251,197 @@ void emu_glBindAttribLocation(Environment& env, std::uint32_t program, std::uint
 		name = env.memory_manager().read_bytes<char>(name_ptr);
 	}
 
+	if (name != nullptr) {
+		env.gl_trace().record_with(GlTrace::Op::BindAttribLocation, name, std::strlen(name), program, index);
+	}
+
+	env.gl_commands().flush();
+	env.shader_cache().bind_attrib_location(program, index, name);
 	glBindAttribLocation(program, index, name);
 
-	spdlog::trace("glBindAttribLocation(program: {}, index: {}, name: {}) -> {}", program, index, name, glGetError());
+	TRACE_GL(env, "glBindAttribLocation(program: {}, index: {}, name: {}) -> {}", program, index, name);
 }
 
 void emu_glLinkProgram(Environment& env, std::uint32_t program) {
-	glLinkProgram(program);
+	env.gl_trace().record(GlTrace::Op::LinkProgram, program);
+
+	{
+		auto timer = env.gl_stats().time_driver();
+		env.gl_commands().flush();
+		env.shader_cache().link_program(program);
+	}
 
-	spdlog::trace("glLinkProgram(program: {}) -> {}", program, glGetError());
+	TRACE_GL(env, "glLinkProgram(program: {}) -> {}", program);
 }
 
 void emu_glDeleteShader(Environment& env, std::uint32_t shader) {
+	env.gl_trace().record(GlTrace::Op::DeleteShader, shader);
+
+	env.gl_commands().flush();
+	env.shader_cache().delete_shader(shader);
 	glDeleteShader(shader);
 
-	spdlog::trace("glDeleteShader(shader: {}) -> {}", shader, glGetError());
+	TRACE_GL(env, "glDeleteShader(shader: {}) -> {}", shader);
+}
+
+void emu_glDeleteProgram(Environment& env, std::uint32_t program) {
+	env.gl_trace().record(GlTrace::Op::DeleteProgram, program);
+
+	env.gl_commands().flush();
+	env.shader_cache().delete_program(program);
+	glDeleteProgram(program);
+
+	TRACE_GL(env, "glDeleteProgram(program: {}) -> {}", program);
 }
 
 void emu_glDeleteBuffers(Environment& env, std::uint32_t n, std::uint32_t buffers_ptr) {
 	auto buffers = env.memory_manager().read_bytes<std::uint32_t>(buffers_ptr);
-	glDeleteBuffers(n, buffers);
+	env.gl_trace().delete_buffers(n, buffers);
+	env.gl().delete_buffers(n, buffers);
+	env.gl_streamer().delete_buffers(n, buffers);
 
-	spdlog::trace("glDeleteBuffers(n: {}, buffers: {:#x}) -> {}", n, buffers_ptr, glGetError());
+	env.gl_commands().delete_buffers(n, buffers);
+
+	TRACE_GL(env, "glDeleteBuffers(n: {}, buffers: {:#x}) -> {}", n, buffers_ptr);
 }
 
 std::int32_t emu_glGetUniformLocation(Environment& env, std::uint32_t program, std::uint32_t name_ptr) {
 	auto name = env.memory_manager().read_bytes<char>(name_ptr);
-	return glGetUniformLocation(program, name);
 
-	spdlog::trace("glGetUniformLocation(program: {}, name: {}) -> {}", program, name, glGetError());
+	env.gl_commands().flush();
+
+	auto r = glGetUniformLocation(program, name);
+	env.gl_trace().get_uniform_location(program, name, r);
+
+	return r;
+
+	TRACE_GL(env, "glGetUniformLocation(program: {}, name: {}) -> {}", program, name);
 }
 
 void emu_glEnable(Environment& env, std::uint32_t cap) {
-	glEnable(cap);
+	env.gl_trace().record(GlTrace::Op::Capability, cap, true);
+
+	if (!env.gl().set_capability(cap, true)) {
+		return;
+	}
+
+	env.gl_commands().set_capability(cap, true);
 }
 
 void emu_glDisable(Environment& env, std::uint32_t cap) {
-	glDisable(cap);
+	env.gl_trace().record(GlTrace::Op::Capability, cap, false);
+
+	if (!env.gl().set_capability(cap, false)) {
+		return;
+	}
+
+	env.gl_commands().set_capability(cap, false);
 }
 
 void emu_glScissor(Environment& env, std::int32_t x, std::int32_t y, std::uint32_t width, std::uint32_t height) {
-	glScissor(x, y, width, height);
+	env.gl_trace().record(GlTrace::Op::Scissor, x, y, width, height);
+
+	if (!env.gl().scissor(x, y, width, height)) {
+		return;
+	}
+
+	env.gl_commands().scissor(x, y, width, height);
 }
 
 void emu_glUniform1i(Environment& env, std::int32_t location, std::int32_t v0) {
-	glUniform1i(location, v0);
+	env.gl_trace().record(GlTrace::Op::Uniform1i, location, v0);
+	env.gl_commands().uniform_1i(location, v0);
 }
 
 void emu_glUniform4fv(Environment& env, std::int32_t location, std::uint32_t count, std::uint32_t value_ptr) {
 	auto value = env.memory_manager().read_bytes<float>(value_ptr);
-	glUniform4fv(location, count, value);
+	env.gl_trace().record_with(GlTrace::Op::Uniform4fv, value, count * 4 * sizeof(float), location, count);
+
+	env.gl_commands().uniform_4fv(location, count, value);
 }
 
 void emu_glUniformMatrix4fv(Environment& env, std::int32_t location, std::uint32_t count, bool transpose, std::uint32_t value_ptr) {
 	auto value = env.memory_manager().read_bytes<float>(value_ptr);
-	glUniformMatrix4fv(location, count, transpose, value);
+	env.gl_trace().record_with(GlTrace::Op::UniformMatrix4fv, value, count * 16 * sizeof(float), location, count, transpose);
+
+	env.gl_commands().uniform_matrix_4fv(location, count, transpose, value);
 }
 
 void emu_glUseProgram(Environment& env, std::uint32_t program) {
-	glUseProgram(program);
+	env.gl_trace().record(GlTrace::Op::UseProgram, program);
+
+	if (!env.gl().use_program(program)) {
+		return;
+	}
+
+	env.gl_stats().count_program_switch();
+	env.gl_commands().use_program(program);
 }
 
 void emu_glBindBuffer(Environment& env, std::uint32_t target, std::uint32_t buffer) {
-	glBindBuffer(target, buffer);
+	env.gl_trace().bind_buffer(target, buffer);
+
+	if (!env.gl().bind_buffer(target, buffer)) {
+		return;
+	}
 
-	spdlog::trace("glBindBuffer(target: {}, buffer: {}) -> {}", target, buffer, glGetError());
+	env.gl_commands().bind_buffer(target, buffer);
+
+	TRACE_GL(env, "glBindBuffer(target: {}, buffer: {}) -> {}", target, buffer);
 }
 
 void emu_glBufferData(Environment& env, std::uint32_t target, std::uint32_t size, std::uint32_t data_ptr, std::uint32_t usage) {
+	if (data_ptr != 0) {
+		env.gl_stats().count_buffer_upload(size);
+	}
+
+	if (env.gl_trace().active()) {
+		env.gl_trace().buffer_data(target, size, data_ptr != 0 ? env.memory_manager().read_bytes<void>(data_ptr) : nullptr, usage);
+	}
+
+	if (env.gl_streamer().buffer_data(env, target, size, data_ptr, usage)) {
+		return;
+	}
+
 	void* data = nullptr;
 	if (data_ptr != 0) {
 		data = env.memory_manager().read_bytes<void>(data_ptr);
 	}
 
-	glBufferData(target, size, data, usage);
+	env.gl_commands().buffer_data(target, size, data, usage);
 
-	spdlog::trace("glBufferData(target: {}, size: {}, data: {:#x}, usage: {}) -> {}", target, size, data_ptr, usage, glGetError());
+	TRACE_GL(env, "glBufferData(target: {}, size: {}, data: {:#x}, usage: {}) -> {}", target, size, data_ptr, usage);
 }
 
 void emu_glTexParameteri(Environment& env, std::uint32_t target, std::uint32_t pname, std::int32_t param) {
-	glTexParameteri(target, pname, param);
+	env.gl_trace().record(GlTrace::Op::TexParameteri, target, pname, param);
+	env.gl_commands().tex_parameteri(target, pname, param);
 }
 
 void emu_glBindTexture(Environment& env, std::uint32_t target, std::uint32_t texture) {
-	glBindTexture(target, texture);
+	env.gl_trace().record(GlTrace::Op::BindTexture, target, texture);
+	env.texture_uploader().bind_texture(target, texture);
+
+	if (!env.gl().bind_texture(target, texture)) {
+		return;
+	}
 
-	spdlog::trace("glBindTexture(target: {}, texture: {}) -> {}", target, texture, glGetError());
+	env.gl_commands().bind_texture(target, texture);
+
+	TRACE_GL(env, "glBindTexture(target: {}, texture: {}) -> {}", target, texture);
 }
 
 void emu_glActiveTexture(Environment& env, std::uint32_t texture) {
-	glActiveTexture(texture);
+	env.gl_trace().record(GlTrace::Op::ActiveTexture, texture);
+	env.texture_uploader().active_texture(texture);
+
+	if (!env.gl().active_texture(texture)) {
+		return;
+	}
+
+	env.gl_commands().active_texture(texture);
 
-	spdlog::trace("glActiveTexture(texture: {}) -> {}", texture, glGetError());
+	TRACE_GL(env, "glActiveTexture(texture: {}) -> {}", texture);
 }
 
 void emu_glGenTextures(Environment& env, std::uint32_t n, std::uint32_t textures_ptr) {
@@ -257,18 +450,26 @@ void emu_glGenTextures(Environment& env, std::uint32_t n, std::uint32_t textures
 		textures = env.memory_manager().read_bytes<std::uint32_t>(textures_ptr);
 	}
 
+	// a pending delete could otherwise free a name that's about to be handed out again
+	env.gl_commands().flush();
 	glGenTextures(n, textures);
+	env.gl_trace().record_with(GlTrace::Op::GenTextures, textures, n * sizeof(std::uint32_t), n);
 
-	spdlog::trace("glGenTextures(n: {}, textures: {:#x}) -> {}", n, textures_ptr, glGetError());
+	TRACE_GL(env, "glGenTextures(n: {}, textures: {:#x}) -> {}", n, textures_ptr);
 }
 
 void emu_glDeleteTextures(Environment& env, std::uint32_t n, std::uint32_t textures_ptr) {
 	std::uint32_t* textures = nullptr;
 	if (textures_ptr != 0) {
 		textures = env.memory_manager().read_bytes<std::uint32_t>(textures_ptr);
+		env.gl_trace().record_with(GlTrace::Op::DeleteTextures, textures, n * sizeof(std::uint32_t), n);
+		env.gl().delete_textures(n, textures);
+		env.texture_uploader().delete_textures(n, textures);
 	}
 
-	glDeleteTextures(n, textures);
+	if (textures != nullptr) {
+		env.gl_commands().delete_textures(n, textures);
+	}
 }
 
 void emu_glGenBuffers(Environment& env, std::uint32_t n, std::uint32_t buffers_ptr) {
@@ -277,135 +478,274 @@ void emu_glGenBuffers(Environment& env, std::uint32_t n, std::uint32_t buffers_p
 		buffers = env.memory_manager().read_bytes<std::uint32_t>(buffers_ptr);
 	}
 
+	env.gl_commands().flush();
 	glGenBuffers(n, buffers);
+	env.gl_trace().record_with(GlTrace::Op::GenBuffers, buffers, n * sizeof(std::uint32_t), n);
 
-	spdlog::trace("glGenBuffers(n: {}, buffers: {:#x}) -> {}", n, buffers_ptr, glGetError());
+	TRACE_GL(env, "glGenBuffers(n: {}, buffers: {:#x}) -> {}", n, buffers_ptr);
 }
 
 void emu_glBlendFunc(Environment& env, std::uint32_t sfactor, std::uint32_t dfactor) {
-	glBlendFunc(sfactor, dfactor);
+	env.gl_trace().record(GlTrace::Op::BlendFunc, sfactor, dfactor);
+
+	if (!env.gl().blend_func(sfactor, dfactor)) {
+		return;
+	}
+
+	env.gl_commands().blend_func(sfactor, dfactor);
 }
 
 void emu_glClearDepthf(Environment& env, float depth) {
-	// this function is unavailable on desktop opengl
-#ifdef SILENE_USE_EGL
-	glClearDepthf(depth);
-#else
-	glClearDepth(depth);
-#endif
+	env.gl_trace().record(GlTrace::Op::ClearDepth, depth);
+
+	if (!env.gl().clear_depth(depth)) {
+		return;
+	}
+
+	env.gl_commands().clear_depth(depth);
 }
 
 void emu_glDepthFunc(Environment& env, std::uint32_t func) {
-	glDepthFunc(func);
+	env.gl_trace().record(GlTrace::Op::DepthFunc, func);
+
+	if (!env.gl().depth_func(func)) {
+		return;
+	}
+
+	env.gl_commands().depth_func(func);
 }
 
 void emu_glClearColor(Environment& env, float red, float green, float blue, float alpha) {
-	glClearColor(red, green, blue, alpha);
+	env.gl_trace().record(GlTrace::Op::ClearColor, red, green, blue, alpha);
+
+	if (!env.gl().clear_color(red, green, blue, alpha)) {
+		return;
+	}
+
+	env.gl_commands().clear_color(red, green, blue, alpha);
 }
 
 void emu_glViewport(Environment& env, std::int32_t x, std::int32_t y, std::uint32_t width, std::uint32_t height) {
-	glViewport(x, y, width, height);
+	env.gl_trace().record(GlTrace::Op::Viewport, x, y, width, height);
+
+	if (!env.gl().viewport(x, y, width, height)) {
+		return;
+	}
 
-	spdlog::trace("glViewport(x: {}, y: {}, width: {}, height: {}) -> {}", x, y, width, height, glGetError());
+	env.gl_commands().viewport(x, y, width, height);
+
+	TRACE_GL(env, "glViewport(x: {}, y: {}, width: {}, height: {}) -> {}", x, y, width, height);
 }
 
 void emu_glTexImage2D(Environment& env, std::uint32_t target, std::int32_t level, std::int32_t internalformat, std::uint32_t width, std::uint32_t height, std::int32_t border, std::uint32_t format, std::uint32_t type, std::uint32_t data_ptr) {
+	if (data_ptr != 0) {
+		env.gl_stats().count_texture_upload(width, height, format, type);
+	}
+
+	if (env.gl_trace().active()) {
+		auto pixels = data_ptr != 0 ? env.memory_manager().read_bytes<void>(data_ptr) : nullptr;
+		env.gl_trace().tex_image_2d(target, level, internalformat, width, height, border, format, type, pixels, env.gl().unpack_alignment());
+	}
+
+	auto timer = env.gl_stats().time_driver();
+	if (env.texture_uploader().tex_image_2d(env, target, level, width, height, border, format, type, data_ptr)) {
+		spdlog::trace("glTexImage2D(target: {}, level: {}, internalformat: {}, width: {}, height: {}, border: {}, format: {}, type: {}, data: {:#x}) -> converted", target, level, internalformat, width, height, border, format, type, data_ptr);
+		return;
+	}
+
 	// is this a 2d array?
 	void* data = nullptr;
 	if (data_ptr != 0) {
 		data = env.memory_manager().read_bytes<void>(data_ptr);
 	}
 
-	glTexImage2D(target, level, internalformat, width, height, border, format, type, data);
+	if (!env.gl_commands().tex_image_2d(target, level, internalformat, width, height, border, format, type, data, env.gl().unpack_alignment())) {
+		env.gl_commands().flush();
+		glTexImage2D(target, level, internalformat, width, height, border, format, type, data);
+	}
 
-	spdlog::trace("glTexImage2D(target: {}, level: {}, internalformat: {}, width: {}, height: {}, border: {}, format: {}, type: {}, data: {:#x}) -> {}", target, level, internalformat, width, height, border, format, type, data_ptr, glGetError());
+	TRACE_GL(env, "glTexImage2D(target: {}, level: {}, internalformat: {}, width: {}, height: {}, border: {}, format: {}, type: {}, data: {:#x}) -> {}", target, level, internalformat, width, height, border, format, type, data_ptr);
 }
 
 void emu_glDrawArrays(Environment& env, std::uint32_t mode, std::int32_t first, std::uint32_t count) {
-	glDrawArrays(mode, first, count);
+	env.gl_trace().draw_arrays(mode, first, count);
+	env.gl_stats().count_draw();
+	auto timer = env.gl_stats().time_driver();
 
-	spdlog::trace("glDrawArrays({}, {}, {}) -> {}", mode, first, count, glGetError());
+	env.texture_uploader().before_draw(env);
+
+	if (!env.gl_streamer().draw_arrays(env, mode, first, count)) {
+		env.gl_commands().draw_arrays(mode, first, count);
+	}
+
+	TRACE_GL(env, "glDrawArrays({}, {}, {}) -> {}", mode, first, count);
 }
 
 void emu_glClear(Environment& env, std::uint32_t mask) {
-	glClear(mask);
+	env.gl_trace().record(GlTrace::Op::Clear, mask);
+	env.gl_commands().clear(mask);
 }
 
 void emu_glDrawElements(Environment& env, std::uint32_t mode, std::uint32_t count, std::uint32_t type, std::uint32_t indices_ptr) {
-	void* indices = nullptr;
-	if (indices_ptr != 0) {
-		indices = env.memory_manager().read_bytes<void>(indices_ptr);
+	env.gl_trace().draw_elements(mode, count, type, indices_ptr);
+	env.gl_stats().count_draw();
+	auto timer = env.gl_stats().time_driver();
+
+	env.texture_uploader().before_draw(env);
+
+	if (env.gl_streamer().draw_elements(env, mode, count, type, indices_ptr)) {
+		TRACE_GL(env, "glDrawElements({}, {}, {}, {:#x}) -> {}", mode, count, type, indices_ptr);
+		return;
 	}
 
-	glDrawElements(mode, count, type, indices);
+	if (env.gl().element_array_buffer_binding() != 0) {
+		env.gl_commands().draw_elements(mode, count, type, indices_ptr);
+	} else {
+		void* indices = nullptr;
+		if (indices_ptr != 0) {
+			indices = env.memory_manager().read_bytes<void>(indices_ptr);
+		}
+
+		env.gl_commands().flush();
+		glDrawElements(mode, count, type, indices);
+	}
 
-	spdlog::trace("glDrawElements({}, {}, {}, {:#x}) -> {}", mode, count, type, indices_ptr, glGetError());
+	TRACE_GL(env, "glDrawElements({}, {}, {}, {:#x}) -> {}", mode, count, type, indices_ptr);
 }
 
 void emu_glBufferSubData(Environment& env, std::uint32_t target, std::uint32_t offset, std::int32_t size, std::uint32_t data_ptr) {
-	void* data = nullptr;
-	if (data_ptr != 0) {
-		data = env.memory_manager().read_bytes<void>(data_ptr);
+	// neither of these can be encoded. a negative size is left to the driver so the guest still gets its error,
+	// while there's nothing to upload from a null pointer
+	if (size < 0 || data_ptr == 0) {
+		if (size < 0) {
+			env.gl_commands().flush();
+			glBufferSubData(target, offset, size, nullptr);
+		}
+
+		TRACE_GL(env, "glBufferSubData({}, {}, {}, {:#x}) -> {}", target, offset, size, data_ptr);
+		return;
 	}
 
-	glBufferSubData(target, offset, size, data);
+	auto data = env.memory_manager().read_bytes<void>(data_ptr);
 
-	spdlog::trace("glBufferSubData({}, {}, {}, {:#x}) -> {}", target, offset, size, data_ptr, glGetError());
+	env.gl_stats().count_buffer_upload(size);
+
+	if (env.gl_trace().active()) {
+		env.gl_trace().buffer_sub_data(target, offset, size, data);
+	}
+
+	if (env.gl_streamer().buffer_sub_data(env, target, offset, size, data_ptr)) {
+		return;
+	}
+
+	env.gl_commands().buffer_sub_data(target, offset, size, data);
+
+	TRACE_GL(env, "glBufferSubData({}, {}, {}, {:#x}) -> {}", target, offset, size, data_ptr);
 }
 
 void emu_glVertexAttribPointer(Environment& env, std::uint32_t index, std::int32_t size, std::uint32_t type, bool normalized, std::uint32_t stride, std::uint32_t pointer_ptr) {
-	void* pointer = nullptr;
-	GLint binding = 0;
+	env.gl_trace().vertex_attrib_pointer(index, size, type, normalized, stride, pointer_ptr);
 
-	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &binding);
+	auto binding = env.gl().array_buffer_binding();
 
-	if (binding) {
-		pointer = reinterpret_cast<void*>(pointer_ptr);
-	} else if (pointer_ptr != 0) {
-		pointer = env.memory_manager().read_bytes<void>(pointer_ptr);
+	// client arrays and streamed buffers are copied out at draw time instead
+	if (env.gl_streamer().set_attrib_pointer(index, {size, type, normalized, stride, pointer_ptr, binding})) {
+		env.gl().forget_vertex_attrib_pointer(index);
+		return;
+	}
+
+	if (!env.gl().vertex_attrib_pointer(index, {size, type, normalized, stride, pointer_ptr, binding})) {
+		return;
 	}
 
-	glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+	if (binding) {
+		env.gl_commands().vertex_attrib_pointer(index, size, type, normalized, stride, pointer_ptr);
+	} else {
+		void* pointer = nullptr;
+		if (pointer_ptr != 0) {
+			pointer = env.memory_manager().read_bytes<void>(pointer_ptr);
+		}
+
+		env.gl_commands().flush();
+		glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+	}
 
-	spdlog::trace("glVertexAttribPointer(index: {}, size: {}, type: {}, normalized: {}, stride: {}, pointer: {:#x}) -> {}", index, size, type, normalized, stride, pointer_ptr, glGetError());
+	TRACE_GL(env, "glVertexAttribPointer(index: {}, size: {}, type: {}, normalized: {}, stride: {}, pointer: {:#x}) -> {}", index, size, type, normalized, stride, pointer_ptr);
 }
 
 void emu_glEnableVertexAttribArray(Environment& env, std::uint32_t index) {
-	glEnableVertexAttribArray(index);
-	spdlog::trace("glEnableVertexAttribArray(index: {}) -> {}", index, glGetError());
+	env.gl_trace().set_vertex_attrib_array(index, true);
+	env.gl_streamer().set_attrib_enabled(index, true);
+
+	if (!env.gl().set_vertex_attrib_array(index, true)) {
+		return;
+	}
+
+	env.gl_commands().set_vertex_attrib_array(index, true);
+	TRACE_GL(env, "glEnableVertexAttribArray(index: {}) -> {}", index);
 }
 
 void emu_glDisableVertexAttribArray(Environment& env, std::uint32_t index) {
-	glDisableVertexAttribArray(index);
-	spdlog::trace("glDisableVertexAttribArray(index: {}) -> {}", index, glGetError());
+	env.gl_trace().set_vertex_attrib_array(index, false);
+	env.gl_streamer().set_attrib_enabled(index, false);
+
+	if (!env.gl().set_vertex_attrib_array(index, false)) {
+		return;
+	}
+
+	env.gl_commands().set_vertex_attrib_array(index, false);
+	TRACE_GL(env, "glDisableVertexAttribArray(index: {}) -> {}", index);
 }
 
 void emu_glLineWidth(Environment& env, float width) {
-	glLineWidth(width);
+	env.gl_trace().record(GlTrace::Op::LineWidth, width);
+
+	if (!env.gl().line_width(width)) {
+		return;
+	}
+
+	env.gl_commands().line_width(width);
 }
 
 void emu_glUniform1f(Environment& env, std::int32_t location, float v0) {
-	glUniform1f(location, v0);
+	env.gl_trace().record(GlTrace::Op::Uniformf, location, 1, v0, 0.0f, 0.0f, 0.0f);
+	env.gl_commands().uniform_f(location, 1, v0);
 }
 
 void emu_glUniform2f(Environment& env, std::int32_t location, float v0, float v1) {
-	glUniform2f(location, v0, v1);
+	env.gl_trace().record(GlTrace::Op::Uniformf, location, 2, v0, v1, 0.0f, 0.0f);
+	env.gl_commands().uniform_f(location, 2, v0, v1);
 }
 
 void emu_glUniform3f(Environment& env, std::int32_t location, float v0, float v1, float v2) {
-	glUniform3f(location, v0, v1, v2);
+	env.gl_trace().record(GlTrace::Op::Uniformf, location, 3, v0, v1, v2, 0.0f);
+	env.gl_commands().uniform_f(location, 3, v0, v1, v2);
 }
 
 void emu_glBindRenderbuffer(Environment& env, std::uint32_t target, std::uint32_t renderbuffer) {
-	glBindRenderbuffer(target, renderbuffer);
+	env.gl_trace().record(GlTrace::Op::BindRenderbuffer, target, renderbuffer);
+
+	if (!env.gl().bind_renderbuffer(target, renderbuffer)) {
+		return;
+	}
+
+	env.gl_commands().bind_renderbuffer(target, renderbuffer);
 }
 
 void emu_glBindFramebuffer(Environment& env, std::uint32_t target, std::uint32_t framebuffer) {
-	glBindFramebuffer(target, framebuffer);
+	env.gl_trace().record(GlTrace::Op::BindFramebuffer, target, framebuffer);
+
+	if (!env.gl().bind_framebuffer(target, framebuffer)) {
+		return;
+	}
+
+	// framebuffer 0 might not be the screen, if the frame chain is in use
+	env.gl_commands().bind_framebuffer(target, env.frame_chain().bind_framebuffer(target, framebuffer));
 }
 
 void emu_glFramebufferTexture2D(Environment& env, std::uint32_t target, std::uint32_t attachment, std::uint32_t textarget, std::uint32_t texture, std::int32_t level) {
-	glFramebufferTexture2D(target, attachment, textarget, texture, level);
+	env.gl_trace().record(GlTrace::Op::FramebufferTexture2D, target, attachment, textarget, texture, level);
+	env.gl_commands().framebuffer_texture_2d(target, attachment, textarget, texture, level);
 }
 
 void emu_glGenRenderbuffers(Environment& env, int32_t n, uint32_t renderbuffers_ptr) {
@@ -414,11 +754,14 @@ void emu_glGenRenderbuffers(Environment& env, int32_t n, uint32_t renderbuffers_
 		renderbuffers = env.memory_manager().read_bytes<std::uint32_t>(renderbuffers_ptr);
 	}
 
+	env.gl_commands().flush();
 	glGenRenderbuffers(n, renderbuffers);
+	env.gl_trace().record_with(GlTrace::Op::GenRenderbuffers, renderbuffers, n * sizeof(std::uint32_t), n);
 }
 
 void emu_glFramebufferRenderbuffer(Environment& env, std::uint32_t target, std::uint32_t attachment, std::uint32_t renderbuffertarget, std::int32_t renderbuffer) {
-	glFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+	env.gl_trace().record(GlTrace::Op::FramebufferRenderbuffer, target, attachment, renderbuffertarget, renderbuffer);
+	env.gl_commands().framebuffer_renderbuffer(target, attachment, renderbuffertarget, renderbuffer);
 }
 
 void emu_glGenFramebuffers(Environment& env, std::int32_t n, std::uint32_t framebuffers_ptr) {
@@ -427,18 +770,27 @@ void emu_glGenFramebuffers(Environment& env, std::int32_t n, std::uint32_t frame
 		framebuffers = env.memory_manager().read_bytes<std::uint32_t>(framebuffers_ptr);
 	}
 
+	env.gl_commands().flush();
 	glGenFramebuffers(n, framebuffers);
+	env.gl_trace().record_with(GlTrace::Op::GenFramebuffers, framebuffers, n * sizeof(std::uint32_t), n);
 }
 
 std::uint32_t emu_glCheckFramebufferStatus(Environment& env, std::uint32_t target) {
+	env.gl_commands().flush();
 	return glCheckFramebufferStatus(target);
 }
 
 void emu_glUniform4f(Environment& env, std::int32_t location, float v0, GLfloat v1, float v2, float v3) {
-	glUniform4f(location, v0, v1, v2, v3);
+	env.gl_trace().record(GlTrace::Op::Uniformf, location, 4, v0, v1, v2, v3);
+	env.gl_commands().uniform_f(location, 4, v0, v1, v2, v3);
 }
 
 std::uint32_t emu_glGetError(Environment& env) {
+	// every one of these is a round trip to the driver
+	env.gl_stats().count_get_error();
+
+	auto timer = env.gl_stats().time_driver();
+	env.gl_commands().flush();
 	return glGetError();
 }
 
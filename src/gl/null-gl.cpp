@@ -0,0 +1,1245 @@
+#include "null-gl.hpp"
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+	// these only exist in gl 4.1 and gles, but cocos asks for them anyways
+	constexpr GLenum MAX_VERTEX_UNIFORM_VECTORS = 0x8DFB;
+	constexpr GLenum MAX_VARYING_VECTORS = 0x8DFC;
+	constexpr GLenum MAX_FRAGMENT_UNIFORM_VECTORS = 0x8DFD;
+	constexpr GLenum NUM_PROGRAM_BINARY_FORMATS = 0x87FE;
+
+	constexpr GLint MAX_TEXTURE_SIZE = 4096;
+	constexpr GLuint MAX_TEXTURE_UNITS = 32;
+	constexpr GLuint MAX_VERTEX_ATTRIBS = 16;
+
+	// glad refuses to load a 3.0 context without any extensions, so there's one that's already covered
+	constexpr const char* EXTENSIONS = "GL_ARB_framebuffer_object";
+
+	struct Shader {
+		GLenum type;
+		std::string source{};
+		bool compiled{false};
+	};
+
+	struct Program {
+		std::vector<GLuint> shaders{};
+		bool linked{false};
+
+		std::unordered_map<std::string, GLint> uniforms{};
+		GLint next_uniform{0};
+	};
+
+	struct Context {
+		NullGl::Counters counters{};
+		GLenum error{GL_NO_ERROR};
+
+		// names are never reused, which makes use after delete easier to spot
+		GLuint next_name{1u};
+
+		std::unordered_map<GLuint, GLsizeiptr> buffers{};
+		std::unordered_set<GLuint> textures{};
+		std::unordered_set<GLuint> framebuffers{};
+		std::unordered_set<GLuint> renderbuffers{};
+		std::unordered_map<GLuint, Shader> shaders{};
+		std::unordered_map<GLuint, Program> programs{};
+
+		GLuint array_buffer{0u};
+		GLuint element_array_buffer{0u};
+		GLuint active_texture{0u};
+		std::array<GLuint, MAX_TEXTURE_UNITS> texture_2d{};
+		std::array<GLuint, MAX_TEXTURE_UNITS> texture_cube_map{};
+		GLuint program{0u};
+		GLuint framebuffer{0u};
+		GLuint renderbuffer{0u};
+
+		std::array<GLint, 4> viewport{};
+		std::array<GLint, 4> scissor{};
+		std::array<GLfloat, 4> clear_color{};
+		GLfloat clear_depth{1.0f};
+		GLfloat line_width{1.0f};
+
+		GLint pack_alignment{4};
+		GLint unpack_alignment{4};
+
+		std::unordered_set<GLenum> caps{GL_DITHER};
+		std::array<bool, MAX_VERTEX_ATTRIBS> attrib_enabled{};
+	};
+
+	Context ctx{};
+
+	void set_error(GLenum error, std::string_view fn) {
+		ctx.counters.errors++;
+		spdlog::debug("null gl: {} raised {:#x}", fn, error);
+
+		// like a real driver, only the first error sticks around until it's read
+		if (ctx.error == GL_NO_ERROR) {
+			ctx.error = error;
+		}
+	}
+
+	GLuint gen_name() {
+		return ctx.next_name++;
+	}
+
+	bool is_draw_mode(GLenum mode) {
+		return mode <= GL_TRIANGLE_FAN;
+	}
+
+	std::uint32_t pixel_size(GLenum format, GLenum type) {
+		switch (type) {
+			case GL_UNSIGNED_SHORT_4_4_4_4:
+			case GL_UNSIGNED_SHORT_5_5_5_1:
+			case GL_UNSIGNED_SHORT_5_6_5:
+				return 2;
+			case GL_UNSIGNED_BYTE:
+				switch (format) {
+					case GL_ALPHA:
+					case GL_LUMINANCE:
+						return 1;
+					case GL_LUMINANCE_ALPHA:
+						return 2;
+					case GL_RGB:
+						return 3;
+					case GL_RGBA:
+						return 4;
+					default:
+						return 0;
+				}
+			default:
+				return 0;
+		}
+	}
+
+	GLuint* buffer_binding(GLenum target) {
+		switch (target) {
+			case GL_ARRAY_BUFFER:
+				return &ctx.array_buffer;
+			case GL_ELEMENT_ARRAY_BUFFER:
+				return &ctx.element_array_buffer;
+			default:
+				return nullptr;
+		}
+	}
+
+	GLuint* texture_binding(GLenum target) {
+		switch (target) {
+			case GL_TEXTURE_2D:
+				return &ctx.texture_2d[ctx.active_texture];
+			case GL_TEXTURE_CUBE_MAP:
+				return &ctx.texture_cube_map[ctx.active_texture];
+			default:
+				return nullptr;
+		}
+	}
+
+	Shader* get_shader(GLuint shader, std::string_view fn) {
+		if (auto it = ctx.shaders.find(shader); it != ctx.shaders.end()) {
+			return &it->second;
+		}
+
+		set_error(GL_INVALID_VALUE, fn);
+		return nullptr;
+	}
+
+	Program* get_program(GLuint program, std::string_view fn) {
+		if (auto it = ctx.programs.find(program); it != ctx.programs.end()) {
+			return &it->second;
+		}
+
+		set_error(GL_INVALID_VALUE, fn);
+		return nullptr;
+	}
+
+	template <typename T>
+	void gen_names(GLsizei n, GLuint* names, T& set, std::string_view fn) {
+		ctx.counters.calls++;
+
+		if (n < 0) {
+			set_error(GL_INVALID_VALUE, fn);
+			return;
+		}
+
+		for (auto i = 0; i < n; i++) {
+			auto name = gen_name();
+			set.insert({name});
+			names[i] = name;
+		}
+	}
+
+	// state
+
+	GLenum APIENTRY null_glGetError() {
+		ctx.counters.calls++;
+
+		auto error = ctx.error;
+		ctx.error = GL_NO_ERROR;
+
+		return error;
+	}
+
+	const GLubyte* APIENTRY null_glGetString(GLenum name) {
+		ctx.counters.calls++;
+
+		const char* value = nullptr;
+		switch (name) {
+			case GL_VENDOR:
+				value = "Silene";
+				break;
+			case GL_RENDERER:
+				value = "Null";
+				break;
+			case GL_VERSION:
+				value = "3.0 Silene Null";
+				break;
+			case GL_SHADING_LANGUAGE_VERSION:
+				value = "1.30";
+				break;
+			case GL_EXTENSIONS:
+				value = EXTENSIONS;
+				break;
+			default:
+				set_error(GL_INVALID_ENUM, "glGetString");
+				break;
+		}
+
+		return reinterpret_cast<const GLubyte*>(value);
+	}
+
+	const GLubyte* APIENTRY null_glGetStringi(GLenum name, GLuint index) {
+		ctx.counters.calls++;
+
+		if (name != GL_EXTENSIONS) {
+			set_error(GL_INVALID_ENUM, "glGetStringi");
+			return nullptr;
+		}
+
+		if (index != 0) {
+			set_error(GL_INVALID_VALUE, "glGetStringi");
+			return nullptr;
+		}
+
+		return reinterpret_cast<const GLubyte*>(EXTENSIONS);
+	}
+
+	void APIENTRY null_glGetIntegerv(GLenum name, GLint* data) {
+		ctx.counters.calls++;
+
+		switch (name) {
+			case GL_MAJOR_VERSION:
+				*data = 3;
+				break;
+			case GL_NUM_EXTENSIONS:
+				*data = 1;
+				break;
+			case GL_MINOR_VERSION:
+			case GL_NUM_COMPRESSED_TEXTURE_FORMATS:
+			case NUM_PROGRAM_BINARY_FORMATS:
+				*data = 0;
+				break;
+			case GL_MAX_TEXTURE_SIZE:
+			case GL_MAX_RENDERBUFFER_SIZE:
+				*data = MAX_TEXTURE_SIZE;
+				break;
+			case GL_MAX_VIEWPORT_DIMS:
+				data[0] = MAX_TEXTURE_SIZE;
+				data[1] = MAX_TEXTURE_SIZE;
+				break;
+			case GL_MAX_TEXTURE_IMAGE_UNITS:
+			case GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS:
+				*data = MAX_TEXTURE_UNITS / 2;
+				break;
+			case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS:
+				*data = MAX_TEXTURE_UNITS;
+				break;
+			case GL_MAX_VERTEX_ATTRIBS:
+				*data = MAX_VERTEX_ATTRIBS;
+				break;
+			case MAX_VERTEX_UNIFORM_VECTORS:
+				*data = 256;
+				break;
+			case MAX_FRAGMENT_UNIFORM_VECTORS:
+				*data = 224;
+				break;
+			case MAX_VARYING_VECTORS:
+				*data = 8;
+				break;
+			case GL_ARRAY_BUFFER_BINDING:
+				*data = ctx.array_buffer;
+				break;
+			case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+				*data = ctx.element_array_buffer;
+				break;
+			case GL_ACTIVE_TEXTURE:
+				*data = GL_TEXTURE0 + ctx.active_texture;
+				break;
+			case GL_TEXTURE_BINDING_2D:
+				*data = ctx.texture_2d[ctx.active_texture];
+				break;
+			case GL_TEXTURE_BINDING_CUBE_MAP:
+				*data = ctx.texture_cube_map[ctx.active_texture];
+				break;
+			case GL_CURRENT_PROGRAM:
+				*data = ctx.program;
+				break;
+			case GL_FRAMEBUFFER_BINDING:
+				*data = ctx.framebuffer;
+				break;
+			case GL_RENDERBUFFER_BINDING:
+				*data = ctx.renderbuffer;
+				break;
+			case GL_VIEWPORT:
+				std::copy(ctx.viewport.begin(), ctx.viewport.end(), data);
+				break;
+			case GL_SCISSOR_BOX:
+				std::copy(ctx.scissor.begin(), ctx.scissor.end(), data);
+				break;
+			case GL_PACK_ALIGNMENT:
+				*data = ctx.pack_alignment;
+				break;
+			case GL_UNPACK_ALIGNMENT:
+				*data = ctx.unpack_alignment;
+				break;
+			case GL_DEPTH_BITS:
+			case GL_STENCIL_BITS:
+				*data = name == GL_DEPTH_BITS ? 24 : 8;
+				break;
+			default:
+				set_error(GL_INVALID_ENUM, "glGetIntegerv");
+				break;
+		}
+	}
+
+	void APIENTRY null_glGetFloatv(GLenum name, GLfloat* data) {
+		switch (name) {
+			case GL_COLOR_CLEAR_VALUE:
+				ctx.counters.calls++;
+				std::copy(ctx.clear_color.begin(), ctx.clear_color.end(), data);
+				break;
+			case GL_DEPTH_CLEAR_VALUE:
+				ctx.counters.calls++;
+				*data = ctx.clear_depth;
+				break;
+			case GL_LINE_WIDTH:
+				ctx.counters.calls++;
+				*data = ctx.line_width;
+				break;
+			case GL_ALIASED_LINE_WIDTH_RANGE:
+				ctx.counters.calls++;
+				data[0] = 1.0f;
+				data[1] = 1.0f;
+				break;
+			default: {
+				// everything else is an integer anyways
+				std::array<GLint, 4> values{};
+				null_glGetIntegerv(name, values.data());
+
+				auto count = name == GL_VIEWPORT || name == GL_SCISSOR_BOX ? 4 : name == GL_MAX_VIEWPORT_DIMS ? 2 : 1;
+				for (auto i = 0; i < count; i++) {
+					data[i] = static_cast<GLfloat>(values[i]);
+				}
+				break;
+			}
+		}
+	}
+
+	void APIENTRY null_glEnable(GLenum cap) {
+		ctx.counters.calls++;
+		ctx.caps.insert(cap);
+	}
+
+	void APIENTRY null_glDisable(GLenum cap) {
+		ctx.counters.calls++;
+		ctx.caps.erase(cap);
+	}
+
+	void APIENTRY null_glPixelStorei(GLenum name, GLint param) {
+		ctx.counters.calls++;
+
+		if (param != 1 && param != 2 && param != 4 && param != 8) {
+			set_error(GL_INVALID_VALUE, "glPixelStorei");
+			return;
+		}
+
+		switch (name) {
+			case GL_PACK_ALIGNMENT:
+				ctx.pack_alignment = param;
+				break;
+			case GL_UNPACK_ALIGNMENT:
+				ctx.unpack_alignment = param;
+				break;
+			default:
+				set_error(GL_INVALID_ENUM, "glPixelStorei");
+				break;
+		}
+	}
+
+	void APIENTRY null_glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+		ctx.counters.calls++;
+
+		if (width < 0 || height < 0) {
+			set_error(GL_INVALID_VALUE, "glViewport");
+			return;
+		}
+
+		ctx.viewport = {x, y, width, height};
+	}
+
+	void APIENTRY null_glScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+		ctx.counters.calls++;
+
+		if (width < 0 || height < 0) {
+			set_error(GL_INVALID_VALUE, "glScissor");
+			return;
+		}
+
+		ctx.scissor = {x, y, width, height};
+	}
+
+	void APIENTRY null_glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+		ctx.counters.calls++;
+		ctx.clear_color = {red, green, blue, alpha};
+	}
+
+	void APIENTRY null_glClearDepth(GLdouble depth) {
+		ctx.counters.calls++;
+		ctx.clear_depth = static_cast<GLfloat>(depth);
+	}
+
+	void APIENTRY null_glLineWidth(GLfloat width) {
+		ctx.counters.calls++;
+
+		if (width <= 0.0f) {
+			set_error(GL_INVALID_VALUE, "glLineWidth");
+			return;
+		}
+
+		ctx.line_width = width;
+	}
+
+	void APIENTRY null_glBlendFunc(GLenum sfactor, GLenum dfactor) {
+		ctx.counters.calls++;
+	}
+
+	void APIENTRY null_glDepthFunc(GLenum func) {
+		ctx.counters.calls++;
+
+		if (func < GL_NEVER || func > GL_ALWAYS) {
+			set_error(GL_INVALID_ENUM, "glDepthFunc");
+		}
+	}
+
+	void APIENTRY null_glClear(GLbitfield mask) {
+		ctx.counters.calls++;
+
+		if ((mask & ~(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT)) != 0) {
+			set_error(GL_INVALID_VALUE, "glClear");
+		}
+	}
+
+	void APIENTRY null_glFlush() {
+		ctx.counters.calls++;
+	}
+
+	void APIENTRY null_glFinish() {
+		ctx.counters.calls++;
+	}
+
+	// buffers
+
+	void APIENTRY null_glGenBuffers(GLsizei n, GLuint* buffers) {
+		ctx.counters.calls++;
+
+		if (n < 0) {
+			set_error(GL_INVALID_VALUE, "glGenBuffers");
+			return;
+		}
+
+		for (auto i = 0; i < n; i++) {
+			buffers[i] = gen_name();
+			ctx.buffers[buffers[i]] = 0;
+		}
+	}
+
+	void APIENTRY null_glDeleteBuffers(GLsizei n, const GLuint* buffers) {
+		ctx.counters.calls++;
+
+		for (auto i = 0; i < n; i++) {
+			ctx.buffers.erase(buffers[i]);
+
+			if (ctx.array_buffer == buffers[i]) {
+				ctx.array_buffer = 0;
+			}
+
+			if (ctx.element_array_buffer == buffers[i]) {
+				ctx.element_array_buffer = 0;
+			}
+		}
+	}
+
+	void APIENTRY null_glBindBuffer(GLenum target, GLuint buffer) {
+		ctx.counters.calls++;
+
+		auto binding = buffer_binding(target);
+		if (binding == nullptr) {
+			set_error(GL_INVALID_ENUM, "glBindBuffer");
+			return;
+		}
+
+		// compatibility contexts create buffers on first bind
+		if (buffer != 0 && !ctx.buffers.contains(buffer)) {
+			ctx.buffers[buffer] = 0;
+		}
+
+		*binding = buffer;
+	}
+
+	void APIENTRY null_glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+		ctx.counters.calls++;
+
+		auto binding = buffer_binding(target);
+		if (binding == nullptr) {
+			set_error(GL_INVALID_ENUM, "glBufferData");
+			return;
+		}
+
+		if (size < 0) {
+			set_error(GL_INVALID_VALUE, "glBufferData");
+			return;
+		}
+
+		if (*binding == 0) {
+			set_error(GL_INVALID_OPERATION, "glBufferData");
+			return;
+		}
+
+		ctx.buffers[*binding] = size;
+
+		if (data != nullptr) {
+			ctx.counters.buffer_bytes += size;
+		}
+	}
+
+	void APIENTRY null_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+		ctx.counters.calls++;
+
+		auto binding = buffer_binding(target);
+		if (binding == nullptr) {
+			set_error(GL_INVALID_ENUM, "glBufferSubData");
+			return;
+		}
+
+		if (*binding == 0) {
+			set_error(GL_INVALID_OPERATION, "glBufferSubData");
+			return;
+		}
+
+		if (offset < 0 || size < 0 || offset + size > ctx.buffers[*binding]) {
+			set_error(GL_INVALID_VALUE, "glBufferSubData");
+			return;
+		}
+
+		ctx.counters.buffer_bytes += size;
+	}
+
+	// textures
+
+	void APIENTRY null_glGenTextures(GLsizei n, GLuint* textures) {
+		gen_names(n, textures, ctx.textures, "glGenTextures");
+	}
+
+	void APIENTRY null_glDeleteTextures(GLsizei n, const GLuint* textures) {
+		ctx.counters.calls++;
+
+		for (auto i = 0; i < n; i++) {
+			ctx.textures.erase(textures[i]);
+
+			for (auto& binding : ctx.texture_2d) {
+				if (binding == textures[i]) {
+					binding = 0;
+				}
+			}
+
+			for (auto& binding : ctx.texture_cube_map) {
+				if (binding == textures[i]) {
+					binding = 0;
+				}
+			}
+		}
+	}
+
+	void APIENTRY null_glActiveTexture(GLenum texture) {
+		ctx.counters.calls++;
+
+		if (texture < GL_TEXTURE0 || texture >= GL_TEXTURE0 + MAX_TEXTURE_UNITS) {
+			set_error(GL_INVALID_ENUM, "glActiveTexture");
+			return;
+		}
+
+		ctx.active_texture = texture - GL_TEXTURE0;
+	}
+
+	void APIENTRY null_glBindTexture(GLenum target, GLuint texture) {
+		ctx.counters.calls++;
+
+		auto binding = texture_binding(target);
+		if (binding == nullptr) {
+			set_error(GL_INVALID_ENUM, "glBindTexture");
+			return;
+		}
+
+		if (texture != 0) {
+			ctx.textures.insert(texture);
+		}
+
+		*binding = texture;
+	}
+
+	bool check_tex_image(GLenum target, GLint level, GLsizei width, GLsizei height, std::string_view fn) {
+		auto is_face = target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z;
+		if (target != GL_TEXTURE_2D && !is_face) {
+			set_error(GL_INVALID_ENUM, fn);
+			return false;
+		}
+
+		if (level < 0 || width < 0 || height < 0 || width > MAX_TEXTURE_SIZE || height > MAX_TEXTURE_SIZE) {
+			set_error(GL_INVALID_VALUE, fn);
+			return false;
+		}
+
+		auto bound = is_face ? ctx.texture_cube_map[ctx.active_texture] : ctx.texture_2d[ctx.active_texture];
+		if (bound == 0) {
+			set_error(GL_INVALID_OPERATION, fn);
+			return false;
+		}
+
+		return true;
+	}
+
+	void APIENTRY null_glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels) {
+		ctx.counters.calls++;
+
+		if (!check_tex_image(target, level, width, height, "glTexImage2D")) {
+			return;
+		}
+
+		if (border != 0) {
+			set_error(GL_INVALID_VALUE, "glTexImage2D");
+			return;
+		}
+
+		auto size = pixel_size(format, type);
+		if (size == 0) {
+			set_error(GL_INVALID_ENUM, "glTexImage2D");
+			return;
+		}
+
+		if (pixels != nullptr) {
+			ctx.counters.texture_bytes += static_cast<std::uint64_t>(width) * height * size;
+		}
+	}
+
+	void APIENTRY null_glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) {
+		ctx.counters.calls++;
+
+		if (!check_tex_image(target, level, width, height, "glTexSubImage2D")) {
+			return;
+		}
+
+		auto size = pixel_size(format, type);
+		if (size == 0) {
+			set_error(GL_INVALID_ENUM, "glTexSubImage2D");
+			return;
+		}
+
+		ctx.counters.texture_bytes += static_cast<std::uint64_t>(width) * height * size;
+	}
+
+	void APIENTRY null_glTexParameteri(GLenum target, GLenum name, GLint param) {
+		ctx.counters.calls++;
+
+		if (texture_binding(target) == nullptr) {
+			set_error(GL_INVALID_ENUM, "glTexParameteri");
+		}
+	}
+
+	// shaders and programs
+
+	GLuint APIENTRY null_glCreateShader(GLenum type) {
+		ctx.counters.calls++;
+
+		if (type != GL_VERTEX_SHADER && type != GL_FRAGMENT_SHADER) {
+			set_error(GL_INVALID_ENUM, "glCreateShader");
+			return 0;
+		}
+
+		auto name = gen_name();
+		ctx.shaders[name] = Shader{type};
+
+		return name;
+	}
+
+	void APIENTRY null_glShaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths) {
+		ctx.counters.calls++;
+
+		auto record = get_shader(shader, "glShaderSource");
+		if (record == nullptr) {
+			return;
+		}
+
+		record->source.clear();
+		for (auto i = 0; i < count; i++) {
+			if (lengths != nullptr && lengths[i] >= 0) {
+				record->source.append(strings[i], lengths[i]);
+			} else {
+				record->source.append(strings[i]);
+			}
+		}
+	}
+
+	void APIENTRY null_glCompileShader(GLuint shader) {
+		ctx.counters.calls++;
+
+		if (auto record = get_shader(shader, "glCompileShader")) {
+			record->compiled = !record->source.empty();
+		}
+	}
+
+	void APIENTRY null_glGetShaderiv(GLuint shader, GLenum name, GLint* params) {
+		ctx.counters.calls++;
+
+		auto record = get_shader(shader, "glGetShaderiv");
+		if (record == nullptr) {
+			return;
+		}
+
+		switch (name) {
+			case GL_SHADER_TYPE:
+				*params = record->type;
+				break;
+			case GL_COMPILE_STATUS:
+				*params = record->compiled;
+				break;
+			case GL_DELETE_STATUS:
+			case GL_INFO_LOG_LENGTH:
+				*params = 0;
+				break;
+			case GL_SHADER_SOURCE_LENGTH:
+				*params = record->source.empty() ? 0 : static_cast<GLint>(record->source.size() + 1);
+				break;
+			default:
+				set_error(GL_INVALID_ENUM, "glGetShaderiv");
+				break;
+		}
+	}
+
+	void APIENTRY null_glGetShaderInfoLog(GLuint shader, GLsizei max_length, GLsizei* length, GLchar* info_log) {
+		ctx.counters.calls++;
+
+		if (get_shader(shader, "glGetShaderInfoLog") == nullptr) {
+			return;
+		}
+
+		if (length != nullptr) {
+			*length = 0;
+		}
+
+		if (max_length > 0) {
+			*info_log = '\0';
+		}
+	}
+
+	void APIENTRY null_glGetShaderSource(GLuint shader, GLsizei buf_size, GLsizei* length, GLchar* source) {
+		ctx.counters.calls++;
+
+		auto record = get_shader(shader, "glGetShaderSource");
+		if (record == nullptr || buf_size <= 0) {
+			return;
+		}
+
+		auto copied = std::min<std::size_t>(record->source.size(), buf_size - 1);
+		std::copy_n(record->source.data(), copied, source);
+		source[copied] = '\0';
+
+		if (length != nullptr) {
+			*length = static_cast<GLsizei>(copied);
+		}
+	}
+
+	void APIENTRY null_glDeleteShader(GLuint shader) {
+		ctx.counters.calls++;
+
+		// attached shaders are only flagged by a real driver, but nothing here reads them after linking
+		if (shader != 0) {
+			ctx.shaders.erase(shader);
+		}
+	}
+
+	GLuint APIENTRY null_glCreateProgram() {
+		ctx.counters.calls++;
+
+		auto name = gen_name();
+		ctx.programs[name] = Program{};
+
+		return name;
+	}
+
+	void APIENTRY null_glDeleteProgram(GLuint program) {
+		ctx.counters.calls++;
+
+		if (program != 0) {
+			ctx.programs.erase(program);
+		}
+
+		if (ctx.program == program) {
+			ctx.program = 0;
+		}
+	}
+
+	void APIENTRY null_glAttachShader(GLuint program, GLuint shader) {
+		ctx.counters.calls++;
+
+		auto record = get_program(program, "glAttachShader");
+		if (record == nullptr || get_shader(shader, "glAttachShader") == nullptr) {
+			return;
+		}
+
+		record->shaders.push_back(shader);
+	}
+
+	void APIENTRY null_glDetachShader(GLuint program, GLuint shader) {
+		ctx.counters.calls++;
+
+		auto record = get_program(program, "glDetachShader");
+		if (record == nullptr) {
+			return;
+		}
+
+		auto& shaders = record->shaders;
+		shaders.erase(std::remove(shaders.begin(), shaders.end(), shader), shaders.end());
+	}
+
+	void APIENTRY null_glBindAttribLocation(GLuint program, GLuint index, const GLchar* name) {
+		ctx.counters.calls++;
+
+		if (index >= MAX_VERTEX_ATTRIBS) {
+			set_error(GL_INVALID_VALUE, "glBindAttribLocation");
+			return;
+		}
+
+		get_program(program, "glBindAttribLocation");
+	}
+
+	void APIENTRY null_glLinkProgram(GLuint program) {
+		ctx.counters.calls++;
+
+		auto record = get_program(program, "glLinkProgram");
+		if (record == nullptr) {
+			return;
+		}
+
+		auto has_vertex = false;
+		auto has_fragment = false;
+		auto all_compiled = true;
+
+		for (auto shader : record->shaders) {
+			auto it = ctx.shaders.find(shader);
+			if (it == ctx.shaders.end()) {
+				continue;
+			}
+
+			has_vertex |= it->second.type == GL_VERTEX_SHADER;
+			has_fragment |= it->second.type == GL_FRAGMENT_SHADER;
+			all_compiled &= it->second.compiled;
+		}
+
+		record->linked = has_vertex && has_fragment && all_compiled;
+		record->uniforms.clear();
+		record->next_uniform = 0;
+	}
+
+	void APIENTRY null_glGetProgramiv(GLuint program, GLenum name, GLint* params) {
+		ctx.counters.calls++;
+
+		auto record = get_program(program, "glGetProgramiv");
+		if (record == nullptr) {
+			return;
+		}
+
+		switch (name) {
+			case GL_LINK_STATUS:
+			case GL_VALIDATE_STATUS:
+				*params = record->linked;
+				break;
+			case GL_ATTACHED_SHADERS:
+				*params = static_cast<GLint>(record->shaders.size());
+				break;
+			case GL_DELETE_STATUS:
+			case GL_INFO_LOG_LENGTH:
+			case GL_ACTIVE_UNIFORMS:
+			case GL_ACTIVE_ATTRIBUTES:
+				*params = 0;
+				break;
+			default:
+				set_error(GL_INVALID_ENUM, "glGetProgramiv");
+				break;
+		}
+	}
+
+	void APIENTRY null_glUseProgram(GLuint program) {
+		ctx.counters.calls++;
+
+		if (program != 0) {
+			auto record = get_program(program, "glUseProgram");
+			if (record == nullptr) {
+				return;
+			}
+
+			if (!record->linked) {
+				set_error(GL_INVALID_OPERATION, "glUseProgram");
+				return;
+			}
+		}
+
+		ctx.program = program;
+	}
+
+	GLint APIENTRY null_glGetUniformLocation(GLuint program, const GLchar* name) {
+		ctx.counters.calls++;
+
+		auto record = get_program(program, "glGetUniformLocation");
+		if (record == nullptr) {
+			return -1;
+		}
+
+		if (!record->linked) {
+			set_error(GL_INVALID_OPERATION, "glGetUniformLocation");
+			return -1;
+		}
+
+		if (auto it = record->uniforms.find(name); it != record->uniforms.end()) {
+			return it->second;
+		}
+
+		// no compiler here, so anything that's mentioned in a shader is considered active
+		auto found = false;
+		for (auto shader : record->shaders) {
+			if (auto it = ctx.shaders.find(shader); it != ctx.shaders.end() && it->second.source.find(name) != std::string::npos) {
+				found = true;
+				break;
+			}
+		}
+
+		auto location = found ? record->next_uniform++ : -1;
+		record->uniforms[name] = location;
+
+		return location;
+	}
+
+	void check_uniform(std::string_view fn) {
+		ctx.counters.calls++;
+
+		if (ctx.program == 0) {
+			set_error(GL_INVALID_OPERATION, fn);
+		}
+	}
+
+	void APIENTRY null_glUniform1i(GLint location, GLint v0) {
+		check_uniform("glUniform1i");
+	}
+
+	void APIENTRY null_glUniform1f(GLint location, GLfloat v0) {
+		check_uniform("glUniform1f");
+	}
+
+	void APIENTRY null_glUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+		check_uniform("glUniform2f");
+	}
+
+	void APIENTRY null_glUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+		check_uniform("glUniform3f");
+	}
+
+	void APIENTRY null_glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+		check_uniform("glUniform4f");
+	}
+
+	void APIENTRY null_glUniform4fv(GLint location, GLsizei count, const GLfloat* value) {
+		check_uniform("glUniform4fv");
+	}
+
+	void APIENTRY null_glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+		check_uniform("glUniformMatrix4fv");
+	}
+
+	// vertex state and drawing
+
+	void APIENTRY null_glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) {
+		ctx.counters.calls++;
+
+		if (index >= MAX_VERTEX_ATTRIBS || size < 1 || size > 4 || stride < 0) {
+			set_error(GL_INVALID_VALUE, "glVertexAttribPointer");
+		}
+	}
+
+	void APIENTRY null_glEnableVertexAttribArray(GLuint index) {
+		ctx.counters.calls++;
+
+		if (index >= MAX_VERTEX_ATTRIBS) {
+			set_error(GL_INVALID_VALUE, "glEnableVertexAttribArray");
+			return;
+		}
+
+		ctx.attrib_enabled[index] = true;
+	}
+
+	void APIENTRY null_glDisableVertexAttribArray(GLuint index) {
+		ctx.counters.calls++;
+
+		if (index >= MAX_VERTEX_ATTRIBS) {
+			set_error(GL_INVALID_VALUE, "glDisableVertexAttribArray");
+			return;
+		}
+
+		ctx.attrib_enabled[index] = false;
+	}
+
+	bool check_draw(GLenum mode, GLsizei count, std::string_view fn) {
+		ctx.counters.calls++;
+
+		if (!is_draw_mode(mode)) {
+			set_error(GL_INVALID_ENUM, fn);
+			return false;
+		}
+
+		if (count < 0) {
+			set_error(GL_INVALID_VALUE, fn);
+			return false;
+		}
+
+		ctx.counters.draw_calls++;
+		ctx.counters.vertices += count;
+
+		return true;
+	}
+
+	void APIENTRY null_glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+		if (first < 0) {
+			ctx.counters.calls++;
+			set_error(GL_INVALID_VALUE, "glDrawArrays");
+			return;
+		}
+
+		check_draw(mode, count, "glDrawArrays");
+	}
+
+	void APIENTRY null_glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+		if (type != GL_UNSIGNED_BYTE && type != GL_UNSIGNED_SHORT && type != GL_UNSIGNED_INT) {
+			ctx.counters.calls++;
+			set_error(GL_INVALID_ENUM, "glDrawElements");
+			return;
+		}
+
+		check_draw(mode, count, "glDrawElements");
+	}
+
+	// framebuffers
+
+	void APIENTRY null_glGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+		gen_names(n, framebuffers, ctx.framebuffers, "glGenFramebuffers");
+	}
+
+	void APIENTRY null_glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+		ctx.counters.calls++;
+
+		for (auto i = 0; i < n; i++) {
+			ctx.framebuffers.erase(framebuffers[i]);
+
+			if (ctx.framebuffer == framebuffers[i]) {
+				ctx.framebuffer = 0;
+			}
+		}
+	}
+
+	void APIENTRY null_glBindFramebuffer(GLenum target, GLuint framebuffer) {
+		ctx.counters.calls++;
+
+		if (target != GL_FRAMEBUFFER && target != GL_DRAW_FRAMEBUFFER && target != GL_READ_FRAMEBUFFER) {
+			set_error(GL_INVALID_ENUM, "glBindFramebuffer");
+			return;
+		}
+
+		if (framebuffer != 0) {
+			ctx.framebuffers.insert(framebuffer);
+		}
+
+		ctx.framebuffer = framebuffer;
+	}
+
+	void APIENTRY null_glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+		ctx.counters.calls++;
+
+		if (ctx.framebuffer == 0) {
+			set_error(GL_INVALID_OPERATION, "glFramebufferTexture2D");
+			return;
+		}
+
+		if (texture != 0 && !ctx.textures.contains(texture)) {
+			set_error(GL_INVALID_OPERATION, "glFramebufferTexture2D");
+		}
+	}
+
+	void APIENTRY null_glFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffer_target, GLuint renderbuffer) {
+		ctx.counters.calls++;
+
+		if (ctx.framebuffer == 0) {
+			set_error(GL_INVALID_OPERATION, "glFramebufferRenderbuffer");
+			return;
+		}
+
+		if (renderbuffer != 0 && !ctx.renderbuffers.contains(renderbuffer)) {
+			set_error(GL_INVALID_OPERATION, "glFramebufferRenderbuffer");
+		}
+	}
+
+	GLenum APIENTRY null_glCheckFramebufferStatus(GLenum target) {
+		ctx.counters.calls++;
+		return GL_FRAMEBUFFER_COMPLETE;
+	}
+
+	void APIENTRY null_glGenRenderbuffers(GLsizei n, GLuint* renderbuffers) {
+		gen_names(n, renderbuffers, ctx.renderbuffers, "glGenRenderbuffers");
+	}
+
+	void APIENTRY null_glDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers) {
+		ctx.counters.calls++;
+
+		for (auto i = 0; i < n; i++) {
+			ctx.renderbuffers.erase(renderbuffers[i]);
+
+			if (ctx.renderbuffer == renderbuffers[i]) {
+				ctx.renderbuffer = 0;
+			}
+		}
+	}
+
+	void APIENTRY null_glBindRenderbuffer(GLenum target, GLuint renderbuffer) {
+		ctx.counters.calls++;
+
+		if (target != GL_RENDERBUFFER) {
+			set_error(GL_INVALID_ENUM, "glBindRenderbuffer");
+			return;
+		}
+
+		if (renderbuffer != 0) {
+			ctx.renderbuffers.insert(renderbuffer);
+		}
+
+		ctx.renderbuffer = renderbuffer;
+	}
+
+	void APIENTRY null_glRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+		ctx.counters.calls++;
+
+		if (ctx.renderbuffer == 0) {
+			set_error(GL_INVALID_OPERATION, "glRenderbufferStorage");
+		}
+	}
+
+#define NULL_GL_ENTRY(name) {#name, reinterpret_cast<void*>(&null_##name)}
+
+	const std::unordered_map<std::string_view, void*> entry_points{
+		NULL_GL_ENTRY(glGetError),
+		NULL_GL_ENTRY(glGetString),
+		NULL_GL_ENTRY(glGetStringi),
+		NULL_GL_ENTRY(glGetIntegerv),
+		NULL_GL_ENTRY(glGetFloatv),
+		NULL_GL_ENTRY(glEnable),
+		NULL_GL_ENTRY(glDisable),
+		NULL_GL_ENTRY(glPixelStorei),
+		NULL_GL_ENTRY(glViewport),
+		NULL_GL_ENTRY(glScissor),
+		NULL_GL_ENTRY(glClearColor),
+		NULL_GL_ENTRY(glClearDepth),
+		NULL_GL_ENTRY(glLineWidth),
+		NULL_GL_ENTRY(glBlendFunc),
+		NULL_GL_ENTRY(glDepthFunc),
+		NULL_GL_ENTRY(glClear),
+		NULL_GL_ENTRY(glFlush),
+		NULL_GL_ENTRY(glFinish),
+		NULL_GL_ENTRY(glGenBuffers),
+		NULL_GL_ENTRY(glDeleteBuffers),
+		NULL_GL_ENTRY(glBindBuffer),
+		NULL_GL_ENTRY(glBufferData),
+		NULL_GL_ENTRY(glBufferSubData),
+		NULL_GL_ENTRY(glGenTextures),
+		NULL_GL_ENTRY(glDeleteTextures),
+		NULL_GL_ENTRY(glActiveTexture),
+		NULL_GL_ENTRY(glBindTexture),
+		NULL_GL_ENTRY(glTexImage2D),
+		NULL_GL_ENTRY(glTexSubImage2D),
+		NULL_GL_ENTRY(glTexParameteri),
+		NULL_GL_ENTRY(glCreateShader),
+		NULL_GL_ENTRY(glShaderSource),
+		NULL_GL_ENTRY(glCompileShader),
+		NULL_GL_ENTRY(glGetShaderiv),
+		NULL_GL_ENTRY(glGetShaderInfoLog),
+		NULL_GL_ENTRY(glGetShaderSource),
+		NULL_GL_ENTRY(glDeleteShader),
+		NULL_GL_ENTRY(glCreateProgram),
+		NULL_GL_ENTRY(glDeleteProgram),
+		NULL_GL_ENTRY(glAttachShader),
+		NULL_GL_ENTRY(glDetachShader),
+		NULL_GL_ENTRY(glBindAttribLocation),
+		NULL_GL_ENTRY(glLinkProgram),
+		NULL_GL_ENTRY(glGetProgramiv),
+		NULL_GL_ENTRY(glUseProgram),
+		NULL_GL_ENTRY(glGetUniformLocation),
+		NULL_GL_ENTRY(glUniform1i),
+		NULL_GL_ENTRY(glUniform1f),
+		NULL_GL_ENTRY(glUniform2f),
+		NULL_GL_ENTRY(glUniform3f),
+		NULL_GL_ENTRY(glUniform4f),
+		NULL_GL_ENTRY(glUniform4fv),
+		NULL_GL_ENTRY(glUniformMatrix4fv),
+		NULL_GL_ENTRY(glVertexAttribPointer),
+		NULL_GL_ENTRY(glEnableVertexAttribArray),
+		NULL_GL_ENTRY(glDisableVertexAttribArray),
+		NULL_GL_ENTRY(glDrawArrays),
+		NULL_GL_ENTRY(glDrawElements),
+		NULL_GL_ENTRY(glGenFramebuffers),
+		NULL_GL_ENTRY(glDeleteFramebuffers),
+		NULL_GL_ENTRY(glBindFramebuffer),
+		NULL_GL_ENTRY(glFramebufferTexture2D),
+		NULL_GL_ENTRY(glFramebufferRenderbuffer),
+		NULL_GL_ENTRY(glCheckFramebufferStatus),
+		NULL_GL_ENTRY(glGenRenderbuffers),
+		NULL_GL_ENTRY(glDeleteRenderbuffers),
+		NULL_GL_ENTRY(glBindRenderbuffer),
+		NULL_GL_ENTRY(glRenderbufferStorage),
+	};
+
+#undef NULL_GL_ENTRY
+}
+
+void* NullGl::get_proc_address(const char* name) {
+	if (auto it = entry_points.find(name); it != entry_points.end()) {
+		return it->second;
+	}
+
+	return nullptr;
+}
+
+const NullGl::Counters& NullGl::counters() {
+	return ctx.counters;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#ifndef _GL_NULL_GL_HPP
+#define _GL_NULL_GL_HPP
+
+#include <cstdint>
+
+/**
+ * a gl implementation that never draws anything, for running without a display or a gpu.
+ *
+ * it's handed to glad like any other loader, so everything behind the wrappers works unchanged.
+ * object names and the bits of state the emulator reads back are tracked, and calls are checked
+ * against what a real driver would reject, so errors still show up through glGetError.
+ * only the entry points the emulator uses are provided, anything else resolves to nullptr
+ */
+namespace NullGl {
+	struct Counters {
+		std::uint64_t calls{0u};
+		std::uint64_t draw_calls{0u};
+		std::uint64_t vertices{0u};
+		std::uint64_t buffer_bytes{0u};
+		std::uint64_t texture_bytes{0u};
+		std::uint64_t errors{0u};
+	};
+
+	/**
+	 * usable as both a glad and an extension loader
+	 */
+	void* get_proc_address(const char* name);
+
+	const Counters& counters();
+}
+
+#endif
@@ -0,0 +1,492 @@
+#include "shader-cache.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+#include <spdlog/spdlog.h>
+
+#ifdef SILENE_USE_EGL
+#include <GLES2/gl2.h>
+#else
+#include <glad/glad.h>
+#endif
+
+#include "gl-extensions.hpp"
+
+namespace {
+	constexpr std::uint32_t CACHE_MAGIC = 0x43534c53; // SLSC
+	constexpr std::uint32_t CACHE_VERSION = 1;
+
+	struct CacheHeader {
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint64_t driver_hash;
+		std::uint32_t binary_format;
+		std::uint32_t binary_length;
+		std::uint32_t shader_count;
+		std::uint32_t reserved;
+	};
+
+	// followed by shader_count shader hashes, then the binary
+	static_assert(sizeof(CacheHeader) == 32);
+
+	constexpr std::uint64_t FNV_OFFSET = 0xcbf29ce484222325;
+	constexpr std::uint64_t FNV_PRIME = 0x100000001b3;
+
+	std::uint64_t hash_bytes(const void* data, std::size_t size, std::uint64_t hash = FNV_OFFSET) {
+		auto bytes = static_cast<const std::uint8_t*>(data);
+		for (auto i = 0u; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= FNV_PRIME;
+		}
+
+		return hash;
+	}
+
+	template <typename T>
+	std::uint64_t hash_value(const T& value, std::uint64_t hash) {
+		return hash_bytes(&value, sizeof(T), hash);
+	}
+
+	std::string_view get_gl_string(std::uint32_t name) {
+		auto str = reinterpret_cast<const char*>(glGetString(name));
+		return str != nullptr ? str : "";
+	}
+
+#ifndef SILENE_USE_EGL
+	bool starts_with_word(std::string_view str, std::string_view word) {
+		return str.starts_with(word) && str.size() > word.size() && std::isspace(static_cast<unsigned char>(str[word.size()]));
+	}
+
+	/**
+	 * glsl before 1.30 knows nothing about precision, so statements are removed and qualifiers are defined away.
+	 * shaders that ask for a version are left alone, those versions understand precision already
+	 */
+	std::string translate_for_desktop(std::string_view source) {
+		if (source.find("#version") != std::string_view::npos) {
+			return std::string{source};
+		}
+
+		std::string out{"#define lowp\n#define mediump\n#define highp\n"};
+		out.reserve(out.size() + source.size());
+
+		while (!source.empty()) {
+			auto line_end = source.find('\n');
+			auto line = source.substr(0, line_end == std::string_view::npos ? source.size() : line_end + 1);
+			source.remove_prefix(line.size());
+
+			auto start = line.find_first_not_of(" \t");
+			if (start != std::string_view::npos && starts_with_word(line.substr(start), "precision")) {
+				// keep anything after the statement, there's rarely anything but a newline
+				auto end = line.find(';', start);
+				line = end == std::string_view::npos ? std::string_view{"\n"} : line.substr(end + 1);
+			}
+
+			out.append(line);
+		}
+
+		return out;
+	}
+#endif
+}
+
+void ShaderCache::load() {
+	if (this->_loaded) {
+		return;
+	}
+
+	this->_loaded = true;
+
+	if (this->_directory.empty()) {
+		return;
+	}
+
+	if (!GlExtensions::get().has_program_binary) {
+		spdlog::info("shader cache: program binaries are unsupported, disabling");
+		return;
+	}
+
+	GLint formats = 0;
+	glGetIntegerv(GlExtensions::NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats <= 0) {
+		spdlog::info("shader cache: driver has no program binary formats, disabling");
+		return;
+	}
+
+	std::error_code ec;
+	std::filesystem::create_directories(this->_directory, ec);
+	if (ec) {
+		spdlog::warn("shader cache: failed to create {}: {}", this->_directory.string(), ec.message());
+		return;
+	}
+
+	// binaries are only good for the exact driver that made them
+	auto driver_hash = FNV_OFFSET;
+	for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+		auto str = get_gl_string(name);
+		driver_hash = hash_bytes(str.data(), str.size(), driver_hash);
+		driver_hash = hash_value('\n', driver_hash);
+	}
+
+	this->_driver_hash = driver_hash;
+	this->_enabled = true;
+
+	auto programs = 0u;
+	for (const auto& entry : std::filesystem::directory_iterator{this->_directory, ec}) {
+		if (!entry.is_regular_file() || entry.path().extension() != ".bin") {
+			continue;
+		}
+
+		std::ifstream file{entry.path(), std::ios::binary};
+
+		CacheHeader header{};
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+		if (!file || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.driver_hash != driver_hash) {
+			continue;
+		}
+
+		std::vector<std::uint64_t> shaders(header.shader_count);
+		file.read(reinterpret_cast<char*>(shaders.data()), shaders.size() * sizeof(std::uint64_t));
+
+		if (!file) {
+			continue;
+		}
+
+		this->_known_shaders.insert(shaders.begin(), shaders.end());
+		programs++;
+	}
+
+	spdlog::info("shader cache: found {} programs in {}", programs, this->_directory.string());
+}
+
+std::uint64_t ShaderCache::program_key(const ProgramRecord& program) const {
+	if (!this->_enabled || program.shaders.empty()) {
+		return 0;
+	}
+
+	std::vector<std::uint64_t> shader_hashes{};
+	for (auto shader : program.shaders) {
+		auto it = this->_shaders.find(shader);
+		if (it == this->_shaders.end()) {
+			return 0;
+		}
+
+		shader_hashes.push_back(it->second.hash);
+	}
+
+	// neither attach nor bind order changes the result
+	std::sort(shader_hashes.begin(), shader_hashes.end());
+
+	auto bindings = program.attrib_bindings;
+	std::sort(bindings.begin(), bindings.end());
+
+	auto key = hash_value(this->_driver_hash, FNV_OFFSET);
+	for (auto hash : shader_hashes) {
+		key = hash_value(hash, key);
+	}
+
+	for (const auto& [index, name] : bindings) {
+		key = hash_value(index, key);
+		key = hash_bytes(name.data(), name.size() + 1, key);
+	}
+
+	return key != 0 ? key : 1;
+}
+
+std::filesystem::path ShaderCache::program_path(std::uint64_t key) const {
+	return this->_directory / fmt::format("{:016x}.bin", key);
+}
+
+bool ShaderCache::load_program(std::uint32_t program, std::uint64_t key) {
+	auto path = this->program_path(key);
+
+	std::ifstream file{path, std::ios::binary};
+	if (!file) {
+		return false;
+	}
+
+	CacheHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	if (!file || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.driver_hash != this->_driver_hash) {
+		return false;
+	}
+
+	file.seekg(header.shader_count * sizeof(std::uint64_t), std::ios::cur);
+
+	std::vector<char> binary(header.binary_length);
+	file.read(binary.data(), binary.size());
+
+	if (!file) {
+		return false;
+	}
+
+	GlExtensions::get().program_binary(program, header.binary_format, binary.data(), static_cast<std::int32_t>(binary.size()));
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+
+	if (status != GL_TRUE) {
+		// drivers are allowed to reject binaries for any reason, so this one isn't worth keeping around
+		spdlog::info("shader cache: driver rejected binary {:016x}, linking from source", key);
+
+		file.close();
+
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+
+		return false;
+	}
+
+	spdlog::debug("shader cache: loaded program {} from {:016x}", program, key);
+
+	return true;
+}
+
+void ShaderCache::store_program(std::uint32_t program, std::uint64_t key, const ProgramRecord& record) {
+	GLint length = 0;
+	glGetProgramiv(program, GlExtensions::PROGRAM_BINARY_LENGTH, &length);
+
+	if (length <= 0) {
+		return;
+	}
+
+	std::vector<char> binary(length);
+	std::uint32_t binary_format = 0;
+	std::int32_t written = 0;
+
+	GlExtensions::get().get_program_binary(program, length, &written, &binary_format, binary.data());
+
+	if (written <= 0) {
+		return;
+	}
+
+	std::vector<std::uint64_t> shaders{};
+	for (auto shader : record.shaders) {
+		shaders.push_back(this->_shaders[shader].hash);
+	}
+
+	CacheHeader header{
+		CACHE_MAGIC, CACHE_VERSION, this->_driver_hash,
+		binary_format, static_cast<std::uint32_t>(written), static_cast<std::uint32_t>(shaders.size()), 0
+	};
+
+	// written to the side first, so a crash can't leave a partial binary behind
+	auto path = this->program_path(key);
+	auto temp_path = path;
+	temp_path += ".tmp";
+
+	{
+		std::ofstream file{temp_path, std::ios::binary | std::ios::trunc};
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(shaders.data()), shaders.size() * sizeof(std::uint64_t));
+		file.write(binary.data(), written);
+
+		if (!file) {
+			spdlog::warn("shader cache: failed to write {}", temp_path.string());
+			return;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temp_path, path, ec);
+	if (ec) {
+		spdlog::warn("shader cache: failed to store {}: {}", path.string(), ec.message());
+		return;
+	}
+
+	this->_known_shaders.insert(shaders.begin(), shaders.end());
+
+	spdlog::debug("shader cache: stored program {} as {:016x} ({} bytes)", program, key, written);
+}
+
+void ShaderCache::compile_deferred(std::uint32_t shader) {
+	auto it = this->_shaders.find(shader);
+	if (it == this->_shaders.end() || !it->second.deferred) {
+		return;
+	}
+
+	it->second.deferred = false;
+	glCompileShader(shader);
+}
+
+const std::string& ShaderCache::translate(const std::string& source, std::uint64_t hash) {
+	if (auto it = this->_translations.find(hash); it != this->_translations.end()) {
+		return it->second;
+	}
+
+#ifdef SILENE_USE_EGL
+	auto translated = source;
+#else
+	auto translated = translate_for_desktop(source);
+#endif
+
+	return this->_translations.emplace(hash, std::move(translated)).first->second;
+}
+
+void ShaderCache::set_directory(const std::filesystem::path& directory) {
+	this->_directory = directory;
+}
+
+void ShaderCache::shader_source(std::uint32_t shader, const std::vector<std::string_view>& sources) {
+	std::string source{};
+	for (auto str : sources) {
+		source.append(str);
+	}
+
+	auto hash = hash_bytes(source.data(), source.size());
+	const auto& translated = this->translate(source, hash);
+
+	auto str = translated.c_str();
+	auto length = static_cast<GLint>(translated.size());
+	glShaderSource(shader, 1, &str, &length);
+
+	this->_shaders[shader] = ShaderRecord{hash, false};
+}
+
+void ShaderCache::compile_shader(std::uint32_t shader) {
+	this->load();
+
+	auto it = this->_shaders.find(shader);
+	if (it != this->_shaders.end() && this->_known_shaders.contains(it->second.hash)) {
+		it->second.deferred = true;
+		return;
+	}
+
+	glCompileShader(shader);
+}
+
+bool ShaderCache::get_shader_iv(std::uint32_t shader, std::uint32_t name, std::int32_t* data) {
+	auto it = this->_shaders.find(shader);
+	if (it == this->_shaders.end() || !it->second.deferred || data == nullptr) {
+		return false;
+	}
+
+	switch (name) {
+		case GL_COMPILE_STATUS:
+			*data = GL_TRUE;
+			return true;
+		case GL_INFO_LOG_LENGTH:
+			*data = 0;
+			return true;
+		default:
+			return false;
+	}
+}
+
+void ShaderCache::delete_shader(std::uint32_t shader) {
+	// a deleted shader lives on while it's attached, so a skipped one might still have to be compiled for a link
+	auto it = this->_shaders.find(shader);
+	if (it == this->_shaders.end()) {
+		return;
+	}
+
+	it->second.deleted = true;
+	this->release_shader(shader);
+}
+
+void ShaderCache::release_shader(std::uint32_t shader) {
+	auto it = this->_shaders.find(shader);
+	if (it == this->_shaders.end() || !it->second.deleted) {
+		return;
+	}
+
+	auto attached = std::any_of(this->_programs.begin(), this->_programs.end(), [shader](const auto& entry) {
+		const auto& shaders = entry.second.shaders;
+		return std::find(shaders.begin(), shaders.end(), shader) != shaders.end();
+	});
+
+	if (!attached) {
+		this->_shaders.erase(it);
+	}
+}
+
+void ShaderCache::create_program(std::uint32_t program) {
+	this->delete_program(program);
+}
+
+void ShaderCache::delete_program(std::uint32_t program) {
+	auto it = this->_programs.find(program);
+	if (it == this->_programs.end()) {
+		return;
+	}
+
+	auto shaders = std::move(it->second.shaders);
+	this->_programs.erase(it);
+
+	for (auto shader : shaders) {
+		this->release_shader(shader);
+	}
+}
+
+void ShaderCache::attach_shader(std::uint32_t program, std::uint32_t shader) {
+	auto& shaders = this->_programs[program].shaders;
+	if (std::find(shaders.begin(), shaders.end(), shader) == shaders.end()) {
+		shaders.push_back(shader);
+	}
+}
+
+void ShaderCache::detach_shader(std::uint32_t program, std::uint32_t shader) {
+	auto it = this->_programs.find(program);
+	if (it == this->_programs.end()) {
+		return;
+	}
+
+	auto& shaders = it->second.shaders;
+	shaders.erase(std::remove(shaders.begin(), shaders.end(), shader), shaders.end());
+
+	this->release_shader(shader);
+}
+
+void ShaderCache::bind_attrib_location(std::uint32_t program, std::uint32_t index, const char* name) {
+	if (name == nullptr) {
+		return;
+	}
+
+	auto& bindings = this->_programs[program].attrib_bindings;
+
+	auto it = std::find_if(bindings.begin(), bindings.end(), [name](const auto& binding) {
+		return binding.second == name;
+	});
+
+	if (it != bindings.end()) {
+		it->first = index;
+	} else {
+		bindings.emplace_back(index, name);
+	}
+}
+
+void ShaderCache::link_program(std::uint32_t program) {
+	this->load();
+
+	const auto& record = this->_programs[program];
+
+	auto key = this->program_key(record);
+	if (key != 0 && this->load_program(program, key)) {
+		return;
+	}
+
+	for (auto shader : record.shaders) {
+		this->compile_deferred(shader);
+	}
+
+	auto& ext = GlExtensions::get();
+	if (key != 0 && ext.program_parameteri != nullptr) {
+		ext.program_parameteri(program, GlExtensions::PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	glLinkProgram(program);
+
+	if (key == 0) {
+		return;
+	}
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+
+	if (status == GL_TRUE) {
+		this->store_program(program, key, record);
+	}
+}
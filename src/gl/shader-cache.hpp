@@ -0,0 +1,112 @@
+#pragma once
+
+#ifndef _GL_SHADER_CACHE_HPP
+#define _GL_SHADER_CACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * keeps linked programs around between launches.
+ *
+ * guest sources are translated for the host once per unique source, then hashed. programs are stored on disk
+ * with glGetProgramBinary, keyed by the hashes of their shaders, their attribute bindings and the driver.
+ * shaders that have been part of a cached program before aren't compiled when the guest asks,
+ * as the program binary makes it unnecessary. they're only compiled if loading the binary fails
+ */
+class ShaderCache {
+	struct ShaderRecord {
+		std::uint64_t hash{0u};
+
+		// the guest asked for a compile, but it was skipped
+		bool deferred{false};
+
+		// the guest deleted it while it was still attached, so it goes once nothing has it attached
+		bool deleted{false};
+	};
+
+	struct ProgramRecord {
+		std::vector<std::uint32_t> shaders{};
+		std::vector<std::pair<std::uint32_t, std::string>> attrib_bindings{};
+	};
+
+	std::filesystem::path _directory{};
+
+	// the cache is only read once the render thread has a context, as the driver is part of the key
+	bool _loaded{false};
+	bool _enabled{false};
+	std::uint64_t _driver_hash{0u};
+
+	std::unordered_map<std::uint64_t, std::string> _translations{};
+	std::unordered_set<std::uint64_t> _known_shaders{};
+
+	std::unordered_map<std::uint32_t, ShaderRecord> _shaders{};
+	std::unordered_map<std::uint32_t, ProgramRecord> _programs{};
+
+	void load();
+
+	/**
+	 * returns 0 if the program can't be cached
+	 */
+	std::uint64_t program_key(const ProgramRecord& program) const;
+	std::filesystem::path program_path(std::uint64_t key) const;
+
+	bool load_program(std::uint32_t program, std::uint64_t key);
+	void store_program(std::uint32_t program, std::uint64_t key, const ProgramRecord& record);
+
+	/**
+	 * forgets a deleted shader once no program has it attached anymore
+	 */
+	void release_shader(std::uint32_t shader);
+
+	/**
+	 * compiles a shader that was skipped, for when the program has to be linked after all
+	 */
+	void compile_deferred(std::uint32_t shader);
+
+	const std::string& translate(const std::string& source, std::uint64_t hash);
+
+public:
+	/**
+	 * sets where programs are stored. an empty path disables the disk cache
+	 */
+	void set_directory(const std::filesystem::path& directory);
+
+	/**
+	 * translates and passes along the source, the strings given are concatenated like the gl would
+	 */
+	void shader_source(std::uint32_t shader, const std::vector<std::string_view>& sources);
+
+	void compile_shader(std::uint32_t shader);
+
+	/**
+	 * answers queries about skipped shaders, returning false if the driver should be asked
+	 */
+	bool get_shader_iv(std::uint32_t shader, std::uint32_t name, std::int32_t* data);
+
+	void delete_shader(std::uint32_t shader);
+
+	/**
+	 * starts a program from nothing, as the driver can hand out the name of a deleted one again
+	 */
+	void create_program(std::uint32_t program);
+	void delete_program(std::uint32_t program);
+
+	void attach_shader(std::uint32_t program, std::uint32_t shader);
+	void detach_shader(std::uint32_t program, std::uint32_t shader);
+
+	/**
+	 * binding a name again replaces its old location, like it does for the driver
+	 */
+	void bind_attrib_location(std::uint32_t program, std::uint32_t index, const char* name);
+
+	void link_program(std::uint32_t program);
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "stream-buffer.hpp"
+
+#include <spdlog/spdlog.h>
+
+#ifdef SILENE_USE_EGL
+#include <GLES2/gl2.h>
+#else
+#include <glad/glad.h>
+#endif
+
+namespace {
+	// one second, anything longer means the gpu is hung and waiting won't help
+	constexpr std::uint64_t FENCE_TIMEOUT_NS = 1'000'000'000;
+}
+
+void StreamBuffer::init() {
+	auto& ext = GlExtensions::get();
+
+	glGenBuffers(1, &this->_buffer);
+	glBindBuffer(this->_target, this->_buffer);
+
+	if (ext.has_buffer_storage && ext.has_sync) {
+		constexpr auto flags = GlExtensions::MAP_WRITE_BIT | GlExtensions::MAP_PERSISTENT_BIT | GlExtensions::MAP_COHERENT_BIT;
+
+		ext.buffer_storage(this->_target, this->_size, nullptr, flags);
+		this->_mapping = reinterpret_cast<std::uint8_t*>(ext.map_buffer_range(this->_target, 0, this->_size, flags));
+
+		if (this->_mapping != nullptr) {
+			spdlog::debug("stream buffer {}: persistently mapped {} bytes", this->_buffer, this->_size);
+			return;
+		}
+
+		// immutable storage can't be respecified, so start over with a fresh buffer
+		spdlog::warn("stream buffer: persistent map failed, falling back to uploads");
+		glDeleteBuffers(1, &this->_buffer);
+		glGenBuffers(1, &this->_buffer);
+		glBindBuffer(this->_target, this->_buffer);
+	}
+
+	glBufferData(this->_target, this->_size, nullptr, GL_STREAM_DRAW);
+	this->_staging.resize(this->_size);
+}
+
+void StreamBuffer::fence_segment(std::uint32_t segment) {
+	auto& ext = GlExtensions::get();
+	if (this->_fences[segment] != nullptr) {
+		ext.delete_sync(this->_fences[segment]);
+	}
+
+	this->_fences[segment] = ext.fence_sync(GlExtensions::SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void StreamBuffer::wait_segment(std::uint32_t segment) {
+	auto fence = this->_fences[segment];
+	if (fence == nullptr) {
+		return;
+	}
+
+	auto& ext = GlExtensions::get();
+
+	// the cheap check first, so stalls can be counted
+	auto status = ext.client_wait_sync(fence, 0, 0);
+	if (status == GlExtensions::TIMEOUT_EXPIRED) {
+		this->_stalls++;
+		status = ext.client_wait_sync(fence, GlExtensions::SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+	}
+
+	if (status == GlExtensions::TIMEOUT_EXPIRED || status == GlExtensions::WAIT_FAILED) {
+		spdlog::warn("stream buffer {}: gave up waiting on segment {}", this->_buffer, segment);
+	}
+
+	ext.delete_sync(fence);
+	this->_fences[segment] = nullptr;
+}
+
+void StreamBuffer::advance_to(std::uint32_t segment) {
+	while (this->_current_segment != segment) {
+		this->fence_segment(this->_current_segment);
+
+		this->_current_segment = (this->_current_segment + 1) % SEGMENT_COUNT;
+		this->wait_segment(this->_current_segment);
+	}
+}
+
+void StreamBuffer::bind() {
+	if (this->_buffer == 0) {
+		this->init();
+		return;
+	}
+
+	glBindBuffer(this->_target, this->_buffer);
+}
+
+std::optional<StreamBuffer::Allocation> StreamBuffer::allocate(std::uint32_t size, std::uint32_t alignment) {
+	if (size == 0 || size > this->_segment_size) {
+		return std::nullopt;
+	}
+
+	auto offset = (this->_head + alignment - 1) & ~(alignment - 1);
+	auto wrapped = offset + size > this->_size;
+	if (wrapped) {
+		offset = 0;
+	}
+
+	if (this->is_persistent()) {
+		this->advance_to(offset / this->_segment_size);
+		this->advance_to((offset + size - 1) / this->_segment_size);
+	} else if (wrapped) {
+		// hand the old storage off to the driver, it'll free it once the gpu is done with it
+		glBufferData(this->_target, this->_size, nullptr, GL_STREAM_DRAW);
+	}
+
+	this->_head = offset + size;
+
+	auto base = this->is_persistent() ? this->_mapping : this->_staging.data();
+	return Allocation{offset, size, base + offset};
+}
+
+void StreamBuffer::flush(const Allocation& allocation) {
+	// coherent mappings are visible as soon as they're written
+	if (this->is_persistent()) {
+		return;
+	}
+
+	glBufferSubData(this->_target, allocation.offset, allocation.size, allocation.ptr);
+}
+
+StreamBuffer::StreamBuffer(std::uint32_t target, std::uint32_t size)
+	: _target{target}, _size{size}, _segment_size{size / SEGMENT_COUNT} {}
@@ -0,0 +1,96 @@
+#pragma once
+
+#ifndef _GL_STREAM_BUFFER_HPP
+#define _GL_STREAM_BUFFER_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "gl-extensions.hpp"
+
+/**
+ * ring of gpu memory for data that is only used once.
+ *
+ * when the context can do it, the ring is persistently mapped and split into segments guarded by fences,
+ * so writes go straight into gpu visible memory and only ever wait on work from a full lap ago.
+ * otherwise, writes are staged on the host and uploaded with glBufferSubData, orphaning the storage every lap
+ */
+class StreamBuffer {
+public:
+	static constexpr std::uint32_t SEGMENT_COUNT = 4;
+
+	struct Allocation {
+		std::uint32_t offset;
+		std::uint32_t size;
+
+		// where the data should be written to
+		std::uint8_t* ptr;
+	};
+
+private:
+	std::uint32_t _target;
+	std::uint32_t _size;
+	std::uint32_t _segment_size;
+
+	std::uint32_t _buffer{0u};
+	std::uint32_t _head{0u};
+	std::uint32_t _current_segment{0u};
+
+	// persistent mapping, or nullptr if writes go through _staging instead
+	std::uint8_t* _mapping{nullptr};
+	std::vector<std::uint8_t> _staging{};
+
+	std::array<GlExtensions::GlSync, SEGMENT_COUNT> _fences{};
+
+	// number of times a segment was still in use by the gpu when it came around again
+	std::uint32_t _stalls{0u};
+
+	void init();
+
+	void fence_segment(std::uint32_t segment);
+	void wait_segment(std::uint32_t segment);
+	void advance_to(std::uint32_t segment);
+
+public:
+	/**
+	 * binds the ring to its target, creating it if needed. must be done before allocate or flush
+	 */
+	void bind();
+
+	/**
+	 * reserves space in the ring, waiting for the gpu if that space is still in use
+	 * returns nothing if the request doesn't fit in a single segment
+	 */
+	std::optional<Allocation> allocate(std::uint32_t size, std::uint32_t alignment = 4);
+
+	/**
+	 * makes the written contents of an allocation visible to the gpu
+	 */
+	void flush(const Allocation& allocation);
+
+	std::uint32_t buffer() const {
+		return this->_buffer;
+	}
+
+	std::uint32_t segment_size() const {
+		return this->_segment_size;
+	}
+
+	bool is_persistent() const {
+		return this->_mapping != nullptr;
+	}
+
+	std::uint32_t stalls() const {
+		return this->_stalls;
+	}
+
+	// gl objects are left for the context to clean up, it's usually gone by the time this is destroyed
+	StreamBuffer(std::uint32_t target, std::uint32_t size);
+
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+};
+
+#endif
@@ -0,0 +1,432 @@
+#include "texture-uploader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <span>
+
+#include <spdlog/spdlog.h>
+
+#ifdef SILENE_USE_EGL
+#include <GLES2/gl2.h>
+#else
+#include <glad/glad.h>
+#endif
+
+#include "../environment.h"
+
+namespace {
+	/**
+	 * bytes per pixel of a format that gets converted, or 0 if it should go to the driver as is
+	 */
+	std::uint32_t source_pixel_size(std::uint32_t format, std::uint32_t type) {
+		switch (type) {
+			case GL_UNSIGNED_SHORT_4_4_4_4:
+			case GL_UNSIGNED_SHORT_5_5_5_1:
+				return format == GL_RGBA ? 2 : 0;
+			case GL_UNSIGNED_SHORT_5_6_5:
+				return format == GL_RGB ? 2 : 0;
+			case GL_UNSIGNED_BYTE:
+				switch (format) {
+					case GL_ALPHA:
+					case GL_LUMINANCE:
+						return 1;
+					case GL_LUMINANCE_ALPHA:
+						return 2;
+					case GL_RGB:
+						return 3;
+					default:
+						// rgba8 is what everything else is converted to
+						return 0;
+				}
+			default:
+				return 0;
+		}
+	}
+
+	constexpr std::uint32_t pack_rgba(std::uint32_t r, std::uint32_t g, std::uint32_t b, std::uint32_t a) {
+		return r | (g << 8) | (b << 16) | (a << 24);
+	}
+
+	// the loops below are kept branchless and without cross-pixel dependencies, so they vectorize
+
+	void convert_4444(const std::uint16_t* src, std::uint32_t* dst, std::uint32_t width) {
+		for (auto i = 0u; i < width; i++) {
+			std::uint32_t v = src[i];
+			dst[i] = pack_rgba(((v >> 12) & 0xf) * 17, ((v >> 8) & 0xf) * 17, ((v >> 4) & 0xf) * 17, (v & 0xf) * 17);
+		}
+	}
+
+	void convert_5551(const std::uint16_t* src, std::uint32_t* dst, std::uint32_t width) {
+		for (auto i = 0u; i < width; i++) {
+			std::uint32_t v = src[i];
+			std::uint32_t r = (v >> 11) & 0x1f;
+			std::uint32_t g = (v >> 6) & 0x1f;
+			std::uint32_t b = (v >> 1) & 0x1f;
+			dst[i] = pack_rgba((r << 3) | (r >> 2), (g << 3) | (g >> 2), (b << 3) | (b >> 2), (v & 1) * 0xff);
+		}
+	}
+
+	void convert_565(const std::uint16_t* src, std::uint32_t* dst, std::uint32_t width) {
+		for (auto i = 0u; i < width; i++) {
+			std::uint32_t v = src[i];
+			std::uint32_t r = (v >> 11) & 0x1f;
+			std::uint32_t g = (v >> 5) & 0x3f;
+			std::uint32_t b = v & 0x1f;
+			dst[i] = pack_rgba((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 0xff);
+		}
+	}
+
+	void convert_alpha(const std::uint8_t* src, std::uint32_t* dst, std::uint32_t width) {
+		for (auto i = 0u; i < width; i++) {
+			dst[i] = pack_rgba(0, 0, 0, src[i]);
+		}
+	}
+
+	void convert_luminance(const std::uint8_t* src, std::uint32_t* dst, std::uint32_t width) {
+		for (auto i = 0u; i < width; i++) {
+			std::uint32_t l = src[i];
+			dst[i] = pack_rgba(l, l, l, 0xff);
+		}
+	}
+
+	void convert_luminance_alpha(const std::uint8_t* src, std::uint32_t* dst, std::uint32_t width) {
+		for (auto i = 0u; i < width; i++) {
+			std::uint32_t l = src[i * 2];
+			dst[i] = pack_rgba(l, l, l, src[i * 2 + 1]);
+		}
+	}
+
+	void convert_rgb(const std::uint8_t* src, std::uint32_t* dst, std::uint32_t width) {
+		for (auto i = 0u; i < width; i++) {
+			dst[i] = pack_rgba(src[i * 3], src[i * 3 + 1], src[i * 3 + 2], 0xff);
+		}
+	}
+
+	/**
+	 * converts pixels into tightly packed rgba8. sampling the result gives the same values as the original format would
+	 */
+	void convert_pixels(std::uint32_t format, std::uint32_t type, const std::uint8_t* src, std::uint32_t src_stride, std::uint32_t width, std::uint32_t height, std::uint8_t* dst) {
+		for (auto y = 0u; y < height; y++) {
+			auto row = src + y * src_stride;
+			auto out = reinterpret_cast<std::uint32_t*>(dst) + y * width;
+
+			switch (type) {
+				case GL_UNSIGNED_SHORT_4_4_4_4:
+					convert_4444(reinterpret_cast<const std::uint16_t*>(row), out, width);
+					break;
+				case GL_UNSIGNED_SHORT_5_5_5_1:
+					convert_5551(reinterpret_cast<const std::uint16_t*>(row), out, width);
+					break;
+				case GL_UNSIGNED_SHORT_5_6_5:
+					convert_565(reinterpret_cast<const std::uint16_t*>(row), out, width);
+					break;
+				default:
+					switch (format) {
+						case GL_ALPHA:
+							convert_alpha(row, out, width);
+							break;
+						case GL_LUMINANCE:
+							convert_luminance(row, out, width);
+							break;
+						case GL_LUMINANCE_ALPHA:
+							convert_luminance_alpha(row, out, width);
+							break;
+						default:
+							convert_rgb(row, out, width);
+							break;
+					}
+					break;
+			}
+		}
+	}
+
+	/**
+	 * rgba8 rows are always 4 byte aligned, which only an alignment of 8 can disagree with
+	 */
+	class UnpackAlignmentGuard {
+		std::int32_t _alignment;
+
+	public:
+		UnpackAlignmentGuard(Environment& env) : _alignment{env.gl().unpack_alignment()} {
+			if (this->_alignment > 4) {
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			}
+		}
+
+		~UnpackAlignmentGuard() {
+			if (this->_alignment > 4) {
+				glPixelStorei(GL_UNPACK_ALIGNMENT, this->_alignment);
+			}
+		}
+	};
+}
+
+void TextureUploader::worker_loop() {
+	while (true) {
+		std::shared_ptr<Job> job;
+
+		{
+			std::unique_lock lk{this->_lock};
+			this->_queue_cv.wait(lk, [this] { return !this->_running || !this->_queue.empty(); });
+
+			if (!this->_running) {
+				return;
+			}
+
+			job = std::move(this->_queue.front());
+			this->_queue.pop_front();
+
+			if (job->cancelled) {
+				continue;
+			}
+		}
+
+		job->pixels.resize(job->width * job->height * 4);
+		convert_pixels(job->format, job->type, job->source.data(), job->source_stride, job->width, job->height, job->pixels.data());
+
+		std::vector<std::uint8_t>{}.swap(job->source);
+
+		{
+			std::scoped_lock lk{this->_lock};
+			job->done = true;
+		}
+
+		this->_done_cv.notify_all();
+	}
+}
+
+void TextureUploader::start_workers() {
+	auto count = std::clamp(std::thread::hardware_concurrency() / 4, 1u, MAX_WORKERS);
+
+	{
+		std::scoped_lock lk{this->_lock};
+		this->_running = true;
+	}
+
+	for (auto i = 0u; i < count; i++) {
+		this->_workers.emplace_back(&TextureUploader::worker_loop, this);
+	}
+
+	spdlog::debug("texture uploader: started {} workers", count);
+}
+
+void TextureUploader::submit(std::shared_ptr<Job> job) {
+	if (this->_workers.empty()) {
+		this->start_workers();
+	}
+
+	this->_pending.push_back(job);
+
+	{
+		std::scoped_lock lk{this->_lock};
+		this->_queue.push_back(std::move(job));
+	}
+
+	this->_queue_cv.notify_one();
+}
+
+void TextureUploader::wait(const std::shared_ptr<Job>& job) {
+	std::unique_lock lk{this->_lock};
+	this->_done_cv.wait(lk, [&job] { return job->done; });
+}
+
+void TextureUploader::upload(Environment& env, Job& job) {
+	auto& ext = GlExtensions::get();
+
+	env.gl_commands().flush();
+
+	glBindTexture(GL_TEXTURE_2D, job.texture);
+
+	UnpackAlignmentGuard alignment{env};
+
+	auto uploaded = false;
+	if (ext.has_pixel_buffer) {
+		this->_pixel_stream.bind();
+
+		if (auto allocation = this->_pixel_stream.allocate(job.pixels.size()); allocation) {
+			std::memcpy(allocation->ptr, job.pixels.data(), job.pixels.size());
+			this->_pixel_stream.flush(*allocation);
+
+			auto offset = static_cast<std::uintptr_t>(allocation->offset);
+			glTexSubImage2D(GL_TEXTURE_2D, job.level, 0, 0, job.width, job.height, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<void*>(offset));
+
+			uploaded = true;
+		}
+
+		glBindBuffer(GlExtensions::PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	if (!uploaded) {
+		glTexSubImage2D(GL_TEXTURE_2D, job.level, 0, 0, job.width, job.height, GL_RGBA, GL_UNSIGNED_BYTE, job.pixels.data());
+	}
+
+	glBindTexture(GL_TEXTURE_2D, this->_bound_2d[this->_active_unit]);
+}
+
+template <typename T>
+void TextureUploader::drain(Environment& env, T&& must_finish) {
+	if (this->_pending.empty()) {
+		return;
+	}
+
+	for (auto& job : this->_pending) {
+		bool done = false;
+		{
+			std::scoped_lock lk{this->_lock};
+			done = job->done;
+		}
+
+		if (!done && must_finish(*job)) {
+			this->wait(job);
+			this->_waits++;
+			done = true;
+		}
+
+		if (done) {
+			this->upload(env, *job);
+			job.reset();
+		}
+	}
+
+	std::erase(this->_pending, nullptr);
+}
+
+void TextureUploader::cancel(std::uint32_t texture, std::int32_t level) {
+	if (this->_pending.empty()) {
+		return;
+	}
+
+	std::erase_if(this->_pending, [this, texture, level](const auto& job) {
+		if (job->texture != texture || (level >= 0 && job->level != level)) {
+			return false;
+		}
+
+		std::scoped_lock lk{this->_lock};
+		job->cancelled = true;
+
+		return true;
+	});
+}
+
+bool TextureUploader::is_bound(std::uint32_t texture) const {
+	return std::find(this->_bound_2d.begin(), this->_bound_2d.end(), texture) != this->_bound_2d.end();
+}
+
+bool TextureUploader::tex_image_2d(Environment& env, std::uint32_t target, std::int32_t level, std::uint32_t width, std::uint32_t height, std::int32_t border, std::uint32_t format, std::uint32_t type, std::uint32_t data_ptr) {
+	if (target != GL_TEXTURE_2D) {
+		return false;
+	}
+
+	auto texture = this->_bound_2d[this->_active_unit];
+
+	// whatever was in flight is about to be replaced, whether or not the new image goes through here.
+	// otherwise the old pixels would land on top of it once the job finishes
+	this->cancel(texture, level);
+
+	// gles won't accept the converted data for anything but an rgba texture, and it can usually handle these formats anyways
+	if (border != 0 || width == 0 || height == 0 || GlExtensions::get().is_es) {
+		return false;
+	}
+
+	auto pixel_size = source_pixel_size(format, type);
+	if (pixel_size == 0) {
+		return false;
+	}
+
+	// everything from here on goes to the driver directly, so the guest's earlier calls have to get there first
+	env.gl_commands().flush();
+
+	if (data_ptr == 0) {
+		glTexImage2D(target, level, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		return true;
+	}
+
+	auto alignment = static_cast<std::uint32_t>(std::max(env.gl().unpack_alignment(), 1));
+	auto stride = (width * pixel_size + alignment - 1) / alignment * alignment;
+	auto source = env.memory_manager().read_bytes<std::uint8_t>(data_ptr);
+
+	// the default texture can't be rebound by name, so it's not worth the trouble
+	if (width * height < ASYNC_MIN_PIXELS || texture == 0) {
+		std::vector<std::uint8_t> pixels(width * height * 4);
+		convert_pixels(format, type, source, stride, width, height, pixels.data());
+
+		UnpackAlignmentGuard guard{env};
+		glTexImage2D(target, level, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+		return true;
+	}
+
+	// storage is made now, so size queries and framebuffer attachments work before the pixels arrive
+	glTexImage2D(target, level, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+	// the guest is free to reuse its memory once this returns, so the pixels have to be copied out now
+	auto job = std::make_shared<Job>(Job{texture, level, width, height, format, type});
+	job->source.assign(source, source + stride * (height - 1) + width * pixel_size);
+	job->source_stride = stride;
+
+	this->submit(std::move(job));
+	this->_deferred_uploads++;
+
+	return true;
+}
+
+void TextureUploader::active_texture(std::uint32_t texture) {
+	auto unit = texture - GL_TEXTURE0;
+	if (unit < MAX_TEXTURE_UNITS) {
+		this->_active_unit = unit;
+	}
+}
+
+void TextureUploader::bind_texture(std::uint32_t target, std::uint32_t texture) {
+	if (target == GL_TEXTURE_2D) {
+		this->_bound_2d[this->_active_unit] = texture;
+	}
+}
+
+void TextureUploader::delete_textures(std::uint32_t n, const std::uint32_t* textures) {
+	for (auto texture : std::span{textures, n}) {
+		if (texture == 0) {
+			continue;
+		}
+
+		this->cancel(texture, -1);
+
+		// deleting a texture unbinds it everywhere
+		std::replace(this->_bound_2d.begin(), this->_bound_2d.end(), texture, 0u);
+	}
+}
+
+void TextureUploader::before_draw(Environment& env) {
+	this->drain(env, [this](const Job& job) {
+		return this->is_bound(job.texture);
+	});
+}
+
+void TextureUploader::begin_frame(Environment& env) {
+	this->drain(env, [](const Job&) {
+		return false;
+	});
+
+	this->_deferred_last_frame = this->_deferred_uploads;
+	this->_deferred_uploads = 0;
+
+	this->_waits_last_frame = this->_waits;
+	this->_waits = 0;
+}
+
+TextureUploader::~TextureUploader() {
+	{
+		std::scoped_lock lk{this->_lock};
+		if (!this->_running) {
+			return;
+		}
+
+		this->_running = false;
+	}
+
+	this->_queue_cv.notify_all();
+
+	for (auto& worker : this->_workers) {
+		worker.join();
+	}
+}
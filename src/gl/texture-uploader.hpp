@@ -0,0 +1,149 @@
+#pragma once
+
+#ifndef _GL_TEXTURE_UPLOADER_HPP
+#define _GL_TEXTURE_UPLOADER_HPP
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "stream-buffer.hpp"
+
+class Environment;
+
+/**
+ * takes texture uploads off of the render thread.
+ *
+ * desktop drivers tend to convert the 16 bit and single channel formats that games like on the cpu, slowly.
+ * instead, every upload in one of those formats is converted to rgba8 here. big textures get their storage
+ * allocated immediately, then the guest pixels are copied and handed to a worker for conversion.
+ * the converted result is uploaded through a pixel buffer the next time the render thread comes by,
+ * or right before a draw that could sample from it.
+ */
+class TextureUploader {
+public:
+	static constexpr std::uint32_t MAX_TEXTURE_UNITS = 32;
+
+	// anything smaller than this is converted on the spot, it's not worth the trip to a worker
+	static constexpr std::uint32_t ASYNC_MIN_PIXELS = 128 * 128;
+
+	// 16mb, so a 1024x1024 rgba8 texture fits in a segment
+	static constexpr std::uint32_t PIXEL_BUFFER_SIZE = 16 * 1024 * 1024;
+
+	static constexpr std::uint32_t MAX_WORKERS = 2;
+
+private:
+	struct Job {
+		std::uint32_t texture;
+		std::int32_t level;
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t format;
+		std::uint32_t type;
+
+		// guest pixels, rows are as far apart as the unpack alignment asked for
+		std::vector<std::uint8_t> source{};
+		std::uint32_t source_stride{0u};
+
+		std::vector<std::uint8_t> pixels{};
+
+		// guarded by the uploader's lock
+		bool done{false};
+		bool cancelled{false};
+	};
+
+	std::mutex _lock{};
+	std::condition_variable _queue_cv{};
+	std::condition_variable _done_cv{};
+
+	std::deque<std::shared_ptr<Job>> _queue{};
+	std::vector<std::thread> _workers{};
+	bool _running{false};
+
+	// only ever touched on the render thread
+	std::vector<std::shared_ptr<Job>> _pending{};
+
+	std::uint32_t _active_unit{0u};
+	std::array<std::uint32_t, MAX_TEXTURE_UNITS> _bound_2d{};
+
+	StreamBuffer _pixel_stream{GlExtensions::PIXEL_UNPACK_BUFFER, PIXEL_BUFFER_SIZE};
+
+	std::uint32_t _deferred_uploads{0u};
+	std::uint32_t _deferred_last_frame{0u};
+
+	std::uint32_t _waits{0u};
+	std::uint32_t _waits_last_frame{0u};
+
+	void worker_loop();
+	void start_workers();
+
+	void submit(std::shared_ptr<Job> job);
+
+	/**
+	 * blocks until a worker has finished with the job
+	 */
+	void wait(const std::shared_ptr<Job>& job);
+
+	/**
+	 * gives the converted pixels to the driver. the job must be done
+	 */
+	void upload(Environment& env, Job& job);
+
+	/**
+	 * uploads every finished job, and waits on the ones matching the predicate
+	 */
+	template <typename T>
+	void drain(Environment& env, T&& must_finish);
+
+	/**
+	 * stops a job for the given texture from overwriting it later
+	 */
+	void cancel(std::uint32_t texture, std::int32_t level);
+
+	/**
+	 * whether any unit has the texture bound, which means a draw could sample from it
+	 */
+	bool is_bound(std::uint32_t texture) const;
+
+public:
+	/**
+	 * handles a glTexImage2D, returning true if the driver shouldn't see it
+	 */
+	bool tex_image_2d(Environment& env, std::uint32_t target, std::int32_t level, std::uint32_t width, std::uint32_t height, std::int32_t border, std::uint32_t format, std::uint32_t type, std::uint32_t data_ptr);
+
+	/**
+	 * these mirror the guest's bindings, which have to be put back after an upload
+	 */
+	void active_texture(std::uint32_t texture);
+	void bind_texture(std::uint32_t target, std::uint32_t texture);
+
+	void delete_textures(std::uint32_t n, const std::uint32_t* textures);
+
+	/**
+	 * finishes every upload that the next draw could sample from
+	 */
+	void before_draw(Environment& env);
+
+	void begin_frame(Environment& env);
+
+	std::uint32_t deferred_last_frame() const {
+		return this->_deferred_last_frame;
+	}
+
+	std::uint32_t waits_last_frame() const {
+		return this->_waits_last_frame;
+	}
+
+	TextureUploader() = default;
+	~TextureUploader();
+
+	TextureUploader(const TextureUploader&) = delete;
+	TextureUploader& operator=(const TextureUploader&) = delete;
+};
+
+#endif
@@ -1,10 +1,14 @@
 #include "glfw-window.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <imgui.h>
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_opengl3.h>
 
 #include "android-application.hpp"
+#include "gl/gl-extensions.hpp"
 
 void GlfwAppWindow::glfw_error_callback(int error, const char* description) {
 	spdlog::error("GLFW Error: {}", description);
@@ -20,20 +24,20 @@ void GlfwAppWindow::glfw_mouse_callback(GLFWwindow* window, int button, int acti
 	double xpos, ypos;
 	glfwGetCursorPos(window, &xpos, &ypos);
 
-	env->application().send_touch(action == GLFW_PRESS, {
+	env->_emulation.send_touch(action == GLFW_PRESS, {
 		1,
-		static_cast<float>(xpos * env->_scale_x),
-		static_cast<float>(ypos * env->_scale_y)
+		static_cast<float>(xpos * env->_scale_x * env->_config.render_scale),
+		static_cast<float>(ypos * env->_scale_y * env->_config.render_scale)
 	});
 }
 
 void GlfwAppWindow::glfw_mouse_move_callback(GLFWwindow* window, double xpos, double ypos) {
 	auto env = reinterpret_cast<GlfwAppWindow*>(glfwGetWindowUserPointer(window));
-	env->application().move_touches({{
+	env->_emulation.move_touch({
 		1,
-		static_cast<float>(xpos * env->_scale_x),
-		static_cast<float>(ypos * env->_scale_y)
-	}});
+		static_cast<float>(xpos * env->_scale_x * env->_config.render_scale),
+		static_cast<float>(ypos * env->_scale_y * env->_config.render_scale)
+	});
 }
 
 void GlfwAppWindow::glfw_key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
@@ -43,10 +47,11 @@ void GlfwAppWindow::glfw_key_callback(GLFWwindow* window, int key, int scancode,
 			if (auto touch = keybind_manager->handle(key_name)) {
 				auto [x, y] = touch.value();
 
-				env->application().send_touch(action == GLFW_PRESS, {
+				// keybinds are in window pixels, like the cursor position shown in the overlay
+				env->_emulation.send_touch(action == GLFW_PRESS, {
 					1,
-					static_cast<float>(x),
-					static_cast<float>(y)
+					static_cast<float>(x * env->_config.render_scale),
+					static_cast<float>(y * env->_config.render_scale)
 				});
 
 				return;
@@ -61,13 +66,13 @@ void GlfwAppWindow::glfw_key_callback(GLFWwindow* window, int key, int scancode,
 
 	switch (key) {
 		case GLFW_KEY_BACKSPACE:
-			env->application().send_ime_delete();
+			env->_emulation.send_ime_delete();
 			break;
 		case GLFW_KEY_ESCAPE:
-			env->application().send_keydown(4 /* AKEYCODE_BACK */);
+			env->_emulation.send_keydown(4 /* AKEYCODE_BACK */);
 			break;
 		case GLFW_KEY_SPACE:
-			env->application().send_ime_insert(" ");
+			env->_emulation.send_ime_insert(" ");
 			break;
 		default: {
 			auto key_name = glfwGetKeyName(key, scancode);
@@ -75,7 +80,7 @@ void GlfwAppWindow::glfw_key_callback(GLFWwindow* window, int key, int scancode,
 				break;
 			}
 
-			env->application().send_ime_insert(key_name);
+			env->_emulation.send_ime_insert(key_name);
 			break;
 		}
 	}
@@ -119,8 +124,27 @@ bool GlfwAppWindow::init() {
 		}
 	}
 
+	// the guest renders on a context of its own that shares the window's objects
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	_emulation_window = glfwCreateWindow(1, 1, "", nullptr, window);
+	if (!_emulation_window) {
+		spdlog::error("failed to create the emulation context");
+		return false;
+	}
+
 	glfwMakeContextCurrent(window);
-	glfwSwapInterval(1);
+
+	auto swap_interval = _pacer.swap_interval();
+	if (swap_interval < 0 && !glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+		spdlog::info("adaptive vsync is not supported, using regular vsync");
+		swap_interval = 1;
+	}
+
+	glfwSwapInterval(swap_interval);
+
+	if (auto mode = glfwGetVideoMode(glfwGetPrimaryMonitor()); mode != nullptr) {
+		_pacer.set_refresh_rate(mode->refreshRate);
+	}
 
 #ifndef SILENE_USE_EGL
 	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
@@ -129,6 +153,8 @@ bool GlfwAppWindow::init() {
 	}
 #endif
 
+	GlExtensions::load(reinterpret_cast<GlExtensions::ProcLoader>(glfwGetProcAddress));
+
 	auto vendor = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
 	auto renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
 	auto version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
@@ -164,32 +190,27 @@ bool GlfwAppWindow::init() {
 void GlfwAppWindow::main_loop() {
 	int width, height;
 	glfwGetFramebufferSize(_window, &width, &height);
-	application().init_game(width, height);
+
+	auto render_width = std::max(static_cast<int>(std::lround(width * _config.render_scale)), 1);
+	auto render_height = std::max(static_cast<int>(std::lround(height * _config.render_scale)), 1);
+
+	application().frame_chain().set_filter(_config.upscale_filter);
+
+	// the game runs on its own thread from here on, this one only handles events and presents
+	_emulation.start(render_width, render_height, [this]() {
+		glfwMakeContextCurrent(_emulation_window);
+	}, []() {
+		glfwMakeContextCurrent(nullptr);
+	});
 
 	// this prevents issues if callbacks happen pre-init
 	glfwSetMouseButtonCallback(_window, &glfw_mouse_callback);
 	glfwSetCursorPosCallback(_window, &glfw_mouse_move_callback);
 	glfwSetKeyCallback(_window, &glfw_key_callback);
 
-	auto last_time = glfwGetTime();
-	auto last_update_time = glfwGetTime();
-	auto accumulated_time = 0.0f;
+	_pacer.start();
 
 	while (!glfwWindowShouldClose(_window)) {
-		auto current_time = glfwGetTime();
-    auto dt = current_time - last_time;
-
-		last_time = current_time;
-    accumulated_time += dt;
-
-		if (accumulated_time < (1.0 / 60.0)) {
-			continue;
-		}
-
-		auto update_dt = current_time - last_update_time;
-    last_update_time = current_time;
-    accumulated_time = 0.0f;
-
 		glfwPollEvents();
 
 		ImGui_ImplOpenGL3_NewFrame();
@@ -198,7 +219,7 @@ void GlfwAppWindow::main_loop() {
 
 		ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_Always, ImVec2(0.0f, 0.0f));
 		if (ImGui::Begin("Info Dialog", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_AlwaysAutoResize)) {
-			ImGui::Text("FPS: %.0f", 1.0/update_dt);
+			draw_frame_info(_emulation.last_frame(), _pacer.frame_times());
 
 			if (_config.show_cursor_pos) {
 				double xpos, ypos;
@@ -213,22 +234,34 @@ void GlfwAppWindow::main_loop() {
 
 		ImGui::Render();
 
-		application().draw_frame();
+		int display_width, display_height;
+		glfwGetFramebufferSize(_window, &display_width, &display_height);
+		application().frame_chain().present(display_width, display_height);
 
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
 		glfwSwapBuffers(_window);
+
+		_pacer.wait();
 	}
 
+	auto frame_times = _pacer.frame_times();
+	spdlog::info("present times: median {:.2f}ms, p95 {:.2f}ms, p99 {:.2f}ms, max {:.2f}ms", frame_times.median, frame_times.p95, frame_times.p99, frame_times.max);
+
+	_emulation.stop();
+	application().frame_chain().destroy_present();
+
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
 
+	glfwDestroyWindow(_emulation_window);
 	glfwDestroyWindow(_window);
 	glfwTerminate();
 
 	_window = nullptr;
+	_emulation_window = nullptr;
 }
 
 GlfwAppWindow::GlfwAppWindow(AndroidApplication& app, WindowConfig config)
-	: BaseWindow(app), _config{config} {}
+	: BaseWindow(app), _config{config}, _pacer{config.pacing}, _emulation{app} {}
@@ -13,6 +13,8 @@
 #include <GLFW/glfw3.h>
 
 #include "base-window.hpp"
+#include "emulation-thread.hpp"
+#include "frame-pacer.hpp"
 #include "keybind-manager.hpp"
 
 class AndroidApplication;
@@ -22,9 +24,16 @@ class GlfwAppWindow : public BaseWindow {
 		bool show_cursor_pos{false};
 		std::string keybind_file{};
 		std::string title_name{};
+
+		// size the guest renders at, relative to the window
+		float render_scale{1.0f};
+		FrameChain::Filter upscale_filter{FrameChain::Filter::Bilinear};
+
+		FramePacer::Config pacing{};
 	};
 
 	WindowConfig _config;
+	FramePacer _pacer;
 
 	float _scale_x{1.0f};
 	float _scale_y{1.0f};
@@ -33,6 +42,11 @@ class GlfwAppWindow : public BaseWindow {
 
 	GLFWwindow* _window{nullptr};
 
+	// never shown, the guest's context needs a window to be current with
+	GLFWwindow* _emulation_window{nullptr};
+
+	EmulationThread _emulation;
+
 	static void glfw_error_callback(int, const char*);
 	static void glfw_mouse_callback(GLFWwindow*, int, int, int);
 	static void glfw_mouse_move_callback(GLFWwindow*, double, double);
@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <CLI/CLI.hpp>
+#include <spdlog/spdlog.h>
+
+#ifdef SILENE_USE_EGL
+#include <GLES2/gl2.h>
+#else
+#include <glad/glad.h>
+#include "gl/null-gl.hpp"
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include "gl/gl-extensions.hpp"
+#include "gl/gl-replay.hpp"
+
+namespace {
+	enum class Backend {
+		Window,
+		Null,
+	};
+
+	struct FrameTiming {
+		std::uint32_t calls;
+
+		// time spent making the calls, then the time until the gpu was done with them
+		std::uint64_t submit_ns;
+		std::uint64_t total_ns;
+	};
+
+	std::uint64_t elapsed_ns(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	}
+
+	double percentile_ms(std::vector<std::uint64_t>& values, double p) {
+		auto index = static_cast<std::size_t>(p * (values.size() - 1));
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[index] / 1e6;
+	}
+
+	void glfw_error_callback(int error, const char* description) {
+		spdlog::error("glfw error {}: {}", error, description);
+	}
+
+	/**
+	 * a hidden window, as the replay draws offscreen anyways. this is only here for the context
+	 */
+	GLFWwindow* create_window() {
+		glfwSetErrorCallback(glfw_error_callback);
+
+#if defined(__APPLE__) && defined(SILENE_USE_ANGLE)
+		glfwInitHint(GLFW_ANGLE_PLATFORM_TYPE, GLFW_ANGLE_PLATFORM_TYPE_METAL);
+#endif
+
+		if (!glfwInit()) {
+			return nullptr;
+		}
+
+#ifdef SILENE_USE_EGL
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_ES_API);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+#else
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+#endif
+
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+		auto window = glfwCreateWindow(1, 1, "silene-glreplay", nullptr, nullptr);
+		if (!window) {
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_NATIVE_CONTEXT_API);
+			window = glfwCreateWindow(1, 1, "silene-glreplay", nullptr, nullptr);
+		}
+
+		if (!window) {
+			glfwTerminate();
+			return nullptr;
+		}
+
+		glfwMakeContextCurrent(window);
+
+#ifndef SILENE_USE_EGL
+		if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+			spdlog::error("Failed to initialize GLAD");
+			return nullptr;
+		}
+#endif
+
+		GlExtensions::load(reinterpret_cast<GlExtensions::ProcLoader>(glfwGetProcAddress));
+
+		return window;
+	}
+}
+
+int main(int argc, char** argv) {
+	CLI::App app{"replays a gl trace recorded with --gl-trace, as fast as possible"};
+	argv = app.ensure_utf8(argv);
+
+	std::string trace_path;
+	app.add_option("trace", trace_path, "path to the trace to replay")
+		->check(CLI::ExistingFile)
+		->required();
+
+	bool verbose = false;
+	app.add_flag("-v,--verbose", verbose, "enable extra debug logging");
+
+	auto backend = Backend::Window;
+	std::map<std::string, Backend> backend_names{
+		{"window", Backend::Window},
+		{"null", Backend::Null},
+	};
+	app.add_option("--gl", backend, "gl implementation to replay on. null measures the replay itself, without a driver")
+		->transform(CLI::CheckedTransformer(backend_names, CLI::ignore_case));
+
+	bool no_finish = false;
+	app.add_flag("--no-finish", no_finish, "don't wait for the gpu after every frame, so only the time spent submitting is measured");
+
+	std::string csv_path{};
+	app.add_option("--csv", csv_path, "path to write per frame timings to");
+
+	CLI11_PARSE(app, argc, argv);
+
+	if (verbose) {
+		spdlog::set_level(spdlog::level::debug);
+	}
+
+	GlReplay replay{};
+	if (!replay.load(trace_path)) {
+		return 1;
+	}
+
+	const auto& header = replay.header();
+	spdlog::info("trace has {} frames at {}x{}", replay.frame_count(), header.width, header.height);
+
+	GLFWwindow* window = nullptr;
+	if (backend == Backend::Null) {
+#ifdef SILENE_USE_EGL
+		spdlog::error("the null backend is only available with desktop gl");
+		return 1;
+#else
+		if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(NullGl::get_proc_address))) {
+			spdlog::error("Failed to initialize GLAD");
+			return 1;
+		}
+
+		GlExtensions::load(reinterpret_cast<GlExtensions::ProcLoader>(NullGl::get_proc_address));
+#endif
+	} else {
+		window = create_window();
+		if (window == nullptr) {
+			spdlog::critical("failed to create a context");
+			return 1;
+		}
+	}
+
+	auto vendor = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
+	auto renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+	auto version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+	spdlog::info("gl information: {} ({}) - {}", renderer, vendor, version);
+
+	if (!replay.create_screen()) {
+		return 1;
+	}
+
+	// setup is mostly shader compiles and texture uploads, which would swamp the frames
+	auto setup_start = std::chrono::steady_clock::now();
+	auto setup_calls = replay.run_setup();
+	glFinish();
+	auto setup_ns = elapsed_ns(setup_start, std::chrono::steady_clock::now());
+
+	spdlog::info("setup: {} calls in {:.2f}ms", setup_calls, setup_ns / 1e6);
+
+	std::vector<FrameTiming> timings{};
+	timings.reserve(replay.frame_count());
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (auto frame = 0u; frame < replay.frame_count(); frame++) {
+		auto frame_start = std::chrono::steady_clock::now();
+		auto calls = replay.run_frame(frame);
+		auto submitted = std::chrono::steady_clock::now();
+
+		if (!no_finish) {
+			glFinish();
+		}
+
+		auto finished = std::chrono::steady_clock::now();
+		timings.push_back({calls, elapsed_ns(frame_start, submitted), elapsed_ns(frame_start, finished)});
+	}
+
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (timings.empty()) {
+		spdlog::warn("trace has no frames to time");
+		return 0;
+	}
+
+	std::vector<std::uint64_t> submit{};
+	std::vector<std::uint64_t> total{};
+	auto calls = 0ull;
+
+	for (const auto& timing : timings) {
+		submit.push_back(timing.submit_ns);
+		total.push_back(timing.total_ns);
+		calls += timing.calls;
+	}
+
+	auto frames = timings.size();
+
+	spdlog::info("replayed {} frames in {:.2f}s ({:.1f} fps), {:.0f} calls per frame", frames, elapsed, frames / elapsed, static_cast<double>(calls) / frames);
+	spdlog::info("submit: median {:.3f}ms, p95 {:.3f}ms, p99 {:.3f}ms, max {:.3f}ms",
+		percentile_ms(submit, 0.5), percentile_ms(submit, 0.95), percentile_ms(submit, 0.99), percentile_ms(submit, 1.0));
+
+	if (!no_finish) {
+		spdlog::info("frame: median {:.3f}ms, p95 {:.3f}ms, p99 {:.3f}ms, max {:.3f}ms",
+			percentile_ms(total, 0.5), percentile_ms(total, 0.95), percentile_ms(total, 0.99), percentile_ms(total, 1.0));
+	}
+
+#ifndef SILENE_USE_EGL
+	if (backend == Backend::Null) {
+		const auto& counters = NullGl::counters();
+		spdlog::info("null gl: {} calls, {} draws ({} vertices), {} buffer bytes, {} texture bytes, {} errors",
+			counters.calls, counters.draw_calls, counters.vertices, counters.buffer_bytes, counters.texture_bytes, counters.errors);
+	}
+#endif
+
+	if (!csv_path.empty()) {
+		std::ofstream csv(csv_path, std::ios::out | std::ios::trunc);
+		if (!csv) {
+			spdlog::warn("failed to open timings file at {}", csv_path);
+		} else {
+			csv << "frame,calls,submit_ns,total_ns\n";
+			for (auto i = 0u; i < timings.size(); i++) {
+				csv << i << ',' << timings[i].calls << ',' << timings[i].submit_ns << ',' << timings[i].total_ns << '\n';
+			}
+		}
+	}
+
+	if (window != nullptr) {
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+
+	return 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#ifndef _GUEST_CLOCK_HPP
+#define _GUEST_CLOCK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+
+/**
+ * the time the guest sees. normally this is just the host's clock, but it can be switched over to virtual time
+ * that only moves when the host moves it. the game then sees the same time pass every frame no matter how long
+ * the frame really took, which keeps runs comparable to each other
+ */
+class GuestClock {
+	static constexpr std::int64_t NS_PER_SECOND = 1'000'000'000;
+
+	std::atomic<bool> _virtual{false};
+
+	// host time when virtual time was started, which it counts on from
+	std::timespec _realtime_start{};
+	std::timespec _monotonic_start{};
+
+	std::atomic<std::int64_t> _elapsed_ns{0};
+
+	static std::timespec host_time(bool realtime) {
+		std::timespec ts{};
+		clock_gettime(realtime ? CLOCK_REALTIME : CLOCK_MONOTONIC, &ts);
+		return ts;
+	}
+
+	static std::int64_t to_ns(const std::timespec& ts) {
+		return static_cast<std::int64_t>(ts.tv_sec) * NS_PER_SECOND + ts.tv_nsec;
+	}
+
+	static std::timespec from_ns(std::int64_t ns) {
+		std::timespec ts{};
+		ts.tv_sec = static_cast<decltype(ts.tv_sec)>(ns / NS_PER_SECOND);
+		ts.tv_nsec = static_cast<decltype(ts.tv_nsec)>(ns % NS_PER_SECOND);
+		return ts;
+	}
+
+public:
+	/**
+	 * stops the clock at the current host time. from here on it only moves through advance
+	 */
+	void use_virtual_time() {
+		this->_realtime_start = host_time(true);
+		this->_monotonic_start = host_time(false);
+		this->_elapsed_ns = 0;
+
+		this->_virtual.store(true, std::memory_order_release);
+	}
+
+	bool is_virtual() const {
+		return this->_virtual.load(std::memory_order_acquire);
+	}
+
+	void advance(std::chrono::nanoseconds amount) {
+		this->_elapsed_ns.fetch_add(amount.count(), std::memory_order_relaxed);
+	}
+
+	/**
+	 * the current time, as the realtime or monotonic clock
+	 */
+	std::timespec now(bool realtime) const {
+		if (!this->is_virtual()) {
+			return host_time(realtime);
+		}
+
+		const auto& start = realtime ? this->_realtime_start : this->_monotonic_start;
+		return from_ns(to_ns(start) + this->_elapsed_ns.load(std::memory_order_relaxed));
+	}
+
+	/**
+	 * turns an absolute guest time into the host time that's just as far away, for waiting on.
+	 * without virtual time the two are the same
+	 */
+	std::timespec to_host(const std::timespec& time, bool realtime) const {
+		if (!this->is_virtual()) {
+			return time;
+		}
+
+		auto remaining = to_ns(time) - to_ns(this->now(realtime));
+		return from_ns(to_ns(host_time(realtime)) + remaining);
+	}
+};
+
+#endif
@@ -0,0 +1,170 @@
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+
+#include <CLI/CLI.hpp>
+#include <spdlog/spdlog.h>
+
+#include "headless-window.h"
+#include "android-application.hpp"
+#include "elf.h"
+#include "zip-file.h"
+
+int main(int argc, char** argv) {
+	CLI::App app;
+	argv = app.ensure_utf8(argv);
+
+	std::string app_apk;
+	app.add_option("apk", app_apk, "path to apk file to use for libraries")
+		->check(CLI::ExistingFile)
+		->required();
+
+	bool verbose = false;
+	app.add_flag("-v,--verbose", verbose, "enable extra debug logging");
+
+	bool enable_debugging = false;
+	app.add_flag("-d,--debug", enable_debugging, "enables debugging through gdb on port 5039");
+
+	std::string app_resources{};
+	app.add_option("--resources", app_resources, "Determines the APK file to use for resources. If left blank, the main APK file is used")
+		->check(CLI::ExistingFile);
+
+	std::string support_dir = "./support/";
+	app.add_option("--link", support_dir, "path to load support binaries from")
+		->capture_default_str()
+		->check(CLI::ExistingDirectory);
+
+	std::uint32_t worker_threads = 0;
+	app.add_option("--threads", worker_threads, "maximum number of guest threads that can run at once. if 0, uses the number of host cores");
+
+	std::string shader_cache_dir = "./shader-cache/";
+	app.add_option("--shader-cache", shader_cache_dir, "path to store compiled shaders in. if empty, shaders are compiled every launch")
+		->capture_default_str();
+
+	std::string frame_log_path{};
+	app.add_option("--frame-log", frame_log_path, "path to write per frame gl stats to, as csv");
+
+	std::string gl_trace_path{};
+	app.add_option("--gl-trace", gl_trace_path, "path to record the game's gl calls to, for replaying with silene-glreplay");
+
+	std::uint32_t gl_trace_frames = 600;
+	app.add_option("--gl-trace-frames", gl_trace_frames, "number of frames to record with --gl-trace")
+		->capture_default_str();
+
+	bool coalesce_draws = false;
+	app.add_flag("--coalesce-draws", coalesce_draws, "merge consecutive draws that share state into one. mostly helps games drawing sprites one at a time");
+
+	std::string record_path{};
+	auto record_option = app.add_option("--record", record_path, "path to record the time, random numbers, socket results and input to, so the session can be played back exactly with --replay");
+
+	std::string replay_path{};
+	app.add_option("--replay", replay_path, "path to a session recorded with --record to play back. input from the frontend is ignored while replaying")
+		->check(CLI::ExistingFile)
+		->excludes(record_option);
+
+	std::uint32_t frames = 600;
+	app.add_option("--frames", frames, "number of frames to run before exiting")
+		->capture_default_str();
+
+	std::uint32_t width = 1280;
+	app.add_option("--width", width, "width of the guest's framebuffer")
+		->capture_default_str();
+
+	std::uint32_t height = 720;
+	app.add_option("--height", height, "height of the guest's framebuffer")
+		->capture_default_str();
+
+	auto backend = HeadlessAppWindow::Backend::Null;
+	std::map<std::string, HeadlessAppWindow::Backend> backend_names{
+		{"null", HeadlessAppWindow::Backend::Null},
+		{"egl", HeadlessAppWindow::Backend::Egl},
+		{"software", HeadlessAppWindow::Backend::Software},
+	};
+	app.add_option("--gl", backend, "gl implementation to render with. null skips rendering entirely, software uses egl with llvmpipe")
+		->transform(CLI::CheckedTransformer(backend_names, CLI::ignore_case));
+
+	CLI11_PARSE(app, argc, argv);
+
+	if (app_resources.empty()) {
+		app_resources = app_apk;
+	}
+
+	if (verbose) {
+		spdlog::set_level(spdlog::level::debug);
+	}
+
+	AndroidApplication application{{enable_debugging, app_resources, worker_threads, shader_cache_dir, frame_log_path, gl_trace_path, gl_trace_frames, coalesce_draws, record_path, replay_path}};
+
+	ZipFile apk_file{app_apk};
+
+	std::string lib_path;
+	if (apk_file.has_file("lib/armeabi-v7a/libgame.so")) {
+		lib_path = "lib/armeabi-v7a/libgame.so";
+	} else if (apk_file.has_file("lib/armeabi-v7a/libcocos2dcpp.so")) {
+		lib_path = "lib/armeabi-v7a/libcocos2dcpp.so";
+	} else if (apk_file.has_file("lib/armeabi/libgame.so")) {
+		lib_path = "lib/armeabi/libgame.so"; // pre 1.6 only has armv5
+	} else {
+		spdlog::error("apk is missing library for a supported architecture");
+		return 1;
+	}
+
+	auto main_lib = apk_file.read_file_bytes(lib_path);
+
+	auto elf = Elf::File(std::move(main_lib));
+
+	std::filesystem::path support_path{support_dir};
+
+	/*
+	auto libc_path = support_path / "libc.so";
+	auto libc = Elf::File(libc_path.string());
+	*/
+
+	auto zlib_path = support_path / "libz.so";
+	auto zlib = Elf::File(zlib_path.string());
+
+	HeadlessAppWindow window{application, {
+		.backend = backend,
+		.width = width,
+		.height = height,
+		.frames = frames
+	}};
+
+	if (!window.init()) {
+		spdlog::critical("failed to init window");
+		return 1;
+	}
+
+	application.init();
+
+	/*
+	env.set_assets_dir(resources_dir);
+	*/
+
+	/*
+	env.program_loader().map_elf(libc);
+	env.post_load();
+	*/
+
+	application.load_library(zlib);
+	application.load_library(elf);
+
+	application.finalize_libraries();
+
+	spdlog::info("init fns done");
+
+	// order of fns:
+	// JNI_OnLoad
+	// Java_org_cocos2dx_lib_Cocos2dxHelper_nativeSetApkPath
+	// Java_org_cocos2dx_lib_Cocos2dxRenderer_nativeInit
+
+	spdlog::info("beginning JNI init");
+
+	application.init_jni();
+
+	window.main_loop();
+
+	return 0;
+}
+
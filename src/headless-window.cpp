@@ -0,0 +1,223 @@
+#include "headless-window.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#include <spdlog/spdlog.h>
+
+#ifdef SILENE_HEADLESS_EGL
+#include <EGL/eglext.h>
+#endif
+
+#include "android-application.hpp"
+#include "gl/gl-extensions.hpp"
+#include "gl/null-gl.hpp"
+
+#ifdef SILENE_HEADLESS_EGL
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+bool HeadlessAppWindow::init_egl() {
+	if (_config.backend == Backend::Software) {
+		// don't override it if the user picked something else
+		setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+	}
+
+	// the surfaceless platform doesn't need a display server, but not every egl has it
+	auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if (get_platform_display != nullptr) {
+		_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+
+	if (_display == EGL_NO_DISPLAY) {
+		_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major, minor;
+	if (_display == EGL_NO_DISPLAY || !eglInitialize(_display, &major, &minor)) {
+		spdlog::error("failed to initialize egl: {:#x}", eglGetError());
+		return false;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		spdlog::error("egl does not support desktop gl");
+		return false;
+	}
+
+	const EGLint config_attribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_STENCIL_SIZE, 8,
+		EGL_NONE
+	};
+
+	EGLConfig config;
+	EGLint config_count = 0;
+	if (!eglChooseConfig(_display, config_attribs, &config, 1, &config_count) || config_count == 0) {
+		spdlog::error("no egl config with a pbuffer");
+		return false;
+	}
+
+	// a pbuffer gives the guest a default framebuffer to draw into, like a window would
+	const EGLint surface_attribs[] = {
+		EGL_WIDTH, static_cast<EGLint>(_config.width),
+		EGL_HEIGHT, static_cast<EGLint>(_config.height),
+		EGL_NONE
+	};
+
+	_surface = eglCreatePbufferSurface(_display, config, surface_attribs);
+	if (_surface == EGL_NO_SURFACE) {
+		spdlog::error("failed to create pbuffer: {:#x}", eglGetError());
+		return false;
+	}
+
+	_context = eglCreateContext(_display, config, EGL_NO_CONTEXT, nullptr);
+	if (_context == EGL_NO_CONTEXT) {
+		spdlog::error("failed to create context: {:#x}", eglGetError());
+		return false;
+	}
+
+	if (!eglMakeCurrent(_display, _surface, _surface, _context)) {
+		spdlog::error("failed to make context current: {:#x}", eglGetError());
+		return false;
+	}
+
+	// vsync means nothing here, but some drivers throttle pbuffers anyways
+	eglSwapInterval(_display, 0);
+
+	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress))) {
+		spdlog::error("Failed to initialize GLAD");
+		return false;
+	}
+
+	GlExtensions::load(reinterpret_cast<GlExtensions::ProcLoader>(eglGetProcAddress));
+
+	return true;
+}
+
+void HeadlessAppWindow::destroy_egl() {
+	if (_display == EGL_NO_DISPLAY) {
+		return;
+	}
+
+	eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+	if (_context != EGL_NO_CONTEXT) {
+		eglDestroyContext(_display, _context);
+	}
+
+	if (_surface != EGL_NO_SURFACE) {
+		eglDestroySurface(_display, _surface);
+	}
+
+	eglTerminate(_display);
+
+	_display = EGL_NO_DISPLAY;
+	_context = EGL_NO_CONTEXT;
+	_surface = EGL_NO_SURFACE;
+}
+#endif
+
+bool HeadlessAppWindow::init() {
+	if (_config.backend == Backend::Null) {
+		if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(NullGl::get_proc_address))) {
+			spdlog::error("Failed to initialize GLAD");
+			return false;
+		}
+
+		GlExtensions::load(reinterpret_cast<GlExtensions::ProcLoader>(NullGl::get_proc_address));
+	} else {
+#ifdef SILENE_HEADLESS_EGL
+		if (!init_egl()) {
+			destroy_egl();
+			return false;
+		}
+#else
+		spdlog::error("this build has no egl support, only the null backend is available");
+		return false;
+#endif
+	}
+
+	auto vendor = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
+	auto renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+	auto version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+	spdlog::info("gl information: {} ({}) - {}", renderer, vendor, version);
+
+	return true;
+}
+
+void HeadlessAppWindow::main_loop() {
+	application().init_game(_config.width, _config.height);
+
+	std::uint64_t render_ns = 0u;
+	std::uint64_t gl_ns = 0u;
+	std::uint64_t gpu_ns = 0u;
+	std::uint32_t gpu_frames = 0u;
+
+	std::uint64_t draws_coalesced = 0u;
+	std::uint64_t coalesced_batches = 0u;
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (auto frame = 0u; frame < _config.frames; frame++) {
+		application().draw_frame();
+		this->swap_buffers();
+
+		const auto& stats = application().gl_stats().last_frame();
+		render_ns += stats.render_ns;
+		gl_ns += stats.gl_ns;
+
+		if (stats.gpu_ns >= 0) {
+			gpu_ns += stats.gpu_ns;
+			gpu_frames++;
+		}
+
+		draws_coalesced += application().gl_streamer().draws_coalesced_last_frame();
+		coalesced_batches += application().gl_streamer().batches_submitted_last_frame();
+	}
+
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	auto frames = std::max(_config.frames, 1u);
+
+	spdlog::info("ran {} frames in {:.2f}s ({:.1f} fps)", _config.frames, elapsed, _config.frames / elapsed);
+	spdlog::info("average per frame: render {:.3f}ms, of which gl {:.3f}ms", render_ns / 1e6 / frames, gl_ns / 1e6 / frames);
+
+	if (gpu_frames != 0) {
+		spdlog::info("average gpu time: {:.3f}ms", gpu_ns / 1e6 / gpu_frames);
+	}
+
+	if (coalesced_batches != 0) {
+		spdlog::info("coalesced {} draws into {} ({:.2f} draws per batch)", draws_coalesced, coalesced_batches, static_cast<double>(draws_coalesced) / coalesced_batches);
+	}
+
+	if (_config.backend == Backend::Null) {
+		const auto& counters = NullGl::counters();
+		spdlog::info("null gl: {} calls, {} draws ({} vertices), {} buffer bytes, {} texture bytes, {} errors",
+			counters.calls, counters.draw_calls, counters.vertices, counters.buffer_bytes, counters.texture_bytes, counters.errors);
+	}
+}
+
+void HeadlessAppWindow::swap_buffers() {
+#ifdef SILENE_HEADLESS_EGL
+	if (_surface != EGL_NO_SURFACE) {
+		eglSwapBuffers(_display, _surface);
+	}
+#endif
+}
+
+HeadlessAppWindow::HeadlessAppWindow(AndroidApplication& app, WindowConfig config)
+	: BaseWindow(app), _config{config} {}
+
+HeadlessAppWindow::~HeadlessAppWindow() {
+#ifdef SILENE_HEADLESS_EGL
+	destroy_egl();
+#endif
+}
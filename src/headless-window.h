@@ -0,0 +1,68 @@
+#pragma once
+
+#ifndef _HEADLESS_APP_WINDOW_H
+#define _HEADLESS_APP_WINDOW_H
+
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#ifdef SILENE_HEADLESS_EGL
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#endif
+
+#include "base-window.hpp"
+
+class AndroidApplication;
+
+/**
+ * runs the game for a fixed number of frames without a window or input, as fast as it'll go.
+ * meant for measuring the emulator, so a summary is logged at the end
+ */
+class HeadlessAppWindow : public BaseWindow {
+public:
+	enum class Backend {
+		// nothing is drawn, see NullGl
+		Null,
+
+		// a real context through egl, without a display
+		Egl,
+
+		// same as egl, but mesa is asked to rasterize on the cpu
+		Software,
+	};
+
+private:
+	struct WindowConfig {
+		Backend backend{Backend::Null};
+		std::uint32_t width{1280};
+		std::uint32_t height{720};
+		std::uint32_t frames{600};
+	};
+
+	WindowConfig _config;
+
+#ifdef SILENE_HEADLESS_EGL
+	EGLDisplay _display{EGL_NO_DISPLAY};
+	EGLContext _context{EGL_NO_CONTEXT};
+	EGLSurface _surface{EGL_NO_SURFACE};
+
+	bool init_egl();
+	void destroy_egl();
+#endif
+
+public:
+	virtual bool init() override;
+	virtual void main_loop() override;
+
+	/**
+	 * finishes the frame, like a window would on present. does nothing on the null backend
+	 */
+	void swap_buffers();
+
+	HeadlessAppWindow(AndroidApplication& app, WindowConfig config);
+	~HeadlessAppWindow();
+};
+
+#endif
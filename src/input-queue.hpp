@@ -0,0 +1,96 @@
+#pragma once
+
+#ifndef _INPUT_QUEUE_HPP
+#define _INPUT_QUEUE_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/**
+ * a single input from the frontend, in the form the guest is given it
+ */
+struct InputEvent {
+	enum class Type : std::uint8_t {
+		TouchDown,
+		TouchUp,
+		TouchMove,
+		ImeInsert,
+		ImeDelete,
+		KeyDown,
+	};
+
+	// key names are all that gets inserted, so anything longer is cut off
+	static constexpr std::size_t MAX_TEXT = 32;
+
+	Type type{Type::TouchMove};
+
+	std::uint32_t id{0};
+	float x{0.0f};
+	float y{0.0f};
+
+	int keycode{0};
+
+	char text[MAX_TEXT]{};
+
+	static InputEvent with_text(std::string_view text) {
+		InputEvent event{};
+		event.type = Type::ImeInsert;
+
+		auto size = std::min(text.size(), MAX_TEXT - 1);
+		std::memcpy(event.text, text.data(), size);
+
+		return event;
+	}
+};
+
+/**
+ * fixed size ring buffer with exactly one producer and one consumer, neither of which ever waits on the other.
+ * the window thread pushes into it while it pumps events, and the emulation thread drains it before every frame
+ */
+template <std::size_t Capacity>
+class InputQueue {
+	static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+	std::array<InputEvent, Capacity> _events{};
+
+	// kept apart so the two threads aren't fighting over the same cache line
+	alignas(64) std::atomic<std::size_t> _head{0u};
+	alignas(64) std::atomic<std::size_t> _tail{0u};
+
+public:
+	/**
+	 * producer only. returns false if the queue is full, in which case the event is dropped
+	 */
+	bool push(const InputEvent& event) {
+		auto tail = this->_tail.load(std::memory_order_relaxed);
+		if (tail - this->_head.load(std::memory_order_acquire) == Capacity) {
+			return false;
+		}
+
+		this->_events[tail & (Capacity - 1)] = event;
+		this->_tail.store(tail + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/**
+	 * consumer only. returns false if there is nothing to read
+	 */
+	bool pop(InputEvent& event) {
+		auto head = this->_head.load(std::memory_order_relaxed);
+		if (head == this->_tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		event = this->_events[head & (Capacity - 1)];
+		this->_head.store(head + 1, std::memory_order_release);
+
+		return true;
+	}
+};
+
+#endif
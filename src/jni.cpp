@@ -1,4 +1,8 @@
 #include "jni.h"
+
+#include <algorithm>
+#include <cstring>
+
 #include "syscall-translator.hpp"
 #include "syscall-handler.hpp"
 #include "libc-state.h"
@@ -10,6 +14,100 @@
 #define REGISTER_STATIC(CLASS, SIGNATURE, NAME) \
 	register_static(CLASS, SIGNATURE, &SyscallTranslator::translate_wrap<&jni_##NAME>)
 
+namespace {
+	/**
+	 * decodes utf-8 (modified or not) into utf-16, returning the number of units. out can be null to only count them.
+	 * anything malformed becomes a replacement character
+	 */
+	std::uint32_t decode_utf(std::string_view str, std::uint16_t* out) {
+		auto count = 0u;
+		auto emit = [&](std::uint32_t unit) {
+			if (out != nullptr) {
+				out[count] = static_cast<std::uint16_t>(unit);
+			}
+
+			count++;
+		};
+
+		for (std::size_t i = 0; i < str.size();) {
+			auto lead = static_cast<std::uint8_t>(str[i]);
+
+			std::uint32_t codepoint;
+			std::size_t size;
+			if (lead < 0x80) {
+				codepoint = lead;
+				size = 1;
+			} else if ((lead & 0xe0) == 0xc0) {
+				codepoint = lead & 0x1f;
+				size = 2;
+			} else if ((lead & 0xf0) == 0xe0) {
+				codepoint = lead & 0x0f;
+				size = 3;
+			} else if ((lead & 0xf8) == 0xf0) {
+				codepoint = lead & 0x07;
+				size = 4;
+			} else {
+				codepoint = 0xfffd;
+				size = 1;
+			}
+
+			for (auto j = 1u; j < size; j++) {
+				if (i + j >= str.size() || (static_cast<std::uint8_t>(str[i + j]) & 0xc0) != 0x80) {
+					codepoint = 0xfffd;
+					size = j;
+					break;
+				}
+
+				codepoint = (codepoint << 6) | (static_cast<std::uint8_t>(str[i + j]) & 0x3f);
+			}
+
+			i += size;
+
+			if (codepoint >= 0x10000) {
+				codepoint -= 0x10000;
+				emit(0xd800 | (codepoint >> 10));
+				emit(0xdc00 | (codepoint & 0x3ff));
+			} else {
+				emit(codepoint);
+			}
+		}
+
+		return count;
+	}
+
+	/**
+	 * encodes utf-16 as modified utf-8, returning the number of bytes (without a null byte). out can be null to only count them
+	 */
+	std::uint32_t encode_utf(const std::uint16_t* chars, std::uint32_t length, char* out) {
+		auto count = 0u;
+		auto emit = [&](std::uint32_t byte) {
+			if (out != nullptr) {
+				out[count] = static_cast<char>(byte);
+			}
+
+			count++;
+		};
+
+		for (auto i = 0u; i < length; i++) {
+			auto unit = chars[i];
+
+			// nulls are two bytes and surrogates are encoded on their own, so there are never any nulls or four byte sequences
+			if (unit != 0 && unit < 0x80) {
+				emit(unit);
+			} else if (unit < 0x800) {
+				emit(0xc0 | (unit >> 6));
+				emit(0x80 | (unit & 0x3f));
+			} else {
+				emit(0xe0 | (unit >> 12));
+				emit(0x80 | ((unit >> 6) & 0x3f));
+				emit(0x80 | (unit & 0x3f));
+			}
+		}
+
+		return count;
+	}
+}
+
 void Silene::JniState::pre_init(const StateHolder& env) {
 	JavaVM vm;
 
@@ -18,11 +116,28 @@ void Silene::JniState::pre_init(const StateHolder& env) {
 
 	JNIEnv jni_env;
 
+	jni_env.ptr_newString = REGISTER_STUB(env, newString);
 	jni_env.ptr_newStringUTF = REGISTER_STUB(env, newStringUTF);
+	jni_env.ptr_getStringLength = REGISTER_STUB(env, getStringLength);
+	jni_env.ptr_getStringUTFLength = REGISTER_STUB(env, getStringUTFLength);
+	jni_env.ptr_getStringChars = REGISTER_STUB(env, getStringChars);
+	jni_env.ptr_getStringCritical = jni_env.ptr_getStringChars;
 	jni_env.ptr_getStringUTFChars = REGISTER_STUB(env, getStringUTFChars);
-	jni_env.ptr_releaseStringUTFChars = REGISTER_STUB(env, releaseStringUTFChars);
+	jni_env.ptr_releaseStringChars = REGISTER_STUB(env, releaseStringChars);
+	jni_env.ptr_releaseStringCritical = jni_env.ptr_releaseStringChars;
+	jni_env.ptr_releaseStringUTFChars = jni_env.ptr_releaseStringChars;
+	jni_env.ptr_getStringRegion = REGISTER_STUB(env, getStringRegion);
+	jni_env.ptr_getStringUTFRegion = REGISTER_STUB(env, getStringUTFRegion);
 	jni_env.ptr_findClass = REGISTER_STUB(env, findClass);
 	jni_env.ptr_deleteLocalRef = REGISTER_STUB(env, deleteLocalRef);
+	jni_env.ptr_newLocalRef = REGISTER_STUB(env, newLocalRef);
+	jni_env.ptr_newGlobalRef = REGISTER_STUB(env, newGlobalRef);
+	jni_env.ptr_deleteGlobalRef = REGISTER_STUB(env, deleteGlobalRef);
+	jni_env.ptr_pushLocalFrame = REGISTER_STUB(env, pushLocalFrame);
+	jni_env.ptr_popLocalFrame = REGISTER_STUB(env, popLocalFrame);
+	jni_env.ptr_ensureLocalCapacity = REGISTER_STUB(env, ensureLocalCapacity);
+	jni_env.ptr_isSameObject = REGISTER_STUB(env, isSameObject);
+	jni_env.ptr_getObjectRefType = REGISTER_STUB(env, getObjectRefType);
 
 	jni_env.ptr_callStaticVoidMethodV = REGISTER_STUB(env, callStaticMethodV);
 	jni_env.ptr_callStaticObjectMethodV = jni_env.ptr_callStaticVoidMethodV;
@@ -37,8 +152,55 @@ void Silene::JniState::pre_init(const StateHolder& env) {
 
 	jni_env.ptr_getStaticMethodID = REGISTER_STUB(env, getStaticMethodID);
 	jni_env.ptr_getArrayLength = REGISTER_STUB(env, getArrayLength);
-	jni_env.ptr_getIntArrayRegion = REGISTER_STUB(env, getIntArrayRegion);
-	jni_env.ptr_getFloatArrayRegion = REGISTER_STUB(env, getFloatArrayRegion);
+
+	jni_env.ptr_newBooleanArray = REGISTER_STUB_RN(env, emu_newArray<1>);
+	jni_env.ptr_newByteArray = jni_env.ptr_newBooleanArray;
+	jni_env.ptr_newCharArray = REGISTER_STUB_RN(env, emu_newArray<2>);
+	jni_env.ptr_newShortArray = jni_env.ptr_newCharArray;
+	jni_env.ptr_newIntArray = REGISTER_STUB_RN(env, emu_newArray<4>);
+	jni_env.ptr_newFloatArray = jni_env.ptr_newIntArray;
+	jni_env.ptr_newLongArray = REGISTER_STUB_RN(env, emu_newArray<8>);
+	jni_env.ptr_newDoubleArray = jni_env.ptr_newLongArray;
+
+	jni_env.ptr_getBooleanArrayElements = REGISTER_STUB(env, getArrayElements);
+	jni_env.ptr_getByteArrayElements = jni_env.ptr_getBooleanArrayElements;
+	jni_env.ptr_getCharArrayElements = jni_env.ptr_getBooleanArrayElements;
+	jni_env.ptr_getShortArrayElements = jni_env.ptr_getBooleanArrayElements;
+	jni_env.ptr_getIntArrayElements = jni_env.ptr_getBooleanArrayElements;
+	jni_env.ptr_getLongArrayElements = jni_env.ptr_getBooleanArrayElements;
+	jni_env.ptr_getFloatArrayElements = jni_env.ptr_getBooleanArrayElements;
+	jni_env.ptr_getDoubleArrayElements = jni_env.ptr_getBooleanArrayElements;
+	jni_env.ptr_getPrimitiveArrayCritical = jni_env.ptr_getBooleanArrayElements;
+
+	jni_env.ptr_releaseBooleanArrayElements = REGISTER_STUB(env, releaseArrayElements);
+	jni_env.ptr_releaseByteArrayElements = jni_env.ptr_releaseBooleanArrayElements;
+	jni_env.ptr_releaseCharArrayElements = jni_env.ptr_releaseBooleanArrayElements;
+	jni_env.ptr_releaseShortArrayElements = jni_env.ptr_releaseBooleanArrayElements;
+	jni_env.ptr_releaseIntArrayElements = jni_env.ptr_releaseBooleanArrayElements;
+	jni_env.ptr_releaseLongArrayElements = jni_env.ptr_releaseBooleanArrayElements;
+	jni_env.ptr_releaseFloatArrayElements = jni_env.ptr_releaseBooleanArrayElements;
+	jni_env.ptr_releaseDoubleArrayElements = jni_env.ptr_releaseBooleanArrayElements;
+	jni_env.ptr_releasePrimitiveArrayCritical = jni_env.ptr_releaseBooleanArrayElements;
+
+	jni_env.ptr_getBooleanArrayRegion = REGISTER_STUB(env, getArrayRegion);
+	jni_env.ptr_getByteArrayRegion = jni_env.ptr_getBooleanArrayRegion;
+	jni_env.ptr_getCharArrayRegion = jni_env.ptr_getBooleanArrayRegion;
+	jni_env.ptr_getShortArrayRegion = jni_env.ptr_getBooleanArrayRegion;
+	jni_env.ptr_getIntArrayRegion = jni_env.ptr_getBooleanArrayRegion;
+	jni_env.ptr_getLongArrayRegion = jni_env.ptr_getBooleanArrayRegion;
+	jni_env.ptr_getFloatArrayRegion = jni_env.ptr_getBooleanArrayRegion;
+	jni_env.ptr_getDoubleArrayRegion = jni_env.ptr_getBooleanArrayRegion;
+
+	jni_env.ptr_setBooleanArrayRegion = REGISTER_STUB(env, setArrayRegion);
+	jni_env.ptr_setByteArrayRegion = jni_env.ptr_setBooleanArrayRegion;
+	jni_env.ptr_setCharArrayRegion = jni_env.ptr_setBooleanArrayRegion;
+	jni_env.ptr_setShortArrayRegion = jni_env.ptr_setBooleanArrayRegion;
+	jni_env.ptr_setIntArrayRegion = jni_env.ptr_setBooleanArrayRegion;
+	jni_env.ptr_setLongArrayRegion = jni_env.ptr_setBooleanArrayRegion;
+	jni_env.ptr_setFloatArrayRegion = jni_env.ptr_setBooleanArrayRegion;
+	jni_env.ptr_setDoubleArrayRegion = jni_env.ptr_setBooleanArrayRegion;
+
+	this->_libc = &env.libc();
 
 	// write after registering symbols so memory is ordered more cleanly
 
@@ -78,29 +240,101 @@ void Silene::JniState::pre_init(const StateHolder& env) {
 	REGISTER_STATIC("org/cocos2dx/lib/Cocos2dxActivity", "showMessageBox;(Ljava/lang/String;Ljava/lang/String;)V", show_message_box);
 }
 
+std::uint32_t Silene::JniState::emu_newString(Environment& env, std::uint32_t java_env, std::uint32_t chars_ptr, std::uint32_t length) {
+	auto chars = env.memory_manager().read_bytes<std::uint16_t>(chars_ptr);
+
+	std::string str(encode_utf(chars, length, nullptr), '\0');
+	encode_utf(chars, length, str.data());
+
+	return env.jni().create_string_ref(str);
+}
+
 std::uint32_t Silene::JniState::emu_newStringUTF(Environment& env, std::uint32_t java_env, std::uint32_t string_ptr) {
 	auto str = env.memory_manager().read_bytes<char>(string_ptr);
 	return env.jni().create_string_ref(str);
 }
 
-std::uint32_t Silene::JniState::emu_getStringUTFChars(Environment& env, std::uint32_t java_env, std::uint32_t string, std::uint32_t is_copy_ptr) {
-	try {
-		auto ref_v = env.jni().get_ref_value(string);
-		auto ref = std::get<std::string>(ref_v);
+std::uint32_t Silene::JniState::emu_getStringLength(Environment& env, std::uint32_t java_env, std::uint32_t string) {
+	if (auto str = env.jni().get_java_string(string); str) {
+		return str->length;
+	}
+
+	spdlog::warn("GetStringLength given invalid value {:#08x}", string);
+	return 0;
+}
 
-		// add a null byte
-		auto ptr = env.libc().allocate_memory(ref.length() + 1, true);
-		env.memory_manager().copy(ptr, ref.data(), ref.length());
+std::uint32_t Silene::JniState::emu_getStringUTFLength(Environment& env, std::uint32_t java_env, std::uint32_t string) {
+	if (auto str = env.jni().get_java_string(string); str) {
+		return str->utf_length;
+	}
 
-		if (is_copy_ptr != 0) {
-			env.memory_manager().write_byte(is_copy_ptr, 1);
-		}
+	spdlog::warn("GetStringUTFLength given invalid value {:#08x}", string);
+	return 0;
+}
+
+std::uint32_t Silene::JniState::emu_getStringChars(Environment& env, std::uint32_t java_env, std::uint32_t string, std::uint32_t is_copy_ptr) {
+	auto str = env.jni().get_java_string(string);
+	if (!str) {
+		spdlog::warn("GetStringChars given invalid value {:#08x}", string);
+		return 0;
+	}
+
+	if (is_copy_ptr != 0) {
+		env.memory_manager().write_byte(is_copy_ptr, 0);
+	}
+
+	return str->chars_ptr;
+}
 
-		return ptr;
-	} catch (const std::out_of_range& e) {
+std::uint32_t Silene::JniState::emu_getStringUTFChars(Environment& env, std::uint32_t java_env, std::uint32_t string, std::uint32_t is_copy_ptr) {
+	auto str = env.jni().get_java_string(string);
+	if (!str) {
 		spdlog::warn("GetStringUTFChars given invalid value {:#08x}", string);
 		return 0;
 	}
+
+	if (is_copy_ptr != 0) {
+		env.memory_manager().write_byte(is_copy_ptr, 0);
+	}
+
+	return str->utf_ptr();
+}
+
+void Silene::JniState::emu_releaseStringChars(Environment& env, std::uint32_t java_env, std::uint32_t jstring, std::uint32_t chars_ptr) {
+	// the guest was given the string itself, which is freed along with its last reference
+}
+
+void Silene::JniState::emu_getStringRegion(Environment& env, std::uint32_t java_env, std::uint32_t string, std::uint32_t start, std::uint32_t len, std::uint32_t buf_ptr) {
+	auto str = env.jni().get_java_string(string);
+	if (!str) {
+		spdlog::warn("GetStringRegion given invalid value {:#08x}", string);
+		return;
+	}
+
+	if (!check_region(*str, start, len) || len == 0) {
+		return;
+	}
+
+	auto src = env.memory_manager().read_bytes<std::uint16_t>(str->chars_ptr) + start;
+	auto buf = env.memory_manager().read_bytes<std::uint8_t>(buf_ptr);
+
+	std::memmove(buf, src, len * sizeof(std::uint16_t));
+}
+
+void Silene::JniState::emu_getStringUTFRegion(Environment& env, std::uint32_t java_env, std::uint32_t string, std::uint32_t start, std::uint32_t len, std::uint32_t buf_ptr) {
+	auto str = env.jni().get_java_string(string);
+	if (!str) {
+		spdlog::warn("GetStringUTFRegion given invalid value {:#08x}", string);
+		return;
+	}
+
+	if (!check_region(*str, start, len) || len == 0) {
+		return;
+	}
+
+	// the region is in utf-16 units, so it has to be encoded again
+	auto chars = env.memory_manager().read_bytes<std::uint16_t>(str->chars_ptr) + start;
+	encode_utf(chars, len, env.memory_manager().read_bytes<char>(buf_ptr));
 }
 
 std::uint32_t Silene::JniState::emu_getEnv(Environment& env, std::uint32_t java_env, std::uint32_t out_ptr, std::uint32_t version) {
@@ -131,14 +365,83 @@ void Silene::JniState::emu_deleteLocalRef(Environment& env, std::uint32_t java_e
 	env.jni().remove_ref(local_ref);
 }
 
+std::uint32_t Silene::JniState::emu_newLocalRef(Environment& env, std::uint32_t java_env, std::uint32_t ref) {
+	return env.jni().duplicate_ref(ref, RefKind::Local);
+}
+
+std::uint32_t Silene::JniState::emu_newGlobalRef(Environment& env, std::uint32_t java_env, std::uint32_t ref) {
+	return env.jni().duplicate_ref(ref, RefKind::Global);
+}
+
+void Silene::JniState::emu_deleteGlobalRef(Environment& env, std::uint32_t java_env, std::uint32_t global_ref) {
+	env.jni().remove_ref(global_ref);
+}
+
+std::uint32_t Silene::JniState::emu_pushLocalFrame(Environment& env, std::uint32_t java_env, std::uint32_t capacity) {
+	env.jni().push_local_frame();
+	return 0;
+}
+
+std::uint32_t Silene::JniState::emu_popLocalFrame(Environment& env, std::uint32_t java_env, std::uint32_t result) {
+	return env.jni().pop_local_frame(result);
+}
+
+std::uint32_t Silene::JniState::emu_ensureLocalCapacity(Environment& env, std::uint32_t java_env, std::uint32_t capacity) {
+	// the table grows as needed
+	return 0;
+}
+
+std::uint32_t Silene::JniState::emu_isSameObject(Environment& env, std::uint32_t java_env, std::uint32_t ref1, std::uint32_t ref2) {
+	if (ref1 == ref2) {
+		return 1;
+	}
+
+	auto& jni = env.jni();
+	std::scoped_lock lk{jni._refs_mutex};
+
+	auto slot1 = jni.find_ref(ref1);
+	auto slot2 = jni.find_ref(ref2);
+
+	return slot1 != nullptr && slot2 != nullptr && slot1->object == slot2->object;
+}
+
+std::uint32_t Silene::JniState::emu_getObjectRefType(Environment& env, std::uint32_t java_env, std::uint32_t ref) {
+	return static_cast<std::uint32_t>(env.jni().get_ref_kind(ref));
+}
+
 void Silene::JniState::emu_callStaticMethodV(Environment& env, std::uint32_t java_env, std::uint32_t local_ref, std::uint32_t method_id) {
+	auto fn = env.jni().get_fn(method_id);
+	if (fn == nullptr) {
+		spdlog::warn("CallStatic*MethodV on nonexistent method {}", method_id);
+		return;
+	}
+
 	// hopefully, the method we call correctly sets the return type
-	env.jni().get_fn(local_ref, method_id)(env);
+	fn(env);
 }
 
-Silene::JniState::StaticJavaClass::JniFunction Silene::JniState::get_fn(std::uint32_t class_id, std::uint32_t method_id) const {
-	auto clazz = _class_mapping.at(class_id);
-	return clazz.method_impls.at(method_id);
+Silene::JniState::StaticJavaClass::JniFunction Silene::JniState::get_fn(std::uint32_t method_id) const {
+	if (method_id == 0 || method_id > this->_methods.size()) {
+		return nullptr;
+	}
+
+	return this->_methods[method_id - 1].fn;
+}
+
+std::uint32_t Silene::JniState::find_static_method(std::uint32_t class_id, std::string_view name, std::string_view signature) const {
+	auto jclass = this->_class_mapping.find(class_id);
+	if (jclass == this->_class_mapping.end()) {
+		return 0;
+	}
+
+	const auto& clazz = jclass->second;
+	auto combined = fmt::format("{};{}", name, signature);
+
+	if (auto jmethod = clazz.method_names.find(combined); jmethod != clazz.method_names.end()) {
+		return jmethod->second;
+	}
+
+	return 0;
 }
 
 std::uint32_t Silene::JniState::emu_getStaticMethodID(Environment& env, std::uint32_t java_env, std::uint32_t class_ptr, std::uint32_t name_ptr, std::uint32_t signature_ptr) {
@@ -146,116 +449,502 @@ std::uint32_t Silene::JniState::emu_getStaticMethodID(Environment& env, std::uin
 	auto method_signature = env.memory_manager().read_bytes<char>(signature_ptr);
 
 	auto& jni = env.jni();
-	if (auto jclass = jni._class_mapping.find(class_ptr); jclass != jni._class_mapping.end()) {
-		auto& clazz = jclass->second;
-		auto combined = fmt::format("{};{}", method_name, method_signature);
+	MethodLookup lookup{class_ptr, name_ptr, signature_ptr};
 
-		if (auto jmethod = clazz.method_names.find(combined); jmethod != clazz.method_names.end()) {
-			return jmethod->second;
+	{
+		std::scoped_lock lk{jni._method_lookups_mutex};
+
+		if (auto it = jni._method_lookups.find(lookup); it != jni._method_lookups.end()) {
+			// the strings could have been somewhere the guest has since reused
+			const auto& method = jni._methods[it->second - 1];
+			if (method.name == method_name && method.signature == method_signature) {
+				return it->second;
+			}
 		}
 	}
 
-	spdlog::warn("GetStaticMethodID on nonexistent method - {};{}", method_name, method_signature);
-	return 0;
+	auto method_id = jni.find_static_method(class_ptr, method_name, method_signature);
+	if (method_id == 0) {
+		spdlog::warn("GetStaticMethodID on nonexistent method - {};{}", method_name, method_signature);
+		return 0;
+	}
+
+	std::scoped_lock lk{jni._method_lookups_mutex};
+	jni._method_lookups[lookup] = method_id;
+
+	return method_id;
 }
 
-void Silene::JniState::remove_ref(std::uint32_t vaddr) {
-	this->_object_refs.erase(vaddr);
+std::uint32_t Silene::JniState::encode_ref(std::uint32_t index, std::uint32_t generation, RefKind kind) {
+	return REF_TAG
+		| (index << (REF_GENERATION_BITS + REF_KIND_BITS))
+		| ((generation & REF_GENERATION_MASK) << REF_KIND_BITS)
+		| static_cast<std::uint32_t>(kind);
 }
 
-Silene::JniState::RefType& Silene::JniState::get_ref_value(std::uint32_t vaddr) {
-	return this->_object_refs.at(vaddr);
+Silene::JniState::RefSlot* Silene::JniState::find_ref(std::uint32_t handle) {
+	if ((handle & REF_TAG) == 0) {
+		return nullptr;
+	}
+
+	auto index = (handle & ~REF_TAG) >> (REF_GENERATION_BITS + REF_KIND_BITS);
+	if (index >= this->_refs.size()) {
+		return nullptr;
+	}
+
+	auto& slot = this->_refs[index];
+	auto generation = (handle >> REF_KIND_BITS) & REF_GENERATION_MASK;
+	auto kind = static_cast<RefKind>(handle & REF_KIND_MASK);
+
+	if (slot.object == nullptr || slot.kind != kind || (slot.generation & REF_GENERATION_MASK) != generation) {
+		return nullptr;
+	}
+
+	return &slot;
 }
 
-std::uint32_t Silene::JniState::create_string_ref(std::string_view str) {
-	return this->create_ref(std::string(str));
+std::uint32_t Silene::JniState::add_ref(std::shared_ptr<RefType> object, RefKind kind) {
+	std::uint32_t index;
+	if (!this->_free_refs.empty()) {
+		index = this->_free_refs.back();
+		this->_free_refs.pop_back();
+	} else {
+		index = static_cast<std::uint32_t>(this->_refs.size());
+		if (index >= MAX_REFS) {
+			spdlog::error("jni reference table overflow ({} live references)", index);
+			return 0;
+		}
+
+		this->_refs.emplace_back();
+	}
+
+	auto& slot = this->_refs[index];
+	slot.object = std::move(object);
+	slot.kind = kind;
+
+	auto handle = encode_ref(index, slot.generation, kind);
+	if (kind == RefKind::Local) {
+		auto& locals = this->local_refs();
+
+		slot.local_owner = std::this_thread::get_id();
+		slot.local_index = locals.refs.size();
+		locals.refs.push_back(handle);
+	}
+
+	spdlog::trace("create ref: {:#08x}", handle);
+
+	return handle;
 }
 
-std::uint32_t Silene::JniState::create_ref(JniState::RefType x) {
-	auto addr = this->_memory.get_next_word_addr();
-	this->_memory.allocate(4);
+void Silene::JniState::free_ref(std::uint32_t handle) {
+	auto slot = this->find_ref(handle);
+	if (slot == nullptr) {
+		return;
+	}
+
+	if (slot->kind == RefKind::Local) {
+		if (auto it = this->_local_refs.find(slot->local_owner); it != this->_local_refs.end()) {
+			auto& refs = it->second.refs;
+			if (slot->local_index < refs.size() && refs[slot->local_index] == handle) {
+				refs[slot->local_index] = 0;
+			}
+		}
+	}
+
+	slot->object.reset();
+	slot->kind = RefKind::Invalid;
+	slot->generation++;
+
+	auto index = (handle & ~REF_TAG) >> (REF_GENERATION_BITS + REF_KIND_BITS);
+	this->_free_refs.push_back(index);
+}
 
-	// write itself for safekeeping
-	this->_memory.write_word(addr, 0xcbfbfbdb);
+void Silene::JniState::remove_ref(std::uint32_t handle) {
+	std::scoped_lock lk{this->_refs_mutex};
 
-	this->_object_refs[addr] = x;
+	if (this->find_ref(handle) == nullptr) {
+		spdlog::warn("attempted to delete an invalid or stale reference {:#08x}", handle);
+		return;
+	}
 
-	spdlog::trace("create ref: {:#08x}", addr);
+	this->free_ref(handle);
 
-	return addr;
+	// locals are usually deleted in the order they were made, which keeps a long running frame from growing
+	auto& locals = this->local_refs();
+	auto frame_start = locals.frames.back();
+	while (locals.refs.size() > frame_start && locals.refs.back() == 0) {
+		locals.refs.pop_back();
+	}
 }
 
-std::uint32_t Silene::JniState::emu_getArrayLength(Environment& env, std::uint32_t java_env, std::uint32_t jarray) {
-	auto& ref_v = env.jni().get_ref_value(jarray);
-	if (std::holds_alternative<std::vector<int>>(ref_v)) {
-		auto& ref = std::get<std::vector<int>>(ref_v);
-		return static_cast<std::uint32_t>(ref.size());
+Silene::JniState::LocalRefs& Silene::JniState::local_refs() {
+	return this->_local_refs[std::this_thread::get_id()];
+}
+
+Silene::JniState::RefType& Silene::JniState::get_ref_value(std::uint32_t handle) {
+	std::scoped_lock lk{this->_refs_mutex};
+
+	auto slot = this->find_ref(handle);
+	if (slot == nullptr) {
+		throw std::out_of_range(fmt::format("invalid or stale jni reference {:#08x}", handle));
+	}
+
+	return *slot->object;
+}
+
+std::shared_ptr<Silene::JniState::RefType> Silene::JniState::intern_string(std::string_view str) {
+	auto is_modified = std::none_of(str.begin(), str.end(), [](char c) {
+		return c == '\0' || static_cast<std::uint8_t>(c) >= 0xf0;
+	});
+
+	if (!is_modified) {
+		// nulls and four byte sequences only show up in regular utf-8, which has to be converted first
+		std::vector<std::uint16_t> chars(decode_utf(str, nullptr));
+		decode_utf(str, chars.data());
+
+		std::string modified(encode_utf(chars.data(), chars.size(), nullptr), '\0');
+		encode_utf(chars.data(), chars.size(), modified.data());
+
+		return this->intern_string(modified);
 	}
 
-	if (std::holds_alternative<std::vector<float>>(ref_v)) {
-		auto& ref = std::get<std::vector<float>>(ref_v);
-		return static_cast<std::uint32_t>(ref.size());
+	auto hash = std::hash<std::string_view>{}(str);
+
+	auto [begin, end] = this->_interned_strings.equal_range(hash);
+	for (auto it = begin; it != end; it++) {
+		auto object = it->second.lock();
+		if (object == nullptr) {
+			continue;
+		}
+
+		const auto& existing = std::get<JavaString>(*object);
+		if (std::string_view{this->_memory.read_bytes<char>(existing.utf_ptr()), existing.utf_length} == str) {
+			return object;
+		}
 	}
 
-	spdlog::warn("getArrayLength called on non array ref");
-	return 0;
+	auto length = decode_utf(str, nullptr);
+	auto utf_length = static_cast<std::uint32_t>(str.size());
+
+	auto ptr = this->_libc->allocate_memory(length * sizeof(std::uint16_t) + utf_length + 1);
+	if (ptr == 0) {
+		return nullptr;
+	}
+
+	JavaString string{ptr, length, utf_length};
+
+	decode_utf(str, this->_memory.read_bytes<std::uint16_t>(string.chars_ptr));
+
+	auto utf = this->_memory.read_bytes<char>(string.utf_ptr());
+	std::memcpy(utf, str.data(), utf_length);
+	utf[utf_length] = '\0';
+
+	auto libc = this->_libc;
+	std::shared_ptr<RefType> object{new RefType{string}, [libc](RefType* object) {
+		libc->free_memory(std::get<JavaString>(*object).chars_ptr);
+		delete object;
+	}};
+
+	// dead strings are only cleared out every so often, as the table grows
+	if (this->_interned_strings.size() >= this->_interned_sweep_at) {
+		std::erase_if(this->_interned_strings, [](const auto& entry) {
+			return entry.second.expired();
+		});
+
+		this->_interned_sweep_at = std::max<std::size_t>(64u, this->_interned_strings.size() * 2);
+	}
+
+	this->_interned_strings.emplace(hash, object);
+
+	return object;
 }
 
-void Silene::JniState::emu_getIntArrayRegion(Environment& env, std::uint32_t java_env, std::uint32_t jarray, std::uint32_t start, std::uint32_t len, std::uint32_t buf_ptr) {
-	auto& ref_v = env.jni().get_ref_value(jarray);
-	auto& ref = std::get<std::vector<int>>(ref_v);
+std::uint32_t Silene::JniState::create_string_ref(std::string_view str, bool constant) {
+	std::scoped_lock lk{this->_refs_mutex};
+
+	auto object = this->intern_string(str);
+	if (object == nullptr) {
+		return 0;
+	}
 
-	auto buf = env.memory_manager().read_bytes<std::int32_t>(buf_ptr);
+	if (constant && std::find(this->_constant_strings.begin(), this->_constant_strings.end(), object) == this->_constant_strings.end()) {
+		this->_constant_strings.push_back(object);
+	}
 
-	std::copy(ref.begin() + start, ref.begin() + start + len, buf);
+	return this->add_ref(std::move(object), RefKind::Local);
 }
 
-void Silene::JniState::emu_getFloatArrayRegion(Environment& env, std::uint32_t java_env, std::uint32_t jarray, std::uint32_t start, std::uint32_t len, std::uint32_t buf_ptr) {
-	auto& ref_v = env.jni().get_ref_value(jarray);
-	auto& ref = std::get<std::vector<float>>(ref_v);
+std::optional<Silene::JniState::JavaString> Silene::JniState::get_java_string(std::uint32_t handle) {
+	std::scoped_lock lk{this->_refs_mutex};
+
+	auto slot = this->find_ref(handle);
+	if (slot == nullptr) {
+		return std::nullopt;
+	}
+
+	if (auto string = std::get_if<JavaString>(slot->object.get()); string != nullptr) {
+		return *string;
+	}
+
+	return std::nullopt;
+}
 
-	auto buf = env.memory_manager().read_bytes<float>(buf_ptr);
+std::optional<std::string_view> Silene::JniState::get_string(std::uint32_t handle) {
+	auto string = this->get_java_string(handle);
+	if (!string) {
+		return std::nullopt;
+	}
 
-	std::copy(ref.begin() + start, ref.begin() + start + len, buf);
+	return std::string_view{this->_memory.read_bytes<char>(string->utf_ptr()), string->utf_length};
 }
 
-void Silene::JniState::emu_releaseStringUTFChars(Environment& env, std::uint32_t java_env, std::uint32_t jstring, std::uint32_t string_ptr) {
-	env.libc().free_memory(string_ptr);
-	// TODO: should we actually free the jstring here?
+std::uint32_t Silene::JniState::create_ref(JniState::RefType x) {
+	std::scoped_lock lk{this->_refs_mutex};
+	return this->add_ref(std::make_shared<RefType>(std::move(x)), RefKind::Local);
 }
 
-std::uint32_t Silene::JniState::register_static(std::string class_name, std::string signature, StaticJavaClass::JniFunction fn) {
-	if (auto jclass = _class_name_mapping.find(class_name); jclass != _class_name_mapping.end()) {
-		auto& clazz = _class_mapping[jclass->second];
-		if (auto jmethod = clazz.method_names.find(signature); jmethod != clazz.method_names.end()) {
-			// oops! we already have a method of that id
-			return jmethod->second;
+std::uint32_t Silene::JniState::duplicate_ref(std::uint32_t handle, RefKind kind) {
+	std::scoped_lock lk{this->_refs_mutex};
+
+	auto slot = this->find_ref(handle);
+	if (slot == nullptr) {
+		return 0;
+	}
+
+	return this->add_ref(slot->object, kind);
+}
+
+Silene::JniState::RefKind Silene::JniState::get_ref_kind(std::uint32_t handle) {
+	std::scoped_lock lk{this->_refs_mutex};
+
+	auto slot = this->find_ref(handle);
+	return slot != nullptr ? slot->kind : RefKind::Invalid;
+}
+
+void Silene::JniState::push_local_frame() {
+	std::scoped_lock lk{this->_refs_mutex};
+
+	auto& locals = this->local_refs();
+	locals.frames.push_back(locals.refs.size());
+}
+
+std::uint32_t Silene::JniState::pop_local_frame(std::uint32_t result) {
+	std::scoped_lock lk{this->_refs_mutex};
+
+	auto& locals = this->local_refs();
+	if (locals.frames.size() <= 1) {
+		spdlog::warn("PopLocalFrame called without a matching push");
+		return 0;
+	}
+
+	// held onto so it survives its reference being freed with the rest of the frame
+	std::shared_ptr<RefType> kept{};
+	if (auto slot = this->find_ref(result); slot != nullptr) {
+		kept = slot->object;
+	}
+
+	auto frame_start = locals.frames.back();
+	locals.frames.pop_back();
+
+	for (auto i = frame_start; i < locals.refs.size(); i++) {
+		if (auto handle = locals.refs[i]; handle != 0) {
+			this->free_ref(handle);
+		}
+	}
+
+	locals.refs.resize(frame_start);
+
+	return kept != nullptr ? this->add_ref(std::move(kept), RefKind::Local) : 0;
+}
+
+void Silene::JniState::release_thread_refs() {
+	std::scoped_lock lk{this->_refs_mutex};
+
+	auto it = this->_local_refs.find(std::this_thread::get_id());
+	if (it == this->_local_refs.end()) {
+		return;
+	}
+
+	for (auto handle : it->second.refs) {
+		if (handle != 0) {
+			this->free_ref(handle);
 		}
+	}
+
+	this->_local_refs.erase(it);
+}
+
+std::size_t Silene::JniState::live_refs() {
+	std::scoped_lock lk{this->_refs_mutex};
+	return this->_refs.size() - this->_free_refs.size();
+}
 
-		auto method_id = clazz.method_count;
-		clazz.method_count++;
+bool Silene::JniState::check_region(const PrimitiveArray& array, std::uint32_t start, std::uint32_t len) {
+	if (start > array.length || len > array.length - start) {
+		spdlog::warn("array region {}+{} is out of bounds for an array of length {}", start, len, array.length);
+		return false;
+	}
 
-		clazz.method_names[signature] = method_id;
-		clazz.method_impls[method_id] = fn;
+	return true;
+}
 
-		return method_id;
+bool Silene::JniState::check_region(const JavaString& string, std::uint32_t start, std::uint32_t len) {
+	if (start > string.length || len > string.length - start) {
+		spdlog::warn("string region {}+{} is out of bounds for a string of length {}", start, len, string.length);
+		return false;
 	}
 
-	// class doesn't exist, time to create it
-	auto class_id = _class_count;
-	_class_count++;
+	return true;
+}
+
+std::uint32_t Silene::JniState::create_array(std::uint32_t element_size, std::uint32_t length, RefKind kind) {
+	if (length > (0x1000'0000u / element_size)) {
+		spdlog::warn("refusing to allocate an array of {} elements", length);
+		return 0;
+	}
+
+	auto ptr = this->_libc->allocate_memory(sizeof(ArrayHeader) + length * element_size, true);
+	if (ptr == 0) {
+		return 0;
+	}
+
+	ArrayHeader header{length, element_size};
+	this->_memory.copy(ptr, &header, sizeof(header));
+
+	// the guest memory goes back to the heap along with the last reference to it
+	auto libc = this->_libc;
+	std::shared_ptr<RefType> object{new RefType{PrimitiveArray{ptr, length, element_size, length}}, [libc](RefType* object) {
+		libc->free_memory(std::get<PrimitiveArray>(*object).header_ptr);
+		delete object;
+	}};
+
+	std::scoped_lock lk{this->_refs_mutex};
+	return this->add_ref(std::move(object), kind);
+}
+
+std::optional<Silene::JniState::PrimitiveArray> Silene::JniState::get_array(std::uint32_t handle) {
+	std::scoped_lock lk{this->_refs_mutex};
+
+	auto slot = this->find_ref(handle);
+	if (slot == nullptr) {
+		return std::nullopt;
+	}
 
-	_class_name_mapping[class_name] = class_id;
-	_class_mapping[class_id] = {class_id, class_name};
+	if (auto array = std::get_if<PrimitiveArray>(slot->object.get()); array != nullptr) {
+		return *array;
+	}
+
+	return std::nullopt;
+}
+
+void Silene::JniState::set_array_length(std::uint32_t handle, std::uint32_t length) {
+	std::scoped_lock lk{this->_refs_mutex};
+
+	auto slot = this->find_ref(handle);
+	if (slot == nullptr) {
+		return;
+	}
+
+	if (auto array = std::get_if<PrimitiveArray>(slot->object.get()); array != nullptr) {
+		array->length = std::min(length, array->capacity);
+		this->_memory.write_word(array->header_ptr, array->length);
+	}
+}
+
+std::uint32_t Silene::JniState::emu_getArrayLength(Environment& env, std::uint32_t java_env, std::uint32_t jarray) {
+	if (auto array = env.jni().get_array(jarray); array) {
+		return array->length;
+	}
+
+	spdlog::warn("getArrayLength called on non array ref");
+	return 0;
+}
+
+template <std::uint32_t ElementSize>
+std::uint32_t Silene::JniState::emu_newArray(Environment& env, std::uint32_t java_env, std::uint32_t length) {
+	return env.jni().create_array(ElementSize, length);
+}
+
+std::uint32_t Silene::JniState::emu_getArrayElements(Environment& env, std::uint32_t java_env, std::uint32_t jarray, std::uint32_t is_copy_ptr) {
+	auto array = env.jni().get_array(jarray);
+	if (!array) {
+		spdlog::warn("Get*ArrayElements called on non array ref {:#08x}", jarray);
+		return 0;
+	}
+
+	if (is_copy_ptr != 0) {
+		env.memory_manager().write_byte(is_copy_ptr, 0);
+	}
+
+	return array->elements_ptr();
+}
+
+void Silene::JniState::emu_releaseArrayElements(Environment& env, std::uint32_t java_env, std::uint32_t jarray, std::uint32_t elems_ptr, std::uint32_t mode) {
+	// the guest was given the array itself, so there's nothing to copy back
+}
+
+void Silene::JniState::emu_getArrayRegion(Environment& env, std::uint32_t java_env, std::uint32_t jarray, std::uint32_t start, std::uint32_t len, std::uint32_t buf_ptr) {
+	auto array = env.jni().get_array(jarray);
+	if (!array) {
+		spdlog::warn("Get*ArrayRegion called on non array ref {:#08x}", jarray);
+		return;
+	}
+
+	if (!check_region(*array, start, len) || len == 0) {
+		return;
+	}
+
+	auto src = env.memory_manager().read_bytes<std::uint8_t>(array->elements_ptr() + start * array->element_size);
+	auto buf = env.memory_manager().read_bytes<std::uint8_t>(buf_ptr);
+
+	std::memmove(buf, src, len * array->element_size);
+}
+
+void Silene::JniState::emu_setArrayRegion(Environment& env, std::uint32_t java_env, std::uint32_t jarray, std::uint32_t start, std::uint32_t len, std::uint32_t buf_ptr) {
+	auto array = env.jni().get_array(jarray);
+	if (!array) {
+		spdlog::warn("Set*ArrayRegion called on non array ref {:#08x}", jarray);
+		return;
+	}
+
+	if (!check_region(*array, start, len) || len == 0) {
+		return;
+	}
+
+	auto buf = env.memory_manager().read_bytes<std::uint8_t>(buf_ptr);
+	auto dest = env.memory_manager().read_bytes<std::uint8_t>(array->elements_ptr() + start * array->element_size);
+
+	std::memmove(dest, buf, len * array->element_size);
+}
+
+std::uint32_t Silene::JniState::register_static(std::string class_name, std::string signature, StaticJavaClass::JniFunction fn) {
+	std::uint32_t class_id;
+	if (auto jclass = _class_name_mapping.find(class_name); jclass != _class_name_mapping.end()) {
+		class_id = jclass->second;
+	} else {
+		// class doesn't exist, time to create it
+		class_id = _class_count;
+		_class_count++;
+
+		_class_name_mapping[class_name] = class_id;
+		_class_mapping[class_id] = {class_id, class_name};
+	}
 
 	auto& clazz = _class_mapping[class_id];
+	if (auto jmethod = clazz.method_names.find(signature); jmethod != clazz.method_names.end()) {
+		// oops! we already have a method of that id
+		return jmethod->second;
+	}
 
-	auto method_id = clazz.method_count;
-	clazz.method_count++;
+	// signatures come in as name;descriptor
+	auto split = signature.find(';');
+	auto method_name = signature.substr(0, split);
+	auto method_descriptor = split != std::string::npos ? signature.substr(split + 1) : std::string{};
+
+	_methods.push_back({class_id, method_name, method_descriptor, fn});
+	auto method_id = static_cast<std::uint32_t>(_methods.size());
 
 	clazz.method_names[signature] = method_id;
-	clazz.method_impls[method_id] = fn;
 
 	return method_id;
 }
-
@@ -4,15 +4,21 @@
 #define _JNI_H
 
 #include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <unordered_map>
 #include <variant>
 #include <string>
+#include <thread>
 #include <vector>
 #include <string_view>
 
 class StateHolder;
 class Environment;
 class PagedMemory;
+class LibcState;
 
 namespace Silene {
 
@@ -279,32 +285,241 @@ class JniState {
 		std::string name;
 
 		std::unordered_map<std::string /* method_signature */, std::uint32_t /* method_id */> method_names{};
-		std::unordered_map<std::uint32_t /* method_id */, JniFunction> method_impls{};
-		std::uint32_t method_count{1};
+	};
+
+	struct StaticMethod {
+		std::uint32_t class_id;
+
+		// kept apart so cached lookups can be checked against the guest's strings without building anything
+		std::string name;
+		std::string signature;
+
+		StaticJavaClass::JniFunction fn;
+	};
+
+	/**
+	 * a GetStaticMethodID call, by the guest addresses of its strings. they're nearly always literals
+	 */
+	struct MethodLookup {
+		std::uint32_t class_id;
+		std::uint32_t name_ptr;
+		std::uint32_t signature_ptr;
+
+		bool operator==(const MethodLookup&) const = default;
+	};
+
+	struct MethodLookupHash {
+		std::size_t operator()(const MethodLookup& lookup) const {
+			auto ptrs = (static_cast<std::uint64_t>(lookup.name_ptr) << 32) | lookup.signature_ptr;
+			return std::hash<std::uint64_t>{}(ptrs ^ lookup.class_id);
+		}
+	};
+
+public:
+	/**
+	 * written at the start of every primitive array's guest allocation, right before the elements
+	 */
+	struct ArrayHeader {
+		std::uint32_t length;
+		std::uint32_t element_size;
+	};
+
+	/**
+	 * a java primitive array. the elements live in guest memory, so they can be handed to the guest directly
+	 */
+	struct PrimitiveArray {
+		std::uint32_t header_ptr;
+
+		std::uint32_t length;
+		std::uint32_t element_size;
+
+		// how many elements the allocation has room for, the length can be changed up to this by the host
+		std::uint32_t capacity;
+
+		std::uint32_t elements_ptr() const {
+			return this->header_ptr + sizeof(ArrayHeader);
+		}
+	};
+
+	/**
+	 * a java string. it lives in guest memory once as utf-16 and once as modified utf-8, so neither has to be made
+	 * when the guest asks for it. the utf-16 comes first, the modified utf-8 right after it with a null byte at the end
+	 */
+	struct JavaString {
+		std::uint32_t chars_ptr;
+
+		// in utf-16 units
+		std::uint32_t length;
+
+		// in bytes, without the null byte
+		std::uint32_t utf_length;
+
+		std::uint32_t utf_ptr() const {
+			return this->chars_ptr + this->length * sizeof(std::uint16_t);
+		}
+	};
+
+	using RefType = std::variant<JavaString, PrimitiveArray>;
+
+	// matches jobjectRefType
+	enum class RefKind : std::uint32_t {
+		Invalid = 0,
+		Local = 1,
+		Global = 2,
+	};
+
+	/**
+	 * gives native code called from the host its own frame of local references, which is popped when this goes away
+	 */
+	class LocalFrame {
+		JniState& _jni;
+
+	public:
+		LocalFrame(JniState& jni) : _jni{jni} {
+			this->_jni.push_local_frame();
+		}
+
+		~LocalFrame() {
+			this->_jni.pop_local_frame(0);
+		}
+
+		LocalFrame(const LocalFrame&) = delete;
+		LocalFrame& operator=(const LocalFrame&) = delete;
+	};
+
+private:
+	/**
+	 * references are handles into a table rather than guest memory, so slots can be reused.
+	 * a handle is laid out as 1iii'iiii'iiii'iiii'iiii'gggg'gggg'ggkk, with the slot's index, the generation it was
+	 * handed out in and its kind. the generation changes every time a slot is freed, so stale handles can be caught
+	 */
+	static constexpr std::uint32_t REF_TAG = 0x8000'0000;
+	static constexpr std::uint32_t REF_KIND_BITS = 2;
+	static constexpr std::uint32_t REF_GENERATION_BITS = 10;
+	static constexpr std::uint32_t REF_INDEX_BITS = 19;
+
+	static constexpr std::uint32_t REF_KIND_MASK = (1u << REF_KIND_BITS) - 1;
+	static constexpr std::uint32_t REF_GENERATION_MASK = (1u << REF_GENERATION_BITS) - 1;
+	static constexpr std::uint32_t MAX_REFS = 1u << REF_INDEX_BITS;
+
+	struct RefSlot {
+		// shared between every reference to the same object
+		std::shared_ptr<RefType> object{};
+
+		std::uint32_t generation{0u};
+		RefKind kind{RefKind::Invalid};
+
+		// the thread a local reference belongs to, and where it sits in that thread's refs.
+		// deleting it early leaves a hole there instead of a stale handle
+		std::thread::id local_owner{};
+		std::size_t local_index{0u};
+	};
+
+	/**
+	 * handles of a thread's local references in the order they were made (0 once deleted), along with where each
+	 * frame starts. the first frame is never popped, it holds anything made outside of a call from the host
+	 */
+	struct LocalRefs {
+		std::vector<std::uint32_t> refs{};
+		std::vector<std::size_t> frames{0};
 	};
 
 	PagedMemory& _memory;
 
+	// arrays are allocated on the guest's heap
+	LibcState* _libc{nullptr};
+
 	std::uint32_t _vm_ptr{0};
 	std::uint32_t _env_ptr{0};
 
-	using RefType = std::variant<std::string, std::vector<int>, std::vector<float>>;
+	std::mutex _refs_mutex{};
+
+	// a deque, so values handed out by reference stay put when the table grows
+	std::deque<RefSlot> _refs{};
+	std::vector<std::uint32_t> _free_refs{};
+
+	// local references only live as long as the frame they were made in, and every thread has its own frames.
+	// each guest thread runs on a host thread of its own, so they're kept by the host thread
+	std::unordered_map<std::thread::id, LocalRefs> _local_refs{};
+
+	// strings by a hash of their modified utf-8, so the same contents share one object while it's alive
+	std::unordered_multimap<std::size_t, std::weak_ptr<RefType>> _interned_strings{};
+	std::size_t _interned_sweep_at{64u};
+
+	// constant strings made by the host are kept alive forever, as they're usually made over and over
+	std::vector<std::shared_ptr<RefType>> _constant_strings{};
 
-	std::unordered_map<std::uint32_t /* vaddr */, RefType /* stored */> _object_refs{};
+	static std::uint32_t encode_ref(std::uint32_t index, std::uint32_t generation, RefKind kind);
+
+	/**
+	 * finds the slot a handle points to, or nullptr if it's invalid or stale
+	 */
+	RefSlot* find_ref(std::uint32_t handle);
+
+	std::uint32_t add_ref(std::shared_ptr<RefType> object, RefKind kind);
+	void free_ref(std::uint32_t handle);
+
+	/**
+	 * the local references of the calling thread. the lock has to be held
+	 */
+	LocalRefs& local_refs();
+
+	/**
+	 * checks that a region is inside the array, warning about it if it isn't
+	 */
+	static bool check_region(const PrimitiveArray& array, std::uint32_t start, std::uint32_t len);
+	static bool check_region(const JavaString& string, std::uint32_t start, std::uint32_t len);
+
+	/**
+	 * finds a live string with the same contents, or copies it into guest memory. the lock has to be held
+	 */
+	std::shared_ptr<RefType> intern_string(std::string_view str);
+
+	std::optional<JavaString> get_java_string(std::uint32_t handle);
 
 	// use a non-zero value to avoid tricking it
 	std::uint32_t _class_count{1};
 	std::unordered_map<std::string /* class_name */, std::uint32_t /* class_id */> _class_name_mapping{};
 	std::unordered_map<std::uint32_t /* class_id */, StaticJavaClass /* class */> _class_mapping{};
 
+	// method ids are an index into this, offset by one so 0 is never valid. only added to before the guest runs
+	std::vector<StaticMethod> _methods{};
+
+	std::mutex _method_lookups_mutex{};
+	std::unordered_map<MethodLookup, std::uint32_t /* method_id */, MethodLookupHash> _method_lookups{};
+
+	static std::uint32_t emu_newString(Environment& env, std::uint32_t java_env, std::uint32_t chars_ptr, std::uint32_t length);
 	static std::uint32_t emu_newStringUTF(Environment& env, std::uint32_t java_env, std::uint32_t string_ptr);
+	static std::uint32_t emu_getStringLength(Environment& env, std::uint32_t java_env, std::uint32_t string);
+	static std::uint32_t emu_getStringUTFLength(Environment& env, std::uint32_t java_env, std::uint32_t string);
+
+	// strings are never copied, so both the critical and regular versions use these
+	static std::uint32_t emu_getStringChars(Environment& env, std::uint32_t java_env, std::uint32_t string, std::uint32_t is_copy_ptr);
 	static std::uint32_t emu_getStringUTFChars(Environment& env, std::uint32_t java_env, std::uint32_t string, std::uint32_t is_copy_ptr);
-	static void emu_releaseStringUTFChars(Environment& env, std::uint32_t java_env, std::uint32_t jstring, std::uint32_t string_ptr);
+	static void emu_releaseStringChars(Environment& env, std::uint32_t java_env, std::uint32_t jstring, std::uint32_t chars_ptr);
+
+	static void emu_getStringRegion(Environment& env, std::uint32_t java_env, std::uint32_t string, std::uint32_t start, std::uint32_t len, std::uint32_t buf_ptr);
+	static void emu_getStringUTFRegion(Environment& env, std::uint32_t java_env, std::uint32_t string, std::uint32_t start, std::uint32_t len, std::uint32_t buf_ptr);
 	static void emu_deleteLocalRef(Environment& env, std::uint32_t java_env, std::uint32_t local_ref);
+	static std::uint32_t emu_newLocalRef(Environment& env, std::uint32_t java_env, std::uint32_t ref);
+	static std::uint32_t emu_newGlobalRef(Environment& env, std::uint32_t java_env, std::uint32_t ref);
+	static void emu_deleteGlobalRef(Environment& env, std::uint32_t java_env, std::uint32_t global_ref);
+	static std::uint32_t emu_pushLocalFrame(Environment& env, std::uint32_t java_env, std::uint32_t capacity);
+	static std::uint32_t emu_popLocalFrame(Environment& env, std::uint32_t java_env, std::uint32_t result);
+	static std::uint32_t emu_ensureLocalCapacity(Environment& env, std::uint32_t java_env, std::uint32_t capacity);
+	static std::uint32_t emu_isSameObject(Environment& env, std::uint32_t java_env, std::uint32_t ref1, std::uint32_t ref2);
+	static std::uint32_t emu_getObjectRefType(Environment& env, std::uint32_t java_env, std::uint32_t ref);
 
 	static std::uint32_t emu_getArrayLength(Environment& env, std::uint32_t java_env, std::uint32_t jarray);
-	static void emu_getIntArrayRegion(Environment& env, std::uint32_t java_env, std::uint32_t jarray, std::uint32_t start, std::uint32_t len, std::uint32_t buf_ptr);
-	static void emu_getFloatArrayRegion(Environment& env, std::uint32_t java_env, std::uint32_t jarray, std::uint32_t start, std::uint32_t len, std::uint32_t buf_ptr);
+
+	template <std::uint32_t ElementSize>
+	static std::uint32_t emu_newArray(Environment& env, std::uint32_t java_env, std::uint32_t length);
+
+	// every element type shares these, as the array knows its own element size
+	static std::uint32_t emu_getArrayElements(Environment& env, std::uint32_t java_env, std::uint32_t jarray, std::uint32_t is_copy_ptr);
+	static void emu_releaseArrayElements(Environment& env, std::uint32_t java_env, std::uint32_t jarray, std::uint32_t elems_ptr, std::uint32_t mode);
+	static void emu_getArrayRegion(Environment& env, std::uint32_t java_env, std::uint32_t jarray, std::uint32_t start, std::uint32_t len, std::uint32_t buf_ptr);
+	static void emu_setArrayRegion(Environment& env, std::uint32_t java_env, std::uint32_t jarray, std::uint32_t start, std::uint32_t len, std::uint32_t buf_ptr);
 
 	static std::uint32_t emu_getEnv(Environment& env, std::uint32_t java_env, std::uint32_t out_ptr, std::uint32_t version);
 	static std::uint32_t emu_attachCurrentThread(Environment& env, std::uint32_t java_env, std::uint32_t p_env_ptr, std::uint32_t attach_args_ptr);
@@ -314,7 +529,15 @@ class JniState {
 
 	static void emu_callStaticMethodV(Environment& env, std::uint32_t java_env, std::uint32_t local_ref, std::uint32_t method_id);
 
-	StaticJavaClass::JniFunction get_fn(std::uint32_t class_id, std::uint32_t method_id) const;
+	/**
+	 * returns nullptr if the method doesn't exist
+	 */
+	StaticJavaClass::JniFunction get_fn(std::uint32_t method_id) const;
+
+	/**
+	 * finds a method by its full name and signature, returning 0 if it doesn't exist
+	 */
+	std::uint32_t find_static_method(std::uint32_t class_id, std::string_view name, std::string_view signature) const;
 
 public:
 	void pre_init(const StateHolder& env);
@@ -328,25 +551,75 @@ public:
 	}
 
 	/**
-	 * removes a stored reference
+	 * removes a stored reference, of any kind
 	 */
-	void remove_ref(std::uint32_t vaddr);
+	void remove_ref(std::uint32_t handle);
 
 	/**
-	 * gets the value associated with a stored reference
+	 * gets the value associated with a stored reference. throws std::out_of_range if the reference is invalid or stale
 	 */
-	RefType& get_ref_value(std::uint32_t vaddr);
+	RefType& get_ref_value(std::uint32_t handle);
 
 	/**
-	 * stores a reference to a string variable, like a jstring
+	 * stores a reference to a string variable, like a jstring. str is utf-8, and shares its object with any live
+	 * string that has the same contents. constant strings are never freed, which makes creating them again free
 	 */
-	std::uint32_t create_string_ref(std::string_view str);
+	std::uint32_t create_string_ref(std::string_view str, bool constant = false);
 
 	/**
-	 * Stores a reference to a generic variable
+	 * gets the modified utf-8 contents of a string, or nothing if the reference isn't one.
+	 * the view points into guest memory, and stays valid for as long as the reference does
+	 */
+	std::optional<std::string_view> get_string(std::uint32_t handle);
+
+	/**
+	 * stores a value as a local reference in the current frame
 	 */
 	std::uint32_t create_ref(RefType t);
 
+	/**
+	 * allocates a zeroed primitive array in guest memory. returns 0 if it couldn't be allocated
+	 */
+	std::uint32_t create_array(std::uint32_t element_size, std::uint32_t length, RefKind kind = RefKind::Local);
+
+	/**
+	 * gets a primitive array, or nothing if the reference isn't one
+	 */
+	std::optional<PrimitiveArray> get_array(std::uint32_t handle);
+
+	/**
+	 * changes the length of an array the host made, up to the size it was made with
+	 */
+	void set_array_length(std::uint32_t handle, std::uint32_t length);
+
+	/**
+	 * makes another reference to the object behind an existing one, returning 0 if that one isn't valid
+	 */
+	std::uint32_t duplicate_ref(std::uint32_t handle, RefKind kind);
+
+	RefKind get_ref_kind(std::uint32_t handle);
+
+	/**
+	 * starts a new frame of local references for the calling thread
+	 */
+	void push_local_frame();
+
+	/**
+	 * frees every local reference made since the last push. result is carried over into the frame below,
+	 * and the new reference to it is returned
+	 */
+	std::uint32_t pop_local_frame(std::uint32_t result);
+
+	/**
+	 * frees every local reference the calling thread still has, for when it exits
+	 */
+	void release_thread_refs();
+
+	/**
+	 * number of references that are alive right now
+	 */
+	std::size_t live_refs();
+
 	/**
 	 * registers a static jni method
 	 */
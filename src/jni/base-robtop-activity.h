@@ -11,7 +11,7 @@ std::uint32_t jni_get_user_id(Environment& env) {
 	// i just generated a random uuid. there's no networking support, so i don't care yet
 	auto uuid = "cc52b577-524d-41b1-b3f0-e46d13dd1452";
 
-	return jni.create_string_ref(uuid);
+	return jni.create_string_ref(uuid, true);
 }
 
 bool jni_is_network_available(Environment& env) {
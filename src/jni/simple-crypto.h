@@ -7,11 +7,11 @@
 
 std::uint32_t jni_decrypt_file_to_string(Environment& env, std::uint32_t java_env, std::uint32_t local_ref, std::uint32_t method_id, VaList args) {
 	auto file_ptr = args.next<std::uint32_t>();
-	auto title = std::get<std::string>(env.jni().get_ref_value(file_ptr));
+	auto title = env.jni().get_string(file_ptr).value_or("");
 
 	spdlog::info("TODO: decrypt file {}", title);
 
-	return env.jni().create_string_ref("");
+	return env.jni().create_string_ref("", true);
 }
 
 #endif
\ No newline at end of file
@@ -13,6 +13,25 @@ std::int32_t kernel_fcntl(Environment& env, std::int32_t fd, std::int32_t op, st
 		spdlog::info("TODO: fcntl({}, {}, {})", fd, op, arg);
 	}
 
+	// sockets stay non-blocking on the host, so only the guest's view of O_NONBLOCK changes
+	constexpr auto EMU_O_NONBLOCK = 04000;
+
+	auto& sockets = env.libc().sockets();
+	if ((op == F_GETFL || op == F_SETFL) && sockets.is_socket(fd)) {
+		if (op == F_SETFL) {
+			sockets.set_guest_blocking(fd, (arg & EMU_O_NONBLOCK) == 0);
+			return fcntl(fd, F_SETFL, (arg & ~EMU_O_NONBLOCK) | O_NONBLOCK);
+		}
+
+		auto flags = fcntl(fd, F_GETFL);
+		if (flags == -1) {
+			return -1;
+		}
+
+		flags &= ~O_NONBLOCK;
+		return sockets.is_guest_blocking(fd) ? flags : (flags | EMU_O_NONBLOCK);
+	}
+
 	return fcntl(fd, op, arg);
 }
 
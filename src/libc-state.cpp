@@ -334,8 +334,106 @@ void LibcState::set_strtok_buffer(std::uint32_t x) {
 	this->_strtok_buffer = x;
 }
 
-std::uint32_t LibcState::get_errno_addr() const {
-	return this->_errno_addr;
+std::uint32_t LibcState::get_errno_addr(Environment& env) const {
+	return env.tls_addr() + TLS_SLOT_ERRNO * sizeof(std::uint32_t);
+}
+
+void LibcState::set_errno(Environment& env, std::int32_t value) {
+	this->_memory.write_word(this->get_errno_addr(env), value);
+}
+
+std::uint32_t LibcState::allocate_tls(std::uint32_t thread_id) {
+	auto tls = this->allocate_memory(TLS_SLOT_COUNT * sizeof(std::uint32_t), true);
+
+	this->_memory.write_word(tls + TLS_SLOT_SELF * sizeof(std::uint32_t), tls);
+	this->_memory.write_word(tls + TLS_SLOT_THREAD_ID * sizeof(std::uint32_t), thread_id);
+
+	std::scoped_lock lk{_tls_lock};
+	_tls_blocks.insert(tls);
+
+	return tls;
+}
+
+void LibcState::exit_thread(Environment& env) {
+	auto tls = env.tls_addr();
+	auto slots = this->_memory.read_bytes<std::uint32_t>(tls);
+
+	// destructors can set new values, so bionic repeats this a few times
+	for (auto i = 0u; i < TLS_DESTRUCTOR_ITERATIONS; i++) {
+		auto called_destructor = false;
+
+		for (auto key = TLS_SLOT_FIRST_USER_SLOT; key < TLS_SLOT_COUNT; key++) {
+			auto destructor = 0u;
+			{
+				std::scoped_lock lk{_tls_lock};
+				if (!_tls_keys[key].in_use) {
+					continue;
+				}
+
+				destructor = _tls_keys[key].destructor;
+			}
+
+			auto value = slots[key];
+			if (destructor == 0 || value == 0) {
+				continue;
+			}
+
+			slots[key] = 0;
+			SyscallTranslator::call_func<void>(env, destructor, value);
+			called_destructor = true;
+		}
+
+		if (!called_destructor) {
+			break;
+		}
+	}
+
+	{
+		std::scoped_lock lk{_tls_lock};
+		_tls_blocks.erase(tls);
+	}
+
+	this->free_memory(tls);
+}
+
+std::uint32_t LibcState::create_tls_key(std::uint32_t destructor) {
+	std::scoped_lock lk{_tls_lock};
+
+	for (auto key = TLS_SLOT_FIRST_USER_SLOT; key < TLS_SLOT_COUNT; key++) {
+		auto& tls_key = _tls_keys[key];
+		if (tls_key.in_use) {
+			continue;
+		}
+
+		tls_key.in_use = true;
+		tls_key.destructor = destructor;
+
+		return key;
+	}
+
+	return 0;
+}
+
+bool LibcState::delete_tls_key(std::uint32_t key) {
+	std::scoped_lock lk{_tls_lock};
+
+	if (key < TLS_SLOT_FIRST_USER_SLOT || key >= TLS_SLOT_COUNT || !_tls_keys[key].in_use) {
+		return false;
+	}
+
+	_tls_keys[key] = {};
+
+	// clear out the old values, so the next user of this key doesn't see them
+	for (auto tls : _tls_blocks) {
+		this->_memory.write_word(tls + key * sizeof(std::uint32_t), 0);
+	}
+
+	return true;
+}
+
+bool LibcState::is_tls_key_valid(std::uint32_t key) {
+	std::scoped_lock lk{_tls_lock};
+	return key >= TLS_SLOT_FIRST_USER_SLOT && key < TLS_SLOT_COUNT && _tls_keys[key].in_use;
 }
 
 void LibcState::pre_init(const StateHolder& env) {
@@ -386,6 +484,8 @@ void LibcState::pre_init(const StateHolder& env) {
 	REGISTER_FN(env, pthread_detach);
 	REGISTER_FN(env, pthread_mutex_init);
 	REGISTER_FN(env, pthread_mutex_lock);
+	REGISTER_FN(env, pthread_mutex_trylock);
+	REGISTER_FN(env, pthread_mutex_timedlock);
 	REGISTER_FN(env, pthread_mutex_destroy);
 	REGISTER_FN(env, pthread_mutex_unlock);
 	REGISTER_FN(env, pthread_cond_init);
@@ -393,12 +493,17 @@ void LibcState::pre_init(const StateHolder& env) {
 	REGISTER_FN(env, pthread_cond_broadcast);
 	REGISTER_FN(env, pthread_cond_signal);
 	REGISTER_FN(env, pthread_cond_wait);
+	REGISTER_FN(env, pthread_cond_timedwait);
+	REGISTER_FN(env, pthread_cond_timedwait_monotonic_np);
+	REGISTER_FN(env, pthread_cond_timeout_np);
 	REGISTER_FN(env, pthread_getspecific);
 	REGISTER_FN(env, pthread_setspecific);
 	REGISTER_FN(env, pthread_exit);
 	REGISTER_FN(env, sem_init);
 	REGISTER_FN(env, sem_post);
 	REGISTER_FN(env, sem_wait);
+	REGISTER_FN(env, sem_timedwait);
+	REGISTER_FN(env, sem_trywait);
 	REGISTER_FN(env, sem_destroy);
 	REGISTER_FN(env, memcpy);
 	REGISTER_FN(env, memmove);
@@ -501,72 +606,69 @@ void LibcState::pre_init(const StateHolder& env) {
 	this->_memory.copy(toupper_tab_addr, &emu__toupper_tab_, sizeof(emu__toupper_tab_));
 	env.program_loader().add_stub_symbol(toupper_tab_addr, "_toupper_tab_");
 
-	auto errno_addr = this->_memory.get_next_word_addr();
-	this->_memory.allocate(0x4);
-	this->_memory.write_word(errno_addr, 0x0);
-	_errno_addr = errno_addr;
-
 	REGISTER_SYSCALL(env, open, 0x5);
 	REGISTER_SYSCALL(env, fcntl, 0x37);
 	REGISTER_SYSCALL(env, fstat, 0x6c);
 	REGISTER_SYSCALL(env, openat, 0x142);
 
-	REGISTER_FN_RN(env, emu_glGetString, "glGetString");
-	REGISTER_FN_RN(env, emu_glGetIntegerv, "glGetIntegerv");
-	REGISTER_FN_RN(env, emu_glGetFloatv, "glGetFloatv");
-	REGISTER_FN_RN(env, emu_glPixelStorei, "glPixelStorei");
-	REGISTER_FN_RN(env, emu_glCreateShader, "glCreateShader");
-	REGISTER_FN_RN(env, emu_glShaderSource, "glShaderSource");
-	REGISTER_FN_RN(env, emu_glCompileShader, "glCompileShader");
-	REGISTER_FN_RN(env, emu_glGetShaderiv, "glGetShaderiv");
-	REGISTER_FN_RN(env, emu_glCreateProgram, "glCreateProgram");
-	REGISTER_FN_RN(env, emu_glAttachShader, "glAttachShader");
-	REGISTER_FN_RN(env, emu_glBindAttribLocation, "glBindAttribLocation");
-	REGISTER_FN_RN(env, emu_glLinkProgram, "glLinkProgram");
-	REGISTER_FN_RN(env, emu_glDeleteShader, "glDeleteShader");
-	REGISTER_FN_RN(env, emu_glGetShaderSource, "glGetShaderSource");
-	REGISTER_FN_RN(env, emu_glGetUniformLocation, "glGetUniformLocation");
-	REGISTER_FN_RN(env, emu_glEnable, "glEnable");
-	REGISTER_FN_RN(env, emu_glDisable, "glDisable");
-	REGISTER_FN_RN(env, emu_glUniform1i, "glUniform1i");
-	REGISTER_FN_RN(env, emu_glUniform4fv, "glUniform4fv");
-	REGISTER_FN_RN(env, emu_glUniformMatrix4fv, "glUniformMatrix4fv");
-	REGISTER_FN_RN(env, emu_glUseProgram, "glUseProgram");
-	REGISTER_FN_RN(env, emu_glBindBuffer, "glBindBuffer");
-	REGISTER_FN_RN(env, emu_glBindTexture, "glBindTexture");
-	REGISTER_FN_RN(env, emu_glActiveTexture, "glActiveTexture");
-	REGISTER_FN_RN(env, emu_glBufferData, "glBufferData");
-	REGISTER_FN_RN(env, emu_glTexParameteri, "glTexParameteri");
-	REGISTER_FN_RN(env, emu_glGenTextures, "glGenTextures");
-	REGISTER_FN_RN(env, emu_glDeleteTextures, "glDeleteTextures");
-	REGISTER_FN_RN(env, emu_glGenBuffers, "glGenBuffers");
-	REGISTER_FN_RN(env, emu_glDeleteBuffers, "glDeleteBuffers");
-	REGISTER_FN_RN(env, emu_glBlendFunc, "glBlendFunc");
-	REGISTER_FN_RN(env, emu_glClearDepthf, "glClearDepthf");
-	REGISTER_FN_RN(env, emu_glDepthFunc, "glDepthFunc");
-	REGISTER_FN_RN(env, emu_glClearColor, "glClearColor");
-	REGISTER_FN_RN(env, emu_glViewport, "glViewport");
-	REGISTER_FN_RN(env, emu_glTexImage2D, "glTexImage2D");
-	REGISTER_FN_RN(env, emu_glDrawArrays, "glDrawArrays");
-	REGISTER_FN_RN(env, emu_glDrawElements, "glDrawElements");
-	REGISTER_FN_RN(env, emu_glClear, "glClear");
-	REGISTER_FN_RN(env, emu_glVertexAttribPointer, "glVertexAttribPointer");
-	REGISTER_FN_RN(env, emu_glEnableVertexAttribArray, "glEnableVertexAttribArray");
-	REGISTER_FN_RN(env, emu_glDisableVertexAttribArray, "glDisableVertexAttribArray");
-	REGISTER_FN_RN(env, emu_glBufferSubData, "glBufferSubData");
-	REGISTER_FN_RN(env, emu_glLineWidth, "glLineWidth");
-	REGISTER_FN_RN(env, emu_glGetError, "glGetError");
-	REGISTER_FN_RN(env, emu_glScissor, "glScissor");
-	REGISTER_FN_RN(env, emu_glGetShaderInfoLog, "glGetShaderInfoLog");
-	REGISTER_FN_RN(env, emu_glUniform1f, "glUniform1f");
-	REGISTER_FN_RN(env, emu_glUniform2f, "glUniform2f");
-	REGISTER_FN_RN(env, emu_glUniform3f, "glUniform3f");
-	REGISTER_FN_RN(env, emu_glBindRenderbuffer, "glBindRenderbuffer");
-	REGISTER_FN_RN(env, emu_glBindFramebuffer, "glBindFramebuffer");
-	REGISTER_FN_RN(env, emu_glFramebufferTexture2D, "glFramebufferTexture2D");
-	REGISTER_FN_RN(env, emu_glGenRenderbuffers, "glGenRenderbuffers");
-	REGISTER_FN_RN(env, emu_glFramebufferRenderbuffer, "glFramebufferRenderbuffer");
-	REGISTER_FN_RN(env, emu_glGenFramebuffers, "glGenFramebuffers");
-	REGISTER_FN_RN(env, emu_glCheckFramebufferStatus, "glCheckFramebufferStatus");
-	REGISTER_FN_RN(env, emu_glUniform4f, "glUniform4f");
+	REGISTER_GL_FN(env, emu_glGetString, "glGetString");
+	REGISTER_GL_FN(env, emu_glGetIntegerv, "glGetIntegerv");
+	REGISTER_GL_FN(env, emu_glGetFloatv, "glGetFloatv");
+	REGISTER_GL_BATCHED(env, emu_glPixelStorei, "glPixelStorei");
+	REGISTER_GL_FN(env, emu_glCreateShader, "glCreateShader");
+	REGISTER_GL_FN(env, emu_glShaderSource, "glShaderSource");
+	REGISTER_GL_FN(env, emu_glCompileShader, "glCompileShader");
+	REGISTER_GL_FN(env, emu_glGetShaderiv, "glGetShaderiv");
+	REGISTER_GL_FN(env, emu_glCreateProgram, "glCreateProgram");
+	REGISTER_GL_FN(env, emu_glDeleteProgram, "glDeleteProgram");
+	REGISTER_GL_FN(env, emu_glAttachShader, "glAttachShader");
+	REGISTER_GL_FN(env, emu_glDetachShader, "glDetachShader");
+	REGISTER_GL_FN(env, emu_glBindAttribLocation, "glBindAttribLocation");
+	REGISTER_GL_FN(env, emu_glLinkProgram, "glLinkProgram");
+	REGISTER_GL_FN(env, emu_glDeleteShader, "glDeleteShader");
+	REGISTER_GL_FN(env, emu_glGetShaderSource, "glGetShaderSource");
+	REGISTER_GL_FN(env, emu_glGetUniformLocation, "glGetUniformLocation");
+	REGISTER_GL_BATCHED(env, emu_glEnable, "glEnable");
+	REGISTER_GL_BATCHED(env, emu_glDisable, "glDisable");
+	REGISTER_GL_BATCHED(env, emu_glUniform1i, "glUniform1i");
+	REGISTER_GL_FN(env, emu_glUniform4fv, "glUniform4fv");
+	REGISTER_GL_FN(env, emu_glUniformMatrix4fv, "glUniformMatrix4fv");
+	REGISTER_GL_BATCHED(env, emu_glUseProgram, "glUseProgram");
+	REGISTER_GL_BATCHED(env, emu_glBindBuffer, "glBindBuffer");
+	REGISTER_GL_BATCHED(env, emu_glBindTexture, "glBindTexture");
+	REGISTER_GL_BATCHED(env, emu_glActiveTexture, "glActiveTexture");
+	REGISTER_GL_FN(env, emu_glBufferData, "glBufferData");
+	REGISTER_GL_BATCHED(env, emu_glTexParameteri, "glTexParameteri");
+	REGISTER_GL_FN(env, emu_glGenTextures, "glGenTextures");
+	REGISTER_GL_FN(env, emu_glDeleteTextures, "glDeleteTextures");
+	REGISTER_GL_FN(env, emu_glGenBuffers, "glGenBuffers");
+	REGISTER_GL_FN(env, emu_glDeleteBuffers, "glDeleteBuffers");
+	REGISTER_GL_BATCHED(env, emu_glBlendFunc, "glBlendFunc");
+	REGISTER_GL_BATCHED(env, emu_glClearDepthf, "glClearDepthf");
+	REGISTER_GL_BATCHED(env, emu_glDepthFunc, "glDepthFunc");
+	REGISTER_GL_BATCHED(env, emu_glClearColor, "glClearColor");
+	REGISTER_GL_BATCHED(env, emu_glViewport, "glViewport");
+	REGISTER_GL_FN(env, emu_glTexImage2D, "glTexImage2D");
+	REGISTER_GL_FN(env, emu_glDrawArrays, "glDrawArrays");
+	REGISTER_GL_FN(env, emu_glDrawElements, "glDrawElements");
+	REGISTER_GL_BATCHED(env, emu_glClear, "glClear");
+	REGISTER_GL_FN(env, emu_glVertexAttribPointer, "glVertexAttribPointer");
+	REGISTER_GL_BATCHED(env, emu_glEnableVertexAttribArray, "glEnableVertexAttribArray");
+	REGISTER_GL_BATCHED(env, emu_glDisableVertexAttribArray, "glDisableVertexAttribArray");
+	REGISTER_GL_FN(env, emu_glBufferSubData, "glBufferSubData");
+	REGISTER_GL_BATCHED(env, emu_glLineWidth, "glLineWidth");
+	REGISTER_GL_FN(env, emu_glGetError, "glGetError");
+	REGISTER_GL_BATCHED(env, emu_glScissor, "glScissor");
+	REGISTER_GL_FN(env, emu_glGetShaderInfoLog, "glGetShaderInfoLog");
+	REGISTER_GL_BATCHED(env, emu_glUniform1f, "glUniform1f");
+	REGISTER_GL_BATCHED(env, emu_glUniform2f, "glUniform2f");
+	REGISTER_GL_BATCHED(env, emu_glUniform3f, "glUniform3f");
+	REGISTER_GL_BATCHED(env, emu_glBindRenderbuffer, "glBindRenderbuffer");
+	REGISTER_GL_BATCHED(env, emu_glBindFramebuffer, "glBindFramebuffer");
+	REGISTER_GL_FN(env, emu_glFramebufferTexture2D, "glFramebufferTexture2D");
+	REGISTER_GL_FN(env, emu_glGenRenderbuffers, "glGenRenderbuffers");
+	REGISTER_GL_BATCHED(env, emu_glFramebufferRenderbuffer, "glFramebufferRenderbuffer");
+	REGISTER_GL_FN(env, emu_glGenFramebuffers, "glGenFramebuffers");
+	REGISTER_GL_FN(env, emu_glCheckFramebufferStatus, "glCheckFramebufferStatus");
+	REGISTER_GL_FN(env, emu_glUniform4f, "glUniform4f");
 }
@@ -7,11 +7,16 @@
 #include <cstdio>
 #include <mutex>
 #include <list>
+#include <array>
+#include <unordered_set>
 
 #include <spdlog/spdlog.h>
 
+#include "libc/socket-reactor.hpp"
+
 class PagedMemory;
 class StateHolder;
+class Environment;
 
 class LibcState {
 	struct StaticDestructor {
@@ -53,12 +58,49 @@ class LibcState {
 
 	void log_allocator_state();
 
-	// this doesn't support multiple threads, too bad?
-	std::uint32_t _errno_addr{0u};
+	struct TlsKey {
+		bool in_use{false};
+		std::uint32_t destructor{0u};
+	};
+
+	// keys are indexes into the tls block, so the well known slots are never handed out
+	std::array<TlsKey, 64> _tls_keys{};
+	std::unordered_set<std::uint32_t> _tls_blocks{};
 
-public:
+	std::mutex _tls_lock{};
 
-	std::uint32_t get_errno_addr() const;
+	SocketReactor _sockets{};
+
+public:
+	// matches the layout of bionic's tls slots
+	static constexpr std::uint32_t TLS_SLOT_SELF = 0;
+	static constexpr std::uint32_t TLS_SLOT_THREAD_ID = 1;
+	static constexpr std::uint32_t TLS_SLOT_ERRNO = 2;
+	static constexpr std::uint32_t TLS_SLOT_FIRST_USER_SLOT = 7;
+	static constexpr std::uint32_t TLS_SLOT_COUNT = 64;
+
+	// bionic's PTHREAD_DESTRUCTOR_ITERATIONS
+	static constexpr std::uint32_t TLS_DESTRUCTOR_ITERATIONS = 4;
+
+	std::uint32_t get_errno_addr(Environment& env) const;
+	void set_errno(Environment& env, std::int32_t value);
+
+	/**
+	 * creates a zeroed tls block for a new thread, returning its address
+	 */
+	std::uint32_t allocate_tls(std::uint32_t thread_id);
+
+	/**
+	 * runs the key destructors for the current thread, then frees its tls block
+	 */
+	void exit_thread(Environment& env);
+
+	/**
+	 * reserves a new pthread key, returning 0 if all keys are taken
+	 */
+	std::uint32_t create_tls_key(std::uint32_t destructor);
+	bool delete_tls_key(std::uint32_t key);
+	bool is_tls_key_valid(std::uint32_t key);
 
 	std::uint32_t allocate_memory(std::uint32_t size, bool zero_mem = false);
 	void free_memory(std::uint32_t vaddr);
@@ -79,6 +121,10 @@ public:
 
 	std::FILE* get_file(std::uint32_t file_ref) const;
 
+	SocketReactor& sockets() {
+		return this->_sockets;
+	}
+
 	void expose_file(std::string emu_name, std::string real_name);
 
 	LibcState(PagedMemory& memory) : _memory(memory) {}
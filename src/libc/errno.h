@@ -6,8 +6,7 @@
 #include "../environment.h"
 
 std::uint32_t emu___errno(Environment& env) {
-	spdlog::info("TODO: errno = {}", errno);
-	return env.libc().get_errno_addr();
+	return env.libc().get_errno_addr(env);
 }
 
 #endif
\ No newline at end of file
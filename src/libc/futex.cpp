@@ -0,0 +1,156 @@
+#include "futex.hpp"
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "../environment.h"
+#include "../scheduler.hpp"
+
+namespace {
+constexpr std::int64_t NS_PER_SECOND = 1'000'000'000;
+
+std::timespec current_time(bool realtime) {
+	std::timespec ts{};
+	clock_gettime(realtime ? CLOCK_REALTIME : CLOCK_MONOTONIC, &ts);
+	return ts;
+}
+
+#ifdef __linux__
+
+std::int32_t host_wait(void* addr, std::uint32_t expected, const Futex::Deadline* deadline) {
+	long r = 0;
+	if (deadline == nullptr) {
+		r = syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+	} else {
+		// bitset waits take an absolute timeout, which is exactly what pthread wants
+		auto op = FUTEX_WAIT_BITSET_PRIVATE | (deadline->realtime ? FUTEX_CLOCK_REALTIME : 0);
+		r = syscall(SYS_futex, addr, op, expected, &deadline->time, nullptr, FUTEX_BITSET_MATCH_ANY);
+	}
+
+	if (r == -1 && errno == ETIMEDOUT) {
+		return Futex::GUEST_ETIMEDOUT;
+	}
+
+	// EAGAIN (value changed) and EINTR are both treated as a wake
+	return 0;
+}
+
+void host_wake(void* addr, std::int32_t count) {
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+#else
+
+// no public futex api outside of linux, so emulate one with a small table of condition variables
+// waiters check the word under the bucket lock, which means a wake can never be missed
+struct WaitBucket {
+	std::mutex lock;
+	std::condition_variable cv;
+};
+
+std::array<WaitBucket, 64> wait_buckets{};
+
+WaitBucket& bucket_for(void* addr) {
+	auto key = reinterpret_cast<std::uintptr_t>(addr) >> 2;
+	return wait_buckets[key % wait_buckets.size()];
+}
+
+template <typename Clock>
+typename Clock::time_point to_time_point(const std::timespec& ts) {
+	auto since_epoch = std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+	return typename Clock::time_point(std::chrono::duration_cast<typename Clock::duration>(since_epoch));
+}
+
+std::int32_t host_wait(void* addr, std::uint32_t expected, const Futex::Deadline* deadline) {
+	auto word = reinterpret_cast<std::atomic_uint32_t*>(addr);
+	auto& bucket = bucket_for(addr);
+
+	std::unique_lock lk{bucket.lock};
+	if (word->load(std::memory_order_relaxed) != expected) {
+		return 0;
+	}
+
+	if (deadline == nullptr) {
+		bucket.cv.wait(lk);
+		return 0;
+	}
+
+	auto status = std::cv_status::no_timeout;
+	if (deadline->realtime) {
+		status = bucket.cv.wait_until(lk, to_time_point<std::chrono::system_clock>(deadline->time));
+	} else {
+		// steady_clock is CLOCK_MONOTONIC on the platforms we care about
+		status = bucket.cv.wait_until(lk, to_time_point<std::chrono::steady_clock>(deadline->time));
+	}
+
+	return status == std::cv_status::timeout ? Futex::GUEST_ETIMEDOUT : 0;
+}
+
+void host_wake(void* addr, std::int32_t count) {
+	auto& bucket = bucket_for(addr);
+
+	// buckets are shared between addresses, so everyone has to recheck their word
+	std::scoped_lock lk{bucket.lock};
+	bucket.cv.notify_all();
+}
+
+#endif
+}
+
+std::optional<Futex::Deadline> Futex::read_deadline(Environment& env, std::uint32_t timespec_ptr, bool realtime) {
+	if (timespec_ptr == 0) {
+		return std::nullopt;
+	}
+
+	// struct timespec { time_t tv_sec; long tv_nsec; }, both are 32 bits on armv7
+	auto tv_sec = static_cast<std::int32_t>(env.memory_manager().read_word(timespec_ptr));
+	auto tv_nsec = static_cast<std::int32_t>(env.memory_manager().read_word(timespec_ptr + 4));
+
+	if (tv_nsec < 0 || tv_nsec >= NS_PER_SECOND) {
+		return std::nullopt;
+	}
+
+	Deadline deadline{};
+	deadline.time.tv_sec = tv_sec;
+	deadline.time.tv_nsec = tv_nsec;
+	deadline.realtime = realtime;
+
+	// the guest worked the deadline out from its own clock, which may not be the host's
+	deadline.time = env.guest_clock().to_host(deadline.time, realtime);
+
+	return deadline;
+}
+
+Futex::Deadline Futex::deadline_from_now(std::uint32_t ms) {
+	auto ts = current_time(false);
+
+	auto nsec = static_cast<std::int64_t>(ts.tv_nsec) + static_cast<std::int64_t>(ms % 1000) * 1'000'000;
+	ts.tv_sec += ms / 1000 + nsec / NS_PER_SECOND;
+	ts.tv_nsec = nsec % NS_PER_SECOND;
+
+	return {ts, false};
+}
+
+std::int32_t Futex::wait(void* addr, std::uint32_t expected, const Deadline* deadline) {
+	if (deadline != nullptr && deadline->time.tv_sec < 0) {
+		return GUEST_ETIMEDOUT;
+	}
+
+	// a waiting thread should not keep a run slot
+	Scheduler::ParkGuard park{};
+	return host_wait(addr, expected, deadline);
+}
+
+void Futex::wake(void* addr, std::int32_t count) {
+	host_wake(addr, count);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef _LIBC_FUTEX_HPP
+#define _LIBC_FUTEX_HPP
+
+#include <cstdint>
+#include <ctime>
+#include <optional>
+
+class Environment;
+
+/**
+ * shared wait/wake layer for the bionic synchronization primitives.
+ * waits happen directly on the host backing memory of a 32-bit guest word
+ */
+namespace Futex {
+	// these are the guest (linux) values, which do not always match the host
+	constexpr std::int32_t GUEST_EAGAIN = 11;
+	constexpr std::int32_t GUEST_EINVAL = 22;
+	constexpr std::int32_t GUEST_ETIMEDOUT = 110;
+
+	constexpr std::int32_t WAKE_ALL = 0x7fff'ffff;
+
+	struct Deadline {
+		std::timespec time;
+		bool realtime;
+	};
+
+	/**
+	 * reads an absolute deadline from a guest timespec
+	 * returns nothing if the timespec is not valid
+	 */
+	std::optional<Deadline> read_deadline(Environment& env, std::uint32_t timespec_ptr, bool realtime);
+
+	/**
+	 * creates a monotonic deadline some amount of milliseconds from now
+	 */
+	Deadline deadline_from_now(std::uint32_t ms);
+
+	/**
+	 * blocks while the word at addr is equal to expected
+	 * returns 0 when woken (spuriously or not), or GUEST_ETIMEDOUT if the deadline has passed
+	 */
+	std::int32_t wait(void* addr, std::uint32_t expected, const Deadline* deadline = nullptr);
+
+	/**
+	 * wakes up to count threads waiting on addr
+	 */
+	void wake(void* addr, std::int32_t count);
+}
+
+#endif
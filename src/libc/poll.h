@@ -4,6 +4,10 @@
 #define _LIBC_POLL_H
 
 #include "../environment.h"
+#include "../scheduler.hpp"
+#include "socket.h"
+
+#include <cstddef>
 
 #include <poll.h>
 
@@ -13,33 +17,29 @@ struct emu_pollfd {
 	std::int16_t revents;
 };
 
-std::int32_t emu_poll(Environment& env, std::uint32_t fds_ptr, std::uint32_t nfds, std::int32_t timeout) {
-	auto emu_fds = env.memory_manager().read_bytes<emu_pollfd>(fds_ptr);
-
-	std::vector<pollfd> fds{};
-	fds.reserve(nfds);
-
-	for (const auto& emu_fd : std::span{emu_fds, nfds}) {
-		struct pollfd fd{
-			.fd = emu_fd.fd,
-			.events = emu_fd.events,
-			.revents = emu_fd.revents
-		};
+// guest pollfds are handed directly to the host, which only works if nothing has moved around
+static_assert(sizeof(emu_pollfd) == sizeof(pollfd) && offsetof(emu_pollfd, events) == offsetof(pollfd, events) && offsetof(emu_pollfd, revents) == offsetof(pollfd, revents), "emu_pollfd does not match the host pollfd");
 
-		fds.push_back(fd);
-	}
-
-	auto r = poll(fds.data(), nfds, timeout);
-	if (r == -1) {
-		return -1;
-	}
-
-	for (auto i = 0u; i < nfds; i++) {
-		auto fd = fds[i];
-		emu_fds[i].revents = fd.revents;
-	}
-
-	return r;
+std::int32_t emu_poll(Environment& env, std::uint32_t fds_ptr, std::uint32_t nfds, std::int32_t timeout) {
+	auto fds = env.memory_manager().read_bytes<pollfd>(fds_ptr);
+
+	// the readiness written back to fds is recorded along with the count
+	return recorded_call(env, ReplayLog::Kind::Poll, {reinterpret_cast<std::uint8_t*>(fds), nfds * sizeof(pollfd)}, [&]() {
+		auto r = 0;
+		if (timeout == 0) {
+			r = poll(fds, nfds, timeout);
+		} else {
+			Scheduler::ParkGuard park{};
+			r = poll(fds, nfds, timeout);
+		}
+
+		if (r == -1) {
+			env.libc().set_errno(env, errno_to_emu(errno));
+			return -1;
+		}
+
+		return r;
+	});
 }
 
 #endif
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <atomic>
 
+#include "futex.hpp"
+
 // hi!
 // https://github.com/aosp-mirror/platform_bionic/blob/main/libc/bionic/pthread_mutex.cpp
 
@@ -87,7 +89,18 @@ std::int32_t mutex_try_lock(BionicMutex* mutex, std::uint16_t shared) {
 	return 16; // EBUSY
 }
 
-std::int32_t mutex_lock(BionicMutex* mutex, std::uint16_t shared) {
+// futexes always operate on 32 bits, so the owner tid is part of the word we wait on
+void* mutex_futex_addr(BionicMutex* mutex) {
+	static_assert(sizeof(BionicMutex) == 4, "bionic mutex state + owner should be a single word");
+	return &mutex->state;
+}
+
+// tid 0 is our main thread, but bionic uses an owner of 0 to mean unowned
+std::uint16_t mutex_owner_tid(Environment& env) {
+	return static_cast<std::uint16_t>(env.thread_id() + 1);
+}
+
+std::int32_t mutex_lock(BionicMutex* mutex, std::uint16_t shared, const Futex::Deadline* deadline) {
 	if (mutex_try_lock(mutex, shared) == 0) {
 		return 0;
 	}
@@ -96,17 +109,18 @@ std::int32_t mutex_lock(BionicMutex* mutex, std::uint16_t shared) {
 	std::uint16_t locked_contended = shared | MUTEX_STATE_BITS_LOCKED_CONTENDED;
 
 	while (std::atomic_exchange_explicit(&mutex->state, locked_contended, std::memory_order_acquire) != unlocked) {
-		// this is probably the most concerning part of a futex swap
-		std::atomic_wait(&mutex->state, locked_contended);
+		// the owner of a normal mutex is always zero, so the full word is just the state
+		if (Futex::wait(mutex_futex_addr(mutex), locked_contended, deadline) == Futex::GUEST_ETIMEDOUT) {
+			return Futex::GUEST_ETIMEDOUT;
+		}
 	}
 
 	return 0;
 }
 
-std::int32_t mutex_wait(BionicMutex* mutex, std::uint16_t shared, std::uint16_t old_state) {
-	// i lied. this is probably the most conerning futex swap
-	std::atomic_wait(&mutex->state, old_state);
-	return 0;
+std::int32_t mutex_wait(BionicMutex* mutex, std::uint16_t old_state, const Futex::Deadline* deadline) {
+	std::uint32_t owner_tid = std::atomic_load_explicit(&mutex->owner_tid, std::memory_order_relaxed);
+	return Futex::wait(mutex_futex_addr(mutex), (owner_tid << 16) | old_state, deadline);
 }
 
 std::int32_t mutex_recursive_increment(BionicMutex* mutex, std::uint16_t old_state) {
@@ -118,17 +132,17 @@ std::int32_t mutex_recursive_increment(BionicMutex* mutex, std::uint16_t old_sta
 	return 0;
 }
 
-std::int32_t mutex_lock_with_timeout(Environment& env, BionicMutex* mutex) {
+std::int32_t mutex_lock_with_timeout(Environment& env, BionicMutex* mutex, const Futex::Deadline* deadline) {
 	auto old_state = std::atomic_load_explicit(&mutex->state, std::memory_order_relaxed);
 	auto mtype = old_state & MUTEX_TYPE_MASK;
 	auto shared = old_state & MUTEX_SHARED_MASK;
 
 	if (mtype == MUTEX_TYPE_BITS_NORMAL) {
-		return mutex_lock(mutex, shared);
+		return mutex_lock(mutex, shared, deadline);
 	}
 
 	// why does 1.0 have a recursive mutex
-	auto tid = env.thread_id();
+	auto tid = mutex_owner_tid(env);
 	if (tid == std::atomic_load_explicit(&mutex->owner_tid, std::memory_order_relaxed)) {
 		if (mtype == MUTEX_TYPE_BITS_ERRORCHECK) {
 			return 45; // EDEADLK
@@ -163,7 +177,10 @@ std::int32_t mutex_lock_with_timeout(Environment& env, BionicMutex* mutex) {
 			old_state = new_state;
 		}
 
-		mutex_wait(mutex, shared, old_state);
+		if (mutex_wait(mutex, old_state, deadline) == Futex::GUEST_ETIMEDOUT) {
+			return Futex::GUEST_ETIMEDOUT;
+		}
+
 		old_state = std::atomic_load_explicit(&mutex->state, std::memory_order_relaxed);
 	}
 }
@@ -174,14 +191,33 @@ void mutex_unlock(BionicMutex* mutex, std::uint16_t shared) {
 
 	// the bionic source has a million comments for this
 	if (std::atomic_exchange_explicit(&mutex->state, unlocked, std::memory_order_release) == locked_contended) {
-		std::atomic_notify_one(&mutex->state);
+		Futex::wake(mutex_futex_addr(mutex), 1);
+	}
+}
+
+std::uint32_t mutex_lock_timed(Environment& env, std::uint32_t mutex_ptr, const Futex::Deadline* deadline) {
+	auto mutex_obj = env.memory_manager().read_bytes<BionicMutex>(mutex_ptr);
+	auto old_state = std::atomic_load_explicit(&mutex_obj->state, std::memory_order_relaxed);
+	auto mtype = old_state & MUTEX_TYPE_MASK;
+
+	if (mtype == MUTEX_TYPE_BITS_NORMAL) {
+		auto shared = old_state & MUTEX_SHARED_MASK;
+		if (mutex_try_lock(mutex_obj, shared) == 0) {
+			return 0;
+		}
 	}
+
+	if (is_mutex_destroyed(old_state)) {
+		throw std::runtime_error("mutex_lock on already destroyed mutex");
+	}
+
+	return mutex_lock_with_timeout(env, mutex_obj, deadline);
 }
 
 }
 
 std::int32_t emu_pthread_mutex_init(Environment& env, std::uint32_t mutex_ptr, std::uint32_t attr_ptr) {
-	spdlog::info("pthread_mutex_init({:#x})", mutex_ptr);
+	spdlog::trace("pthread_mutex_init({:#x})", mutex_ptr);
 
 	auto mutex_obj = env.memory_manager().read_bytes<BionicMutex>(mutex_ptr);
 	std::memset(mutex_obj, 0, sizeof(BionicMutex));
@@ -221,7 +257,32 @@ std::int32_t emu_pthread_mutex_init(Environment& env, std::uint32_t mutex_ptr, s
 }
 
 std::uint32_t emu_pthread_mutex_lock(Environment& env, std::uint32_t mutex_ptr) {
-	spdlog::info("pthread_mutex_lock({:#x})", mutex_ptr);
+	spdlog::trace("pthread_mutex_lock({:#x})", mutex_ptr);
+
+	if (mutex_ptr == 0) {
+		return 22; // EINVAL
+	}
+
+	return mutex_lock_timed(env, mutex_ptr, nullptr);
+}
+
+std::int32_t emu_pthread_mutex_timedlock(Environment& env, std::uint32_t mutex_ptr, std::uint32_t abs_timeout_ptr) {
+	spdlog::trace("pthread_mutex_timedlock({:#x}, {:#x})", mutex_ptr, abs_timeout_ptr);
+
+	if (mutex_ptr == 0) {
+		return 22; // EINVAL
+	}
+
+	auto deadline = Futex::read_deadline(env, abs_timeout_ptr, true);
+	if (!deadline) {
+		return 22; // EINVAL
+	}
+
+	return mutex_lock_timed(env, mutex_ptr, &deadline.value());
+}
+
+std::int32_t emu_pthread_mutex_trylock(Environment& env, std::uint32_t mutex_ptr) {
+	spdlog::trace("pthread_mutex_trylock({:#x})", mutex_ptr);
 
 	if (mutex_ptr == 0) {
 		return 22; // EINVAL
@@ -230,23 +291,38 @@ std::uint32_t emu_pthread_mutex_lock(Environment& env, std::uint32_t mutex_ptr)
 	auto mutex_obj = env.memory_manager().read_bytes<BionicMutex>(mutex_ptr);
 	auto old_state = std::atomic_load_explicit(&mutex_obj->state, std::memory_order_relaxed);
 	auto mtype = old_state & MUTEX_TYPE_MASK;
+	auto shared = old_state & MUTEX_SHARED_MASK;
 
 	if (mtype == MUTEX_TYPE_BITS_NORMAL) {
-		auto shared = old_state & MUTEX_SHARED_MASK;
-		if (mutex_try_lock(mutex_obj, shared) == 0) {
-			return 0;
-		}
+		return mutex_try_lock(mutex_obj, shared);
 	}
 
 	if (is_mutex_destroyed(old_state)) {
-		throw std::runtime_error("mutex_lock on already destroyed mutex");
+		throw std::runtime_error("mutex_trylock on already destroyed mutex");
+	}
+
+	auto tid = mutex_owner_tid(env);
+	if (tid == std::atomic_load_explicit(&mutex_obj->owner_tid, std::memory_order_relaxed)) {
+		if (mtype == MUTEX_TYPE_BITS_ERRORCHECK) {
+			return 16; // EBUSY
+		}
+		return mutex_recursive_increment(mutex_obj, old_state);
 	}
 
-	return mutex_lock_with_timeout(env, mutex_obj);
+	auto unlocked = mtype | shared | MUTEX_STATE_BITS_UNLOCKED;
+	auto locked_uncontended = mtype | shared | MUTEX_STATE_BITS_LOCKED_UNCONTENDED;
+
+	old_state = unlocked;
+	if (std::atomic_compare_exchange_strong_explicit(&mutex_obj->state, &old_state, locked_uncontended, std::memory_order_acquire, std::memory_order_relaxed)) {
+		std::atomic_store_explicit(&mutex_obj->owner_tid, tid, std::memory_order_relaxed);
+		return 0;
+	}
+
+	return 16; // EBUSY
 }
 
 std::uint32_t emu_pthread_mutex_unlock(Environment& env, std::uint32_t mutex_ptr) {
-	spdlog::info("pthread_mutex_unlock({:#x})", mutex_ptr);
+	spdlog::trace("pthread_mutex_unlock({:#x})", mutex_ptr);
 
 	if (mutex_ptr == 0) {
 		return 22; // EINVAL
@@ -266,7 +342,7 @@ std::uint32_t emu_pthread_mutex_unlock(Environment& env, std::uint32_t mutex_ptr
 		throw std::runtime_error("unlocking destroyed mutex");
 	}
 
-	auto tid = env.thread_id();
+	auto tid = mutex_owner_tid(env);
 	if (tid != std::atomic_load_explicit(&mutex_obj->owner_tid, std::memory_order_relaxed)) {
 		return 1; // EPERM
 	}
@@ -280,14 +356,14 @@ std::uint32_t emu_pthread_mutex_unlock(Environment& env, std::uint32_t mutex_ptr
 	auto unlocked = mtype | shared | MUTEX_STATE_BITS_UNLOCKED;
 	old_state = std::atomic_exchange_explicit(&mutex_obj->state, unlocked, std::memory_order_release);
 	if (mutex_state_bits_is_locked_contended(old_state)) {
-		std::atomic_notify_one(&mutex_obj->state);
+		Futex::wake(mutex_futex_addr(mutex_obj), 1);
 	}
 
 	return 0;
 }
 
 std::int32_t emu_pthread_mutex_destroy(Environment& env, std::uint32_t mutex_ptr) {
-	spdlog::info("pthread_mutex_destroy({:#x})", mutex_ptr);
+	spdlog::trace("pthread_mutex_destroy({:#x})", mutex_ptr);
 
 	auto mutex_obj = env.memory_manager().read_bytes<BionicMutex>(mutex_ptr);
 	auto old_state = std::atomic_load_explicit(&mutex_obj->state, std::memory_order_relaxed);
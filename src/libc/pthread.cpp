@@ -4,15 +4,24 @@
 #include <type_traits>
 
 #include "../android-application.hpp"
+#include "futex.hpp"
 
 std::int32_t emu_pthread_key_create(Environment& env, std::uint32_t key_ptr, std::uint32_t destructor_fn_ptr) {
-	spdlog::info("TODO: pthread_key_create");
-	// this should be implemented, one day. not sure how honestly
-	return 88; // ENOSYS
+	auto key = env.libc().create_tls_key(destructor_fn_ptr);
+	if (key == 0) {
+		return 11; // EAGAIN
+	}
+
+	env.memory_manager().write_word(key_ptr, key);
+
+	return 0;
 }
 
-std::int32_t emu_pthread_key_delete(Environment& env, std::uint32_t key_ptr) {
-	spdlog::info("TODO: pthread_key_delete");
+std::int32_t emu_pthread_key_delete(Environment& env, std::uint32_t key) {
+	if (!env.libc().delete_tls_key(key)) {
+		return 22; // EINVAL
+	}
+
 	return 0;
 }
 
@@ -41,11 +50,11 @@ std::uint32_t emu_pthread_once(Environment& env, std::uint32_t once_control_ptr,
 
 			std::atomic_store_explicit(once_control_obj, 2, std::memory_order_release);
 
-			std::atomic_notify_all(once_control_obj);
+			Futex::wake(once_control_obj, Futex::WAKE_ALL);
 			return 0;
 		}
 
-		std::atomic_wait_explicit(once_control_obj, old_value, std::memory_order_acquire);
+		Futex::wait(once_control_obj, old_value);
 		old_value = std::atomic_load_explicit(once_control_obj, std::memory_order_acquire);
 	}
 }
@@ -68,18 +77,31 @@ std::int32_t emu_pthread_detach(Environment& env, std::uint32_t thread) {
 }
 
 std::int32_t emu_pthread_exit(Environment& env, std::uint32_t ret_val_ptr) {
-	spdlog::info("TODO: pthread_exit");
-	return 0;
+	// the main thread is the one the emulator drives, so there's nothing for it to unwind back to
+	if (env.thread_id() == 0) {
+		spdlog::warn("pthread_exit called on the main thread, ignoring");
+		return 0;
+	}
+
+	throw ThreadExit{ret_val_ptr};
 }
 
 
 std::uint32_t emu_pthread_getspecific(Environment& env, std::int32_t key) {
-	spdlog::info("TODO: pthread_getspecific");
-	return 0;
+	if (!env.libc().is_tls_key_valid(key)) {
+		return 0;
+	}
+
+	return env.memory_manager().read_word(env.tls_addr() + key * sizeof(std::uint32_t));
 }
 
 std::int32_t emu_pthread_setspecific(Environment& env, std::int32_t key, std::uint32_t value) {
-	spdlog::info("TODO: pthread_setspecific");
+	if (!env.libc().is_tls_key_valid(key)) {
+		return 22; // EINVAL
+	}
+
+	env.memory_manager().write_word(env.tls_addr() + key * sizeof(std::uint32_t), value);
+
 	return 0;
 }
 
@@ -94,31 +116,43 @@ constexpr std::uint8_t BIONIC_COND_FLAGS_MASK = BIONIC_COND_SHARED_MASK | BIONIC
 
 constexpr std::uint8_t BIONIC_COND_COUNTER_STEP = 0x4;
 
+// the clock bit holds the clock id, and CLOCK_REALTIME is 0
+constexpr bool cond_uses_realtime_clock(std::uint32_t state) {
+	return (state & BIONIC_COND_CLOCK_MASK) == 0;
+}
+
 std::int32_t __pthread_cond_pulse(Environment& env, std::uint32_t cond_ptr, std::int32_t thread_count) {
 	auto cond = env.memory_manager().read_bytes<std::atomic_uint32_t>(cond_ptr);
-  std::atomic_fetch_add_explicit(cond, BIONIC_COND_COUNTER_STEP, std::memory_order_relaxed);
-	std::atomic_notify_all(cond);
-  return 0;
+
+	// the counter only has to change, so waiters never miss a pulse that happens before they sleep
+	std::atomic_fetch_add_explicit(cond, BIONIC_COND_COUNTER_STEP, std::memory_order_relaxed);
+	Futex::wake(cond, thread_count);
+
+	return 0;
 }
 
-std::int32_t __pthread_cond_timedwait(Environment& env, std::uint32_t cond_ptr, std::uint32_t mutex_ptr) {
+std::int32_t __pthread_cond_timedwait(Environment& env, std::uint32_t cond_ptr, std::uint32_t mutex_ptr, const Futex::Deadline* deadline) {
 	auto cond = env.memory_manager().read_bytes<std::atomic_uint32_t>(cond_ptr);
 
-  auto old_state = std::atomic_load_explicit(cond, std::memory_order_relaxed);
+	auto old_state = std::atomic_load_explicit(cond, std::memory_order_relaxed);
 
-  emu_pthread_mutex_unlock(env, mutex_ptr);
+	emu_pthread_mutex_unlock(env, mutex_ptr);
 
-	std::atomic_wait(cond, old_state);
+	auto status = Futex::wait(cond, old_state, deadline);
 
-  emu_pthread_mutex_lock(env, mutex_ptr);
+	emu_pthread_mutex_lock(env, mutex_ptr);
 
-  return 0;
+	if (status == Futex::GUEST_ETIMEDOUT) {
+		return 110; // ETIMEDOUT
+	}
+
+	return 0;
 }
 
 }
 
 std::int32_t emu_pthread_cond_init(Environment& env, std::uint32_t cond_ptr, std::uint32_t attr_ptr) {
-	spdlog::info("pthread_cond_init({:#x})", cond_ptr);
+	spdlog::trace("pthread_cond_init({:#x})", cond_ptr);
 
 	if (cond_ptr == 0) {
 		return 22; // EINVAL
@@ -136,7 +170,7 @@ std::int32_t emu_pthread_cond_init(Environment& env, std::uint32_t cond_ptr, std
 }
 
 std::int32_t emu_pthread_cond_destroy(Environment& env, std::uint32_t cond_ptr) {
-	spdlog::info("pthread_cond_destroy({:#x})", cond_ptr);
+	spdlog::trace("pthread_cond_destroy({:#x})", cond_ptr);
 
 	auto cond = env.memory_manager().read_bytes<std::atomic_uint32_t>(cond_ptr);
 	std::atomic_store_explicit(cond, 0xdeadc04d, std::memory_order_relaxed);
@@ -145,19 +179,49 @@ std::int32_t emu_pthread_cond_destroy(Environment& env, std::uint32_t cond_ptr)
 }
 
 std::int32_t emu_pthread_cond_broadcast(Environment& env, std::uint32_t cond_ptr) {
-	spdlog::info("pthread_cond_broadcast({:#x})", cond_ptr);
+	spdlog::trace("pthread_cond_broadcast({:#x})", cond_ptr);
 
-	return __pthread_cond_pulse(env, cond_ptr, std::numeric_limits<std::int32_t>::max());
+	return __pthread_cond_pulse(env, cond_ptr, Futex::WAKE_ALL);
 }
 
 std::int32_t emu_pthread_cond_signal(Environment& env, std::uint32_t cond_ptr) {
-	spdlog::info("pthread_cond_signal({:#x})", cond_ptr);
+	spdlog::trace("pthread_cond_signal({:#x})", cond_ptr);
 
-  return __pthread_cond_pulse(env, cond_ptr, 1);
+	return __pthread_cond_pulse(env, cond_ptr, 1);
 }
 
 std::int32_t emu_pthread_cond_wait(Environment& env, std::uint32_t cond_ptr, std::uint32_t mutex_ptr) {
-	spdlog::info("pthread_cond_wait({:#x}, {:#x})", cond_ptr, mutex_ptr);
+	spdlog::trace("pthread_cond_wait({:#x}, {:#x})", cond_ptr, mutex_ptr);
+
+	return __pthread_cond_timedwait(env, cond_ptr, mutex_ptr, nullptr);
+}
+
+std::int32_t emu_pthread_cond_timedwait(Environment& env, std::uint32_t cond_ptr, std::uint32_t mutex_ptr, std::uint32_t abs_timeout_ptr) {
+	spdlog::trace("pthread_cond_timedwait({:#x}, {:#x}, {:#x})", cond_ptr, mutex_ptr, abs_timeout_ptr);
+
+	auto state = env.memory_manager().read_word(cond_ptr);
+	auto deadline = Futex::read_deadline(env, abs_timeout_ptr, cond_uses_realtime_clock(state));
+	if (!deadline) {
+		return 22; // EINVAL
+	}
+
+	return __pthread_cond_timedwait(env, cond_ptr, mutex_ptr, &deadline.value());
+}
+
+std::int32_t emu_pthread_cond_timedwait_monotonic_np(Environment& env, std::uint32_t cond_ptr, std::uint32_t mutex_ptr, std::uint32_t abs_timeout_ptr) {
+	spdlog::trace("pthread_cond_timedwait_monotonic_np({:#x}, {:#x}, {:#x})", cond_ptr, mutex_ptr, abs_timeout_ptr);
+
+	auto deadline = Futex::read_deadline(env, abs_timeout_ptr, false);
+	if (!deadline) {
+		return 22; // EINVAL
+	}
+
+	return __pthread_cond_timedwait(env, cond_ptr, mutex_ptr, &deadline.value());
+}
+
+std::int32_t emu_pthread_cond_timeout_np(Environment& env, std::uint32_t cond_ptr, std::uint32_t mutex_ptr, std::uint32_t ms) {
+	spdlog::trace("pthread_cond_timeout_np({:#x}, {:#x}, {})", cond_ptr, mutex_ptr, ms);
 
-	return __pthread_cond_timedwait(env, cond_ptr, mutex_ptr);
+	auto deadline = Futex::deadline_from_now(ms);
+	return __pthread_cond_timedwait(env, cond_ptr, mutex_ptr, &deadline);
 }
@@ -2,6 +2,8 @@
 
 #include <atomic>
 
+#include "futex.hpp"
+
 // much like pthread, this is based off the bionic source code
 // https://github.com/aosp-mirror/platform_bionic/blob/main/libc/bionic/semaphore.cpp
 
@@ -47,6 +49,20 @@ std::int32_t sem_dec(std::atomic_uint32_t* sem_count_ptr) {
 	return semcount_to_value(old_value);
 }
 
+// only decrements if the semaphore is positive, doesn't mark it as having waiters
+std::int32_t sem_trydec(std::atomic_uint32_t* sem_count_ptr) {
+	auto old_value = std::atomic_load_explicit(sem_count_ptr, std::memory_order_relaxed);
+	auto shared = old_value & SEMCOUNT_SHARED_MASK;
+
+	do {
+		if (semcount_to_value(old_value) <= 0) {
+			break;
+		}
+	} while (!std::atomic_compare_exchange_weak(sem_count_ptr, &old_value, semcount_decrement(old_value) | shared));
+
+	return semcount_to_value(old_value);
+}
+
 std::int32_t sem_inc(std::atomic_uint32_t* sem_count_ptr) {
 	auto old_value = std::atomic_load_explicit(sem_count_ptr, std::memory_order_relaxed);
 	auto shared = old_value & SEMCOUNT_SHARED_MASK;
@@ -93,8 +109,10 @@ std::int32_t emu_sem_post(Environment& env, std::uint32_t sem_ptr) {
 
 	auto old_value = sem_inc(sem_atomic);
 	if (old_value < 0) {
-		std::atomic_notify_all(sem_atomic);
+		// a negative count means there are waiters, and they're all allowed to race for the new value
+		Futex::wake(sem_atomic, Futex::WAKE_ALL);
 	} else if (old_value == SILENE_SEM_VALUE_MAX) {
+		env.libc().set_errno(env, 75); // EOVERFLOW
 		return -1;
 	}
 
@@ -110,12 +128,51 @@ std::int32_t emu_sem_wait(Environment& env, std::uint32_t sem_ptr) {
 			return 0;
 		}
 
-		std::atomic_wait(sem_atomic, shared | SEMCOUNT_MINUS_ONE);
+		Futex::wait(sem_atomic, shared | SEMCOUNT_MINUS_ONE);
 	}
 
 	return 0;
 }
 
+std::int32_t emu_sem_timedwait(Environment& env, std::uint32_t sem_ptr, std::uint32_t abs_timeout_ptr) {
+	auto sem_atomic = env.memory_manager().read_bytes<std::atomic_uint32_t>(sem_ptr);
+
+	// posix says the timeout is only checked if we would block
+	if (sem_trydec(sem_atomic) > 0) {
+		return 0;
+	}
+
+	auto deadline = Futex::read_deadline(env, abs_timeout_ptr, true);
+	if (!deadline) {
+		env.libc().set_errno(env, Futex::GUEST_EINVAL);
+		return -1;
+	}
+
+	auto shared = sem_get_shared(sem_atomic);
+
+	while (true) {
+		if (sem_dec(sem_atomic) > 0) {
+			return 0;
+		}
+
+		if (Futex::wait(sem_atomic, shared | SEMCOUNT_MINUS_ONE, &deadline.value()) == Futex::GUEST_ETIMEDOUT) {
+			env.libc().set_errno(env, Futex::GUEST_ETIMEDOUT);
+			return -1;
+		}
+	}
+}
+
+std::int32_t emu_sem_trywait(Environment& env, std::uint32_t sem_ptr) {
+	auto sem_atomic = env.memory_manager().read_bytes<std::atomic_uint32_t>(sem_ptr);
+
+	if (sem_trydec(sem_atomic) > 0) {
+		return 0;
+	}
+
+	env.libc().set_errno(env, Futex::GUEST_EAGAIN);
+	return -1;
+}
+
 std::int32_t emu_sem_destroy(Environment& env, std::uint32_t sem_ptr) {
 	// this too is unimplemented on bionic
 	return 0;
@@ -8,6 +8,8 @@
 std::uint32_t emu_sem_init(Environment& env, std::uint32_t sem_ptr, std::int32_t p_shared, std::uint32_t value);
 std::int32_t emu_sem_post(Environment& env, std::uint32_t sem_ptr);
 std::int32_t emu_sem_wait(Environment& env, std::uint32_t sem_ptr);
+std::int32_t emu_sem_timedwait(Environment& env, std::uint32_t sem_ptr, std::uint32_t abs_timeout_ptr);
+std::int32_t emu_sem_trywait(Environment& env, std::uint32_t sem_ptr);
 std::int32_t emu_sem_destroy(Environment& env, std::uint32_t sem_ptr);
 
 #endif
\ No newline at end of file
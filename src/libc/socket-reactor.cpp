@@ -0,0 +1,338 @@
+#include "socket-reactor.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <optional>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "futex.hpp"
+
+namespace {
+	// these always come back, even if nobody asked for them
+	constexpr std::int16_t ALWAYS_REPORTED = POLLERR | POLLHUP | POLLNVAL;
+
+	void set_host_nonblocking(int fd) {
+		auto flags = fcntl(fd, F_GETFL);
+		if (flags == -1) {
+			return;
+		}
+
+		fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+	}
+}
+
+void SocketReactor::start() {
+	if (pipe(this->_wake_fds) != 0) {
+		spdlog::error("socket reactor: failed to create wake pipe: {}", errno);
+		throw std::runtime_error("failed to start socket reactor");
+	}
+
+	set_host_nonblocking(this->_wake_fds[0]);
+	set_host_nonblocking(this->_wake_fds[1]);
+
+#ifdef __linux__
+	this->_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (this->_epoll_fd == -1) {
+		spdlog::error("socket reactor: failed to create epoll instance: {}", errno);
+		throw std::runtime_error("failed to start socket reactor");
+	}
+
+	epoll_event wake_event{};
+	wake_event.events = EPOLLIN;
+	wake_event.data.fd = this->_wake_fds[0];
+	epoll_ctl(this->_epoll_fd, EPOLL_CTL_ADD, this->_wake_fds[0], &wake_event);
+#endif
+
+	this->_running = true;
+	this->_thread = std::thread(&SocketReactor::run, this);
+}
+
+void SocketReactor::notify() {
+	char c = 0;
+	[[maybe_unused]] auto r = write(this->_wake_fds[1], &c, 1);
+}
+
+void SocketReactor::run() {
+	auto drain_wake_pipe = [this]() {
+		std::array<char, 64> buf;
+		while (read(this->_wake_fds[0], buf.data(), buf.size()) > 0) {}
+	};
+
+#ifdef __linux__
+	std::array<epoll_event, 32> events;
+
+	while (true) {
+		auto count = epoll_wait(this->_epoll_fd, events.data(), events.size(), -1);
+		if (count == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			spdlog::error("socket reactor: epoll_wait failed: {}", errno);
+			break;
+		}
+
+		for (auto i = 0; i < count; i++) {
+			auto fd = events[i].data.fd;
+			if (fd == this->_wake_fds[0]) {
+				drain_wake_pipe();
+				continue;
+			}
+
+			// the low epoll bits are the same as the poll ones
+			this->dispatch(fd, static_cast<std::int16_t>(events[i].events));
+		}
+
+		std::scoped_lock lk{this->_lock};
+		if (!this->_running) {
+			break;
+		}
+	}
+#else
+	std::vector<pollfd> fds{};
+
+	while (true) {
+		{
+			std::scoped_lock lk{this->_lock};
+			if (!this->_running) {
+				break;
+			}
+
+			// only rebuild the set when a waiter comes or goes
+			if (this->_interest_changed || fds.empty()) {
+				fds.clear();
+				fds.push_back({.fd = this->_wake_fds[0], .events = POLLIN, .revents = 0});
+
+				for (const auto& [fd, socket] : this->_sockets) {
+					std::int16_t events = 0;
+					for (const auto waiter : socket.waiters) {
+						events |= waiter->events;
+					}
+
+					if (events != 0) {
+						fds.push_back({.fd = fd, .events = events, .revents = 0});
+					}
+				}
+
+				this->_interest_changed = false;
+			}
+		}
+
+		auto count = poll(fds.data(), fds.size(), -1);
+		if (count == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			spdlog::error("socket reactor: poll failed: {}", errno);
+			break;
+		}
+
+		for (auto& pfd : fds) {
+			if (pfd.revents == 0) {
+				continue;
+			}
+
+			if (pfd.fd == this->_wake_fds[0]) {
+				drain_wake_pipe();
+			} else {
+				this->dispatch(pfd.fd, pfd.revents);
+			}
+
+			pfd.revents = 0;
+		}
+	}
+#endif
+}
+
+void SocketReactor::arm(int fd, Socket& socket) {
+	std::int16_t events = 0;
+	for (const auto waiter : socket.waiters) {
+		events |= waiter->events;
+	}
+
+	if (events == 0) {
+		return;
+	}
+
+#ifdef __linux__
+	// oneshot, so the reactor never spins on a socket that nobody is waiting on
+	epoll_event event{};
+	event.events = static_cast<std::uint32_t>(events) | EPOLLONESHOT;
+	event.data.fd = fd;
+
+	auto op = socket.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+	if (epoll_ctl(this->_epoll_fd, op, fd, &event) != 0) {
+		spdlog::warn("socket reactor: failed to watch fd {}: {}", fd, errno);
+		return;
+	}
+
+	socket.registered = true;
+#else
+	socket.registered = true;
+	this->_interest_changed = true;
+	this->notify();
+#endif
+}
+
+void SocketReactor::dispatch(int fd, std::int16_t revents) {
+	std::scoped_lock lk{this->_lock};
+
+	auto it = this->_sockets.find(fd);
+	if (it == this->_sockets.end()) {
+		return;
+	}
+
+	auto& socket = it->second;
+
+	std::erase_if(socket.waiters, [revents](Waiter* waiter) {
+		auto ready = revents & (waiter->events | ALWAYS_REPORTED);
+		if (ready == 0) {
+			return false;
+		}
+
+		waiter->revents = static_cast<std::int16_t>(ready);
+		waiter->done.store(1, std::memory_order_release);
+		Futex::wake(&waiter->done, Futex::WAKE_ALL);
+
+		return true;
+	});
+
+#ifdef __linux__
+	// the event was consumed by oneshot, so anyone left over needs it rearmed
+	this->arm(fd, socket);
+#else
+	this->_interest_changed = true;
+#endif
+}
+
+void SocketReactor::add_socket(int fd, bool guest_blocking) {
+	set_host_nonblocking(fd);
+
+	std::scoped_lock lk{this->_lock};
+	this->_sockets[fd] = Socket{.guest_blocking = guest_blocking};
+}
+
+void SocketReactor::remove_socket(int fd) {
+	std::scoped_lock lk{this->_lock};
+
+	auto it = this->_sockets.find(fd);
+	if (it == this->_sockets.end()) {
+		return;
+	}
+
+	for (auto waiter : it->second.waiters) {
+		waiter->revents = POLLNVAL;
+		waiter->done.store(1, std::memory_order_release);
+		Futex::wake(&waiter->done, Futex::WAKE_ALL);
+	}
+
+#ifdef __linux__
+	if (it->second.registered) {
+		epoll_ctl(this->_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+	}
+#else
+	this->_interest_changed = true;
+#endif
+
+	this->_sockets.erase(it);
+}
+
+bool SocketReactor::is_socket(int fd) {
+	std::scoped_lock lk{this->_lock};
+	return this->_sockets.contains(fd);
+}
+
+bool SocketReactor::is_guest_blocking(int fd) {
+	std::scoped_lock lk{this->_lock};
+
+	auto it = this->_sockets.find(fd);
+	return it != this->_sockets.end() && it->second.guest_blocking;
+}
+
+void SocketReactor::set_guest_blocking(int fd, bool blocking) {
+	std::scoped_lock lk{this->_lock};
+
+	auto it = this->_sockets.find(fd);
+	if (it != this->_sockets.end()) {
+		it->second.guest_blocking = blocking;
+	}
+}
+
+std::int16_t SocketReactor::wait(int fd, std::int16_t events, std::int32_t timeout_ms) {
+	Waiter waiter{};
+	waiter.events = events;
+
+	{
+		std::scoped_lock lk{this->_lock};
+
+		auto it = this->_sockets.find(fd);
+		if (it == this->_sockets.end()) {
+			return POLLNVAL;
+		}
+
+		if (!this->_running) {
+			this->start();
+		}
+
+		it->second.waiters.push_back(&waiter);
+		this->arm(fd, it->second);
+	}
+
+	std::optional<Futex::Deadline> deadline{};
+	if (timeout_ms >= 0) {
+		deadline = Futex::deadline_from_now(timeout_ms);
+	}
+
+	while (waiter.done.load(std::memory_order_acquire) == 0) {
+		auto status = Futex::wait(&waiter.done, 0, deadline ? &deadline.value() : nullptr);
+		if (status != Futex::GUEST_ETIMEDOUT) {
+			continue;
+		}
+
+		// the reactor only touches waiters under the lock, so once this is gone it's safe to return
+		std::scoped_lock lk{this->_lock};
+		if (waiter.done.load(std::memory_order_acquire) != 0) {
+			break;
+		}
+
+		if (auto it = this->_sockets.find(fd); it != this->_sockets.end()) {
+			std::erase(it->second.waiters, &waiter);
+		}
+
+		return 0;
+	}
+
+	return waiter.revents;
+}
+
+SocketReactor::~SocketReactor() {
+	{
+		std::scoped_lock lk{this->_lock};
+		if (!this->_running) {
+			return;
+		}
+
+		this->_running = false;
+		this->notify();
+	}
+
+	this->_thread.join();
+
+#ifdef __linux__
+	close(this->_epoll_fd);
+#endif
+
+	close(this->_wake_fds[0]);
+	close(this->_wake_fds[1]);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#ifndef _LIBC_SOCKET_REACTOR_HPP
+#define _LIBC_SOCKET_REACTOR_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * readiness notifications for guest sockets.
+ *
+ * every guest socket is non-blocking on the host. when the guest expects a call to block,
+ * the calling thread parks on a futex and a single reactor thread (epoll, or poll elsewhere)
+ * wakes it once the socket is ready, instead of each thread sitting in its own host syscall
+ */
+class SocketReactor {
+	struct Waiter {
+		std::int16_t events{0};
+		std::int16_t revents{0};
+
+		// set to 1 by the reactor once revents is filled
+		std::atomic_uint32_t done{0};
+	};
+
+	struct Socket {
+		// what the guest thinks the socket is, the host side is always non-blocking
+		bool guest_blocking{true};
+
+		// if the fd is currently known to the backend
+		bool registered{false};
+
+		std::vector<Waiter*> waiters{};
+	};
+
+	std::mutex _lock{};
+	std::unordered_map<int, Socket> _sockets{};
+
+	std::thread _thread{};
+	bool _running{false};
+
+	// written to whenever the reactor thread needs to look at the interest set again
+	int _wake_fds[2]{-1, -1};
+
+#ifdef __linux__
+	int _epoll_fd{-1};
+#else
+	bool _interest_changed{false};
+#endif
+
+	void start();
+	void run();
+	void notify();
+
+	// must hold the lock
+	void arm(int fd, Socket& socket);
+	void dispatch(int fd, std::int16_t revents);
+
+public:
+	/**
+	 * starts tracking a newly created socket and switches it to non-blocking
+	 */
+	void add_socket(int fd, bool guest_blocking = true);
+
+	/**
+	 * stops tracking a socket before it is closed. anyone waiting on it gets POLLNVAL
+	 */
+	void remove_socket(int fd);
+
+	bool is_socket(int fd);
+
+	bool is_guest_blocking(int fd);
+	void set_guest_blocking(int fd, bool blocking);
+
+	/**
+	 * parks the calling thread until one of events is ready on fd
+	 * returns the ready events, or 0 if timeout_ms (negative waits forever) passes first
+	 */
+	std::int16_t wait(int fd, std::int16_t events, std::int32_t timeout_ms = -1);
+
+	SocketReactor() = default;
+	~SocketReactor();
+
+	SocketReactor(const SocketReactor&) = delete;
+	SocketReactor& operator=(const SocketReactor&) = delete;
+};
+
+#endif
@@ -4,10 +4,123 @@
 #define _LIBC_SOCKET_H
 
 #include "../environment.h"
+#include "../scheduler.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <vector>
 
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <poll.h>
+
+std::int32_t errno_to_emu(std::int32_t error) {
+	#ifdef __APPLE__
+		// only the ones a socket is likely to hand back
+		switch (error) {
+			case EAGAIN:
+				return 11;
+			case EINPROGRESS:
+				return 115;
+			case EALREADY:
+				return 114;
+			case ENOTCONN:
+				return 107;
+			case EISCONN:
+				return 106;
+			case ECONNREFUSED:
+				return 111;
+			case ECONNRESET:
+				return 104;
+			case ECONNABORTED:
+				return 103;
+			case ETIMEDOUT:
+				return 110;
+			case ENETUNREACH:
+				return 101;
+			case EHOSTUNREACH:
+				return 113;
+			case EADDRINUSE:
+				return 98;
+			case EADDRNOTAVAIL:
+				return 99;
+			default:
+				return error;
+		}
+	#else
+		return error;
+	#endif
+}
+
+// guest MSG_DONTWAIT, which the host doesn't need as its sockets never block
+constexpr std::uint32_t EMU_MSG_DONTWAIT = 0x40;
+
+/**
+ * retries a non-blocking socket operation until it stops returning EAGAIN
+ * the host socket is never blocking, so this is where guests that expect blocking behavior get parked.
+ * flags are the guest's for this call, as MSG_DONTWAIT makes a single call non-blocking on a blocking socket
+ */
+template <typename Fn>
+std::int32_t socket_io(Environment& env, std::int32_t sockfd, std::int16_t events, std::uint32_t flags, Fn&& op) {
+	auto& sockets = env.libc().sockets();
+	auto blocking = (flags & EMU_MSG_DONTWAIT) == 0 && sockets.is_guest_blocking(sockfd);
+
+	while (true) {
+		auto r = static_cast<std::int32_t>(op());
+		if (r != -1) {
+			return r;
+		}
+
+		if ((errno != EAGAIN && errno != EWOULDBLOCK) || !blocking) {
+			env.libc().set_errno(env, errno_to_emu(errno));
+			return -1;
+		}
+
+		sockets.wait(sockfd, events);
+	}
+}
+
+/**
+ * a call whose result depends on the network, as seen by the replay log. when replaying, op isn't run and the guest gets
+ * the recorded result instead, with data filled in from what the call wrote there when it was recorded.
+ * op has to set the guest errno itself when it fails. a read only keeps the bytes it read, everything else keeps all of data
+ */
+template <typename Fn>
+std::int32_t recorded_call(Environment& env, ReplayLog::Kind kind, std::span<std::uint8_t> data, Fn&& op) {
+	auto& log = env.replay_log();
+
+	if (auto replayed = log.replay_result(env.thread_id(), kind); replayed) {
+		if (auto size = std::min(data.size(), replayed->data.size()); size != 0) {
+			std::memcpy(data.data(), replayed->data.data(), size);
+		}
+
+		if (replayed->value == -1) {
+			env.libc().set_errno(env, replayed->error);
+		}
+
+		return replayed->value;
+	}
+
+	auto r = static_cast<std::int32_t>(op());
+
+	if (log.recording()) {
+		auto error = r == -1 ? static_cast<std::int32_t>(env.memory_manager().read_word(env.libc().get_errno_addr(env))) : 0;
+
+		auto kept = data.size();
+		if (r == -1) {
+			kept = 0u;
+		} else if (kind == ReplayLog::Kind::Read) {
+			kept = std::min(static_cast<std::size_t>(r), data.size());
+		}
+
+		log.record_result(env.thread_id(), kind, r, error, data.first(kept));
+	}
+
+	return r;
+}
 
 std::int32_t emu_getsockopt(Environment& env, std::int32_t socket, std::int32_t level, std::int32_t option_name, std::uint32_t option_value_ptr, std::uint32_t option_len_ptr) {
 	bool unhandled = false;
@@ -35,15 +148,23 @@ std::int32_t emu_getsockopt(Environment& env, std::int32_t socket, std::int32_t
 		spdlog::info("TODO: getsockopt({}, {}, {})", socket, level, option_name);
 	}
 
-	auto option_value = env.memory_manager().read_bytes<void>(option_value_ptr);
+	auto option_value = env.memory_manager().read_bytes<std::uint8_t>(option_value_ptr);
 	auto option_len = env.memory_manager().read_bytes<std::uint32_t>(option_len_ptr);
 
-	if (getsockopt(socket, level, option_name, option_value, option_len) != 0) {
-		spdlog::info("getsockopt failed: {}", errno);
-		return -1;
-	}
+	return recorded_call(env, ReplayLog::Kind::SocketQuery, {option_value, *option_len}, [&]() {
+		if (getsockopt(socket, level, option_name, option_value, option_len) != 0) {
+			spdlog::info("getsockopt failed: {}", errno);
+			env.libc().set_errno(env, errno_to_emu(errno));
+			return -1;
+		}
 
-	return 0;
+		if (level == SOL_SOCKET && option_name == SO_ERROR) {
+			auto error = reinterpret_cast<std::int32_t*>(option_value);
+			*error = errno_to_emu(*error);
+		}
+
+		return 0;
+	});
 }
 
 std::int32_t domain_to_system(std::int32_t domain) {
@@ -73,8 +194,20 @@ std::int32_t domain_to_emu(std::int32_t domain) {
 }
 
 std::int32_t emu_socket(Environment& env, std::int32_t domain, std::int32_t type, std::int32_t protocol) {
+	// SOCK_NONBLOCK, which doesn't exist on every host
+	constexpr auto EMU_SOCK_NONBLOCK = 04000;
+	auto guest_blocking = (type & EMU_SOCK_NONBLOCK) == 0;
+
 	// this is a bad idea isn't it
-	return socket(domain_to_system(domain), type, protocol);
+	auto fd = socket(domain_to_system(domain), type & ~EMU_SOCK_NONBLOCK, protocol);
+	if (fd == -1) {
+		env.libc().set_errno(env, errno_to_emu(errno));
+		return -1;
+	}
+
+	env.libc().sockets().add_socket(fd, guest_blocking);
+
+	return fd;
 }
 
 struct emu_sockaddr {
@@ -121,59 +254,110 @@ std::int32_t emu_getaddrinfo(Environment& env, std::uint32_t node_ptr, std::uint
 		hints.ai_flags = AI_V4MAPPED | AI_ADDRCONFIG;
 	}
 
-	struct addrinfo* result;
+	// the results are flattened out, so that the same list can be built from the replay log
+	struct lookup_entry {
+		std::int32_t flags;
+		std::int32_t family;
+		std::int32_t socktype;
+		std::int32_t protocol;
+		std::uint32_t has_addr;
+		emu_sockaddr addr;
+		std::uint32_t canonname_len;
+	};
+
+	std::vector<std::uint8_t> entries{};
+
+	auto& log = env.replay_log();
+	auto status = 0;
+
+	if (auto replayed = log.replay_result(env.thread_id(), ReplayLog::Kind::Lookup); replayed) {
+		status = replayed->value;
+		entries.assign(replayed->data.begin(), replayed->data.end());
+	} else {
+		struct addrinfo* result;
 
-	if (auto status = getaddrinfo(node, service, &hints, &result); status != 0) {
+		{
+			// lookups can take a while, don't hold up other threads
+			Scheduler::ParkGuard park{};
+			status = getaddrinfo(node, service, &hints, &result);
+		}
+
+		if (status == 0) {
+			for (auto obj = result; obj != nullptr; obj = obj->ai_next) {
+				lookup_entry entry{
+					.flags = obj->ai_flags,
+					.family = domain_to_emu(obj->ai_family),
+					.socktype = obj->ai_socktype,
+					.protocol = obj->ai_protocol,
+					.has_addr = obj->ai_addr != nullptr,
+					.addr = {},
+					.canonname_len = obj->ai_canonname != nullptr ? static_cast<std::uint32_t>(strlen(obj->ai_canonname) + 1) : 0u
+				};
+
+				if (obj->ai_addr != nullptr) {
+					entry.addr.sa_family = domain_to_emu(obj->ai_addr->sa_family);
+					memcpy(&entry.addr.sa_data, &obj->ai_addr->sa_data, 14);
+				}
+
+				auto entry_bytes = reinterpret_cast<const std::uint8_t*>(&entry);
+				entries.insert(entries.end(), entry_bytes, entry_bytes + sizeof(entry));
+
+				auto canonname = reinterpret_cast<const std::uint8_t*>(obj->ai_canonname);
+				entries.insert(entries.end(), canonname, canonname + entry.canonname_len);
+			}
+
+			freeaddrinfo(result);
+		}
+
+		log.record_result(env.thread_id(), ReplayLog::Kind::Lookup, status, 0, entries);
+	}
+
+	if (status != 0) {
 		return status;
 	}
 
 	// we have to translate it yay !!!
-	auto copy_addr_info = [](Environment& env, addrinfo* obj, auto& copy_impl) -> std::uint32_t {
-		if (obj == nullptr) {
-			return 0;
-		}
+	auto next_ptr = res_ptr;
+	for (auto offset = 0u; offset + sizeof(lookup_entry) <= entries.size();) {
+		lookup_entry entry;
+		memcpy(&entry, entries.data() + offset, sizeof(entry));
+		offset += sizeof(entry);
 
 		auto addr_mem = env.libc().allocate_memory(sizeof(emu_addrinfo));
 
 		auto addr_ptr = 0u;
-		if (obj->ai_addr != nullptr) {
-			addr_ptr = env.libc().allocate_memory(obj->ai_addrlen);
-			emu_sockaddr emu_addr;
-
-			emu_addr.sa_family = domain_to_emu(obj->ai_addr->sa_family);
-			memcpy(&emu_addr.sa_data, &obj->ai_addr->sa_data, 14);
-
-			env.memory_manager().copy(addr_ptr, &emu_addr, sizeof(emu_sockaddr));
+		if (entry.has_addr) {
+			addr_ptr = env.libc().allocate_memory(sizeof(emu_sockaddr));
+			env.memory_manager().copy(addr_ptr, &entry.addr, sizeof(emu_sockaddr));
 		}
 
 		auto canonname_ptr = 0u;
-		if (obj->ai_canonname != nullptr) {
-			auto len = strlen(obj->ai_canonname) + 1;
-			canonname_ptr = env.libc().allocate_memory(len);
-			env.memory_manager().copy(canonname_ptr, obj->ai_canonname, len);
+		if (entry.canonname_len != 0 && offset + entry.canonname_len <= entries.size()) {
+			canonname_ptr = env.libc().allocate_memory(entry.canonname_len);
+			env.memory_manager().copy(canonname_ptr, entries.data() + offset, entry.canonname_len);
 		}
 
+		offset += entry.canonname_len;
+
 		emu_addrinfo emu_obj = {
-			.ai_flags = obj->ai_flags,
-			.ai_family = domain_to_emu(obj->ai_family),
-			.ai_socktype = obj->ai_socktype,
-			.ai_protocol = obj->ai_protocol,
+			.ai_flags = entry.flags,
+			.ai_family = entry.family,
+			.ai_socktype = entry.socktype,
+			.ai_protocol = entry.protocol,
 			.ai_addrlen = sizeof(emu_sockaddr),
 			.ai_canonname_ptr = canonname_ptr,
 			.ai_addr_ptr = addr_ptr,
-			.ai_next_ptr = copy_impl(env, obj->ai_next, copy_impl)
+			.ai_next_ptr = 0
 		};
 
 		env.memory_manager().copy(addr_mem, &emu_obj, sizeof(emu_addrinfo));
 
-		return addr_mem;
-	};
-
-	auto r = copy_addr_info(env, result, copy_addr_info);
-
-	freeaddrinfo(result);
+		// each entry is linked to from the one before it, the first from res
+		env.memory_manager().write_word(next_ptr, addr_mem);
+		next_ptr = addr_mem + offsetof(emu_addrinfo, ai_next_ptr);
+	}
 
-	env.memory_manager().write_word(res_ptr, r);
+	env.memory_manager().write_word(next_ptr, 0);
 
 	return 0;
 }
@@ -209,64 +393,115 @@ std::int32_t emu_connect(Environment& env, std::int32_t sockfd, std::uint32_t ad
 	addr.sa_family = emu_addr->sa_family;
 	memcpy(&addr.sa_data, &emu_addr->sa_data, 14);
 
-	return connect(sockfd, &addr, 16);
+	// the wait is part of the call, so a replay gets the same outcome without waiting on anything
+	return recorded_call(env, ReplayLog::Kind::Connect, {}, [&]() {
+		if (connect(sockfd, &addr, 16) == 0) {
+			return 0;
+		}
+
+		auto& sockets = env.libc().sockets();
+		if (errno != EINPROGRESS || !sockets.is_guest_blocking(sockfd)) {
+			env.libc().set_errno(env, errno_to_emu(errno));
+			return -1;
+		}
+
+		// a blocking connect finishes once the socket becomes writable
+		sockets.wait(sockfd, POLLOUT);
+
+		std::int32_t error = 0;
+		socklen_t error_len = sizeof(error);
+		if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &error_len) != 0) {
+			error = errno;
+		}
+
+		if (error != 0) {
+			env.libc().set_errno(env, errno_to_emu(error));
+			return -1;
+		}
+
+		return 0;
+	});
 }
 
 std::int32_t emu_getpeername(Environment& env, std::int32_t sockfd, std::uint32_t addr_ptr, std::uint32_t len_ptr) {
 	auto emu_addr = env.memory_manager().read_bytes<emu_sockaddr>(addr_ptr);
 
-	struct sockaddr addr{};
-	socklen_t addrlen = sizeof(struct sockaddr);
+	auto r = recorded_call(env, ReplayLog::Kind::SocketQuery, {reinterpret_cast<std::uint8_t*>(emu_addr), sizeof(emu_sockaddr)}, [&]() {
+		struct sockaddr addr{};
+		socklen_t addrlen = sizeof(struct sockaddr);
 
-	if (getpeername(sockfd, &addr, &addrlen) == -1) {
-		return -1;
-	}
+		if (getpeername(sockfd, &addr, &addrlen) == -1) {
+			env.libc().set_errno(env, errno_to_emu(errno));
+			return -1;
+		}
 
-	emu_addr->sa_family = domain_to_emu(addr.sa_family);
-	memcpy(&emu_addr->sa_data, &addr.sa_data, 14);
+		emu_addr->sa_family = domain_to_emu(addr.sa_family);
+		memcpy(&emu_addr->sa_data, &addr.sa_data, 14);
 
-	env.memory_manager().write_word(len_ptr, sizeof(emu_sockaddr));
+		return 0;
+	});
 
-	return 0;
+	if (r == 0) {
+		env.memory_manager().write_word(len_ptr, sizeof(emu_sockaddr));
+	}
+
+	return r;
 }
 
 std::int32_t emu_getsockname(Environment& env, std::int32_t sockfd, std::uint32_t addr_ptr, std::uint32_t len_ptr) {
 	auto emu_addr = env.memory_manager().read_bytes<emu_sockaddr>(addr_ptr);
 
-	struct sockaddr addr{};
-	socklen_t addrlen;
+	auto r = recorded_call(env, ReplayLog::Kind::SocketQuery, {reinterpret_cast<std::uint8_t*>(emu_addr), sizeof(emu_sockaddr)}, [&]() {
+		struct sockaddr addr{};
+		socklen_t addrlen = sizeof(struct sockaddr);
 
-	if (getsockname(sockfd, &addr, &addrlen) == -1) {
-		return -1;
-	}
+		if (getsockname(sockfd, &addr, &addrlen) == -1) {
+			env.libc().set_errno(env, errno_to_emu(errno));
+			return -1;
+		}
 
-	emu_addr->sa_family = domain_to_emu(addr.sa_family);
-	memcpy(&emu_addr->sa_data, &addr.sa_data, 14);
+		emu_addr->sa_family = domain_to_emu(addr.sa_family);
+		memcpy(&emu_addr->sa_data, &addr.sa_data, 14);
 
-	env.memory_manager().write_word(len_ptr, sizeof(emu_sockaddr));
+		return 0;
+	});
 
-	return 0;
+	if (r == 0) {
+		env.memory_manager().write_word(len_ptr, sizeof(emu_sockaddr));
+	}
+
+	return r;
 }
 
 std::int32_t emu_send(Environment& env, std::int32_t sockfd, std::uint32_t buf_ptr, std::uint32_t size, std::uint32_t flags) {
-	if (flags & 0x4000) {
-		flags = (flags & ~0x4000) | MSG_NOSIGNAL;
-	}
+	spdlog::trace("send({}, {:#x}, {}, {:#x})", sockfd, buf_ptr, size, flags);
 
-	spdlog::info("TODO: send({}, {:#x}, {}, {:#x})", sockfd, buf_ptr, size, flags);
+	auto host_flags = flags & ~EMU_MSG_DONTWAIT;
+	if (host_flags & 0x4000) {
+		host_flags = (host_flags & ~0x4000) | MSG_NOSIGNAL;
+	}
 
 	auto buf = env.memory_manager().read_bytes<void>(buf_ptr);
 
 	// spdlog::info("send: {}",reinterpret_cast<char*>(buf));
 
-	return send(sockfd, buf, size, flags);
+	return recorded_call(env, ReplayLog::Kind::Write, {}, [&]() {
+		return socket_io(env, sockfd, POLLOUT, flags, [&]() {
+			return send(sockfd, buf, size, host_flags);
+		});
+	});
 }
 
 std::int32_t emu_recv(Environment& env, std::int32_t sockfd, std::uint32_t buf_ptr, std::uint32_t size, std::int32_t flags) {
-	spdlog::info("TODO: recv({}, {:#x}, {}, {:#x})", sockfd, buf_ptr, size, flags);
+	spdlog::trace("recv({}, {:#x}, {}, {:#x})", sockfd, buf_ptr, size, flags);
 
-	auto buf = env.memory_manager().read_bytes<void>(buf_ptr);
-	auto r = recv(sockfd, buf, size, flags);
+	auto buf = env.memory_manager().read_bytes<std::uint8_t>(buf_ptr);
+
+	auto r = recorded_call(env, ReplayLog::Kind::Read, {buf, size}, [&]() {
+		return socket_io(env, sockfd, POLLIN, flags, [&]() {
+			return recv(sockfd, buf, size, flags & ~EMU_MSG_DONTWAIT);
+		});
+	});
 
 	// spdlog::info("recv: {}", std::string_view{reinterpret_cast<char*>(buf), std::min(size, 512u)});
 
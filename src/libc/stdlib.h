@@ -105,11 +105,11 @@ std::uint32_t emu_getenv(Environment& env, std::uint32_t name_ptr) {
 }
 
 std::int32_t emu_lrand48(Environment& env) {
-	return static_cast<std::int32_t>(lrand48());
+	return static_cast<std::int32_t>(env.replay_log().random(env.thread_id(), static_cast<std::uint32_t>(lrand48())));
 }
 
 std::uint32_t emu_arc4random(Environment& env) {
-	return arc4random();
+	return env.replay_log().random(env.thread_id(), arc4random());
 }
 
 void emu_srand48(Environment& env, std::int32_t seed) {
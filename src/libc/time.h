@@ -17,6 +17,16 @@ int emu_gettimeofday(Environment& env, std::uint32_t tv_ptr, std::uint32_t tz_pt
 		return r;
 	}
 
+	std::timespec ts{tv.tv_sec, tv.tv_usec * 1000};
+	if (env.guest_clock().is_virtual()) {
+		ts = env.guest_clock().now(true);
+	}
+
+	env.replay_log().time(env.thread_id(), ts);
+
+	tv.tv_sec = ts.tv_sec;
+	tv.tv_usec = ts.tv_nsec / 1000;
+
 	if (tv_ptr != 0) {
 			auto emu_tv = env.memory_manager().read_bytes<std::int32_t>(tv_ptr);
 			emu_tv[0] = static_cast<std::int32_t>(tv.tv_sec);
@@ -33,7 +43,14 @@ int emu_gettimeofday(Environment& env, std::uint32_t tv_ptr, std::uint32_t tz_pt
 }
 
 std::int32_t emu_time(Environment& env, std::uint32_t arg_ptr) {
-	auto r = static_cast<std::int32_t>(std::time(nullptr));
+	std::timespec ts{std::time(nullptr), 0};
+	if (env.guest_clock().is_virtual()) {
+		ts = env.guest_clock().now(true);
+	}
+
+	env.replay_log().time(env.thread_id(), ts);
+
+	auto r = static_cast<std::int32_t>(ts.tv_sec);
 
 	if (arg_ptr != 0 && r != -1) {
 		env.memory_manager().write_word(arg_ptr, r);
@@ -43,10 +60,8 @@ std::int32_t emu_time(Environment& env, std::uint32_t arg_ptr) {
 }
 
 int emu_ftime(Environment& env, std::uint32_t tp_ptr) {
-	struct timespec ts{};
-	if (clock_gettime(CLOCK_REALTIME, &ts) < 0) {
-		return -1;
-	}
+	auto ts = env.guest_clock().now(true);
+	env.replay_log().time(env.thread_id(), ts);
 
 	auto timeb_time = static_cast<std::int32_t>(ts.tv_sec);
 	std::uint16_t ms_tm = (ts.tv_nsec + 500000) / 1000000;
@@ -65,11 +80,15 @@ int emu_ftime(Environment& env, std::uint32_t tp_ptr) {
 int emu_clock_gettime(Environment& env, std::int32_t clock_id, std::uint32_t ts_ptr) {
 	struct timespec ts{};
 
-	auto r = clock_gettime(static_cast<clockid_t>(clock_id), &ts);
-	if (r < 0) {
+	if (env.guest_clock().is_virtual()) {
+		// CLOCK_REALTIME and CLOCK_REALTIME_COARSE, everything else counts from some point in the past
+		ts = env.guest_clock().now(clock_id == 0 || clock_id == 5);
+	} else if (auto r = clock_gettime(static_cast<clockid_t>(clock_id), &ts); r < 0) {
 		return r;
 	}
 
+	env.replay_log().time(env.thread_id(), ts);
+
 	env.memory_manager().write_word(ts_ptr, static_cast<std::int32_t>(ts.tv_sec));
 	env.memory_manager().write_word(ts_ptr + 4, static_cast<std::int32_t>(ts.tv_nsec));
 
@@ -4,10 +4,14 @@
 #define _LIBC_UNISTD_H
 
 #include "../environment.h"
+#include "socket.h"
 
 #include <unistd.h>
 
 std::int32_t emu_close(Environment& env, std::int32_t fd) {
+	// anything parked on this socket has to be let go before the fd number can be reused
+	env.libc().sockets().remove_socket(fd);
+
 	return close(fd);
 }
 
@@ -18,11 +22,27 @@ std::uint32_t emu_alarm(Environment& env, std::uint32_t seconds) {
 
 std::int32_t emu_write(Environment& env, std::int32_t fd, std::uint32_t buf_ptr, std::uint32_t count) {
 	auto buf = env.memory_manager().read_bytes<void>(buf_ptr);
+	if (env.libc().sockets().is_socket(fd)) {
+		return recorded_call(env, ReplayLog::Kind::Write, {}, [&]() {
+			return socket_io(env, fd, POLLOUT, 0u, [&]() {
+				return write(fd, buf, count);
+			});
+		});
+	}
+
 	return write(fd, buf, count);
 }
 
 std::int32_t emu_read(Environment& env, std::int32_t fd, std::uint32_t buf_ptr, std::uint32_t count) {
-	auto buf = env.memory_manager().read_bytes<void>(buf_ptr);
+	auto buf = env.memory_manager().read_bytes<std::uint8_t>(buf_ptr);
+	if (env.libc().sockets().is_socket(fd)) {
+		return recorded_call(env, ReplayLog::Kind::Read, {buf, count}, [&]() {
+			return socket_io(env, fd, POLLIN, 0u, [&]() {
+				return read(fd, buf, count);
+			});
+		});
+	}
+
 	return read(fd, buf, count);
 }
 
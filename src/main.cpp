@@ -1,6 +1,7 @@
 #include <cstdint>
 #include <cstdio>
 #include <filesystem>
+#include <map>
 
 #include <CLI/CLI.hpp>
 #include <spdlog/spdlog.h>
@@ -35,6 +36,34 @@ int main(int argc, char** argv) {
 		->capture_default_str()
 		->check(CLI::ExistingDirectory);
 
+	std::uint32_t worker_threads = 0;
+	app.add_option("--threads", worker_threads, "maximum number of guest threads that can run at once. if 0, uses the number of host cores");
+
+	std::string shader_cache_dir = "./shader-cache/";
+	app.add_option("--shader-cache", shader_cache_dir, "path to store compiled shaders in. if empty, shaders are compiled every launch")
+		->capture_default_str();
+
+	std::string frame_log_path{};
+	app.add_option("--frame-log", frame_log_path, "path to write per frame gl stats to, as csv");
+
+	std::string gl_trace_path{};
+	app.add_option("--gl-trace", gl_trace_path, "path to record the game's gl calls to, for replaying with silene-glreplay");
+
+	std::uint32_t gl_trace_frames = 600;
+	app.add_option("--gl-trace-frames", gl_trace_frames, "number of frames to record with --gl-trace")
+		->capture_default_str();
+
+	bool coalesce_draws = false;
+	app.add_flag("--coalesce-draws", coalesce_draws, "merge consecutive draws that share state into one. mostly helps games drawing sprites one at a time");
+
+	std::string record_path{};
+	auto record_option = app.add_option("--record", record_path, "path to record the time, random numbers, socket results and input to, so the session can be played back exactly with --replay");
+
+	std::string replay_path{};
+	app.add_option("--replay", replay_path, "path to a session recorded with --record to play back. input from the frontend is ignored while replaying")
+		->check(CLI::ExistingFile)
+		->excludes(record_option);
+
 	bool show_cursor_pos = false;
 	app.add_flag("--show-cursor-pos", show_cursor_pos, "enables showing the cursor position on the info dialog. useful for making keybinds");
 
@@ -42,6 +71,33 @@ int main(int argc, char** argv) {
 	app.add_option("--keybinds", keybind_file, "path to keybind file, if unspecified keybinding is disabled")
 		->check(CLI::ExistingFile);
 
+	float render_scale = 1.0f;
+	app.add_option("--render-scale", render_scale, "size the game renders at, relative to the window. lower values are faster on weak gpus")
+		->capture_default_str()
+		->check(CLI::Range(0.25f, 2.0f));
+
+	auto upscale_filter = FrameChain::Filter::Bilinear;
+	std::map<std::string, FrameChain::Filter> filter_names{
+		{"bilinear", FrameChain::Filter::Bilinear},
+		{"sharp", FrameChain::Filter::Sharp},
+	};
+	app.add_option("--upscale-filter", upscale_filter, "filter used to scale the game up to the window. sharp sharpens on top of bilinear")
+		->transform(CLI::CheckedTransformer(filter_names, CLI::ignore_case));
+
+	auto vsync_mode = FramePacer::Mode::Vsync;
+	std::map<std::string, FramePacer::Mode> vsync_names{
+		{"on", FramePacer::Mode::Vsync},
+		{"off", FramePacer::Mode::Uncapped},
+		{"adaptive", FramePacer::Mode::Adaptive},
+	};
+	app.add_option("--vsync", vsync_mode, "when frames are presented. adaptive waits for vblank unless the frame was late, which tears instead")
+		->transform(CLI::CheckedTransformer(vsync_names, CLI::ignore_case));
+
+	double fps_limit = 60.0;
+	app.add_option("--fps-limit", fps_limit, "rate to present at. 0 leaves it to --vsync, which is unlimited when it's off")
+		->capture_default_str()
+		->check(CLI::NonNegativeNumber);
+
 	CLI11_PARSE(app, argc, argv);
 
 	if (app_resources.empty()) {
@@ -52,7 +108,7 @@ int main(int argc, char** argv) {
 		spdlog::set_level(spdlog::level::debug);
 	}
 
-	AndroidApplication application{{enable_debugging, app_resources}};
+	AndroidApplication application{{enable_debugging, app_resources, worker_threads, shader_cache_dir, frame_log_path, gl_trace_path, gl_trace_frames, coalesce_draws, record_path, replay_path}};
 
 	ZipFile apk_file{app_apk};
 
@@ -86,7 +142,10 @@ int main(int argc, char** argv) {
 	GlfwAppWindow window{application, {
 		.show_cursor_pos = show_cursor_pos,
 		.keybind_file = keybind_file,
-		.title_name = apk_path.filename().string()
+		.title_name = apk_path.filename().string(),
+		.render_scale = render_scale,
+		.upscale_filter = upscale_filter,
+		.pacing = {vsync_mode, fps_limit}
 	}};
 
 	if (!window.init()) {
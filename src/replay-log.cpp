@@ -0,0 +1,368 @@
+#include "replay-log.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+	std::uint64_t zigzag(std::int64_t value) {
+		return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+	}
+
+	std::int64_t unzigzag(std::uint64_t value) {
+		return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+	}
+}
+
+ReplayLog::Stream& ReplayLog::stream(std::int32_t id) {
+	std::scoped_lock lk{this->_streams_mutex};
+	return this->_streams[id];
+}
+
+void ReplayLog::write_chunk(std::int32_t id, Stream& stream) {
+	if (stream.data.empty()) {
+		return;
+	}
+
+	std::scoped_lock lk{this->_file_mutex};
+
+	auto size = static_cast<std::uint32_t>(stream.data.size());
+	this->_file.write(reinterpret_cast<const char*>(&id), sizeof(id));
+	this->_file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+	this->_file.write(reinterpret_cast<const char*>(stream.data.data()), size);
+
+	stream.data.clear();
+}
+
+void ReplayLog::write_varint(Stream& stream, std::uint64_t value) {
+	while (value >= 0x80) {
+		stream.data.push_back(static_cast<std::uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+
+	stream.data.push_back(static_cast<std::uint8_t>(value));
+}
+
+std::optional<std::uint64_t> ReplayLog::read_varint(Stream& stream) {
+	std::uint64_t value = 0u;
+
+	for (auto shift = 0u; shift < 64u; shift += 7) {
+		if (stream.position >= stream.data.size()) {
+			return std::nullopt;
+		}
+
+		auto byte = stream.data[stream.position++];
+		value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+
+		if ((byte & 0x80) == 0) {
+			return value;
+		}
+	}
+
+	return std::nullopt;
+}
+
+bool ReplayLog::begin_record(Stream& stream, Kind kind) {
+	if (!this->recording()) {
+		return false;
+	}
+
+	stream.data.push_back(static_cast<std::uint8_t>(kind));
+	return true;
+}
+
+void ReplayLog::end_record(std::int32_t id, Stream& stream) {
+	if (stream.data.size() >= WRITE_THRESHOLD) {
+		this->write_chunk(id, stream);
+	}
+}
+
+bool ReplayLog::begin_replay(std::int32_t id, Stream& stream, Kind kind) {
+	if (!this->replaying() || stream.diverged) {
+		return false;
+	}
+
+	if (stream.position >= stream.data.size()) {
+		this->diverge(id, stream, "ran out of recorded values");
+		return false;
+	}
+
+	if (stream.data[stream.position] != static_cast<std::uint8_t>(kind)) {
+		this->diverge(id, stream, "asked for something else than was recorded");
+		return false;
+	}
+
+	stream.position++;
+	return true;
+}
+
+void ReplayLog::diverge(std::int32_t id, Stream& stream, const char* reason) {
+	stream.diverged = true;
+	spdlog::warn("replay: thread {} {} at offset {}, it gets host values from here on", id, reason, stream.position);
+}
+
+bool ReplayLog::start_recording(const std::filesystem::path& path) {
+	this->_file = std::ofstream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!this->_file) {
+		spdlog::error("failed to open {} for recording", path.string());
+		return false;
+	}
+
+	Header header{MAGIC, VERSION};
+	this->_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	this->_mode = Mode::Record;
+
+	spdlog::info("recording session to {}", path.string());
+
+	return true;
+}
+
+bool ReplayLog::start_replay(const std::filesystem::path& path) {
+	std::ifstream file(path, std::ios::in | std::ios::binary);
+	if (!file) {
+		spdlog::error("failed to open recording at {}", path.string());
+		return false;
+	}
+
+	Header header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.magic != MAGIC || header.version != VERSION) {
+		spdlog::error("{} is not a recording this version can replay", path.string());
+		return false;
+	}
+
+	std::int32_t id;
+	std::uint32_t size;
+	while (file.read(reinterpret_cast<char*>(&id), sizeof(id)) && file.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+		auto& stream = this->_streams[id];
+
+		auto offset = stream.data.size();
+		stream.data.resize(offset + size);
+
+		if (!file.read(reinterpret_cast<char*>(stream.data.data() + offset), size)) {
+			spdlog::error("recording at {} is cut off", path.string());
+			return false;
+		}
+	}
+
+	if (auto it = this->_streams.find(INPUT_STREAM); it != this->_streams.end()) {
+		if (!this->read_inputs(it->second)) {
+			spdlog::error("recording at {} has invalid input", path.string());
+			return false;
+		}
+
+		this->_streams.erase(it);
+	}
+
+	this->_mode = Mode::Replay;
+
+	spdlog::info("replaying session from {} ({} threads, {} inputs)", path.string(), this->_streams.size(), this->_inputs.size());
+
+	return true;
+}
+
+bool ReplayLog::read_inputs(Stream& stream) {
+	while (stream.position < stream.data.size()) {
+		if (stream.data[stream.position++] != static_cast<std::uint8_t>(Kind::Input)) {
+			return false;
+		}
+
+		auto frame = read_varint(stream);
+		auto count = read_varint(stream);
+		if (!frame || !count) {
+			return false;
+		}
+
+		auto& record = this->_inputs.emplace_back();
+		record.frame = static_cast<std::uint32_t>(*frame);
+
+		for (auto i = 0u; i < *count; i++) {
+			auto type = read_varint(stream);
+			auto id = read_varint(stream);
+			auto x = read_varint(stream);
+			auto y = read_varint(stream);
+			auto keycode = read_varint(stream);
+
+			if (!type || !id || !x || !y || !keycode) {
+				return false;
+			}
+
+			auto& event = record.events.emplace_back();
+			event.type = static_cast<InputEvent::Type>(*type);
+			event.id = static_cast<std::uint32_t>(*id);
+			event.x = std::bit_cast<float>(static_cast<std::uint32_t>(*x));
+			event.y = std::bit_cast<float>(static_cast<std::uint32_t>(*y));
+			event.keycode = static_cast<int>(unzigzag(*keycode));
+		}
+
+		auto text_size = read_varint(stream);
+		if (!text_size || stream.position + *text_size > stream.data.size()) {
+			return false;
+		}
+
+		record.text.assign(reinterpret_cast<const char*>(stream.data.data() + stream.position), *text_size);
+		stream.position += *text_size;
+	}
+
+	return true;
+}
+
+void ReplayLog::finish() {
+	if (!this->recording()) {
+		return;
+	}
+
+	this->_mode = Mode::Off;
+
+	std::scoped_lock lk{this->_streams_mutex};
+	for (auto& [id, stream] : this->_streams) {
+		this->write_chunk(id, stream);
+	}
+
+	this->_file.close();
+}
+
+void ReplayLog::time(std::int32_t thread, std::timespec& ts) {
+	if (this->mode() == Mode::Off) {
+		return;
+	}
+
+	auto& stream = this->stream(thread);
+
+	if (this->begin_replay(thread, stream, Kind::Time)) {
+		auto sec = read_varint(stream);
+		auto nsec = read_varint(stream);
+		if (!sec || !nsec) {
+			this->diverge(thread, stream, "has a cut off time");
+			return;
+		}
+
+		ts.tv_sec = static_cast<decltype(ts.tv_sec)>(unzigzag(*sec));
+		ts.tv_nsec = static_cast<decltype(ts.tv_nsec)>(*nsec);
+		return;
+	}
+
+	if (this->begin_record(stream, Kind::Time)) {
+		write_varint(stream, zigzag(ts.tv_sec));
+		write_varint(stream, static_cast<std::uint64_t>(ts.tv_nsec));
+		this->end_record(thread, stream);
+	}
+}
+
+std::uint32_t ReplayLog::random(std::int32_t thread, std::uint32_t value) {
+	if (this->mode() == Mode::Off) {
+		return value;
+	}
+
+	auto& stream = this->stream(thread);
+
+	if (this->begin_replay(thread, stream, Kind::Random)) {
+		if (auto recorded = read_varint(stream); recorded) {
+			return static_cast<std::uint32_t>(*recorded);
+		}
+
+		this->diverge(thread, stream, "has a cut off random number");
+		return value;
+	}
+
+	if (this->begin_record(stream, Kind::Random)) {
+		write_varint(stream, value);
+		this->end_record(thread, stream);
+	}
+
+	return value;
+}
+
+std::optional<ReplayLog::Result> ReplayLog::replay_result(std::int32_t thread, Kind kind) {
+	if (!this->replaying()) {
+		return std::nullopt;
+	}
+
+	auto& stream = this->stream(thread);
+	if (!this->begin_replay(thread, stream, kind)) {
+		return std::nullopt;
+	}
+
+	auto value = read_varint(stream);
+	auto error = read_varint(stream);
+	auto size = read_varint(stream);
+	if (!value || !error || !size || stream.position + *size > stream.data.size()) {
+		this->diverge(thread, stream, "has a cut off result");
+		return std::nullopt;
+	}
+
+	Result result{
+		static_cast<std::int32_t>(unzigzag(*value)),
+		static_cast<std::int32_t>(unzigzag(*error)),
+		{stream.data.data() + stream.position, static_cast<std::size_t>(*size)}
+	};
+
+	stream.position += *size;
+
+	return result;
+}
+
+void ReplayLog::record_result(std::int32_t thread, Kind kind, std::int32_t value, std::int32_t error, std::span<const std::uint8_t> data) {
+	if (!this->recording()) {
+		return;
+	}
+
+	auto& stream = this->stream(thread);
+	if (!this->begin_record(stream, kind)) {
+		return;
+	}
+
+	write_varint(stream, zigzag(value));
+	write_varint(stream, zigzag(error));
+	write_varint(stream, data.size());
+
+	stream.data.insert(stream.data.end(), data.begin(), data.end());
+
+	this->end_record(thread, stream);
+}
+
+void ReplayLog::record_input(std::uint32_t frame, std::span<const InputEvent> events, std::string_view text) {
+	if (!this->recording() || events.empty()) {
+		return;
+	}
+
+	auto& stream = this->stream(INPUT_STREAM);
+	if (!this->begin_record(stream, Kind::Input)) {
+		return;
+	}
+
+	write_varint(stream, frame);
+	write_varint(stream, events.size());
+
+	for (const auto& event : events) {
+		write_varint(stream, static_cast<std::uint64_t>(event.type));
+		write_varint(stream, event.id);
+		write_varint(stream, std::bit_cast<std::uint32_t>(event.x));
+		write_varint(stream, std::bit_cast<std::uint32_t>(event.y));
+		write_varint(stream, zigzag(event.keycode));
+	}
+
+	write_varint(stream, text.size());
+	stream.data.insert(stream.data.end(), text.begin(), text.end());
+
+	this->end_record(INPUT_STREAM, stream);
+}
+
+std::span<const ReplayLog::InputRecord> ReplayLog::take_inputs(std::uint32_t frame) {
+	if (!this->replaying()) {
+		return {};
+	}
+
+	auto start = this->_next_input;
+	while (this->_next_input < this->_inputs.size() && this->_inputs[this->_next_input].frame <= frame) {
+		this->_next_input++;
+	}
+
+	return {this->_inputs.data() + start, this->_next_input - start};
+}
+
+ReplayLog::~ReplayLog() {
+	this->finish();
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#ifndef _REPLAY_LOG_HPP
+#define _REPLAY_LOG_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "input-queue.hpp"
+
+/**
+ * records every value the host hands the guest that could differ between runs (the time, random numbers, the results of
+ * socket calls and input), so that a later run can be given the same values and play out the same way.
+ *
+ * values are kept in a stream per guest thread, in the order that thread asked for them. input is kept in its own stream,
+ * by the frame it was sent before. streams are written out in chunks as they fill up, each chunk being the stream's id,
+ * the size and the bytes. every value in a stream is a one byte kind followed by its fields as leb128 varints.
+ *
+ * if a replay asks for something the recording doesn't have next, that thread has diverged and gets host values from then on
+ */
+class ReplayLog {
+public:
+	enum class Mode {
+		Off,
+		Record,
+		Replay,
+	};
+
+	enum class Kind : std::uint8_t {
+		Time,
+		Random,
+		Input,
+
+		// results of socket calls, which decide what the guest does next as much as the data does
+		Read,
+		Write,
+		Poll,
+		Connect,
+		Lookup,
+		SocketQuery,
+	};
+
+	static constexpr std::uint32_t MAGIC = 0x50524c53; // SLRP
+	static constexpr std::uint32_t VERSION = 3;
+
+	struct Header {
+		std::uint32_t magic;
+		std::uint32_t version;
+	};
+
+	static_assert(sizeof(Header) == 8);
+
+	// id of the stream that input is kept in, as guest threads only ever have positive ids
+	static constexpr std::int32_t INPUT_STREAM = -1;
+
+	// a stream is written out once it has this much
+	static constexpr std::size_t WRITE_THRESHOLD = 64 * 1024;
+
+	struct Result {
+		std::int32_t value{0};
+
+		// guest errno, if the call failed
+		std::int32_t error{0};
+
+		// whatever the call wrote out, such as the bytes read
+		std::span<const std::uint8_t> data{};
+	};
+
+	struct InputRecord {
+		std::uint32_t frame{0};
+
+		// a move is sent as all of its touches at once, everything else is a single event
+		std::vector<InputEvent> events{};
+
+		// the whole of inserted text, as an event only has room for the start of it
+		std::string text{};
+	};
+
+private:
+	struct Stream {
+		std::vector<std::uint8_t> data{};
+		std::size_t position{0u};
+		bool diverged{false};
+	};
+
+	std::atomic<Mode> _mode{Mode::Off};
+
+	// only held to find a stream, after which each thread has its own to itself
+	std::mutex _streams_mutex{};
+	std::unordered_map<std::int32_t, Stream> _streams{};
+
+	std::mutex _file_mutex{};
+	std::ofstream _file{};
+
+	std::vector<InputRecord> _inputs{};
+	std::size_t _next_input{0u};
+
+	Stream& stream(std::int32_t id);
+
+	void write_chunk(std::int32_t id, Stream& stream);
+
+	static void write_varint(Stream& stream, std::uint64_t value);
+	static std::optional<std::uint64_t> read_varint(Stream& stream);
+
+	/**
+	 * starts a value in the stream, returns false if this thread isn't being recorded
+	 */
+	bool begin_record(Stream& stream, Kind kind);
+	void end_record(std::int32_t id, Stream& stream);
+
+	/**
+	 * moves past the kind of the next value, returns false if it isn't the one expected
+	 */
+	bool begin_replay(std::int32_t id, Stream& stream, Kind kind);
+	void diverge(std::int32_t id, Stream& stream, const char* reason);
+
+	bool read_inputs(Stream& stream);
+
+public:
+	Mode mode() const {
+		return this->_mode.load(std::memory_order_relaxed);
+	}
+
+	bool recording() const {
+		return this->mode() == Mode::Record;
+	}
+
+	bool replaying() const {
+		return this->mode() == Mode::Replay;
+	}
+
+	bool start_recording(const std::filesystem::path& path);
+	bool start_replay(const std::filesystem::path& path);
+
+	/**
+	 * writes out anything left of a recording. should only be called once the guest has stopped
+	 */
+	void finish();
+
+	/**
+	 * records the time, or replaces it with the recorded one
+	 */
+	void time(std::int32_t thread, std::timespec& ts);
+
+	std::uint32_t random(std::int32_t thread, std::uint32_t value);
+
+	/**
+	 * what a call returned when it was recorded, or nothing if the host should make the call itself.
+	 * the data stays valid until the thread's next value
+	 */
+	std::optional<Result> replay_result(std::int32_t thread, Kind kind);
+	void record_result(std::int32_t thread, Kind kind, std::int32_t value, std::int32_t error, std::span<const std::uint8_t> data = {});
+
+	/**
+	 * input from the frontend, sent before frame is drawn. text is what was inserted, if anything
+	 */
+	void record_input(std::uint32_t frame, std::span<const InputEvent> events, std::string_view text = {});
+
+	/**
+	 * the recorded input to send before drawing frame. every record is only given out once
+	 */
+	std::span<const InputRecord> take_inputs(std::uint32_t frame);
+
+	~ReplayLog();
+};
+
+#endif
@@ -0,0 +1,276 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <thread>
+
+#include <pthread.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+namespace {
+	// a thread belongs to at most one scheduler, so there is no need to look it up from anywhere else
+	thread_local Scheduler* current_scheduler{nullptr};
+	thread_local std::uint32_t current_thread_id{0};
+
+	std::uint64_t thread_cpu_time_ns() {
+		std::timespec ts{};
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+		return static_cast<std::uint64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+	}
+
+	std::uint32_t host_core_count() {
+		return std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	void pin_render_thread(std::uint32_t cpu) {
+#ifdef __linux__
+		if (host_core_count() > 1) {
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+
+			if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+				spdlog::debug("failed to pin render thread to cpu {}", cpu);
+			}
+		}
+
+		// raising priority needs permission on most desktops, so it's fine if this doesn't work
+		auto tid = static_cast<id_t>(syscall(SYS_gettid));
+		if (setpriority(PRIO_PROCESS, tid, -4) != 0) {
+			spdlog::debug("failed to raise render thread priority");
+		}
+#elif defined(__APPLE__)
+		// macos doesn't have affinity, but it will keep interactive threads on the performance cores
+		pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+#endif
+	}
+
+	void keep_off_render_cpu(std::uint32_t cpu) {
+#ifdef __linux__
+		auto cores = host_core_count();
+		if (cores <= 1) {
+			return;
+		}
+
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (auto i = 0u; i < cores; i++) {
+			if (i != cpu) {
+				CPU_SET(i, &set);
+			}
+		}
+
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+	}
+}
+
+void Scheduler::acquire_slot(std::unique_lock<std::mutex>& lk, ThreadRecord& record) {
+	auto ticket = this->_next_ticket++;
+	this->_slot_cv.wait(lk, [this, ticket]() {
+		return this->_free_slots > 0 && this->_now_serving == ticket;
+	});
+
+	this->_free_slots--;
+	this->_now_serving++;
+
+	record.holds_slot = true;
+	record.stats.parked = false;
+
+	// the next ticket may also be able to run now
+	this->_slot_cv.notify_all();
+}
+
+void Scheduler::release_slot(ThreadRecord& record) {
+	if (!record.holds_slot) {
+		return;
+	}
+
+	record.holds_slot = false;
+	this->_free_slots++;
+	this->_slot_cv.notify_all();
+}
+
+void Scheduler::update_cpu_time(ThreadRecord& record) {
+	auto now = thread_cpu_time_ns();
+	record.stats.cpu_time_ns += now - record.last_cpu_ns;
+	record.last_cpu_ns = now;
+}
+
+void Scheduler::register_render_thread(std::uint32_t thread_id) {
+	pin_render_thread(this->_render_cpu);
+
+	std::scoped_lock lk{this->_lock};
+
+	auto& record = this->_threads[thread_id];
+	record = ThreadRecord{};
+	record.stats.thread_id = thread_id;
+	record.stats.render = true;
+	record.last_cpu_ns = thread_cpu_time_ns();
+
+	current_scheduler = this;
+	current_thread_id = thread_id;
+}
+
+void Scheduler::leave_render_thread() {
+	keep_off_render_cpu(this->_render_cpu);
+
+	current_scheduler = nullptr;
+	current_thread_id = 0;
+}
+
+void Scheduler::register_thread(std::uint32_t thread_id) {
+	keep_off_render_cpu(this->_render_cpu);
+
+	std::unique_lock lk{this->_lock};
+
+	auto& record = this->_threads[thread_id];
+	record = ThreadRecord{};
+	record.stats.thread_id = thread_id;
+
+	current_scheduler = this;
+	current_thread_id = thread_id;
+
+	this->acquire_slot(lk, record);
+
+	// time spent waiting for a slot doesn't count
+	record.last_cpu_ns = thread_cpu_time_ns();
+}
+
+void Scheduler::unregister_thread() {
+	if (current_scheduler != this) {
+		return;
+	}
+
+	{
+		std::scoped_lock lk{this->_lock};
+
+		auto& record = this->_threads.at(current_thread_id);
+		this->update_cpu_time(record);
+		this->release_slot(record);
+
+		this->_retired_cpu_ns += record.stats.cpu_time_ns;
+		spdlog::debug("thread {} exited after {}ms of cpu time", current_thread_id, record.stats.cpu_time_ns / 1'000'000);
+
+		this->_threads.erase(current_thread_id);
+	}
+
+	current_scheduler = nullptr;
+	current_thread_id = 0;
+}
+
+void Scheduler::yield() {
+	if (current_scheduler != this) {
+		return;
+	}
+
+	std::unique_lock lk{this->_lock};
+
+	auto& record = this->_threads.at(current_thread_id);
+	this->update_cpu_time(record);
+
+	// nobody is waiting (or this is the render thread), so there's no reason to give anything up
+	if (!record.holds_slot || this->_next_ticket == this->_now_serving) {
+		return;
+	}
+
+	record.stats.yields++;
+
+	this->release_slot(record);
+	this->acquire_slot(lk, record);
+}
+
+void Scheduler::park() {
+	if (current_scheduler != this) {
+		return;
+	}
+
+	std::scoped_lock lk{this->_lock};
+
+	auto& record = this->_threads.at(current_thread_id);
+	this->update_cpu_time(record);
+
+	if (!record.holds_slot) {
+		return;
+	}
+
+	record.stats.parks++;
+	record.stats.parked = true;
+
+	this->release_slot(record);
+}
+
+void Scheduler::unpark() {
+	if (current_scheduler != this) {
+		return;
+	}
+
+	std::unique_lock lk{this->_lock};
+
+	auto& record = this->_threads.at(current_thread_id);
+	if (!record.stats.parked) {
+		return;
+	}
+
+	this->acquire_slot(lk, record);
+	record.last_cpu_ns = thread_cpu_time_ns();
+}
+
+std::vector<Scheduler::ThreadStats> Scheduler::thread_stats() {
+	std::scoped_lock lk{this->_lock};
+
+	std::vector<ThreadStats> stats{};
+	stats.reserve(this->_threads.size());
+
+	for (const auto& [id, record] : this->_threads) {
+		stats.push_back(record.stats);
+	}
+
+	return stats;
+}
+
+std::uint64_t Scheduler::retired_cpu_time_ns() {
+	std::scoped_lock lk{this->_lock};
+	return this->_retired_cpu_ns;
+}
+
+Scheduler::ParkGuard::ParkGuard() : _scheduler{current_scheduler} {
+	if (this->_scheduler != nullptr) {
+		this->_scheduler->park();
+	}
+}
+
+Scheduler::ParkGuard::~ParkGuard() {
+	if (this->_scheduler != nullptr) {
+		this->_scheduler->unpark();
+	}
+}
+
+Scheduler* Scheduler::current() {
+	return current_scheduler;
+}
+
+Scheduler::Scheduler(std::uint32_t worker_count) {
+	auto cores = host_core_count();
+
+	if (worker_count == 0) {
+		worker_count = std::max(cores - 1, 1u);
+	}
+
+	this->_worker_count = worker_count;
+	this->_free_slots = worker_count;
+
+	// higher numbered cores tend to be the faster ones on big.LITTLE systems
+	this->_render_cpu = cores - 1;
+
+	spdlog::info("scheduler: {} worker slots on {} host cores", worker_count, cores);
+}
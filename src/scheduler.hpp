@@ -0,0 +1,144 @@
+#pragma once
+
+#ifndef _SCHEDULER_HPP
+#define _SCHEDULER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * limits how many guest threads are allowed to execute at once.
+ *
+ * every guest thread keeps its own host thread (nested guest calls need a real host stack to unwind through),
+ * but it has to hold one of a fixed number of run slots while it is executing guest code.
+ * threads give up their slot when they block (futex, poll, join) and when they yield between jit slices,
+ * so a blocked thread never holds a core and a busy one can't starve the rest.
+ *
+ * the render thread does not take a slot. it gets a core of its own, and is pinned/prioritized where possible
+ */
+class Scheduler {
+public:
+	struct ThreadStats {
+		std::uint32_t thread_id{0};
+		bool render{false};
+		bool parked{false};
+		std::uint64_t cpu_time_ns{0};
+		std::uint64_t yields{0};
+		std::uint64_t parks{0};
+	};
+
+private:
+	struct ThreadRecord {
+		ThreadStats stats{};
+
+		// cpu clock reading at the last time stats were updated
+		std::uint64_t last_cpu_ns{0};
+		bool holds_slot{false};
+	};
+
+	std::mutex _lock{};
+	std::condition_variable _slot_cv{};
+
+	std::uint32_t _worker_count;
+	std::uint32_t _free_slots;
+
+	// slots are handed out first come first serve, otherwise a yielding thread could immediately take its slot back
+	std::uint64_t _next_ticket{0};
+	std::uint64_t _now_serving{0};
+
+	std::uint32_t _render_cpu{0};
+
+	std::unordered_map<std::uint32_t, ThreadRecord> _threads{};
+
+	// stats for threads that have already exited
+	std::uint64_t _retired_cpu_ns{0};
+
+	void acquire_slot(std::unique_lock<std::mutex>& lk, ThreadRecord& record);
+	void release_slot(ThreadRecord& record);
+
+	void update_cpu_time(ThreadRecord& record);
+
+public:
+	/**
+	 * marks the calling host thread as the render thread.
+	 * it is pinned to its own core and does not compete for run slots
+	 */
+	void register_render_thread(std::uint32_t thread_id);
+
+	/**
+	 * the calling thread is done rendering, as another thread is about to take over.
+	 * it's kept off the render core from now on, and must not run guest code afterwards
+	 */
+	void leave_render_thread();
+
+	/**
+	 * registers the calling host thread as a guest thread, then blocks until it is allowed to run
+	 */
+	void register_thread(std::uint32_t thread_id);
+
+	/**
+	 * gives up the slot held by the calling thread, should be called before it exits
+	 */
+	void unregister_thread();
+
+	/**
+	 * lets another thread run if one is waiting. no-op if nobody is waiting or if the thread is not managed
+	 */
+	void yield();
+
+	/**
+	 * gives up the run slot for a thread that is about to block on the host
+	 */
+	void park();
+
+	/**
+	 * waits for a run slot after a blocking operation has returned
+	 */
+	void unpark();
+
+	/**
+	 * returns a snapshot of every live thread
+	 */
+	std::vector<ThreadStats> thread_stats();
+
+	/**
+	 * total cpu time used by guest threads that have already exited
+	 */
+	std::uint64_t retired_cpu_time_ns();
+
+	std::uint32_t worker_count() const {
+		return this->_worker_count;
+	}
+
+	/**
+	 * parks the current thread for the lifetime of the guard, if it belongs to a scheduler
+	 */
+	class ParkGuard {
+		Scheduler* _scheduler;
+
+	public:
+		ParkGuard();
+		~ParkGuard();
+
+		ParkGuard(const ParkGuard&) = delete;
+		ParkGuard& operator=(const ParkGuard&) = delete;
+	};
+
+	/**
+	 * returns the scheduler that owns the calling host thread, or nullptr if it is not managed
+	 */
+	static Scheduler* current();
+
+	/**
+	 * worker_count of 0 picks one slot per host core, minus one for the render thread
+	 */
+	Scheduler(std::uint32_t worker_count = 0);
+
+	Scheduler(const Scheduler&) = delete;
+	Scheduler& operator=(const Scheduler&) = delete;
+};
+
+#endif
@@ -1,5 +1,9 @@
 #include "sdl-window.h"
 #include "android-application.hpp"
+#include "gl/gl-extensions.hpp"
+
+#include <algorithm>
+#include <cmath>
 
 #include <imgui.h>
 #include <backends/imgui_impl_sdl3.h>
@@ -40,12 +44,34 @@ bool SdlAppWindow::init() {
 		return false;
 	}
 
-	if (!SDL_GL_SetSwapInterval(-1)) {
-		if (!SDL_GL_SetSwapInterval(1)) {
+	// the guest renders on a context of its own that shares the window's objects
+	SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+
+	_emulation_window = SDL_CreateWindow("", 1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+	if (_emulation_window != nullptr) {
+		_emulation_context = SDL_GL_CreateContext(_emulation_window);
+	}
+
+	if (_emulation_context == nullptr) {
+		spdlog::info("failed to create the emulation context: {}", SDL_GetError());
+		return false;
+	}
+
+	// creating the context made it current
+	SDL_GL_MakeCurrent(window, glContext);
+
+	if (!SDL_GL_SetSwapInterval(_pacer.swap_interval())) {
+		if (_pacer.mode() != FramePacer::Mode::Adaptive) {
+			spdlog::warn("Failed to set the swap interval: {}", SDL_GetError());
+		} else if (!SDL_GL_SetSwapInterval(1)) {
 			spdlog::warn("Failed to enable vertical sync: {}", SDL_GetError());
 		}
 	}
 
+	if (auto mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(window)); mode != nullptr) {
+		_pacer.set_refresh_rate(mode->refresh_rate);
+	}
+
 #ifndef SILENE_USE_EGL
 	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(SDL_GL_GetProcAddress))) {
 		spdlog::error("Failed to initialize GLAD: {}", SDL_GetError());
@@ -53,6 +79,8 @@ bool SdlAppWindow::init() {
 	}
 #endif
 
+	GlExtensions::load(reinterpret_cast<GlExtensions::ProcLoader>(SDL_GL_GetProcAddress));
+
 	auto vendor = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
 	auto renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
 	auto version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
@@ -95,10 +123,11 @@ void SdlAppWindow::handle_key(SDL_KeyboardEvent& event) {
 		if (auto touch = _keybind_manager->handle(key_name)) {
 			auto [x, y] = touch.value();
 
-			application().send_touch(event.down, {
+			// keybinds are in window pixels, like the cursor position shown in the overlay
+			_emulation.send_touch(event.down, {
 				1,
-				static_cast<float>(x),
-				static_cast<float>(y)
+				static_cast<float>(x * _config.render_scale),
+				static_cast<float>(y * _config.render_scale)
 			});
 
 			return;
@@ -111,18 +140,18 @@ void SdlAppWindow::handle_key(SDL_KeyboardEvent& event) {
 
 	switch (event.key) {
 		case SDLK_BACKSPACE:
-			application().send_ime_delete();
+			_emulation.send_ime_delete();
 			break;
 		case SDLK_ESCAPE:
-			application().send_keydown(4 /* AKEYCODE_BACK */);
+			_emulation.send_keydown(4 /* AKEYCODE_BACK */);
 			break;
 		case SDLK_SPACE:
-			application().send_ime_insert(" ");
+			_emulation.send_ime_insert(" ");
 			break;
 		default: {
 			auto key_name = SDL_GetKeyName(event.key);
 
-			application().send_ime_insert(key_name);
+			_emulation.send_ime_insert(key_name);
 			break;
 		}
 	}
@@ -144,21 +173,21 @@ void SdlAppWindow::handle_event(SDL_Event* event) {
 				return;
 			}
 
-			application().send_touch(button.down, {
+			_emulation.send_touch(button.down, {
 				1,
-				static_cast<float>(button.x * _scale_x),
-				static_cast<float>(button.y * _scale_y)
+				static_cast<float>(button.x * _scale_x * _config.render_scale),
+				static_cast<float>(button.y * _scale_y * _config.render_scale)
 			});
 
 			break;
 		}
 		case SDL_EVENT_MOUSE_MOTION: {
 			auto& motion = event->motion;
-			application().move_touches({{
+			_emulation.move_touch({
 				1,
-				static_cast<float>(motion.x * _scale_x),
-				static_cast<float>(motion.y * _scale_y)
-			}});
+				static_cast<float>(motion.x * _scale_x * _config.render_scale),
+				static_cast<float>(motion.y * _scale_y * _config.render_scale)
+			});
 			break;
 		}
 		case SDL_EVENT_KEY_DOWN:
@@ -170,28 +199,42 @@ void SdlAppWindow::handle_event(SDL_Event* event) {
 }
 
 void SdlAppWindow::on_quit() {
+	auto frame_times = _pacer.frame_times();
+	spdlog::info("present times: median {:.2f}ms, p95 {:.2f}ms, p99 {:.2f}ms, max {:.2f}ms", frame_times.median, frame_times.p95, frame_times.p99, frame_times.max);
+
+	_emulation.stop();
+	application().frame_chain().destroy_present();
+
+	SDL_GL_DestroyContext(_emulation_context);
+	SDL_DestroyWindow(_emulation_window);
+
+	_emulation_context = nullptr;
+	_emulation_window = nullptr;
+
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplSDL3_Shutdown();
 	ImGui::DestroyContext();
 }
 
 void SdlAppWindow::main_loop() {
-	auto current_tick = SDL_GetTicks();
-	auto tick_difference = current_tick - _last_tick;
-	if (tick_difference >= 1000) {
-		_last_tick = SDL_GetTicks();
-		_fps = static_cast<float>(_frame_counter * 1000) / tick_difference;
-		_frame_counter = 0;
-	} else {
-		_frame_counter++;
-	}
-
 	if (_is_first_frame) {
 		int width, height;
 		SDL_GetWindowSizeInPixels(_window, &width, &height);
 
-		application().init_game(width, height);
+		auto render_width = std::max(static_cast<int>(std::lround(width * _config.render_scale)), 1);
+		auto render_height = std::max(static_cast<int>(std::lround(height * _config.render_scale)), 1);
+
+		application().frame_chain().set_filter(_config.upscale_filter);
+
+		// the game runs on its own thread from here on, this one only handles events and presents
+		_emulation.start(render_width, render_height, [this]() {
+			SDL_GL_MakeCurrent(_emulation_window, _emulation_context);
+		}, [this]() {
+			SDL_GL_MakeCurrent(_emulation_window, nullptr);
+		});
+
 		_is_first_frame = false;
+		_pacer.start();
 	}
 
 	ImGui_ImplOpenGL3_NewFrame();
@@ -200,7 +243,7 @@ void SdlAppWindow::main_loop() {
 
 	ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_Always, ImVec2(0.0f, 0.0f));
 	if (ImGui::Begin("Info Dialog", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_AlwaysAutoResize)) {
-		ImGui::Text("FPS: %.0f", _fps);
+		draw_frame_info(_emulation.last_frame(), _pacer.frame_times());
 
 		if (_config.show_cursor_pos) {
 			float xpos, ypos;
@@ -214,12 +257,16 @@ void SdlAppWindow::main_loop() {
 
 	ImGui::Render();
 
-	application().draw_frame();
+	int display_width, display_height;
+	SDL_GetWindowSizeInPixels(_window, &display_width, &display_height);
+	application().frame_chain().present(display_width, display_height);
 
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
 	SDL_GL_SwapWindow(_window);
+
+	_pacer.wait();
 }
 
 SdlAppWindow::SdlAppWindow(std::unique_ptr<AndroidApplication>&& app, WindowConfig config)
-	: BaseWindow(*app), _config{config}, _application{std::move(app)} {}
+	: BaseWindow(*app), _config{config}, _pacer{config.pacing}, _application{std::move(app)}, _emulation{*_application} {}
@@ -16,31 +16,43 @@
 #include "base-window.hpp"
 #include "keybind-manager.hpp"
 #include "android-application.hpp"
+#include "emulation-thread.hpp"
+#include "frame-pacer.hpp"
 
 class SdlAppWindow : public BaseWindow {
 	struct WindowConfig {
 		bool show_cursor_pos{false};
 		std::string keybind_file{};
 		std::string title_name{};
+
+		// size the guest renders at, relative to the window
+		float render_scale{1.0f};
+		FrameChain::Filter upscale_filter{FrameChain::Filter::Bilinear};
+
+		FramePacer::Config pacing{};
 	};
 
 	WindowConfig _config;
+	FramePacer _pacer;
 
 	SDL_Window* _window{nullptr};
 	bool _is_first_frame{false};
 
 	std::unique_ptr<KeybindManager> _keybind_manager{nullptr};
 
+	// never shown, the guest's context needs a window to be current with
+	SDL_Window* _emulation_window{nullptr};
+	SDL_GLContext _emulation_context{nullptr};
+
 	// store it here as it gets deleted from main
 	std::unique_ptr<AndroidApplication> _application;
 
+	// after the application, so the thread is stopped before it goes away
+	EmulationThread _emulation;
+
 	float _scale_x{0.0f};
 	float _scale_y{0.0f};
 
-	float _fps{};
-	std::uint32_t _frame_counter{};
-	std::uint64_t _last_tick{};
-
 	void handle_key(SDL_KeyboardEvent& event);
 
 public:
@@ -13,6 +13,8 @@ void SyscallHandler::on_symbol_call(Environment& env) {
 
 	spdlog::trace("resolve symbol: pc = {:#08x}, lr = {:#08x}, r12 = {:#08x}", pc, lr, got);
 
+	env.counters().symbol_calls.fetch_add(1, std::memory_order_relaxed);
+
 	try {
 		auto fn_ptr = this->fns.at(pc);
 		fn_ptr(env);
@@ -30,6 +32,8 @@ void SyscallHandler::on_kernel_call(Environment& env) {
 	auto call_number = env.current_cpu()->Regs()[7];
 	spdlog::trace("resolve kernel: call = {:#08x}", call_number);
 
+	env.counters().kernel_calls.fetch_add(1, std::memory_order_relaxed);
+
 	try {
 		auto fn_ptr = this->_kernel_fns.at(call_number);
 		fn_ptr(env);
@@ -79,7 +83,7 @@ std::uint32_t SyscallHandler::replace_fn(std::uint32_t addr, HandlerFunction fn)
 
 	// non thumb
 	this->_memory.write_word(addr, 0xef000002);
-	this->_memory.write_word(addr, 0xe12fff1e);
+	this->_memory.write_word(addr + 4, 0xe12fff1e);
 	this->fns[addr + 4] = fn;
 
 	return addr;